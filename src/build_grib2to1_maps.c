@@ -0,0 +1,296 @@
+/*
+** File: build_grib2to1_maps.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to compile the GRIB2 to GRIB1 parameter, level and time range maps
+**          (tables/parameters/GRIB2/GRIB2_to_GRIB1.txt,
+**          tables/GRIB2_to_GRIB1_levels.txt and
+**          tables/GRIB2_to_GRIB1_time_ranges.txt) into the C tables that
+**          grib2to1.c includes (grib2to1_maps.c)
+**
+** Usage:
+**   build_grib2to1_maps parameter_map level_map time_range_map c_file
+**      checks every line of the three maps and writes the tables to 'c_file';
+**        the new file replaces any old one with a rename, so a failed run
+**        leaves the old tables in place
+**
+** Notes:   1) The maps are kept as tables, not as code, so that new centers,
+**             levels and processes are added to tables/ without editing
+**             grib2to1.c; the generated file is committed with the maps, so
+**             that grib2to1.c can still be compiled on its own.
+**
+**          2) A map that has two lines with the same key (the same parameter,
+**             level or process for the same center) is rejected here, so
+**             grib2to1.c can build its perfect hashes without checking for
+**             duplicates.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MAX_COLUMNS 8
+
+/* MapSpec describes the columns of one map
+**   name:         the name of the C table
+**   type:         the C type of an entry of the table
+**   what:         what a line maps, for the messages
+**   num_columns:  the number of columns
+**   num_ints:     the number of leading integer columns; the rest are real
+**   num_keys:     the number of leading columns that make up the key
+**   column_names: the name of each column
+**   min, max:     the range of each integer column
+*/
+typedef struct {
+  const char *name,*type,*what;
+  int num_columns,num_ints,num_keys;
+  const char *column_names[MAX_COLUMNS];
+  int min[MAX_COLUMNS],max[MAX_COLUMNS];
+} MapSpec;
+
+const MapSpec PARAMETER_SPEC={"PARAMETER_MAP","ParameterMapEntry","parameter",6,6,4,{"discipline","category","number","center","table version","parameter code"},{0,0,0,-1,0,0},{255,255,255,255,255,255}};
+const MapSpec LEVEL_SPEC={"LEVEL_MAP","LevelMapEntry","level",8,4,3,{"level type","layer","center","GRIB1 level type","offset","mul1","mul2","div"},{0,0,-1,0},{255,1,255,255}};
+const MapSpec TIME_RANGE_SPEC={"TIME_RANGE_MAP","TimeRangeMapEntry","process",4,4,3,{"process","number of ranges","center","time range indicator"},{0,1,-1,0},{255,3,255,255}};
+
+/* MapLine is one line of a map
+**   values: the value of each column
+**   line:   the line number in the map file
+*/
+typedef struct {
+  double values[MAX_COLUMNS];
+  size_t line;
+} MapLine;
+
+/* Map is a map that has been read
+*/
+typedef struct {
+  const MapSpec *spec;
+  const char *path;
+  MapLine *lines;
+  size_t num_lines;
+} Map;
+
+int num_keys;
+
+int compare_keys(const void *a,const void *b)
+{
+  const MapLine *la=(const MapLine *)a,*lb=(const MapLine *)b;
+  for (int n=0; n < num_keys; ++n) {
+    if (la->values[n] != lb->values[n]) {
+	return (la->values[n] < lb->values[n]) ? -1 : 1;
+    }
+  }
+  return (la->line < lb->line) ? -1 : (la->line > lb->line);
+}
+
+/* bad_line rejects a line that doesn't have the columns of its map
+*/
+void bad_line(const Map *map,size_t line_num)
+{
+  const MapSpec *spec=map->spec;
+  if (spec->num_ints == spec->num_columns) {
+    fprintf(stderr,"Error: %s, line %zu: expected %d integers\n",map->path,line_num,spec->num_columns);
+  }
+  else {
+    fprintf(stderr,"Error: %s, line %zu: expected %d numbers, the first %d of them integers\n",map->path,line_num,spec->num_columns,spec->num_ints);
+  }
+  exit(1);
+}
+
+/* read_map reads and checks the lines of a map
+*/
+void read_map(Map *map)
+{
+  const MapSpec *spec=map->spec;
+  FILE *fp;
+  if ( (fp=fopen(map->path,"r")) == NULL) {
+    fprintf(stderr,"Error opening %s\n",map->path);
+    exit(1);
+  }
+  size_t capacity=0,line_num=0;
+  char line[1024];
+  map->lines=NULL;
+  map->num_lines=0;
+  while (fgets(line,sizeof(line),fp) != NULL) {
+    ++line_num;
+    char *p=line;
+    while (*p == ' ' || *p == '\t') {
+	++p;
+    }
+    if (*p == '#' || *p == '\n' || *p == '\0') {
+	continue;
+    }
+    if (map->num_lines == capacity) {
+	capacity= (capacity > 0) ? 2*capacity : 256;
+	MapLine *new_lines=(MapLine *)realloc(map->lines,capacity*sizeof(MapLine));
+	if (new_lines == NULL) {
+	  fprintf(stderr,"Error allocating the %s map\n",spec->what);
+	  exit(1);
+	}
+	map->lines=new_lines;
+    }
+    MapLine *l=&map->lines[map->num_lines];
+    for (int n=0; n < spec->num_columns; ++n) {
+	char *end;
+	errno=0;
+	if (n < spec->num_ints) {
+	  long value=strtol(p,&end,10);
+	  if (end != p && (value < spec->min[n] || value > spec->max[n])) {
+	    fprintf(stderr,"Error: %s, line %zu: %s %ld is out of range\n",map->path,line_num,spec->column_names[n],value);
+	    exit(1);
+	  }
+	  l->values[n]=value;
+	}
+	else {
+	  l->values[n]=strtod(p,&end);
+	}
+	if (end == p || errno != 0 || (*end != ' ' && *end != '\t' && *end != '\n' && *end != '\0')) {
+	  bad_line(map,line_num);
+	}
+	p=end;
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\n') {
+	++p;
+    }
+    if (*p != '\0') {
+	bad_line(map,line_num);
+    }
+    if (spec == &LEVEL_SPEC && l->values[7] == 0.) {
+	fprintf(stderr,"Error: %s, line %zu: div can't be 0\n",map->path,line_num);
+	exit(1);
+    }
+    l->line=line_num;
+    ++map->num_lines;
+  }
+  fclose(fp);
+  if (map->num_lines == 0) {
+    fprintf(stderr,"Error: %s has no lines\n",map->path);
+    exit(1);
+  }
+}
+
+/* check_duplicates rejects a map that has two lines with the same key
+*/
+void check_duplicates(const Map *map)
+{
+  MapLine *sorted=(MapLine *)malloc(map->num_lines*sizeof(MapLine));
+  if (sorted == NULL) {
+    fprintf(stderr,"Error allocating the %s map\n",map->spec->what);
+    exit(1);
+  }
+  memcpy(sorted,map->lines,map->num_lines*sizeof(MapLine));
+  num_keys=map->spec->num_keys;
+  qsort(sorted,map->num_lines,sizeof(MapLine),compare_keys);
+  for (size_t n=1; n < map->num_lines; ++n) {
+    if (memcmp(sorted[n].values,sorted[n-1].values,num_keys*sizeof(double)) == 0) {
+	fprintf(stderr,"Error: %s, lines %zu and %zu map the same %s for the same center\n",map->path,sorted[n-1].line,sorted[n].line,map->spec->what);
+	exit(1);
+    }
+  }
+  free(sorted);
+}
+
+/* write_value writes one value of a table in a field of 'width' characters;
+**   whole real values keep the trailing '.' of a double constant
+*/
+void write_value(FILE *fp,const MapSpec *spec,int column,double value,int width)
+{
+  char buf[64];
+  if (column < spec->num_ints) {
+    snprintf(buf,sizeof(buf),"%d",(int)value);
+  }
+  else if (value > -1.e15 && value < 1.e15 && value == (double)(long long)value) {
+    snprintf(buf,sizeof(buf),"%lld.",(long long)value);
+  }
+  else {
+    snprintf(buf,sizeof(buf),"%.17g",value);
+  }
+  fprintf(fp,"%*s",width,buf);
+}
+
+/* write_table writes one map as a C table
+*/
+void write_table(FILE *fp,const Map *map,const char *comment,const int *widths)
+{
+  const MapSpec *spec=map->spec;
+  fprintf(fp,"const %s %s[]={\n",spec->type,spec->name);
+  fprintf(fp,"// %s\n",comment);
+  for (size_t n=0; n < map->num_lines; ++n) {
+    fprintf(fp,"  {");
+    for (int m=0; m < spec->num_columns; ++m) {
+	write_value(fp,spec,m,map->lines[n].values[m],widths[m]);
+	if (m+1 < spec->num_columns) {
+	  fprintf(fp,",");
+	}
+    }
+    fprintf(fp,"}%s\n",(n+1 < map->num_lines) ? "," : "");
+  }
+  fprintf(fp,"};\n\n");
+}
+
+/* write_maps writes the C tables to a temporary file and renames it to 'path'
+*/
+void write_maps(const Map *maps,const char *path)
+{
+  char *tmp_path=(char *)malloc(strlen(path)+32);
+  sprintf(tmp_path,"%s.tmp.%d",path,(int)getpid());
+  FILE *fp;
+  if ( (fp=fopen(tmp_path,"w")) == NULL) {
+    fprintf(stderr,"Error opening %s for output\n",tmp_path);
+    exit(1);
+  }
+  const char *name=strrchr(path,'/');
+  name= (name == NULL) ? path : name+1;
+  fprintf(fp,"/*\n");
+  fprintf(fp,"** File: %s\n",name);
+  fprintf(fp,"**\n");
+  fprintf(fp,"** Generated by build_grib2to1_maps from %s,\n",maps[0].path);
+  fprintf(fp,"**   %s and %s;\n",maps[1].path,maps[2].path);
+  fprintf(fp,"**   do not edit - change the maps and run build_grib2to1_maps again\n");
+  fprintf(fp,"*/\n");
+  fprintf(fp,"#ifndef GRIB2TO1_MAPS_C\n");
+  fprintf(fp,"#define GRIB2TO1_MAPS_C\n\n");
+  const int parameter_widths[6]={3,3,3,3,4,3};
+  write_table(fp,&maps[0],"discipline category number center, table_version parameter_code",parameter_widths);
+  const int level_widths[8]={3,1,2,4,5,11,5,5};
+  write_table(fp,&maps[1],"lvl1_type layer center, level_type offset mul1 mul2 div",level_widths);
+  const int time_range_widths[4]={3,1,2,4};
+  write_table(fp,&maps[2],"proc_code num_ranges center, t_range",time_range_widths);
+  fprintf(fp,"#endif\n");
+  if (fclose(fp) != 0) {
+    fprintf(stderr,"Error writing %s\n",tmp_path);
+    exit(1);
+  }
+  if (rename(tmp_path,path) != 0) {
+    fprintf(stderr,"Error renaming %s to %s: %s\n",tmp_path,path,strerror(errno));
+    unlink(tmp_path);
+    exit(1);
+  }
+  printf("%s: %zu parameters, %zu levels, %zu time ranges\n",path,maps[0].num_lines,maps[1].num_lines,maps[2].num_lines);
+  free(tmp_path);
+}
+
+int main(int argc,char **argv)
+{
+  if (argc != 5) {
+    fprintf(stderr,"usage: %s parameter_map level_map time_range_map c_file\n",argv[0]);
+    exit(1);
+  }
+  Map maps[3]={
+    {&PARAMETER_SPEC,argv[1],NULL,0},
+    {&LEVEL_SPEC,argv[2],NULL,0},
+    {&TIME_RANGE_SPEC,argv[3],NULL,0}
+  };
+  for (size_t n=0; n < 3; ++n) {
+    read_map(&maps[n]);
+    check_duplicates(&maps[n]);
+  }
+  write_maps(maps,argv[4]);
+  for (size_t n=0; n < 3; ++n) {
+    free(maps[n].lines);
+  }
+  return 0;
+}
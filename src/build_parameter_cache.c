@@ -0,0 +1,644 @@
+/*
+** File: build_parameter_cache.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to compile the XML GRIB2 parameter tables into a parameter cache
+**          (see parameter_cache.c), and to look up parameters in a cache
+**
+** Usage:
+**   build_parameter_cache tables_directory cache_file
+**      compiles every GRIB2 table (WMO_GRIB2.*.xml) under 'tables_directory'
+**        (e.g. tables/parameters), and its sub-directories, into
+**        'cache_file'; the new cache replaces any old one with a rename, so
+**        programs that have the old one open keep working
+**   build_parameter_cache -q cache_file center sub_center master_version
+**                         local_version discipline category number
+**      prints the metadata of a parameter from 'cache_file'
+**
+** The tables identify themselves with their <center> and <table> elements; a
+**   WMO master table, which has neither, takes its version from its name
+**   (WMO_GRIB2.<master>-<local>.xml).
+**
+** The XML reader only understands what the parameter tables use: elements,
+**   attributes in double quotes, text, comments, the XML declaration, and the
+**   five predefined entities.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "parameter_cache.c"
+
+/* StringPool interns strings: each distinct string is stored once
+**   buffer:   the strings, each ending with a null; offset 0 is ""
+**   len:      the length of the strings in 'buffer'
+**   capacity: the capacity of 'buffer'
+**   slots:    an open addressing hash of string offsets; 0 is an empty slot
+**   num_slots, num_strings: the size of 'slots' and the number of strings
+*/
+typedef struct {
+  char *buffer;
+  size_t len,capacity;
+  uint32_t *slots;
+  size_t num_slots,num_strings;
+} StringPool;
+
+/* TableData is a parameter table as it is read
+**   center, sub_center, master_ver, local_ver: as in ParameterCacheTable
+**   title:       the string offset of the title
+**   path:        the file that the table was read from
+**   first_entry: the index in 'entries' of the table's first entry
+**   num_entries: the number of entries read from the table
+*/
+typedef struct {
+  int center,sub_center,master_ver,local_ver;
+  uint32_t title;
+  char *path;
+  size_t first_entry,num_entries;
+} TableData;
+
+/* Builder holds everything that has been read from the tables
+*/
+typedef struct {
+  StringPool pool;
+  TableData *tables;
+  size_t num_tables,tables_capacity;
+  ParameterCacheEntry *entries;
+  size_t num_entries,entries_capacity;
+  ParameterCacheKeyword *keywords;
+  size_t num_keywords,keywords_capacity;
+} Builder;
+
+void *grow_array(void *array,size_t *capacity,size_t needed,size_t size)
+{
+  if (needed > *capacity) {
+    *capacity= (*capacity == 0) ? 64 : *capacity*2;
+    if (*capacity < needed) {
+	*capacity=needed;
+    }
+    array=realloc(array,*capacity*size);
+    if (array == NULL) {
+	fprintf(stderr,"Error: unable to allocate memory\n");
+	exit(1);
+    }
+  }
+  return array;
+}
+
+uint32_t hash_string(const char *s,size_t len)
+{
+  uint32_t h=2166136261u;
+  for (size_t n=0; n < len; ++n) {
+    h=(h ^ (unsigned char)s[n])*16777619u;
+  }
+  return h;
+}
+
+void initialize_pool(StringPool *pool)
+{
+  pool->capacity=65536;
+  pool->buffer=(char *)malloc(pool->capacity);
+  pool->buffer[0]='\0';
+  pool->len=1;
+  pool->num_slots=4096;
+  pool->slots=(uint32_t *)calloc(pool->num_slots,sizeof(uint32_t));
+  pool->num_strings=0;
+}
+
+/* intern_string returns the offset of 's' in the pool, adding it if it isn't
+**   already there
+*/
+uint32_t intern_string(StringPool *pool,const char *s,size_t len)
+{
+  if (len == 0) {
+    return 0;
+  }
+  if ((pool->num_strings+1)*2 > pool->num_slots) {
+// keep the hash at most half full
+    size_t num_slots=pool->num_slots*2;
+    uint32_t *slots=(uint32_t *)calloc(num_slots,sizeof(uint32_t));
+    for (size_t n=0; n < pool->num_slots; ++n) {
+	if (pool->slots[n] != 0) {
+	  const char *p=&pool->buffer[pool->slots[n]];
+	  size_t m=hash_string(p,strlen(p)) & (num_slots-1);
+	  while (slots[m] != 0) {
+	    m=(m+1) & (num_slots-1);
+	  }
+	  slots[m]=pool->slots[n];
+	}
+    }
+    free(pool->slots);
+    pool->slots=slots;
+    pool->num_slots=num_slots;
+  }
+  size_t m=hash_string(s,len) & (pool->num_slots-1);
+  while (pool->slots[m] != 0) {
+    const char *p=&pool->buffer[pool->slots[m]];
+    if (strncmp(p,s,len) == 0 && p[len] == '\0') {
+	return pool->slots[m];
+    }
+    m=(m+1) & (pool->num_slots-1);
+  }
+  if (pool->len+len+1 > UINT32_MAX) {
+    fprintf(stderr,"Error: the string pool is too large\n");
+    exit(1);
+  }
+  pool->buffer=(char *)grow_array(pool->buffer,&pool->capacity,pool->len+len+1,1);
+  uint32_t off=pool->len;
+  memcpy(&pool->buffer[off],s,len);
+  pool->buffer[off+len]='\0';
+  pool->len+=len+1;
+  pool->slots[m]=off;
+  ++pool->num_strings;
+  return off;
+}
+
+/* decode_text replaces the predefined entities in 'text' (in place), trims
+**   leading and trailing white space, and returns the new length
+*/
+size_t decode_text(char *text,size_t len)
+{
+  static const char *entities[5]={"&amp;","&lt;","&gt;","&quot;","&apos;"};
+  static const char chars[5]={'&','<','>','"','\''};
+  size_t out=0;
+  for (size_t n=0; n < len; ) {
+    if (text[n] == '&') {
+	size_t e=0;
+	while (e < 5 && strncmp(&text[n],entities[e],strlen(entities[e])) != 0) {
+	  ++e;
+	}
+	if (e < 5) {
+	  text[out++]=chars[e];
+	  n+=strlen(entities[e]);
+	  continue;
+	}
+    }
+    text[out++]=text[n++];
+  }
+  size_t start=0;
+  while (start < out && (text[start] == ' ' || text[start] == '\t' || text[start] == '\n' || text[start] == '\r')) {
+    ++start;
+  }
+  while (out > start && (text[out-1] == ' ' || text[out-1] == '\t' || text[out-1] == '\n' || text[out-1] == '\r')) {
+    --out;
+  }
+  memmove(text,&text[start],out-start);
+  return out-start;
+}
+
+/* get_attribute copies the value of attribute 'name' from the attributes of a
+**   start tag into 'value' and returns 1, or returns 0 if the tag doesn't have
+**   it
+*/
+int get_attribute(const char *attrs,size_t attrs_len,const char *name,char *value,size_t value_size)
+{
+  size_t name_len=strlen(name);
+  for (size_t n=0; n+name_len+2 <= attrs_len; ++n) {
+    if ((n == 0 || attrs[n-1] == ' ' || attrs[n-1] == '\t' || attrs[n-1] == '\n') && strncmp(&attrs[n],name,name_len) == 0 && attrs[n+name_len] == '=' && attrs[n+name_len+1] == '"') {
+	const char *start=&attrs[n+name_len+2];
+	const char *end=memchr(start,'"',attrs_len-(start-attrs));
+	if (end == NULL || (size_t)(end-start) >= value_size) {
+	  return 0;
+	}
+	memcpy(value,start,end-start);
+	value[end-start]='\0';
+	return 1;
+    }
+  }
+  return 0;
+}
+
+/* parse_level_condition parses an 'ifLevelType' condition, which is a level
+**   type ("103") or a layer ("106-106")
+*/
+void parse_level_condition(const char *cond,ParameterCacheKeyword *k,const char *path)
+{
+  int lvl1,lvl2;
+  int n=sscanf(cond,"%d-%d",&lvl1,&lvl2);
+  if (n < 1 || lvl1 < 0 || lvl1 > 254 || (n == 2 && (lvl2 < 0 || lvl2 > 254))) {
+    fprintf(stderr,"Error: bad ifLevelType \"%s\" in %s\n",cond,path);
+    exit(1);
+  }
+  k->lvl1_type=lvl1;
+  k->lvl2_type= (n == 2) ? lvl2 : 255;
+}
+
+/* parse_code returns the value of a 'code' attribute, or -1 if it isn't a code;
+**   a parameter code can also be written in full ("0.14.192"), as long as it
+**   agrees with the discipline and category that it is in
+*/
+int parse_code(const char *value,int discipline,int category)
+{
+  int d,c,code;
+  char extra;
+  if (sscanf(value,"%d%c",&code,&extra) == 1) {
+    return (code >= 0 && code <= 255) ? code : -1;
+  }
+  if (sscanf(value,"%d.%d.%d%c",&d,&c,&code,&extra) == 3 && d == discipline && c == category) {
+    return (code >= 0 && code <= 255) ? code : -1;
+  }
+  return -1;
+}
+
+int table_id_from_name(const char *path,TableData *t)
+{
+  const char *name=strrchr(path,'/');
+  name= (name == NULL) ? path : name+1;
+  char rest[8];
+  if (sscanf(name,"WMO_GRIB2.%d-%d%7s",&t->master_ver,&t->local_ver,rest) == 3 && strcmp(rest,".xml") == 0) {
+    return 0;
+  }
+  return 1;
+}
+
+/* read_table reads one XML parameter table into the builder
+*/
+void read_table(Builder *b,const char *path)
+{
+  FILE *fp;
+  if ( (fp=fopen(path,"rb")) == NULL) {
+    fprintf(stderr,"Error opening %s\n",path);
+    exit(1);
+  }
+  fseek(fp,0,SEEK_END);
+  long size=ftell(fp);
+  fseek(fp,0,SEEK_SET);
+  char *xml=(char *)malloc(size+1);
+  if (fread(xml,1,size,fp) != (size_t)size) {
+    fprintf(stderr,"Error reading %s\n",path);
+    exit(1);
+  }
+  fclose(fp);
+  xml[size]='\0';
+  b->tables=(TableData *)grow_array(b->tables,&b->tables_capacity,b->num_tables+1,sizeof(TableData));
+  TableData *t=&b->tables[b->num_tables];
+  t->center=t->sub_center=-1;
+  t->master_ver=t->local_ver=-1;
+  t->title=0;
+  t->path=strdup(path);
+  t->first_entry=b->num_entries;
+  t->num_entries=0;
+  int depth=0,discipline=-1,category=-1,in_parameter=0;
+  ParameterCacheEntry entry;
+  ParameterCacheKeyword keyword;
+  char value[256];
+  size_t text_start=0;
+  for (size_t n=0; n < (size_t)size; ) {
+    if (xml[n] != '<') {
+	++n;
+	continue;
+    }
+    if (strncmp(&xml[n],"<?",2) == 0 || strncmp(&xml[n],"<!--",4) == 0) {
+	char *end=strstr(&xml[n],(xml[n+1] == '?') ? "?>" : "-->");
+	if (end == NULL) {
+	  fprintf(stderr,"Error: unterminated declaration or comment in %s\n",path);
+	  exit(1);
+	}
+	n=end-xml+2;
+	continue;
+    }
+    char *end=strchr(&xml[n],'>');
+    if (end == NULL) {
+	fprintf(stderr,"Error: unterminated tag in %s\n",path);
+	exit(1);
+    }
+    size_t tag_end=end-xml;
+    if (xml[n+1] == '/') {
+// an end tag: the text since the start tag is the element's content
+	char *name=&xml[n+2];
+	size_t name_len=tag_end-(n+2);
+	char *text=&xml[text_start];
+	size_t text_len=decode_text(text,n-text_start);
+	if (in_parameter && depth == 5) {
+	  if (name_len == 9 && strncmp(name,"shortName",9) == 0) {
+	    entry.short_name=intern_string(&b->pool,text,text_len);
+	  }
+	  else if (name_len == 11 && strncmp(name,"description",11) == 0) {
+	    entry.description=intern_string(&b->pool,text,text_len);
+	  }
+	  else if (name_len == 5 && strncmp(name,"units",5) == 0) {
+	    entry.units=intern_string(&b->pool,text,text_len);
+	  }
+	  else if ((name_len == 2 && strncmp(name,"CF",2) == 0) || (name_len == 4 && strncmp(name,"GCMD",4) == 0)) {
+	    keyword.keyword=intern_string(&b->pool,text,text_len);
+	    b->keywords=(ParameterCacheKeyword *)grow_array(b->keywords,&b->keywords_capacity,b->num_keywords+1,sizeof(ParameterCacheKeyword));
+	    b->keywords[b->num_keywords++]=keyword;
+	    ++entry.num_keywords;
+	  }
+	}
+	else if (depth == 2 && name_len == 5 && strncmp(name,"title",5) == 0) {
+	  t->title=intern_string(&b->pool,text,text_len);
+	}
+	else if (depth == 4 && name_len == 9 && strncmp(name,"parameter",9) == 0) {
+	  b->entries=(ParameterCacheEntry *)grow_array(b->entries,&b->entries_capacity,b->num_entries+1,sizeof(ParameterCacheEntry));
+	  b->entries[b->num_entries++]=entry;
+	  ++t->num_entries;
+	  in_parameter=0;
+	}
+	--depth;
+	if (depth < 0) {
+	  fprintf(stderr,"Error: unbalanced tags in %s\n",path);
+	  exit(1);
+	}
+    }
+    else {
+// a start tag; the attributes follow the name
+	char *name=&xml[n+1];
+	size_t name_len=strcspn(name," \t\r\n/>");
+	char *attrs=&name[name_len];
+	size_t attrs_len=&xml[tag_end]-attrs;
+	int empty= (xml[tag_end-1] == '/');
+	if (depth == 1 && name_len == 6 && strncmp(name,"center",6) == 0) {
+	  if (get_attribute(attrs,attrs_len,"ID",value,sizeof(value))) {
+	    t->center=atoi(value);
+	  }
+	  if (get_attribute(attrs,attrs_len,"subcenterID",value,sizeof(value))) {
+	    t->sub_center=atoi(value);
+	  }
+	}
+	else if (depth == 1 && name_len == 5 && strncmp(name,"table",5) == 0) {
+	  if (get_attribute(attrs,attrs_len,"masterVersion",value,sizeof(value))) {
+	    t->master_ver=atoi(value);
+	  }
+	  if (get_attribute(attrs,attrs_len,"localVersion",value,sizeof(value))) {
+	    t->local_ver=atoi(value);
+	  }
+	}
+	else if (depth >= 1 && depth <= 3 && get_attribute(attrs,attrs_len,"code",value,sizeof(value))) {
+	  int code=parse_code(value,discipline,category);
+	  if (code < 0) {
+	    fprintf(stderr,"Error: bad code %s in %s\n",value,path);
+	    exit(1);
+	  }
+	  if (depth == 1 && name_len == 10 && strncmp(name,"discipline",10) == 0) {
+	    discipline=code;
+	  }
+	  else if (depth == 2 && name_len == 17 && strncmp(name,"parameterCategory",17) == 0) {
+	    category=code;
+	  }
+	  else if (depth == 3 && name_len == 9 && strncmp(name,"parameter",9) == 0) {
+	    if (discipline < 0 || category < 0) {
+		fprintf(stderr,"Error: parameter %d is outside of a discipline or category in %s\n",code,path);
+		exit(1);
+	    }
+	    memset(&entry,0,sizeof(entry));
+	    entry.code=(uint32_t)discipline << 16 | (uint32_t)category << 8 | (uint32_t)code;
+	    entry.first_keyword=b->num_keywords;
+	    in_parameter=1;
+	  }
+	}
+	else if (in_parameter && depth == 4 && ((name_len == 2 && strncmp(name,"CF",2) == 0) || (name_len == 4 && strncmp(name,"GCMD",4) == 0))) {
+	  memset(&keyword,0,sizeof(keyword));
+	  keyword.type= (name_len == 2) ? CF_KEYWORD : GCMD_KEYWORD;
+	  keyword.lvl1_type=keyword.lvl2_type=255;
+	  if (get_attribute(attrs,attrs_len,"ifLevelType",value,sizeof(value))) {
+	    parse_level_condition(value,&keyword,path);
+	  }
+	  if (get_attribute(attrs,attrs_len,"ifLevelValue",value,sizeof(value))) {
+	    keyword.has_value=1;
+	    keyword.level_value=atof(value);
+	  }
+	}
+	if (!empty) {
+	  ++depth;
+	}
+    }
+    n=tag_end+1;
+    text_start=n;
+  }
+  free(xml);
+  if (depth != 0) {
+    fprintf(stderr,"Error: unbalanced tags in %s\n",path);
+    exit(1);
+  }
+  if (t->center < 0) {
+// a WMO master table
+    if (table_id_from_name(path,t) != 0) {
+	fprintf(stderr,"Error: %s has no <center> and its name doesn't give the table version\n",path);
+	exit(1);
+    }
+    t->center=t->sub_center=65535;
+    t->local_ver=255;
+  }
+  if (t->sub_center < 0 || t->master_ver < 0 || t->master_ver > 254 || t->local_ver < 0 || t->local_ver > 255 || t->center > 65535 || t->sub_center > 65535) {
+    fprintf(stderr,"Error: %s has a missing or bad <center> or <table>\n",path);
+    exit(1);
+  }
+  ++b->num_tables;
+}
+
+int compare_names(const void *a,const void *b)
+{
+  return strcmp(*(char * const *)a,*(char * const *)b);
+}
+
+/* read_tables reads every GRIB2 table under 'dirname', in name order so that
+**   the same tables always give the same cache
+*/
+void read_tables(Builder *b,const char *dirname)
+{
+  DIR *dir;
+  if ( (dir=opendir(dirname)) == NULL) {
+    fprintf(stderr,"Error opening directory %s\n",dirname);
+    exit(1);
+  }
+  char **names=NULL;
+  size_t num_names=0,capacity=0;
+  struct dirent *entry;
+  while ( (entry=readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+	continue;
+    }
+    names=(char **)grow_array(names,&capacity,num_names+1,sizeof(char *));
+    names[num_names]=(char *)malloc(strlen(dirname)+strlen(entry->d_name)+2);
+    sprintf(names[num_names],"%s/%s",dirname,entry->d_name);
+    ++num_names;
+  }
+  closedir(dir);
+  qsort(names,num_names,sizeof(char *),compare_names);
+  for (size_t n=0; n < num_names; ++n) {
+    struct stat st;
+    if (stat(names[n],&st) == 0) {
+	const char *name=strrchr(names[n],'/')+1;
+	size_t len=strlen(name);
+	if (S_ISDIR(st.st_mode)) {
+	  read_tables(b,names[n]);
+	}
+	else if (S_ISREG(st.st_mode) && strncmp(name,"WMO_GRIB2.",10) == 0 && len > 4 && strcmp(&name[len-4],".xml") == 0) {
+	  read_table(b,names[n]);
+	}
+    }
+    free(names[n]);
+  }
+  free(names);
+}
+
+int compare_tables(const void *a,const void *b)
+{
+  const TableData *t1=(const TableData *)a,*t2=(const TableData *)b;
+  unsigned long long k1=parameter_table_key(t1->center,t1->sub_center,t1->master_ver,t1->local_ver);
+  unsigned long long k2=parameter_table_key(t2->center,t2->sub_center,t2->master_ver,t2->local_ver);
+  return (k1 < k2) ? -1 : (k1 > k2);
+}
+
+int compare_entries(const void *a,const void *b)
+{
+  uint32_t c1=((const ParameterCacheEntry *)a)->code,c2=((const ParameterCacheEntry *)b)->code;
+  return (c1 < c2) ? -1 : (c1 > c2);
+}
+
+void write_section(FILE *fp,const void *data,size_t len,size_t *off,const char *path)
+{
+  static const char zeros[8]={0};
+  size_t pad=align_parameter_cache_offset(*off)-*off;
+  if ((pad > 0 && fwrite(zeros,1,pad,fp) != pad) || (len > 0 && fwrite(data,1,len,fp) != len)) {
+    fprintf(stderr,"Error writing %s\n",path);
+    exit(1);
+  }
+  *off+=pad+len;
+}
+
+/* write_cache writes the cache to a temporary file and renames it to 'path'
+*/
+void write_cache(Builder *b,const char *path)
+{
+  qsort(b->tables,b->num_tables,sizeof(TableData),compare_tables);
+  ParameterCacheTable *tables=(ParameterCacheTable *)calloc(b->num_tables+1,sizeof(ParameterCacheTable));
+  ParameterCacheEntry *entries=(ParameterCacheEntry *)malloc((b->num_entries+1)*sizeof(ParameterCacheEntry));
+  size_t num_entries=0;
+  for (size_t n=0; n < b->num_tables; ++n) {
+    TableData *t=&b->tables[n];
+    if (n > 0 && compare_tables(&b->tables[n-1],t) == 0) {
+	fprintf(stderr,"Error: %s and %s are the same table\n",b->tables[n-1].path,t->path);
+	exit(1);
+    }
+    tables[n].center=t->center;
+    tables[n].sub_center=t->sub_center;
+    tables[n].master_ver=t->master_ver;
+    tables[n].local_ver=t->local_ver;
+    tables[n].first_entry=num_entries;
+    tables[n].num_entries=t->num_entries;
+    tables[n].title=t->title;
+    memcpy(&entries[num_entries],&b->entries[t->first_entry],t->num_entries*sizeof(ParameterCacheEntry));
+    qsort(&entries[num_entries],t->num_entries,sizeof(ParameterCacheEntry),compare_entries);
+    for (size_t m=1; m < t->num_entries; ++m) {
+	if (entries[num_entries+m].code == entries[num_entries+m-1].code) {
+	  uint32_t code=entries[num_entries+m].code;
+	  fprintf(stderr,"Error: parameter %u.%u.%u is in %s more than once\n",code >> 16,(code >> 8) & 0xff,code & 0xff,t->path);
+	  exit(1);
+	}
+    }
+    num_entries+=t->num_entries;
+  }
+  ParameterCacheHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,PARAMETER_CACHE_MAGIC,8);
+  h.version=PARAMETER_CACHE_VERSION;
+  h.byte_order=PARAMETER_CACHE_BYTE_ORDER;
+  h.num_tables=b->num_tables;
+  h.num_entries=num_entries;
+  h.num_keywords=b->num_keywords;
+  h.tables_off=align_parameter_cache_offset(sizeof(h));
+  h.entries_off=align_parameter_cache_offset(h.tables_off+h.num_tables*sizeof(ParameterCacheTable));
+  h.keywords_off=align_parameter_cache_offset(h.entries_off+h.num_entries*sizeof(ParameterCacheEntry));
+  h.strings_off=align_parameter_cache_offset(h.keywords_off+h.num_keywords*sizeof(ParameterCacheKeyword));
+  h.strings_len=b->pool.len;
+  h.file_size=h.strings_off+h.strings_len;
+  char *tmp_path=(char *)malloc(strlen(path)+32);
+  sprintf(tmp_path,"%s.tmp.%d",path,(int)getpid());
+  FILE *fp;
+  if ( (fp=fopen(tmp_path,"wb")) == NULL) {
+    fprintf(stderr,"Error opening %s for output\n",tmp_path);
+    exit(1);
+  }
+  size_t off=0;
+  write_section(fp,&h,sizeof(h),&off,tmp_path);
+  write_section(fp,tables,h.num_tables*sizeof(ParameterCacheTable),&off,tmp_path);
+  write_section(fp,entries,h.num_entries*sizeof(ParameterCacheEntry),&off,tmp_path);
+  write_section(fp,b->keywords,h.num_keywords*sizeof(ParameterCacheKeyword),&off,tmp_path);
+  write_section(fp,b->pool.buffer,h.strings_len,&off,tmp_path);
+  if (fflush(fp) != 0 || fsync(fileno(fp)) != 0 || fclose(fp) != 0) {
+    fprintf(stderr,"Error writing %s\n",tmp_path);
+    exit(1);
+  }
+  if (rename(tmp_path,path) != 0) {
+    fprintf(stderr,"Error renaming %s to %s: %s\n",tmp_path,path,strerror(errno));
+    unlink(tmp_path);
+    exit(1);
+  }
+  printf("%s: %u tables, %u parameters, %u keywords, %u bytes of strings\n",path,h.num_tables,h.num_entries,h.num_keywords,h.strings_len);
+  free(tmp_path);
+  free(tables);
+  free(entries);
+}
+
+void print_parameter(const ParameterCache *cache,int *args)
+{
+  ParameterInfo info;
+  if (lookup_parameter(cache,args[0],args[1],args[2],args[3],args[4],args[5],args[6],&info) != 0) {
+    printf("Parameter %d.%d.%d is not in the cache\n",args[4],args[5],args[6]);
+    return;
+  }
+  printf("Short name: %s\n",info.short_name);
+  printf("Description: %s\n",info.description);
+  printf("Units: %s\n",info.units);
+  for (size_t n=0; n < info.num_keywords; ++n) {
+    const ParameterCacheKeyword *k=&info.keywords[n];
+    printf("%s: %s",(k->type == CF_KEYWORD) ? "CF" : "GCMD",&cache->strings[k->keyword]);
+    if (k->lvl1_type != 255) {
+	printf("  (level type %d",k->lvl1_type);
+	if (k->lvl2_type != 255) {
+	  printf("-%d",k->lvl2_type);
+	}
+	if (k->has_value) {
+	  printf(", value %g",k->level_value);
+	}
+	printf(")");
+    }
+    printf("\n");
+  }
+}
+
+void usage(char *program)
+{
+  fprintf(stderr,"usage: %s tables_directory cache_file\n",program);
+  fprintf(stderr,"   or: %s -q cache_file center sub_center master_version local_version discipline category number\n",program);
+  exit(1);
+}
+
+int main(int argc,char **argv)
+{
+  if (argc == 10 && strcmp(argv[1],"-q") == 0) {
+    ParameterCache cache;
+    if (open_parameter_cache(argv[2],&cache) != 0) {
+	exit(1);
+    }
+    int args[7];
+    for (int n=0; n < 7; ++n) {
+	args[n]=atoi(argv[n+3]);
+    }
+    print_parameter(&cache,args);
+    close_parameter_cache(&cache);
+    return 0;
+  }
+  if (argc != 3 || argv[1][0] == '-') {
+    usage(argv[0]);
+  }
+  Builder b;
+  memset(&b,0,sizeof(b));
+  initialize_pool(&b.pool);
+  read_tables(&b,argv[1]);
+  if (b.num_tables == 0) {
+    fprintf(stderr,"Error: no GRIB2 parameter tables were found in %s\n",argv[1]);
+    exit(1);
+  }
+  write_cache(&b,argv[2]);
+  return 0;
+}
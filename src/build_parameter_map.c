@@ -0,0 +1,188 @@
+/*
+** File: build_parameter_map.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to compile the GRIB1 to GRIB2 parameter map
+**          (tables/parameters/GRIB1/GRIB1_to_GRIB2.txt) into the C table that
+**          grib1to2.c includes (grib1to2_parameter_map.c)
+**
+** Usage:
+**   build_parameter_map map_file c_file
+**      checks every line of 'map_file' and writes the table to 'c_file'; the
+**        new file replaces any old one with a rename, so a failed run leaves
+**        the old table in place
+**
+** Notes:   1) The map is kept as a table, not as code, so that new centers and
+**             tables are added to tables/parameters without editing
+**             grib1to2.c; the generated file is committed with the map, so
+**             that grib1to2.c can still be compiled on its own.
+**
+**          2) The map is not derived from the <GRIB1> elements of the GRIB2
+**             parameter tables, because a GRIB1 parameter often appears in
+**             several of them (e.g. as a WMO parameter and as an NCEP local
+**             parameter), and the map has to pick one.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* MapLine is one line of the parameter map
+**   values: parameter, center, sub-center, table version, discipline, category
+**             and number
+**   line:   the line number in the map file
+*/
+typedef struct {
+  int values[7];
+  size_t line;
+} MapLine;
+
+/* the smallest value of each column; center, sub-center and table version can
+**   be -1 for any value
+*/
+const int MIN_VALUES[7]={0,-1,-1,-1,0,0,0};
+const char *COLUMN_NAMES[7]={"parameter","center","sub-center","table version","discipline","category","number"};
+
+int compare_keys(const void *a,const void *b)
+{
+  const MapLine *la=(const MapLine *)a,*lb=(const MapLine *)b;
+  for (int n=0; n < 4; ++n) {
+    if (la->values[n] != lb->values[n]) {
+	return (la->values[n] < lb->values[n]) ? -1 : 1;
+    }
+  }
+  return (la->line < lb->line) ? -1 : (la->line > lb->line);
+}
+
+/* read_map reads and checks the lines of 'path' and returns the number of them
+*/
+size_t read_map(const char *path,MapLine **lines)
+{
+  FILE *fp;
+  if ( (fp=fopen(path,"r")) == NULL) {
+    fprintf(stderr,"Error opening %s\n",path);
+    exit(1);
+  }
+  size_t num_lines=0,capacity=0,line_num=0;
+  char line[1024];
+  *lines=NULL;
+  while (fgets(line,sizeof(line),fp) != NULL) {
+    ++line_num;
+    char *p=line;
+    while (*p == ' ' || *p == '\t') {
+	++p;
+    }
+    if (*p == '#' || *p == '\n' || *p == '\0') {
+	continue;
+    }
+    if (num_lines == capacity) {
+	capacity= (capacity > 0) ? 2*capacity : 256;
+	MapLine *new_lines=(MapLine *)realloc(*lines,capacity*sizeof(MapLine));
+	if (new_lines == NULL) {
+	  fprintf(stderr,"Error allocating the parameter map\n");
+	  exit(1);
+	}
+	*lines=new_lines;
+    }
+    MapLine *l=&(*lines)[num_lines];
+    int len=0;
+    if (sscanf(p,"%d %d %d %d %d %d %d %n",&l->values[0],&l->values[1],&l->values[2],&l->values[3],&l->values[4],&l->values[5],&l->values[6],&len) != 7 || p[len] != '\0') {
+	fprintf(stderr,"Error: %s, line %zu: expected seven numbers\n",path,line_num);
+	exit(1);
+    }
+    for (int n=0; n < 7; ++n) {
+	if (l->values[n] < MIN_VALUES[n] || l->values[n] > 255) {
+	  fprintf(stderr,"Error: %s, line %zu: %s %d is out of range\n",path,line_num,COLUMN_NAMES[n],l->values[n]);
+	  exit(1);
+	}
+    }
+    l->line=line_num;
+    ++num_lines;
+  }
+  fclose(fp);
+  return num_lines;
+}
+
+/* check_duplicates rejects a map that has two lines for the same parameter,
+**   center, sub-center and table version
+*/
+void check_duplicates(const char *path,const MapLine *lines,size_t num_lines)
+{
+  MapLine *sorted=(MapLine *)malloc((num_lines+1)*sizeof(MapLine));
+  if (sorted == NULL) {
+    fprintf(stderr,"Error allocating the parameter map\n");
+    exit(1);
+  }
+  memcpy(sorted,lines,num_lines*sizeof(MapLine));
+  qsort(sorted,num_lines,sizeof(MapLine),compare_keys);
+  for (size_t n=1; n < num_lines; ++n) {
+    if (memcmp(sorted[n].values,sorted[n-1].values,4*sizeof(int)) == 0) {
+	fprintf(stderr,"Error: %s, lines %zu and %zu map the same parameter\n",path,sorted[n-1].line,sorted[n].line);
+	exit(1);
+    }
+  }
+  free(sorted);
+}
+
+/* write_map writes the C table to a temporary file and renames it to 'path'
+*/
+void write_map(const char *map_path,const MapLine *lines,size_t num_lines,const char *path)
+{
+  char *tmp_path=(char *)malloc(strlen(path)+32);
+  sprintf(tmp_path,"%s.tmp.%d",path,(int)getpid());
+  FILE *fp;
+  if ( (fp=fopen(tmp_path,"w")) == NULL) {
+    fprintf(stderr,"Error opening %s for output\n",tmp_path);
+    exit(1);
+  }
+  const char *name=strrchr(path,'/');
+  name= (name == NULL) ? path : name+1;
+  fprintf(fp,"/*\n");
+  fprintf(fp,"** File: %s\n",name);
+  fprintf(fp,"**\n");
+  fprintf(fp,"** Generated by build_parameter_map from %s;\n",map_path);
+  fprintf(fp,"**   do not edit - change the map and run build_parameter_map again\n");
+  fprintf(fp,"*/\n");
+  fprintf(fp,"#ifndef GRIB1TO2_PARAMETER_MAP_C\n");
+  fprintf(fp,"#define GRIB1TO2_PARAMETER_MAP_C\n\n");
+  fprintf(fp,"const ParameterMapEntry PARAMETER_MAP[]={\n");
+  fprintf(fp,"// param center sub-center table_ver, discipline category number\n");
+  for (size_t n=0; n < num_lines; ++n) {
+    const int *v=lines[n].values;
+    fprintf(fp,"  {%3d,%3d,%3d,%3d,%4d,%3d,%3d}%s\n",v[0],v[1],v[2],v[3],v[4],v[5],v[6],(n+1 < num_lines) ? "," : "");
+  }
+  fprintf(fp,"};\n\n");
+  fprintf(fp,"#endif\n");
+  if (fclose(fp) != 0) {
+    fprintf(stderr,"Error writing %s\n",tmp_path);
+    exit(1);
+  }
+  if (rename(tmp_path,path) != 0) {
+    fprintf(stderr,"Error renaming %s to %s: %s\n",tmp_path,path,strerror(errno));
+    unlink(tmp_path);
+    exit(1);
+  }
+  printf("%s: %zu parameters\n",path,num_lines);
+  free(tmp_path);
+}
+
+int main(int argc,char **argv)
+{
+  if (argc != 3) {
+    fprintf(stderr,"usage: %s map_file c_file\n",argv[0]);
+    exit(1);
+  }
+  MapLine *lines;
+  size_t num_lines=read_map(argv[1],&lines);
+  if (num_lines == 0) {
+    fprintf(stderr,"Error: %s has no parameters\n",argv[1]);
+    exit(1);
+  }
+  check_duplicates(argv[1],lines,num_lines);
+  write_map(argv[1],lines,num_lines,argv[2]);
+  free(lines);
+  return 0;
+}
@@ -0,0 +1,533 @@
+/*
+** File: coordinate_cache.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to provide the latitude and longitude of every gridpoint of GRIB2
+**          grids, computed once for each grid definition and shared by all of
+**          the grids (and threads) that use it
+**
+** Notes:   1) A grid definition is identified by the bytes of its Grid
+**             Definition Section: they are hashed into a 64-bit fingerprint,
+**             and grids with the same fingerprint are compared byte for byte.
+**             A grid that was unpacked with a 'stride' (see unpackgrib2.c) has
+**             its own coordinates, which are those of the kept gridpoints.
+**
+**          2) The coordinates are kept in a cache of a fixed number of grid
+**             definitions; when it is full, the one that was used least
+**             recently and isn't in use is dropped.  If every definition is in
+**             use, the cache grows past its capacity until they are released.
+**
+**          3) The coordinates are immutable once they have been computed, so
+**             any number of threads can use them at the same time.  When
+**             compiled with -DPTHREADS, the cache is shared by threads: a
+**             thread that asks for coordinates that another thread is
+**             computing waits for them instead of computing them again.  The
+**             rows of a grid are computed once, and the projections are
+**             computed in chunks by 'num_threads' threads of the message.
+**
+**          4) Latitude/longitude (GDS Template 3.0), Mercator (3.10), Lambert
+**             conformal (3.30) and Gaussian (3.40) grids are supported, with
+**             the same spherical earth as point_extractor.c.  Longitudes are
+**             from 0 to 360.
+**
+**          5) This file includes point_extractor.c (and unpackgrib2.c), which
+**             are guarded, so a program may also include them itself.
+**
+** example C syntax for using the cache:
+**    CoordinateCache cache;
+**    const GridCoordinates *coords;
+**
+**    initialize_coordinate_cache(&cache,16);
+**    while (unpackgrib2(fp,&grib2_msg) != GRIB_EOF) {
+**      ...
+**      for (n=0; n < grib2_msg.num_grids; ++n) {
+**        if (acquire_grid_coordinates(&cache,&grib2_msg,n,&coords) == 0) {
+**          ... coords->lats[m] and coords->lons[m] are the location of
+**              grib2_msg.grids[n].gridpoints[m] ...
+**          release_grid_coordinates(&cache,coords);
+**        }
+**      }
+**    }
+**    free_coordinate_cache(&cache);
+*/
+#ifndef COORDINATE_CACHE_C
+#define COORDINATE_CACHE_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "point_extractor.c"
+
+/* GridCoordinates holds the location of each gridpoint of a grid, in the order
+**   of its gridpoints
+**   lats, lons: the latitude and longitude of each gridpoint
+**   num_points: the number of gridpoints (nx*ny)
+**   nx, ny:     the dimensions of the grid
+*/
+typedef struct {
+  double *lats,*lons;
+  size_t num_points;
+  int nx,ny;
+} GridCoordinates;
+
+/* CoordinateEntry is a grid definition in the cache; 'coords' is first so that
+**   the entry can be found from the coordinates that were handed out
+**   fingerprint: the hash of the Grid Definition Section
+**   gds, gds_len: a copy of the Grid Definition Section
+**   stride:      the stride of the grids that use the coordinates
+**   ready:       1 when the coordinates have been computed
+**   status:      the status of computing them, and 'error' if it failed
+**   refs:        the number of users of the coordinates
+**   prev, next:  the entries that were used more and less recently
+*/
+typedef struct CoordinateEntry {
+  GridCoordinates coords;
+  unsigned long long fingerprint;
+  unsigned char *gds;
+  size_t gds_len;
+  int stride;
+  int ready,status,refs;
+  char error[256];
+  struct CoordinateEntry *prev,*next;
+} CoordinateEntry;
+
+/* CoordinateCache is a least-recently-used cache of grid coordinates
+**   head, tail:  the most and least recently used entries
+**   num_entries: the number of entries
+**   capacity:    the number of entries that are kept when they aren't in use
+**   hits:        the number of requests that found their coordinates
+**   misses:      the number of requests that computed their coordinates
+*/
+typedef struct {
+  CoordinateEntry *head,*tail;
+  size_t num_entries,capacity;
+  size_t hits,misses;
+#ifdef PTHREADS
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+#endif
+} CoordinateCache;
+
+/* CoordinateChunks holds what the threads that compute the coordinates of the
+**   chunks of a grid need
+*/
+typedef struct {
+  const GRIB2Metadata *md;
+  GridCoordinates *coords;
+  const double *rows,*cols;
+  int stride;
+  double radius,n,f,x0,y0;
+} CoordinateChunks;
+
+int initialize_coordinate_cache(CoordinateCache *cache,size_t capacity)
+{
+  cache->head=cache->tail=NULL;
+  cache->num_entries=0;
+  cache->capacity= (capacity > 0) ? capacity : 1;
+  cache->hits=cache->misses=0;
+#ifdef PTHREADS
+  if (pthread_mutex_init(&cache->lock,NULL) != 0) {
+    return 1;
+  }
+  if (pthread_cond_init(&cache->ready,NULL) != 0) {
+    pthread_mutex_destroy(&cache->lock);
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+void free_coordinate_entry(CoordinateEntry *entry)
+{
+  free(entry->coords.lats);
+  free(entry->coords.lons);
+  free(entry->gds);
+  free(entry);
+}
+
+/* free_coordinate_cache frees the cache; all of the coordinates must have been
+**   released
+*/
+void free_coordinate_cache(CoordinateCache *cache)
+{
+  while (cache->head != NULL) {
+    CoordinateEntry *next=cache->head->next;
+    free_coordinate_entry(cache->head);
+    cache->head=next;
+  }
+  cache->tail=NULL;
+  cache->num_entries=0;
+#ifdef PTHREADS
+  pthread_cond_destroy(&cache->ready);
+  pthread_mutex_destroy(&cache->lock);
+#endif
+}
+
+/* grib2_gds_fingerprint returns the 64-bit FNV-1a hash of the 'len' bytes of a
+**   Grid Definition Section
+*/
+unsigned long long grib2_gds_fingerprint(const unsigned char *gds,size_t len)
+{
+  unsigned long long hash=0xcbf29ce484222325ULL;
+  for (size_t n=0; n < len; ++n) {
+    hash^=gds[n];
+    hash*=0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/* grid_location finds the column 'i' and the row 'j' of gridpoint 'n' of a
+**   grid; this is the inverse of point_index
+*/
+void grid_location(const GRIB2Metadata *md,size_t n,size_t *i,size_t *j)
+{
+  if ((md->scan_mode & 0x20) == 0) {
+    *j=n/md->nx;
+    *i=n % md->nx;
+    if ((md->scan_mode & 0x10) != 0 && (*j % 2) == 1) {
+	*i=md->nx-1-*i;
+    }
+  }
+  else {
+    *i=n/md->ny;
+    *j=n % md->ny;
+    if ((md->scan_mode & 0x10) != 0 && (*i % 2) == 1) {
+	*j=md->ny-1-*j;
+    }
+  }
+}
+
+/* coordinates_chunk computes the coordinates of the gridpoints 'start' to
+**   'end'-1; grids with latitudes that only depend on the row and longitudes
+**   that only depend on the column just look them up, and Lambert conformal
+**   grids are projected back from the position of each gridpoint
+*/
+void coordinates_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  CoordinateChunks *c=(CoordinateChunks *)arg;
+  const GRIB2Metadata *md=c->md;
+  GridCoordinates *coords=c->coords;
+  GRIB2Metadata strided=*md;
+  strided.nx=coords->nx;
+  strided.ny=coords->ny;
+  if (c->rows != NULL) {
+    for (size_t n=start; n < end; ++n) {
+	size_t i,j;
+	grid_location(&strided,n,&i,&j);
+	coords->lats[n]=c->rows[j];
+	coords->lons[n]=c->cols[i];
+    }
+    return;
+  }
+  double rad=acos(-1.)/180.;
+  double quarter_pi=atan(1.);
+  double dx= ((md->scan_mode & 0x80) == 0) ? md->xinc.dxinc : -md->xinc.dxinc;
+  double dy= ((md->scan_mode & 0x40) != 0) ? md->yinc.dyinc : -md->yinc.dyinc;
+  double sign= (c->n < 0.) ? -1. : 1.;
+  for (size_t n=start; n < end; ++n) {
+    size_t i,j;
+    grid_location(&strided,n,&i,&j);
+    double x=c->x0+(double)i*c->stride*dx;
+    double y=c->y0-(double)j*c->stride*dy;
+    double rho=sign*sqrt(x*x+y*y);
+    double theta=atan2(sign*x,sign*y);
+    coords->lats[n]=(2.*atan(pow(c->radius*c->f/rho,1./c->n))-2.*quarter_pi)/rad;
+    coords->lons[n]=normalize_longitude(md->lons.lov+theta/c->n/rad);
+  }
+}
+
+/* compute_grid_coordinates computes the coordinates of the gridpoints of a
+**   grid with the full grid definition 'md' that is unpacked with 'stride'
+*/
+int compute_grid_coordinates(GRIB2Message *grib2_msg,const GRIB2Metadata *md,int stride,GridCoordinates *coords)
+{
+  coords->nx=grib2_stride_length(md->nx,stride);
+  coords->ny=grib2_stride_length(md->ny,stride);
+  coords->num_points=(size_t)coords->nx*coords->ny;
+  coords->lats=(double *)malloc(coords->num_points*sizeof(double));
+  coords->lons=(double *)malloc(coords->num_points*sizeof(double));
+  CoordinateChunks c;
+  c.md=md;
+  c.coords=coords;
+  c.stride=stride;
+  double *rows=NULL,*cols=NULL;
+  if (md->gds_templ_num != 30) {
+    rows=(double *)malloc(coords->ny*sizeof(double));
+    cols=(double *)malloc(coords->nx*sizeof(double));
+  }
+  if (coords->lats == NULL || coords->lons == NULL || (md->gds_templ_num != 30 && (rows == NULL || cols == NULL))) {
+    free(coords->lats);
+    free(coords->lons);
+    free(rows);
+    free(cols);
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the coordinates of %zu gridpoints",coords->num_points);
+  }
+  double rad=acos(-1.)/180.;
+  double quarter_pi=atan(1.);
+  c.radius=earth_radius(md->earth_shape);
+  switch (md->gds_templ_num) {
+    case 0:
+    case 10:
+    case 40:
+    {
+	double dlon=md->xinc.loinc;
+	if (md->gds_templ_num == 10) {
+	  dlon=md->xinc.dxinc/(c.radius*cos(md->latin1*rad))/rad;
+	}
+	if ((md->scan_mode & 0x80) != 0) {
+	  dlon=-dlon;
+	}
+	for (int n=0; n < coords->nx; ++n) {
+	  cols[n]=normalize_longitude(md->slon+(double)n*stride*dlon);
+	}
+	if (md->gds_templ_num == 0) {
+	  double dlat= (md->lats.elat >= md->slat) ? md->yinc.lainc : -md->yinc.lainc;
+	  for (int n=0; n < coords->ny; ++n) {
+	    rows[n]=md->slat+(double)n*stride*dlat;
+	  }
+	}
+	else if (md->gds_templ_num == 10) {
+/* the rows are evenly spaced in the projected y */
+	  double dy=md->yinc.dyinc/(c.radius*cos(md->latin1*rad));
+	  if ((md->scan_mode & 0x40) == 0) {
+	    dy=-dy;
+	  }
+	  double y1=log(tan(quarter_pi+md->slat*rad/2.));
+	  for (int n=0; n < coords->ny; ++n) {
+	    rows[n]=(2.*atan(exp(y1+(double)n*stride*dy))-2.*quarter_pi)/rad;
+	  }
+	}
+	else {
+/* the rows are a run of the rows of the global Gaussian grid, starting at the
+**   one that is nearest to the first latitude */
+	  int nlat=2*md->yinc.lainc;
+	  double *lats= (nlat > 0) ? (double *)malloc(nlat*sizeof(double)) : NULL;
+	  int first=0,dir= (md->lats.elat <= md->slat) ? 1 : -1;
+	  if (lats != NULL) {
+	    gaussian_latitudes(nlat,lats);
+	    for (int n=1; n < nlat; ++n) {
+		if (fabs(lats[n]-md->slat) < fabs(lats[first]-md->slat)) {
+		  first=n;
+		}
+	    }
+	  }
+	  if (lats == NULL || first+dir*(md->ny-1) < 0 || first+dir*(md->ny-1) >= nlat) {
+	    free(lats);
+	    free(rows);
+	    free(cols);
+	    free(coords->lats);
+	    free(coords->lons);
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the Gaussian grid definition is not valid");
+	  }
+	  for (int n=0; n < coords->ny; ++n) {
+	    rows[n]=lats[first+dir*n*stride];
+	  }
+	  free(lats);
+	}
+	break;
+    }
+    case 30:
+    {
+	double phi1=md->latin1*rad,phi2=md->latin2*rad;
+	c.n= (fabs(md->latin1-md->latin2) < 1.e-6) ? sin(phi1) : log(cos(phi1)/cos(phi2))/log(tan(quarter_pi+phi2/2.)/tan(quarter_pi+phi1/2.));
+	c.f=cos(phi1)*pow(tan(quarter_pi+phi1/2.),c.n)/c.n;
+	double rho0=c.radius*c.f/pow(tan(quarter_pi+md->slat*rad/2.),c.n);
+	double theta0=c.n*(normalize_longitude(md->slon-md->lons.lov+180.)-180.)*rad;
+	c.x0=rho0*sin(theta0);
+	c.y0=rho0*cos(theta0);
+	break;
+    }
+    default:
+    {
+	free(rows);
+	free(cols);
+	free(coords->lats);
+	free(coords->lons);
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"the coordinates of grid template %d are not computed",md->gds_templ_num);
+    }
+  }
+  c.rows=rows;
+  c.cols=cols;
+  grib_parallel_for(coords->num_points,grib2_msg->num_threads,coordinates_chunk,&c);
+  free(rows);
+  free(cols);
+  return 0;
+}
+
+/* drop_unused_entries removes the least recently used entries that aren't in
+**   use until the cache is back to its capacity; the cache must be locked
+*/
+void drop_unused_entries(CoordinateCache *cache)
+{
+  CoordinateEntry *entry=cache->tail;
+  while (cache->num_entries > cache->capacity && entry != NULL) {
+    CoordinateEntry *prev=entry->prev;
+    if (entry->refs == 0 && entry->ready) {
+	if (prev != NULL) {
+	  prev->next=entry->next;
+	}
+	else {
+	  cache->head=entry->next;
+	}
+	if (entry->next != NULL) {
+	  entry->next->prev=prev;
+	}
+	else {
+	  cache->tail=prev;
+	}
+	free_coordinate_entry(entry);
+	--cache->num_entries;
+    }
+    entry=prev;
+  }
+}
+
+/* acquire_grid_coordinates sets 'coords' to the coordinates of the gridpoints
+**   of grid 'grid_num' of a message, computing them if they aren't in the
+**   cache yet; the coordinates must be released with release_grid_coordinates
+**   when they aren't needed anymore
+**
+**   the coordinates are computed from the Grid Definition Section itself, so
+**   they are right for a grid that was unpacked with a stride, whose grid
+**   definition in the metadata has been changed
+*/
+int acquire_grid_coordinates(CoordinateCache *cache,GRIB2Message *grib2_msg,int grid_num,const GridCoordinates **coords)
+{
+  *coords=NULL;
+  const GRIB2Metadata *md=&grib2_msg->grids[grid_num].md;
+  const unsigned char *gds=&grib2_msg->buffer[md->gds_off/8];
+  int len;
+  get_bits(grib2_msg->buffer,&len,md->gds_off,32);
+  if (len < 5 || md->gds_off/8+len > (size_t)grib2_msg->total_len) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the Grid Definition Section length %d is not valid",len);
+  }
+// the full grid definition, which is different from the metadata of a grid
+// that was unpacked with a stride
+  GRIB2Message full=*grib2_msg;
+  full.offset=md->gds_off;
+  int status;
+  if ( (status=unpack_GDS(&full)) != 0) {
+    strcpy(grib2_msg->error,full.error);
+    return status;
+  }
+  int stride= (full.md.nx != md->nx || full.md.ny != md->ny) ? grib2_msg->stride : 1;
+  if (stride < 1 || grib2_stride_length(full.md.nx,stride) != md->nx || grib2_stride_length(full.md.ny,stride) != md->ny) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid dimensions %d x %d don't match the Grid Definition Section",md->nx,md->ny);
+  }
+  unsigned long long fingerprint=grib2_gds_fingerprint(gds,len);
+#ifdef PTHREADS
+  pthread_mutex_lock(&cache->lock);
+#endif
+  CoordinateEntry *entry;
+  for (entry=cache->head; entry != NULL; entry=entry->next) {
+    if (entry->fingerprint == fingerprint && entry->stride == stride && entry->gds_len == (size_t)len && memcmp(entry->gds,gds,len) == 0) {
+	break;
+    }
+  }
+  if (entry != NULL) {
+    ++cache->hits;
+    ++entry->refs;
+// move the entry to the front of the list
+    if (entry != cache->head) {
+	entry->prev->next=entry->next;
+	if (entry->next != NULL) {
+	  entry->next->prev=entry->prev;
+	}
+	else {
+	  cache->tail=entry->prev;
+	}
+	entry->prev=NULL;
+	entry->next=cache->head;
+	cache->head->prev=entry;
+	cache->head=entry;
+    }
+#ifdef PTHREADS
+    while (!entry->ready) {
+	pthread_cond_wait(&cache->ready,&cache->lock);
+    }
+#endif
+  }
+  else {
+    ++cache->misses;
+    entry=(CoordinateEntry *)malloc(sizeof(CoordinateEntry));
+    unsigned char *copy=(unsigned char *)malloc(len);
+    if (entry == NULL || copy == NULL) {
+#ifdef PTHREADS
+	pthread_mutex_unlock(&cache->lock);
+#endif
+	free(entry);
+	free(copy);
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate a cache entry");
+    }
+    memcpy(copy,gds,len);
+    entry->coords.lats=entry->coords.lons=NULL;
+    entry->fingerprint=fingerprint;
+    entry->gds=copy;
+    entry->gds_len=len;
+    entry->stride=stride;
+    entry->ready=0;
+    entry->refs=1;
+    entry->prev=NULL;
+    entry->next=cache->head;
+    if (cache->head != NULL) {
+	cache->head->prev=entry;
+    }
+    else {
+	cache->tail=entry;
+    }
+    cache->head=entry;
+    ++cache->num_entries;
+// the coordinates are computed without the lock, so that other grids can be
+// looked up in the meantime; threads that want the same grid wait for them
+#ifdef PTHREADS
+    pthread_mutex_unlock(&cache->lock);
+#endif
+    entry->status=compute_grid_coordinates(grib2_msg,&full.md,stride,&entry->coords);
+    if (entry->status != 0) {
+	strcpy(entry->error,grib2_msg->error);
+	entry->coords.lats=entry->coords.lons=NULL;
+    }
+#ifdef PTHREADS
+    pthread_mutex_lock(&cache->lock);
+#endif
+    entry->ready=1;
+#ifdef PTHREADS
+    pthread_cond_broadcast(&cache->ready);
+#endif
+  }
+// a grid definition whose coordinates can't be computed stays in the cache, so
+// that its error is returned without trying again
+  status=entry->status;
+  if (status != 0) {
+    strcpy(grib2_msg->error,entry->error);
+    --entry->refs;
+  }
+  else {
+    *coords=&entry->coords;
+  }
+  drop_unused_entries(cache);
+#ifdef PTHREADS
+  pthread_mutex_unlock(&cache->lock);
+#endif
+  return status;
+}
+
+/* release_grid_coordinates releases coordinates that were returned by
+**   acquire_grid_coordinates; they must not be used after they are released
+*/
+void release_grid_coordinates(CoordinateCache *cache,const GridCoordinates *coords)
+{
+  CoordinateEntry *entry=(CoordinateEntry *)coords;
+#ifdef PTHREADS
+  pthread_mutex_lock(&cache->lock);
+#endif
+  --entry->refs;
+  drop_unused_entries(cache);
+#ifdef PTHREADS
+  pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+#endif
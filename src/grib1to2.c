@@ -11,10 +11,60 @@
 ** Revision History:
 **   20 May 2017 - first version
 **   10 Jul 2017 - convert Mercator grids; always include bitmap section (6)
+**   18 Oct 2026 - pack the bitmap and the data values with a buffered bit
+**                 writer instead of calling set_bits for every value
+**               - added the option to write complex packing with second-order
+**                 spatial differencing (DRS Template 5.3)
+**               - added the options to write CCSDS (DRS Template 5.42) and
+**                 JPEG 2000 (DRS Template 5.40) compressed data, and to
+**                 convert several messages at the same time
+**               - simple packing copies the packed data values and the bitmap
+**                 from the GRIB1 message instead of unpacking and packing them
+**                 again, when the GRIB1 data are also simple packed
+**               - messages are built complete in one buffer (including the
+**                 Indicator and End Sections) and written in batches through a
+**                 large output buffer, optionally with direct I/O; the
+**                 discipline is now set in the Indicator Section
+**               - with -t, messages are converted by a pipeline of threads
+**                 that reads, converts and writes at the same time, keeping the
+**                 output in input order
+**               - added a batch mode (-m) that converts a list of files, or a
+**                 directory, on a pool of threads
+**               - GRIB1 parameters are mapped into GRIB2 with a table
+**                 (PARAMETER_MAP) and a perfect hash instead of a switch
+**               - messages that the decoder can't unpack are skipped with a
+**                 warning instead of ending the program
+**               - batch mode runs each file as a task on the work-stealing
+**                 scheduler in grib_scheduler.c, and large grids are unpacked
+**                 in parallel on the same pool
+**               - the bit writer and the output buffer are shared with
+**                 grib2to1.c in grib_convert.c
+**               - the pipeline of threads (-t) is shared with grib2to1.c in
+**                 grib_convert.c, and each GRIB2 message is built directly in
+**                 the output buffer
+**               - the buffers of the complex, JPEG 2000 and CCSDS packing are
+**                 freed with the rest of each conversion
+**               - in batch mode, a failure to create the threads or the
+**                 conversions is reported for each file instead of ending the
+**                 program
+**               - batch mode is shared with grib2to1.c in grib_convert.c; a
+**                 file whose output file can't be opened is skipped like one
+**                 whose input file can't be opened, and files whose output
+**                 files would have the same name are rejected
+**               - PARAMETER_MAP is generated from
+**                 tables/parameters/GRIB1/GRIB1_to_GRIB2.txt by
+**                 build_parameter_map.c instead of being coded by hand
+**               - the perfect hash of PARAMETER_MAP is shared with grib2to1.c in
+**                 grib_convert.c; duplicate entries are reported by
+**                 build_parameter_map.c instead of when the program starts
 **
 ** You will need to download the GRIB1 decoder:
 **    https://raw.githubusercontent.com/rda-dattore/GRIB/master/src/unpackgrib1.c
-** It must be in the same directory as this program.
+** the code that is shared with grib2to1.c:
+**    https://raw.githubusercontent.com/rda-dattore/GRIB/master/src/grib_convert.c
+** and the parameter map:
+**    https://raw.githubusercontent.com/rda-dattore/GRIB/master/src/grib1to2_parameter_map.c
+** They must be in the same directory as this program.
 **
 ** Example compile command:
 **    % cc -std=c99 -o grib1to2 grib1to2.c
@@ -23,14 +73,62 @@
 **   include the math library in the compile
 **      e.g. % cc -std=c99 -o grib1to2 grib1to2.c -lm
 **
+** Optional features are compiled in with these flags:
+**    -DAEC       CCSDS packing (DRS Template 5.42); requires libaec
+**                  e.g. % cc -std=c99 -DAEC -o grib1to2 grib1to2.c -lm -laec
+**    -DOPENJPEG  JPEG 2000 packing (DRS Template 5.40); requires OpenJPEG 2.x
+**                  e.g. % cc -std=c99 -DOPENJPEG -o grib1to2 grib1to2.c -lm -lopenjp2
+**    -DPTHREADS  convert several messages at the same time
+**                  e.g. % cc -std=c99 -DPTHREADS -o grib1to2 grib1to2.c -lm -lpthread
+**
 ** To use the program:
-**    % grib1to2 <name of GRIB1 file to convert> <name of GRIB2 file to create>
+**    % grib1to2 [-p packing] [-t threads] [-b megabytes] [-d] <name of GRIB1 file to convert> <name of GRIB2 file to create>
+**      where packing is "simple" (DRS Template 5.0, the default), "complex"
+**        (DRS Template 5.3, complex packing with second-order spatial
+**        differencing, which is usually much smaller for smooth fields),
+**        "ccsds" (DRS Template 5.42, requires -DAEC) or "jpeg2000" (DRS
+**        Template 5.40, requires -DOPENJPEG); fields that can't be packed as
+**        requested are written with simple packing
+**      and threads is the number of worker threads that convert messages
+**        (requires -DPTHREADS); the input is read and the output is written on
+**        their own threads, and the messages are written in input order
+**      -b sets the size in megabytes of the output buffer (default 4), and -d
+**        writes the output with direct I/O (O_DIRECT) for file systems that
+**        perform best with large, unbuffered writes
+**
+** To convert many files at once:
+**    % grib1to2 [-p packing] [-t threads] [-b megabytes] [-d] -m <manifest or directory> [-o template]
+**      where the manifest names one GRIB1 file per line, optionally followed by
+**        the name of its GRIB2 file (blank lines and lines starting with '#'
+**        are ignored), or the directory holds the GRIB1 files
+**      and the template names the GRIB2 files that are not named in the
+**        manifest; %f is replaced by the name of the GRIB1 file without its
+**        directory and %b by the same without its extension (the default is
+**        "%b.grb2", in the current directory)
+**      a file whose output file has the same name as that of an earlier file
+**        (e.g. input files with the same name in different directories) is
+**        skipped, as is a file whose input or output file can't be opened
+**      the files are converted by 'threads' threads, each of which reuses its
+**        buffers from one file to the next, and the throughput is printed at
+**        the end; with -DPTHREADS, threads that run out of files help to
+**        unpack the large grids of the files that are still being converted
+**        (grib_scheduler.c must be in the same directory as this program)
 */
 
+/* O_DIRECT is a GNU extension */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#ifdef AEC
+#include <libaec.h>
+#endif
+#ifdef OPENJPEG
+#include <openjpeg.h>
+#endif
 #include "unpackgrib1.c"
+#include "grib_convert.c"
 
 /* set_bits sets the contents of the various GRIB octets
 **   buf is the GRIB buffer as a stream of bytes
@@ -98,1927 +196,265 @@ void set_bits(unsigned char *buf,int src,size_t off,size_t bits)
   }
 }
 
+/* ParameterMapEntry maps a GRIB1 parameter into GRIB2
+**   param:      the GRIB1 parameter code
+**   center:     the originating center, or -1 for any center
+**   sub_center: the sub-center, or -1 for any sub-center
+**   table_ver:  the GRIB1 parameter table version, or -1 for any version
+**   discipline, category, number: the GRIB2 parameter; 255 for all three means
+**     that the parameter has no GRIB2 equivalent for this center or table
+*/
+typedef struct {
+  short param,center,sub_center,table_ver;
+  unsigned char discipline,category,number;
+} ParameterMapEntry;
+
+/* PARAMETER_MAP is the GRIB1 to GRIB2 parameter mapping; a parameter is mapped
+**   by its most specific entry, tried in this order:
+**     center, sub-center and table version
+**     center and sub-center
+**     center and table version
+**     center
+**     table version
+**     any center and table version
+**   so a new center or table is added with new entries, not new code; the
+**   entries are in tables/parameters/GRIB1/GRIB1_to_GRIB2.txt, which
+**   build_parameter_map.c compiles into grib1to2_parameter_map.c
+*/
+#include "grib1to2_parameter_map.c"
+
+PerfectHash parameter_hash;
+
+/* parameter_key packs a parameter, center, sub-center and table version (each
+**   either -1 or 0-255) into one key
+*/
+unsigned long long parameter_key(int param,int center,int sub_center,int table_ver)
+{
+  return (unsigned long long)(param & 0x1ff) | (unsigned long long)((center+1) & 0x1ff) << 9 | (unsigned long long)((sub_center+1) & 0x1ff) << 18 | (unsigned long long)((table_ver+1) & 0x1ff) << 27;
+}
+
+/* build_parameter_hash builds the perfect hash of PARAMETER_MAP; it must be
+**   called before any messages are converted
+*/
+void build_parameter_hash(void)
+{
+  size_t num=sizeof(PARAMETER_MAP)/sizeof(PARAMETER_MAP[0]);
+  unsigned long long *keys=(unsigned long long *)malloc(num*sizeof(unsigned long long));
+  for (size_t n=0; n < num; ++n) {
+    const ParameterMapEntry *e=&PARAMETER_MAP[n];
+    keys[n]=parameter_key(e->param,e->center,e->sub_center,e->table_ver);
+  }
+  build_perfect_hash(&parameter_hash,keys,num);
+  free(keys);
+}
+
+/* find_parameter returns the PARAMETER_MAP entry for a key, or NULL */
+const ParameterMapEntry *find_parameter(unsigned long long key)
+{
+  int n=find_key(&parameter_hash,key);
+  return (n >= 0) ? &PARAMETER_MAP[n] : NULL;
+}
+
 void map_GRIB1_parameter_into_GRIB2(GRIBMessage *grib_msg,int *discipline,int *parameter_category,int *parameter_number)
 {
-  *discipline=255;*parameter_category=255,*parameter_number=255;
-  switch (grib_msg->param) {
-    case 1:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 228) {
-	  *discipline=0;*parameter_category=7;*parameter_number=7;
-	}
-	else {
-	  *discipline=0;*parameter_category=3;*parameter_number=0;
-	}
+  int p=grib_msg->param,c=grib_msg->center_id,s=grib_msg->sub_center_id,t=grib_msg->table_ver;
+  unsigned long long keys[6]={
+    parameter_key(p,c,s,t),
+    parameter_key(p,c,s,-1),
+    parameter_key(p,c,-1,t),
+    parameter_key(p,c,-1,-1),
+    parameter_key(p,-1,-1,t),
+    parameter_key(p,-1,-1,-1)
+  };
+  for (size_t n=0; n < 6; ++n) {
+    const ParameterMapEntry *e=find_parameter(keys[n]);
+    if (e != NULL) {
+	*discipline=e->discipline;
+	*parameter_category=e->category;
+	*parameter_number=e->number;
 	return;
     }
-    case 2:
+  }
+  *discipline=255;*parameter_category=255;*parameter_number=255;
+}
+
+void pack_IDS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+{
+// length of the IDS
+  size_t length=21;
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,1,*offset+32,8);
+// originating center code
+  set_bits(grib2_buffer,msg->center_id,*offset+40,16);
+// sub-center code
+  set_bits(grib2_buffer,msg->sub_center_id,*offset+56,16);
+// master table version number
+  set_bits(grib2_buffer,18,*offset+72,8);
+// local table version number
+  set_bits(grib2_buffer,0,*offset+80,8);
+// significance of reference time
+  set_bits(grib2_buffer,1,*offset+88,8);
+// year, month, day, hour, minute, second of reference time
+  set_bits(grib2_buffer,msg->yr,*offset+96,16);
+  set_bits(grib2_buffer,msg->mo,*offset+112,8);
+  set_bits(grib2_buffer,msg->dy,*offset+120,8);
+  set_bits(grib2_buffer,msg->time/100,*offset+128,8);
+  set_bits(grib2_buffer,(msg->time % 100),*offset+136,8);
+  set_bits(grib2_buffer,0,*offset+144,8);
+// production status
+  set_bits(grib2_buffer,255,*offset+152,8);
+// type of data
+  set_bits(grib2_buffer,255,*offset+160,8);
+  (*offset)+=length*8;
+}
+
+void pack_GDS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+{
+  size_t length,template_num;
+  switch (msg->data_rep) {
+    case 0:
     {
-	*discipline=0;*parameter_category=3;*parameter_number=1;
-	return;
+// Latitude-Longitude
+	length=72;
+	template_num=0;
+	break;
     }
-    case 3:
+    case 1:
     {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 228) {
-	  *discipline=10;*parameter_category=0;*parameter_number=17;
-	}
-	else {
-	  *discipline=0;*parameter_category=3;*parameter_number=2;
-	}
-	return;
+// Mercator
+	length=72;
+	template_num=10;
+	break;
     }
     case 4:
     {
-	*discipline=0;*parameter_category=2;*parameter_number=14;
-	return;
+// Gaussian Latitude-Longitude
+	length=72;
+	template_num=40;
+	break;
     }
     case 5:
     {
-	*discipline=0;*parameter_category=3;*parameter_number=3;
-	return;
-    }
-    case 6:
-    {
-	*discipline=0;*parameter_category=3;*parameter_number=4;
-	return;
+// Polar Stereographic
+	length=65;
+	template_num=20;
+	break;
     }
-    case 7:
+    default:
     {
-	*discipline=0;*parameter_category=3;*parameter_number=5;
-	return;
+	fprintf(stderr,"Unable to convert grid %d\n",msg->data_rep);
+	exit(1);
     }
-    case 8:
+  }
+// length of the GDS
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,3,*offset+32,8);
+// source of grid definition
+  set_bits(grib2_buffer,0,*offset+40,8);
+// number of data points
+  set_bits(grib2_buffer,(msg->nx*msg->ny),*offset+48,32);
+// octets 11 and 12
+  set_bits(grib2_buffer,0,*offset+80,16);
+// template number
+  set_bits(grib2_buffer,template_num,*offset+96,16);
+  switch (template_num) {
+    case 0:
     {
-	if (grib_msg->center_id == 78 && grib_msg->table_ver == 174) {
-	  *discipline=2;*parameter_category=0;*parameter_number=34;
+// Latitude-Longitude
+// shape of the Earth
+	set_bits(grib2_buffer,6,*offset+112,8);
+// next six fields relate to shape of earth, which are not used because we used
+//  a standard radius in octet 15
+	set_bits(grib2_buffer,0,*offset+120,8);
+	set_bits(grib2_buffer,0,*offset+128,32);
+	set_bits(grib2_buffer,0,*offset+160,8);
+	set_bits(grib2_buffer,0,*offset+168,32);
+	set_bits(grib2_buffer,0,*offset+200,8);
+	set_bits(grib2_buffer,0,*offset+208,32);
+// number of points in i-direction
+	set_bits(grib2_buffer,msg->nx,*offset+240,32);
+// number of points in j-direction
+	set_bits(grib2_buffer,msg->ny,*offset+272,32);
+// octets 39-42 and 43-46 can be ignored because we don't have high-precision
+//  latitudes and longitudes
+	set_bits(grib2_buffer,0,*offset+304,32);
+	set_bits(grib2_buffer,0,*offset+336,32);
+// latitude of first gridpoint
+	if (msg->slat < 0.) {
+	  set_bits(grib2_buffer,1,*offset+368,1);
 	}
 	else {
-	  *discipline=0;*parameter_category=3;*parameter_number=6;
+	  set_bits(grib2_buffer,0,*offset+368,1);
 	}
-	return;
-    }
-    case 9:
-    {
-	*discipline=0;*parameter_category=3;*parameter_number=7;
-	return;
-    }
-    case 10:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=0;*parameter_category=14;*parameter_number=2;
+	set_bits(grib2_buffer,abs(msg->slat*1000000.),*offset+369,31);
+// longitude of first gridpoint
+	if (msg->slon < 0.) {
+	  set_bits(grib2_buffer,1,*offset+400,1);
 	}
 	else {
-	  *discipline=0;*parameter_category=14;*parameter_number=0;
+	  set_bits(grib2_buffer,0,*offset+400,1);
 	}
-	return;
-    }
-    case 11:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=0;
-	return;
-    }
-    case 12:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=1;
-	return;
-    }
-    case 13:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=2;
-	return;
-    }
-    case 14:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=3;
-	return;
-    }
-    case 15:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=4;
-	return;
-    }
-    case 16:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=5;
-	return;
-    }
-    case 17:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=6;
-	return;
-    }
-    case 18:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=7;
-	return;
-    }
-    case 19:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=8;
-	return;
-    }
-    case 20:
-    {
-	*discipline=0;*parameter_category=19;*parameter_number=0;
-	return;
-    }
-    case 21:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=0;*parameter_number=28;
+	set_bits(grib2_buffer,abs(msg->slon*1000000.),*offset+401,31);
+// resolution and component flags
+	unsigned char rcflg=((msg->rescomp & 0x80) >> 2) | ((msg->rescomp & 0x80) >> 3) | (msg->rescomp & 0xf);
+	set_bits(grib2_buffer,rcflg,*offset+432,8);
+// latitude of last gridpoint
+	if (msg->elat < 0.) {
+	  set_bits(grib2_buffer,1,*offset+440,1);
 	}
 	else {
-	  *discipline=0;*parameter_category=15;*parameter_number=6;
+	  set_bits(grib2_buffer,0,*offset+440,1);
 	}
-	return;
-    }
-    case 22:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=3;*parameter_number=31;
+	set_bits(grib2_buffer,abs(msg->elat*1000000.),*offset+441,31);
+// longitude of last gridpoint
+	if (msg->elon < 0.) {
+	  set_bits(grib2_buffer,1,*offset+472,1);
 	}
 	else {
-	  *discipline=0;*parameter_category=15;*parameter_number=7;
+	  set_bits(grib2_buffer,0,*offset+472,1);
 	}
-	return;
+	set_bits(grib2_buffer,abs(msg->elon*1000000.),*offset+473,31);
+// i-direction increment
+	set_bits(grib2_buffer,lround(msg->loinc*1000000.),*offset+504,32);
+// j-direction increment
+	set_bits(grib2_buffer,lround(msg->lainc*1000000.),*offset+536,32);
+// scanning mode
+	set_bits(grib2_buffer,msg->scan_mode,*offset+568,8);
+	break;
     }
-    case 23:
+    case 10:
     {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=2;*parameter_number=45;
+// Mercator
+// shape of the Earth
+	set_bits(grib2_buffer,6,*offset+112,8);
+// next six fields relate to shape of earth, which are not used because we used
+//  a standard radius in octet 15
+	set_bits(grib2_buffer,0,*offset+120,8);
+	set_bits(grib2_buffer,0,*offset+128,32);
+	set_bits(grib2_buffer,0,*offset+160,8);
+	set_bits(grib2_buffer,0,*offset+168,32);
+	set_bits(grib2_buffer,0,*offset+200,8);
+	set_bits(grib2_buffer,0,*offset+208,32);
+// number of points in i-direction
+	set_bits(grib2_buffer,msg->nx,*offset+240,32);
+// number of points in j-direction
+	set_bits(grib2_buffer,msg->ny,*offset+272,32);
+// latitude of first gridpoint
+	if (msg->slat < 0.) {
+	  set_bits(grib2_buffer,1,*offset+304,1);
 	}
 	else {
-	  *discipline=0;*parameter_category=15;*parameter_number=8;
+	  set_bits(grib2_buffer,0,*offset+304,1);
 	}
-	return;
-    }
-    case 24:
-    {
-	*discipline=0;*parameter_category=7;*parameter_number=0;
-	return;
-    }
-    case 25:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=9;
-	return;
-    }
-    case 26:
-    {
-	*discipline=0;*parameter_category=3;*parameter_number=8;
-	return;
-    }
-    case 27:
-    {
-	*discipline=0;*parameter_category=3;*parameter_number=9;
-	return;
-    }
-    case 28:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=0;
-	return;
-    }
-    case 29:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=1;
-	return;
-    }
-    case 30:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 203) {
-	  *discipline=0;*parameter_category=7;*parameter_number=8;
+	set_bits(grib2_buffer,abs(msg->slat*1000000.),*offset+305,31);
+// longitude of first gridpoint
+	if (msg->slon < 0.) {
+	  set_bits(grib2_buffer,(msg->slon+360.)*1000000.,*offset+336,32);
 	}
 	else {
-	  *discipline=10;*parameter_category=0;*parameter_number=2;
-	}
-	return;
-    }
-    case 31:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=0;
-	return;
-    }
-    case 32:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=1;
-	return;
-    }
-    case 33:
-    {
-	if (grib_msg->center_id == 98) {
-	  if (grib_msg->table_ver == 201) {
-	    *discipline=0;*parameter_category=1;*parameter_number=82;
-	  }
-	  else if (grib_msg->table_ver == 203) {
-	    *discipline=0;*parameter_category=2;*parameter_number=46;
-	  }
-	}
-	else {
-	  *discipline=0;*parameter_category=2;*parameter_number=2;
-	}
-	return;
-    }
-    case 34:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=3;
-	return;
-    }
-    case 35:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=4;
-	return;
-    }
-    case 36:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=5;
-	return;
-    }
-    case 37:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=6;
-	return;
-    }
-    case 38:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=7;
-	return;
-    }
-    case 39:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=8;
-	return;
-    }
-    case 40:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=9;
-	return;
-    }
-    case 41:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=1;*parameter_number=78;
-	}
-	else {
-	  *discipline=0;*parameter_category=2;*parameter_number=10;
-	}
-	return;
-    }
-    case 42:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=11;
-	return;
-    }
-    case 43:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=12;
-	return;
-    }
-    case 44:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=13;
-	return;
-    }
-    case 45:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=15;
-	return;
-    }
-    case 46:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=0;*parameter_category=3;*parameter_number=20;
-	}
-	else {
-	  *discipline=0;*parameter_category=2;*parameter_number=16;
-	}
-	return;
-    }
-    case 47:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=0;*parameter_category=3;*parameter_number=24;
-	}
-	else {
-	  *discipline=10;*parameter_category=1;*parameter_number=0;
-	}
-	return;
-    }
-    case 48:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=0;*parameter_category=3;*parameter_number=21;
-	}
-	else {
-	  *discipline=10;*parameter_category=1;*parameter_number=1;
-	}
-	return;
-    }
-    case 49:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=0;*parameter_category=3;*parameter_number=22;
-	}
-	else {
-	  *discipline=10;*parameter_category=1;*parameter_number=2;
-	}
-	return;
-    }
-    case 50:
-    {
-	*discipline=10;*parameter_category=1;*parameter_number=3;
-	return;
-    }
-    case 51:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=0;
-	return;
-    }
-    case 52:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=1;
-	return;
-    }
-    case 53:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=2;
-	return;
-    }
-    case 54:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=64;
-	}
-	else {
-	  *discipline=0;*parameter_category=1;*parameter_number=3;
-	}
-	return;
-    }
-    case 55:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=4;
-	return;
-    }
-    case 56:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=5;
-	return;
-    }
-    case 57:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=6;
-	return;
-    }
-    case 58:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=70;
-	}
-	else {
-	  *discipline=0;*parameter_category=6;*parameter_number=0;
-	}
-	return;
-    }
-    case 59:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=7;*parameter_number=6;
-	}
-	else {
-	  *discipline=0;*parameter_category=1;*parameter_number=7;
-	}
-	return;
-    }
-    case 60:
-    {
-	*discipline=0;*parameter_category=19;*parameter_number=2;
-	return;
-    }
-    case 61:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=2;*parameter_category=0;*parameter_number=28;
-	}
-	else {
-	  *discipline=0;*parameter_category=1;*parameter_number=8;
-	}
-	return;
-    }
-    case 62:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=2;*parameter_category=0;*parameter_number=32;
-	}
-	else {
-	  *discipline=0;*parameter_category=1;*parameter_number=9;
-	}
-	return;
-    }
-    case 63:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=10;
-	return;
-    }
-    case 64:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=12;
-	return;
-    }
-    case 65:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=13;
-	return;
-    }
-    case 66:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=11;
-	return;
-    }
-    case 67:
-    {
-	*discipline=0;*parameter_category=19;*parameter_number=3;
-	return;
-    }
-    case 68:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=6;*parameter_number=26;
-	}
-	else {
-	  *discipline=10;*parameter_category=4;*parameter_number=2;
-	}
-	return;
-    }
-    case 69:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=6;*parameter_number=27;
-	}
-	else {
-	  *discipline=10;*parameter_category=4;*parameter_number=0;
-	}
-	return;
-    }
-    case 70:
-    {
-	*discipline=10;*parameter_category=4;*parameter_number=1;
-	return;
-    }
-    case 71:
-    {
-	*discipline=0;*parameter_category=6;*parameter_number=1;
-	return;
-    }
-    case 72:
-    {
-	*discipline=0;*parameter_category=6;*parameter_number=2;
-	return;
-    }
-    case 73:
-    {
-	*discipline=0;*parameter_category=6;*parameter_number=3;
-	return;
-    }
-    case 74:
-    {
-	*discipline=0;*parameter_category=6;*parameter_number=4;
-	return;
-    }
-    case 75:
-    {
-	if (grib_msg->center_id == 98) {
-	  if (grib_msg->table_ver == 128) {
-	    *discipline=0;*parameter_category=1;*parameter_number=85;
-	  }
-	  else if (grib_msg->table_ver == 202) {
-	    *discipline=2;*parameter_category=0;*parameter_number=29;
-	  }
-	}
-	else {
-	  *discipline=0;*parameter_category=6;*parameter_number=5;
-	}
-	return;
-    }
-    case 76:
-    {
-	if (grib_msg->center_id == 98) {
-	  if (grib_msg->table_ver == 2) {
-	    *discipline=0;*parameter_category=1;*parameter_number=69;
-	  }
-	  else if (grib_msg->table_ver == 128) {
-	    *discipline=0;*parameter_category=1;*parameter_number=86;
-	  }
-	  else if (grib_msg->table_ver == 202) {
-	    *discipline=2;*parameter_category=0;*parameter_number=30;
-	  }
-	}
-	else {
-	  *discipline=0;*parameter_category=6;*parameter_number=6;
-	}
-	return;
-    }
-    case 77:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=2;*parameter_number=32;
-	}
-	else {
-	  *discipline=0;*parameter_category=7;*parameter_number=1;
-	}
-	return;
-    }
-    case 78:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 202) {
-	  *discipline=2;*parameter_category=0;*parameter_number=31;
-	}
-	else {
-	  *discipline=0;*parameter_category=1;*parameter_number=14;
-	}
-	return;
-    }
-    case 79:
-    {
-	*discipline=0;*parameter_category=1;*parameter_number=15;
-	return;
-    }
-    case 80:
-    {
-	*discipline=10;*parameter_category=3;*parameter_number=0;
-	return;
-    }
-    case 81:
-    {
-	*discipline=1;*parameter_category=2;*parameter_number=8;
-	return;
-    }
-    case 82:
-    {
-	*discipline=10;*parameter_category=3;*parameter_number=1;
-	return;
-    }
-    case 83:
-    {
-	*discipline=2;*parameter_category=0;*parameter_number=1;
-	return;
-    }
-    case 84:
-    {
-	*discipline=0;*parameter_category=19;*parameter_number=1;
-	return;
-    }
-    case 85:
-    {
-	*discipline=2;*parameter_category=0;*parameter_number=2;
-	return;
-    }
-    case 86:
-    {
-	*discipline=2;*parameter_category=0;*parameter_number=3;
-	return;
-    }
-    case 87:
-    {
-	*discipline=2;*parameter_category=0;*parameter_number=4;
-	return;
-    }
-    case 88:
-    {
-	*discipline=10;*parameter_category=4;*parameter_number=3;
-	return;
-    }
-    case 89:
-    {
-	*discipline=0;*parameter_category=3;*parameter_number=10;
-	return;
-    }
-    case 90:
-    {
-	*discipline=2;*parameter_category=0;*parameter_number=5;
-	return;
-    }
-    case 91:
-    {
-	*discipline=1;*parameter_category=2;*parameter_number=7;
-	return;
-    }
-    case 92:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=1;
-	return;
-    }
-    case 93:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=2;
-	return;
-    }
-    case 94:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=3;
-	return;
-    }
-    case 95:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=4;
-	return;
-    }
-    case 96:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=5;
-	return;
-    }
-    case 97:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=6;
-	return;
-    }
-    case 98:
-    {
-	*discipline=10;*parameter_category=2;*parameter_number=7;
-	return;
-    }
-    case 99:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 203) {
-	  *discipline=0;*parameter_category=19;*parameter_number=25;
-	}
-	else {
-	  *discipline=0;*parameter_category=1;*parameter_number=16;
-	}
-	return;
-    }
-    case 100:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=1;*parameter_number=77;
-	}
-	else {
-	  *discipline=10;*parameter_category=0;*parameter_number=3;
-	}
-	return;
-    }
-    case 101:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=4;
-	return;
-    }
-    case 102:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=5;
-	return;
-    }
-    case 103:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=6;
-	return;
-    }
-    case 104:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=7;
-	return;
-    }
-    case 105:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=8;
-	return;
-    }
-    case 106:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=9;
-	return;
-    }
-    case 107:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=10;
-	return;
-    }
-    case 108:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=11;
-	return;
-    }
-    case 109:
-    {
-	if (grib_msg->center_id == 98) {
-	  if (grib_msg->table_ver == 162) {
-	    *discipline=0;*parameter_category=0;*parameter_number=20;
-	  }
-	  else if (grib_msg->table_ver == 228) {
-	    *discipline=0;*parameter_category=6;*parameter_number=13;
-	  }
-	}
-	else {
-	  *discipline=10;*parameter_category=0;*parameter_number=12;
-	}
-	return;
-    }
-    case 110:
-    {
-	*discipline=10;*parameter_category=0;*parameter_number=13;
-	return;
-    }
-    case 111:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=1;*parameter_number=76;
-	}
-	else {
-	  *discipline=0;*parameter_category=4;*parameter_number=0;
-	}
-	return;
-    }
-    case 112:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=1;*parameter_number=55;
-	}
-	else {
-	  *discipline=0;*parameter_category=5;*parameter_number=0;
-	}
-	return;
-    }
-    case 113:
-    {
-	*discipline=0;*parameter_category=4;*parameter_number=1;
-	return;
-    }
-    case 114:
-    {
-	*discipline=0;*parameter_category=5;*parameter_number=1;
-	return;
-    }
-    case 115:
-    {
-	*discipline=0;*parameter_category=5;*parameter_number=2;
-	return;
-    }
-    case 116:
-    {
-	*discipline=0;*parameter_category=4;*parameter_number=2;
-	return;
-    }
-    case 117:
-    {
-	*discipline=0;*parameter_category=4;*parameter_number=3;
-	return;
-    }
-    case 118:
-    {
-	*discipline=0;*parameter_category=4;*parameter_number=4;
-	return;
-    }
-    case 119:
-    {
-	*discipline=0;*parameter_category=4;*parameter_number=5;
-	return;
-    }
-    case 120:
-    {
-	*discipline=0;*parameter_category=4;*parameter_number=6;
-	return;
-    }
-    case 121:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 228) {
-	  *discipline=0;*parameter_category=7;*parameter_number=2;
-	}
-	else {
-	  *discipline=0;*parameter_category=0;*parameter_number=10;
-	}
-	return;
-    }
-    case 122:
-    {
-	*discipline=0;*parameter_category=0;*parameter_number=11;
-	return;
-    }
-    case 123:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 228) {
-	  *discipline=0;*parameter_category=7;*parameter_number=4;
-	}
-	else {
-	  *discipline=0;*parameter_category=2;*parameter_number=20;
-	}
-	return;
-    }
-    case 124:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=17;
-	return;
-    }
-    case 125:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=18;
-	return;
-    }
-    case 126:
-    {
-	*discipline=0;*parameter_category=2;*parameter_number=19;
-	return;
-    }
-    case 131:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=70;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=43;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 132:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=7;*parameter_number=11;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=6;*parameter_number=21;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 133:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=7;*parameter_number=2;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=44;
-		break;
-	    }
-	  }
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=1;*parameter_number=61;
-	}
-	return;
-    }
-    case 134:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=7;*parameter_number=5;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=6;*parameter_number=16;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 135:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=38;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=21;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 136:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=2;*parameter_number=25;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=69;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 137:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=70;
-		break;
-	    }
-	    case 131:
-	    {
-		*discipline=0;*parameter_category=17;*parameter_number=0;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 138:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 129) {
-	  *discipline=0;*parameter_category=1;*parameter_number=45;
-	}
-	return;
-    }
-    case 139:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 129) {
-	  *discipline=0;*parameter_category=1;*parameter_number=46;
-	}
-	return;
-    }
-    case 140:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=33;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=6;*parameter_number=20;
-		break;
-	    }
-	  }
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 203) {
-	  *discipline=0;*parameter_category=7;*parameter_number=3;
-	}
-	return;
-    }
-    case 141:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=34;
-	}
-	return;
-    }
-    case 142:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=35;
-	}
-	return;
-    }
-    case 143:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=36;
-	}
-	return;
-    }
-    case 144:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=2;*parameter_category=0;*parameter_number=9;
-		break;
-	    }
-	    case 128:
-	    {
-		*discipline=10;*parameter_category=3;*parameter_number=2;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 145:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 131) {
-	  *discipline=0;*parameter_category=1;*parameter_number=41;
-	}
-	return;
-    }
-    case 146:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=6;*parameter_number=15;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=0;*parameter_category=6;*parameter_number=15;
-	}
-	return;
-    }
-    case 147:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=3;*parameter_number=16;
-	}
-	else if (grib_msg->center_id == 98) {
-	  switch (grib_msg->table_ver) {
-	    case 201:
-	    {
-		*discipline=0;*parameter_category=19;*parameter_number=24;
-		break;
-	    }
-	    case 254:
-	    {
-		*discipline=0;*parameter_category=2;*parameter_number=27;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 148:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=3;*parameter_number=17;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 254) {
-	  *discipline=0;*parameter_category=2;*parameter_number=28;
-	}
-	return;
-    }
-    case 152:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=19;*parameter_number=11;
-	}
-	return;
-    }
-    case 153:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=22;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=2;*parameter_number=31;
-	}
-	return;
-    }
-    case 154:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=14;*parameter_number=1;
-	}
-	return;
-    }
-    case 155:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=2;*parameter_category=0;*parameter_number=10;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=2;*parameter_category=0;*parameter_number=10;
-	}
-	return;
-    }
-    case 156:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=7;*parameter_number=7;
-	}
-	return;
-    }
-    case 157:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=7;*parameter_number=6;
-	}
-	return;
-    }
-    case 158:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=19;*parameter_number=11;
-	}
-	return;
-    }
-    case 159:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=0;*parameter_category=19;*parameter_number=17;
-	}
-	return;
-    }
-    case 160:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=4;*parameter_number=53;
-		break;
-	    }
-	    case 130:
-	    {
-		*discipline=2;*parameter_category=3;*parameter_number=5;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 163:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=5;*parameter_number=8;
-	}
-	return;
-    }
-    case 170:
-    {
-	if (grib_msg->center_id == 7) {
-	  if (grib_msg->table_ver == 2) {
-	    *discipline=0;*parameter_category=1;*parameter_number=24;
-	  }
-	  else if (grib_msg->table_ver == 130) {
-	    *discipline=0;*parameter_category=19;*parameter_number=18;
-	  }
-	}
-	return;
-    }
-    case 171:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=25;
-		break;
-	    }
-	    case 130:
-	    {
-		*discipline=2;*parameter_category=3;*parameter_number=6;
-		break;
-	    }
-	  }
-	}
-	else if (grib_msg->center_id == 98) {
-	  switch (grib_msg->table_ver) {
-	    case 201:
-	    {
-		*discipline=0;*parameter_category=0;*parameter_number=19;
-		break;
-	    }
-	    case 228:
-	    {
-		*discipline=2;*parameter_category=0;*parameter_number=26;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 172:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=2;*parameter_number=26;
-	}
-	return;
-    }
-    case 174:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 140) {
-	  *discipline=0;*parameter_category=6;*parameter_number=25;
-	}
-	return;
-    }
-    case 178:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=23;
-	}
-	return;
-    }
-    case 180:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=0;*parameter_category=1;*parameter_number=17;
-	}
-	else if (grib_msg->center_id == 98) {
-	  switch (grib_msg->table_ver) {
-	    case 128:
-	    {
-		*discipline=0;*parameter_category=2;*parameter_number=38;
-		break;
-	    }
-	    case 202:
-	    {
-		*discipline=0;*parameter_category=14;*parameter_number=1;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 181:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=15;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=2;*parameter_number=37;
-	}
-	return;
-    }
-    case 182:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=28;
-	}
-	return;
-    }
-    case 184:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=0;*parameter_category=19;*parameter_number=19;
-	}
-	return;
-    }
-    case 189:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=0;*parameter_number=15;
-	}
-	return;
-    }
-    case 190:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=7;*parameter_number=8;
-	}
-	return;
-    }
-    case 191:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 133) {
-	  *discipline=0;*parameter_category=6;*parameter_number=33;
-	}
-	return;
-    }
-    case 192:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 133) {
-	  *discipline=10;*parameter_category=191;*parameter_number=1;
-	}
-	return;
-    }
-    case 193:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 131) {
-	  *discipline=0;*parameter_category=0;*parameter_number=21;
-	}
-	return;
-    }
-    case 194:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1,*parameter_number=39;
-	}
-	return;
-    }
-    case 195:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 128) {
-	  *discipline=10;*parameter_category=4,*parameter_number=4;
-	}
-	return;
-    }
-    case 196:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=2;*parameter_number=27;
-		break;
-	    }
-	    case 128:
-	    {
-		*discipline=10;*parameter_category=4,*parameter_number=5;
-		break;
-	    }
-	    case 130:
-	    {
-		*discipline=2;*parameter_category=0;*parameter_number=7;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 197:
-    {
-	if (grib_msg->center_id == 7) {
-	  if (grib_msg->table_ver == 2) {
-	    *discipline=0;*parameter_category=2;*parameter_number=28;
-	  }
-	  else if (grib_msg->table_ver == 128) {
-	    *discipline=10;*parameter_category=4,*parameter_number=6;
-	  }
-	}
-	return;
-    }
-    case 200:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=2;*parameter_category=0;*parameter_number=13;
-	}
-	return;
-    }
-    case 202:
-    {
-	if (grib_msg->center_id == 98) {
-	  if (grib_msg->table_ver == 133) {
-	    *discipline=0;*parameter_category=3;*parameter_number=27;
-	  }
-	  else if (grib_msg->table_ver == 200) {
-	    *discipline=2;*parameter_category=0;*parameter_number=6;
-	  }
-	}
-	return;
-    }
-    case 203:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=16;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=0;*parameter_number=18;
-	}
-	return;
-    }
-    case 204:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=4,*parameter_number=7;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=0;*parameter_category=4,*parameter_number=7;
-	}
-	return;
-    }
-    case 205:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=5;*parameter_number=3;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=0;*parameter_category=5;*parameter_number=3;
-	}
-	return;
-    }
-    case 206:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=0;*parameter_category=15;*parameter_number=3;
-	}
-	return;
-    }
-    case 207:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=2;*parameter_category=0;*parameter_number=11;
-	}
-	return;
-    }
-    case 208:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=2;*parameter_category=0;*parameter_number=12;
-	}
-	return;
-    }
-    case 209:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 133) {
-	  *discipline=0;*parameter_category=3;*parameter_number=28;
-	}
-	return;
-    }
-    case 211:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    case 130:
-	    case 131:
-	    {
-		*discipline=0;*parameter_category=4,*parameter_number=8;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=16,*parameter_number=4;
-		break;
-	    }
-	  }
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=0;*parameter_category=4,*parameter_number=8;
-	}
-	return;
-    }
-    case 212:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=5;*parameter_number=4;
-	}
-	else if (grib_msg->center_id == 98) {
-	  switch (grib_msg->table_ver) {
-	    case 200:
-	    {
-		*discipline=0;*parameter_category=5;*parameter_number=4;
-		break;
-	    }
-	    case 201:
-	    {
-		*discipline=2;*parameter_category=0;*parameter_number=16;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 214:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=37;
-	}
-	return;
-    }
-    case 218:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 129) {
-	  *discipline=0;*parameter_category=1;*parameter_number=27;
-	}
-	return;
-    }
-    case 219:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=6;*parameter_number=13;
-		break;
-	    }
-	    case 130:
-	    {
-		*discipline=2;*parameter_category=0;*parameter_number=17;
-		break;
-	    }
-	  }
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 200) {
-	  *discipline=0;*parameter_category=2;*parameter_number=21;
-	}
-	return;
-    }
-    case 221:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=3;*parameter_number=18;
-	}
-	return;
-    }
-    case 222:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=3;*parameter_number=15;
-	}
-	return;
-    }
-    case 223:
-    {
-	if (grib_msg->center_id == 7) {
-	  if (grib_msg->table_ver == 2) {
-	    *discipline=2;*parameter_category=0;*parameter_number=13;
-	  }
-	  else if (grib_msg->table_ver == 129) {
-	    *discipline=0;*parameter_category=1;*parameter_number=65;
-	  }
-	}
-	return;
-    }
-    case 224:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=2;*parameter_category=3;*parameter_number=0;
-		break;
-	    }
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=1;*parameter_number=66;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 225:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 129) {
-	  *discipline=0;*parameter_category=1;*parameter_number=67;
-	}
-	return;
-    }
-    case 226:
-    {
-	if (grib_msg->center_id == 7) {
-	  if (grib_msg->table_ver == 2) {
-	    *discipline=2;*parameter_category=0;*parameter_number=14;
-	  }
-	  else if (grib_msg->table_ver == 129) {
-	    *discipline=0;*parameter_category=1;*parameter_number=68;
-	  }
-	}
-	return;
-    }
-    case 227:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 129) {
-	  *discipline=0;*parameter_category=7;*parameter_number=15;
-	}
-	return;
-    }
-    case 228:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=40;
-	}
-	return;
-    }
-    case 229:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=0;*parameter_number=16;
-	}
-	return;
-    }
-    case 230:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 2:
-	    {
-		*discipline=0;*parameter_category=3;*parameter_number=19;
-		break;
-	    }
-	    case 130:
-	    {
-		*discipline=2;*parameter_category=3;*parameter_number=7;
-		break;
-	    }
-	  }
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 201) {
-	  *discipline=0;*parameter_category=15;*parameter_number=1;
-	}
-	return;
-    }
-    case 231:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=3;*parameter_number=8;
-	}
-	return;
-    }
-    case 233:
-    {
-	if (grib_msg->center_id == 98 && grib_msg->table_ver == 140) {
-	  *discipline=10;*parameter_category=0;*parameter_number=16;
-	}
-	return;
-    }
-    case 234:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=1;*parameter_category=0;*parameter_number=5;
-	}
-	return;
-    }
-    case 235:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=1;*parameter_category=0;*parameter_number=6;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=0;*parameter_number=17;
-	}
-	return;
-    }
-    case 238:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=1;*parameter_number=42;
-	}
-	return;
-    }
-    case 239:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=0;*parameter_number=18;
-	}
-	return;
-    }
-    case 240:
-    {
-	if (grib_msg->center_id == 7) {
-	  switch (grib_msg->table_ver) {
-	    case 129:
-	    {
-		*discipline=0;*parameter_category=16;*parameter_number=3;
-		break;
-	    }
-	    case 130:
-	    {
-		*discipline=2;*parameter_category=3;*parameter_number=9;
-		break;
-	    }
-	  }
-	}
-	return;
-    }
-    case 246:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=18;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=1;*parameter_number=83;
-	}
-	return;
-    }
-    case 247:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=19;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=1;*parameter_number=84;
-	}
-	return;
-    }
-    case 248:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=20;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 128) {
-	  *discipline=0;*parameter_category=6;*parameter_number=32;
-	}
-	return;
-    }
-    case 249:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 130) {
-	  *discipline=2;*parameter_category=0;*parameter_number=21;
-	}
-	return;
-    }
-    case 250:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 129) {
-	  *discipline=2;*parameter_category=4,*parameter_number=2;
-	}
-	return;
-    }
-    case 252:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=2;*parameter_number=29;
-	}
-	return;
-    }
-    case 253:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=2;*parameter_number=30;
-	}
-	else if (grib_msg->center_id == 98 && grib_msg->table_ver == 140) {
-	  *discipline=10;*parameter_category=0;*parameter_number=44;
-	}
-	return;
-    }
-    case 254:
-    {
-	if (grib_msg->center_id == 7 && grib_msg->table_ver == 2) {
-	  *discipline=0;*parameter_category=7;*parameter_number=12;
-	}
-	return;
-    }
-  }
-}
-
-void pack_IDS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
-{
-// length of the IDS
-  size_t length=21;
-  set_bits(grib2_buffer,length,*offset,32);
-// section number
-  set_bits(grib2_buffer,1,*offset+32,8);
-// originating center code
-  set_bits(grib2_buffer,msg->center_id,*offset+40,16);
-// sub-center code
-  set_bits(grib2_buffer,msg->sub_center_id,*offset+56,16);
-// master table version number
-  set_bits(grib2_buffer,18,*offset+72,8);
-// local table version number
-  set_bits(grib2_buffer,0,*offset+80,8);
-// significance of reference time
-  set_bits(grib2_buffer,1,*offset+88,8);
-// year, month, day, hour, minute, second of reference time
-  set_bits(grib2_buffer,msg->yr,*offset+96,16);
-  set_bits(grib2_buffer,msg->mo,*offset+112,8);
-  set_bits(grib2_buffer,msg->dy,*offset+120,8);
-  set_bits(grib2_buffer,msg->time/100,*offset+128,8);
-  set_bits(grib2_buffer,(msg->time % 100),*offset+136,8);
-  set_bits(grib2_buffer,0,*offset+144,8);
-// production status
-  set_bits(grib2_buffer,255,*offset+152,8);
-// type of data
-  set_bits(grib2_buffer,255,*offset+160,8);
-  (*offset)+=length*8;
-}
-
-void pack_GDS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
-{
-  size_t length,template_num;
-  switch (msg->data_rep) {
-    case 0:
-    {
-// Latitude-Longitude
-	length=72;
-	template_num=0;
-	break;
-    }
-    case 1:
-    {
-// Mercator
-	length=72;
-	template_num=10;
-	break;
-    }
-    case 4:
-    {
-// Gaussian Latitude-Longitude
-	length=72;
-	template_num=40;
-	break;
-    }
-    case 5:
-    {
-// Polar Stereographic
-	length=65;
-	template_num=20;
-	break;
-    }
-    default:
-    {
-	fprintf(stderr,"Unable to convert grid %d\n",msg->data_rep);
-	exit(1);
-    }
-  }
-// length of the GDS
-  set_bits(grib2_buffer,length,*offset,32);
-// section number
-  set_bits(grib2_buffer,3,*offset+32,8);
-// source of grid definition
-  set_bits(grib2_buffer,0,*offset+40,8);
-// number of data points
-  set_bits(grib2_buffer,(msg->nx*msg->ny),*offset+48,32);
-// octets 11 and 12
-  set_bits(grib2_buffer,0,*offset+80,16);
-// template number
-  set_bits(grib2_buffer,template_num,*offset+96,16);
-  switch (template_num) {
-    case 0:
-    {
-// Latitude-Longitude
-// shape of the Earth
-	set_bits(grib2_buffer,6,*offset+112,8);
-// next six fields relate to shape of earth, which are not used because we used
-//  a standard radius in octet 15
-	set_bits(grib2_buffer,0,*offset+120,8);
-	set_bits(grib2_buffer,0,*offset+128,32);
-	set_bits(grib2_buffer,0,*offset+160,8);
-	set_bits(grib2_buffer,0,*offset+168,32);
-	set_bits(grib2_buffer,0,*offset+200,8);
-	set_bits(grib2_buffer,0,*offset+208,32);
-// number of points in i-direction
-	set_bits(grib2_buffer,msg->nx,*offset+240,32);
-// number of points in j-direction
-	set_bits(grib2_buffer,msg->ny,*offset+272,32);
-// octets 39-42 and 43-46 can be ignored because we don't have high-precision
-//  latitudes and longitudes
-	set_bits(grib2_buffer,0,*offset+304,32);
-	set_bits(grib2_buffer,0,*offset+336,32);
-// latitude of first gridpoint
-	if (msg->slat < 0.) {
-	  set_bits(grib2_buffer,1,*offset+368,1);
-	}
-	else {
-	  set_bits(grib2_buffer,0,*offset+368,1);
-	}
-	set_bits(grib2_buffer,abs(msg->slat*1000000.),*offset+369,31);
-// longitude of first gridpoint
-	if (msg->slon < 0.) {
-	  set_bits(grib2_buffer,1,*offset+400,1);
-	}
-	else {
-	  set_bits(grib2_buffer,0,*offset+400,1);
-	}
-	set_bits(grib2_buffer,abs(msg->slon*1000000.),*offset+401,31);
-// resolution and component flags
-	unsigned char rcflg=((msg->rescomp & 0x80) >> 2) | ((msg->rescomp & 0x80) >> 3) | (msg->rescomp & 0xf);
-	set_bits(grib2_buffer,rcflg,*offset+432,8);
-// latitude of last gridpoint
-	if (msg->elat < 0.) {
-	  set_bits(grib2_buffer,1,*offset+440,1);
-	}
-	else {
-	  set_bits(grib2_buffer,0,*offset+440,1);
-	}
-	set_bits(grib2_buffer,abs(msg->elat*1000000.),*offset+441,31);
-// longitude of last gridpoint
-	if (msg->elon < 0.) {
-	  set_bits(grib2_buffer,1,*offset+472,1);
-	}
-	else {
-	  set_bits(grib2_buffer,0,*offset+472,1);
-	}
-	set_bits(grib2_buffer,abs(msg->elon*1000000.),*offset+473,31);
-// i-direction increment
-	set_bits(grib2_buffer,lround(msg->loinc*1000000.),*offset+504,32);
-// j-direction increment
-	set_bits(grib2_buffer,lround(msg->lainc*1000000.),*offset+536,32);
-// scanning mode
-	set_bits(grib2_buffer,msg->scan_mode,*offset+568,8);
-	break;
-    }
-    case 10:
-    {
-// Mercator
-// shape of the Earth
-	set_bits(grib2_buffer,6,*offset+112,8);
-// next six fields relate to shape of earth, which are not used because we used
-//  a standard radius in octet 15
-	set_bits(grib2_buffer,0,*offset+120,8);
-	set_bits(grib2_buffer,0,*offset+128,32);
-	set_bits(grib2_buffer,0,*offset+160,8);
-	set_bits(grib2_buffer,0,*offset+168,32);
-	set_bits(grib2_buffer,0,*offset+200,8);
-	set_bits(grib2_buffer,0,*offset+208,32);
-// number of points in i-direction
-	set_bits(grib2_buffer,msg->nx,*offset+240,32);
-// number of points in j-direction
-	set_bits(grib2_buffer,msg->ny,*offset+272,32);
-// latitude of first gridpoint
-	if (msg->slat < 0.) {
-	  set_bits(grib2_buffer,1,*offset+304,1);
-	}
-	else {
-	  set_bits(grib2_buffer,0,*offset+304,1);
-	}
-	set_bits(grib2_buffer,abs(msg->slat*1000000.),*offset+305,31);
-// longitude of first gridpoint
-	if (msg->slon < 0.) {
-	  set_bits(grib2_buffer,(msg->slon+360.)*1000000.,*offset+336,32);
-	}
-	else {
-	  set_bits(grib2_buffer,msg->slon*1000000.,*offset+336,32);
+	  set_bits(grib2_buffer,msg->slon*1000000.,*offset+336,32);
 	}
 // resolution and component flags
 	unsigned char rcflg=((msg->rescomp & 0x80) >> 2) | ((msg->rescomp & 0x80) >> 3) | (msg->rescomp & 0xf);
@@ -2188,7 +624,18 @@ void pack_GDS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
   (*offset)+=length*8;
 }
 
-int mdays[]={0,31,28,31,30,31,30,31,31,30,31,30,31};
+/* days_in_month doesn't modify a shared table, so that messages can be
+**   converted at the same time
+*/
+int days_in_month(int yr,int mo)
+{
+  static const int mdays[]={0,31,28,31,30,31,30,31,31,30,31,30,31};
+  if (mo == 2 && (yr % 4) == 0 && ( (yr % 100 != 0) || (yr % 400) == 0)) {
+    return 29;
+  }
+  return mdays[mo];
+}
+
 void add_time(int time_to_add,int time_units,int *yr,int *mo,int *dy,int *time)
 {
   int hr=*time/100;
@@ -2221,24 +668,12 @@ void add_time(int time_to_add,int time_units,int *yr,int *mo,int *dy,int *time)
     if (hr >= 24) {
 	*dy+=hr/24;
 	hr=(hr % 24);
-	if ( (*yr % 4) == 0 && ( (*yr % 100 != 0) || (*yr % 400) == 0)) {
-	  mdays[2]=29;
-	}
-	else {
-	  mdays[2]=28;
-	}
-	while (*dy > mdays[*mo]) {
-	  *dy-=mdays[*mo];
+	while (*dy > days_in_month(*yr,*mo)) {
+	  *dy-=days_in_month(*yr,*mo);
 	  ++(*mo);
 	  if (*mo > 12) {
 	    ++(*yr);
 	    *mo=1;
-	    if ( (*yr % 4) == 0 && ( (*yr % 100 != 0) || (*yr % 400) == 0)) {
-		mdays[2]=29;
-	    }
-	    else {
-		mdays[2]=28;
-	    }
 	  }
 	}
     } 
@@ -2308,6 +743,15 @@ void pack_PDS(GRIBMessage *msg,int parameter_category,int parameter_number,unsig
 	    set_bits(grib2_buffer,msg->p1,*offset+144,32);
 	    break;
 	  }
+	  case 2:
+	  case 3:
+	  case 4:
+	  {
+// the forecast time of a statistically processed field is the start of the
+// time range
+	    set_bits(grib2_buffer,msg->p1,*offset+144,32);
+	    break;
+	  }
 	  case 1:
 	  {
 	    set_bits(grib2_buffer,0,*offset+144,32);
@@ -2552,23 +996,506 @@ void pack_PDS(GRIBMessage *msg,int parameter_category,int parameter_number,unsig
 // time increment between successive fields
 	  set_bits(grib2_buffer,0,*offset+432,32);
 	}
-	break;
+	break;
+    }
+  }
+  (*offset)+=length*8;
+}
+
+void pack_DRS(GRIBMessage *msg,float R,unsigned char *grib2_buffer,size_t *offset)
+{
+// length of the DRS
+  size_t length=21;
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,5,*offset+32,8);
+// number of data points
+  set_bits(grib2_buffer,msg->nx*msg->ny,*offset+40,32);
+// template number
+  set_bits(grib2_buffer,0,*offset+72,16);
+// reference value
+  union {
+    float f;
+    int i;
+  } u;
+  u.f=R;
+  set_bits(grib2_buffer,u.i,*offset+88,32);
+// binary scale factor
+  float E=msg->E;
+  if (E < 0) {
+    E=0x8000-E;
+  }
+  set_bits(grib2_buffer,E,*offset+120,16);
+// decimal scale factor
+  float D=msg->D;
+  if (D < 0) {
+    D=0x8000-D;
+  }
+  set_bits(grib2_buffer,D,*offset+136,16);
+// packed value width
+  set_bits(grib2_buffer,msg->pack_width,*offset+152,8);
+// type of original values
+  set_bits(grib2_buffer,0,*offset+160,8);
+  (*offset)+=length*8;
+}
+
+void pack_BMS(GRIBMessage *msg,int include_bitmap,unsigned char *grib2_buffer,size_t *offset)
+{
+// length of the BMS
+  size_t length=6;
+  if (msg->bms_included && include_bitmap) {
+    length+=(msg->bitmap_len+7)/8;
+  }
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,6,*offset+32,8);
+  if (length > 6) {
+// bitmap indicator
+    set_bits(grib2_buffer,0,*offset+40,8);
+// bitmap - the section starts on an octet boundary, so build the bitmap a
+// whole octet at a time
+    unsigned char *b=&grib2_buffer[*offset/8+6];
+    size_t nfull=msg->bitmap_len/8;
+    unsigned char *bitmap=msg->bitmap;
+    for (size_t n=0; n < nfull; ++n) {
+	b[n]=(bitmap[0] << 7) | (bitmap[1] << 6) | (bitmap[2] << 5) | (bitmap[3] << 4) | (bitmap[4] << 3) | (bitmap[5] << 2) | (bitmap[6] << 1) | bitmap[7];
+	bitmap+=8;
+    }
+    if ( (msg->bitmap_len % 8) > 0) {
+	b[nfull]=0;
+	for (size_t n=0; n < (msg->bitmap_len % 8); ++n) {
+	  b[nfull]|=bitmap[n] << (7-n);
+	}
+    }
+  }
+  else {
+// bitmap indicator
+    set_bits(grib2_buffer,255,*offset+40,8);
+  }
+  (*offset)+=length*8;
+}
+
+void pack_DS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+{
+// length of the DS
+  size_t length=5+(msg->nx*msg->ny*msg->pack_width+7)/8;
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,7,*offset+32,8);
+  float d=pow(10.,msg->D);
+  float e=pow(2.,msg->E);
+  BitWriter bw;
+  bitwriter_init(&bw,grib2_buffer,*offset+40);
+  for (size_t n=0; n < msg->nx*msg->ny; ++n) {
+    if (msg->gridpoints[n] != GRIB_MISSING_VALUE) {
+	int pval=lround((msg->gridpoints[n]-msg->ref_val)*d/e);
+	bitwriter_put(&bw,pval,msg->pack_width);
+    }
+  }
+// the section has room for every gridpoint, so clear the octets that follow the
+// packed values when there are missing values
+  size_t end=(bitwriter_flush(&bw)+7)/8;
+  memset(&grib2_buffer[end],0,*offset/8+length-end);
+  (*offset)+=length*8;
+}
+
+/* can_copy_packed_data returns 1 if the packed data values in the GRIB1 BDS can
+**   be copied directly into a GRIB2 Data Section with simple packing, which uses
+**   the same stream of fixed-width values, and sets 'num_to_copy' to the
+**   number of values to copy; otherwise it returns 0 and the gridpoints have to
+**   be unpacked and packed again
+*/
+int can_copy_packed_data(GRIBMessage *msg,size_t *num_to_copy)
+{
+// grid point data with simple packing and no additional flags
+  if ( (msg->bds_flag & 0xd) != 0) {
+    return 0;
+  }
+  switch (msg->data_rep) {
+    case 0:
+    case 4:
+    case 10:
+    {
+	switch (msg->grid_type) {
+	  case 23:
+	  case 24:
+	  case 26:
+	  case 63:
+	  case 64:
+	  {
+// the first packed value of these grids is not a gridpoint
+	    return 0;
+	  }
+	}
+	break;
+    }
+    case 1:
+    case 3:
+    case 5:
+    {
+	break;
+    }
+    default:
+    {
+	return 0;
+    }
+  }
+  size_t num_points=msg->nx*msg->ny;
+  if (msg->bms_included) {
+    if (msg->bitmap_len != num_points) {
+	return 0;
+    }
+// the number of values is the number of bits that are on in the bitmap
+    unsigned char *b=&msg->buffer[msg->bms_off/8+6];
+    size_t cnt=0;
+    for (size_t n=0; n < num_points/8; ++n) {
+#if defined(__GNUC__)
+	cnt+=__builtin_popcount(b[n]);
+#else
+	for (unsigned char octet=b[n]; octet != 0; octet&=octet-1) {
+	  ++cnt;
+	}
+#endif
+    }
+    for (size_t n=num_points/8*8; n < num_points; ++n) {
+	cnt+=(b[n/8] >> (7-(n % 8))) & 0x1;
+    }
+    *num_to_copy=cnt;
+  }
+  else {
+    *num_to_copy=num_points;
+  }
+  if (msg->pack_width > 0 && *num_to_copy > msg->num_packed) {
+    return 0;
+  }
+  return 1;
+}
+
+/* copy_BMS packs the Bit Map Section from the bitmap in the GRIB1 message,
+**   without unpacking it
+*/
+void copy_BMS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+{
+// length of the BMS
+  size_t length=6;
+  if (msg->bms_included) {
+    length+=(msg->bitmap_len+7)/8;
+  }
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,6,*offset+32,8);
+  if (length > 6) {
+// bitmap indicator
+    set_bits(grib2_buffer,0,*offset+40,8);
+// bitmap
+    copy_bits(&grib2_buffer[*offset/8+6],&msg->buffer[msg->bms_off/8+6],msg->bitmap_len);
+  }
+  else {
+// bitmap indicator
+    set_bits(grib2_buffer,255,*offset+40,8);
+  }
+  (*offset)+=length*8;
+}
+
+/* copy_DS packs the Data Section from the packed data values in the GRIB1
+**   message, without unpacking them
+*/
+void copy_DS(GRIBMessage *msg,size_t num_to_copy,unsigned char *grib2_buffer,size_t *offset)
+{
+  size_t bits=num_to_copy*msg->pack_width;
+// length of the DS
+  size_t length=5+(bits+7)/8;
+  set_bits(grib2_buffer,length,*offset,32);
+// section number
+  set_bits(grib2_buffer,7,*offset+32,8);
+// packed data values - they start 11 octets into the GRIB1 BDS
+  copy_bits(&grib2_buffer[*offset/8+5],&msg->buffer[msg->bds_off/8+11],bits);
+  (*offset)+=length*8;
+}
+
+/* ComplexPacking holds a field that has been prepared for complex packing with
+**   second-order spatial differencing (DRS Template 5.3)
+**   vals:            the second-order differences, less 'omin', for each
+**                      gridpoint
+**   miss:            1 for gridpoints that are missing, otherwise 0
+**   capacity:        the capacity of 'vals' and 'miss'
+**   miss_val_mgmt:   1 if the field has missing values, which are then coded
+**                      in the groups, otherwise 0
+**   num_groups:      the number of groups
+**   ref_vals:        the reference value of each group
+**   widths:          the bit width of each group
+**   lengths:         the number of values in each group
+**   group_capacity:  the capacity of 'ref_vals', 'widths' and 'lengths'
+**   first_vals:      the first two (undifferenced) scaled values
+**   omin:            the overall minimum of the second-order differences
+**   order_vals_width: number of octets for 'first_vals' and 'omin'
+**   ref_width:       bit width of the group reference values
+**   width_width:     bit width of the group widths
+**   length_ref:      reference for the group lengths
+**   length_width:    bit width of the group lengths
+**   ds_len:          the length in octets of the Data Section
+*/
+typedef struct {
+  long long *vals;
+  unsigned char *miss;
+  size_t capacity;
+  int miss_val_mgmt;
+  int num_groups;
+  int *ref_vals,*widths,*lengths;
+  size_t group_capacity;
+  long long first_vals[2],omin;
+  int order_vals_width,ref_width,width_width,length_ref,length_width;
+  size_t ds_len;
+} ComplexPacking;
+
+/* the number of gridpoints in each of the initial segments that are merged into
+**   groups */
+const int COMPLEX_SEGMENT_LENGTH=8;
+
+void initialize_complex_packing(ComplexPacking *cp)
+{
+  cp->vals=NULL;
+  cp->miss=NULL;
+  cp->capacity=0;
+  cp->ref_vals=cp->widths=cp->lengths=NULL;
+  cp->group_capacity=0;
+}
+
+typedef struct {
+  size_t len,nmiss;
+  int min,max;
+} GroupStats;
+
+/* group_width returns the bit width of a group; with missing value management,
+**   the largest value for the width of every group is reserved as the missing
+**   value, and groups that are entirely missing or entirely the same value
+**   have a width of zero */
+int group_width(GroupStats *g,int miss_val_mgmt)
+{
+  if (g->nmiss == g->len || (g->nmiss == 0 && g->max == g->min)) {
+    return 0;
+  }
+  if (miss_val_mgmt == 1) {
+    return bit_width((unsigned long long)(g->max-g->min)+1);
+  }
+  return bit_width(g->max-g->min);
+}
+
+void add_group(ComplexPacking *cp,GroupStats *g)
+{
+  cp->ref_vals[cp->num_groups]= (g->nmiss == g->len) ? -1 : g->min;
+  cp->widths[cp->num_groups]=group_width(g,cp->miss_val_mgmt);
+  cp->lengths[cp->num_groups]=g->len;
+  ++cp->num_groups;
+}
+
+/* prepare_complex_packing computes the second-order spatial differences of the
+**   scaled gridpoint values and splits them into groups (split method 1,
+**   general group splitting) - segments of COMPLEX_SEGMENT_LENGTH gridpoints
+**   are merged into the current group whenever that costs fewer bits than
+**   starting a new group; missing gridpoints are coded in the groups (missing
+**   value management 1), so no bitmap is needed
+**
+** returns 0 if the field was prepared, or 1 if the field should be simple
+**   packed instead (constant fields, fewer than three non-missing values, or
+**   differences too large to pack)
+*/
+int prepare_complex_packing(GRIBMessage *msg,ComplexPacking *cp)
+{
+  size_t num_points=msg->nx*msg->ny;
+  if (msg->pack_width == 0 || num_points < 3) {
+    return 1;
+  }
+  if (num_points > cp->capacity) {
+    if (cp->vals != NULL) {
+	free(cp->vals);
+	free(cp->miss);
+    }
+    cp->capacity=num_points;
+    cp->vals=(long long *)malloc(cp->capacity*sizeof(long long));
+    cp->miss=(unsigned char *)malloc(cp->capacity*sizeof(unsigned char));
+  }
+// scale the values exactly as for simple packing and compute the second-order
+// differences over the non-missing values
+  float d=pow(10.,msg->D);
+  float e=pow(2.,msg->E);
+  long long x1=0,x2=0;
+  long long omin=0,omax=0;
+  size_t num_vals=0;
+  size_t first_idx[2];
+  for (size_t n=0; n < num_points; ++n) {
+    if (msg->gridpoints[n] == GRIB_MISSING_VALUE) {
+	cp->miss[n]=1;
+	continue;
+    }
+    cp->miss[n]=0;
+    long long x=lround((msg->gridpoints[n]-msg->ref_val)*d/e);
+    if (num_vals < 2) {
+	cp->first_vals[num_vals]=x;
+	first_idx[num_vals]=n;
+    }
+    else {
+	cp->vals[n]=x-2*x1+x2;
+	if (num_vals == 2 || cp->vals[n] < omin) {
+	  omin=cp->vals[n];
+	}
+	if (num_vals == 2 || cp->vals[n] > omax) {
+	  omax=cp->vals[n];
+	}
+    }
+    x2=x1;
+    x1=x;
+    ++num_vals;
+  }
+  if (num_vals < 3 || omax-omin >= 0x40000000 || cp->first_vals[0] < 0 || cp->first_vals[1] < 0) {
+    return 1;
+  }
+  cp->omin=omin;
+  cp->miss_val_mgmt= (num_vals < num_points) ? 1 : 0;
+// the positions of the first values are not used by the decoder; give them a
+// difference of 'omin' so that they pack as zeros
+  cp->vals[first_idx[0]]=cp->vals[first_idx[1]]=omin;
+  for (size_t n=0; n < num_points; ++n) {
+    cp->vals[n]= (cp->miss[n] == 1) ? 0 : cp->vals[n]-omin;
+  }
+// split the differences into groups
+  size_t max_groups=(num_points+COMPLEX_SEGMENT_LENGTH-1)/COMPLEX_SEGMENT_LENGTH;
+  if (max_groups > cp->group_capacity) {
+    if (cp->ref_vals != NULL) {
+	free(cp->ref_vals);
+	free(cp->widths);
+	free(cp->lengths);
+    }
+    cp->group_capacity=max_groups;
+    cp->ref_vals=(int *)malloc(cp->group_capacity*sizeof(int));
+    cp->widths=(int *)malloc(cp->group_capacity*sizeof(int));
+    cp->lengths=(int *)malloc(cp->group_capacity*sizeof(int));
+  }
+  int est_ref_width=bit_width(omax-omin+1);
+  size_t overhead=est_ref_width+bit_width(est_ref_width)+8;
+  cp->num_groups=0;
+  GroupStats cur;
+  cur.len=0;
+  for (size_t start=0; start < num_points; start+=COMPLEX_SEGMENT_LENGTH) {
+    GroupStats seg;
+    seg.len=seg.nmiss=0;
+    size_t end= (start+COMPLEX_SEGMENT_LENGTH < num_points) ? start+COMPLEX_SEGMENT_LENGTH : num_points;
+    for (size_t n=start; n < end; ++n) {
+	if (cp->miss[n] == 1) {
+	  ++seg.nmiss;
+	}
+	else if (seg.len == seg.nmiss) {
+	  seg.min=seg.max=cp->vals[n];
+	}
+	else if (cp->vals[n] < seg.min) {
+	  seg.min=cp->vals[n];
+	}
+	else if (cp->vals[n] > seg.max) {
+	  seg.max=cp->vals[n];
+	}
+	++seg.len;
+    }
+    if (cur.len == 0) {
+	cur=seg;
+	continue;
+    }
+    GroupStats merged;
+    merged.len=cur.len+seg.len;
+    merged.nmiss=cur.nmiss+seg.nmiss;
+    if (cur.nmiss == cur.len) {
+	merged.min=seg.min;
+	merged.max=seg.max;
+    }
+    else if (seg.nmiss == seg.len) {
+	merged.min=cur.min;
+	merged.max=cur.max;
+    }
+    else {
+	merged.min= (seg.min < cur.min) ? seg.min : cur.min;
+	merged.max= (seg.max > cur.max) ? seg.max : cur.max;
+    }
+    if (merged.len*group_width(&merged,cp->miss_val_mgmt) <= cur.len*group_width(&cur,cp->miss_val_mgmt)+seg.len*group_width(&seg,cp->miss_val_mgmt)+overhead) {
+	cur=merged;
+    }
+    else {
+	add_group(cp,&cur);
+	cur=seg;
+    }
+  }
+  add_group(cp,&cur);
+// with missing value management, the largest group reference value is reserved
+// to flag groups of missing values; the decoder does not handle fields of zero
+// width, so the reference values, widths and lengths are always at least one
+// bit wide
+  int max_ref=0,max_width=0;
+  for (int n=0; n < cp->num_groups; ++n) {
+    if (cp->ref_vals[n] > max_ref) {
+	max_ref=cp->ref_vals[n];
+    }
+    if (cp->widths[n] > max_width) {
+	max_width=cp->widths[n];
+    }
+  }
+  cp->ref_width=bit_width((unsigned long long)max_ref+cp->miss_val_mgmt);
+  if (cp->ref_width == 0) {
+    cp->ref_width=1;
+  }
+  for (int n=0; n < cp->num_groups; ++n) {
+    if (cp->ref_vals[n] < 0) {
+	cp->ref_vals[n]=(1 << cp->ref_width)-1;
+    }
+  }
+  cp->width_width=bit_width(max_width);
+  if (cp->width_width == 0) {
+    cp->width_width=1;
+  }
+  cp->length_ref=0;
+  int max_length=0;
+  if (cp->num_groups > 1) {
+    cp->length_ref=cp->lengths[0];
+    for (int n=0; n < cp->num_groups-1; ++n) {
+	if (cp->lengths[n] < cp->length_ref) {
+	  cp->length_ref=cp->lengths[n];
+	}
+	if (cp->lengths[n] > max_length) {
+	  max_length=cp->lengths[n];
+	}
     }
+    max_length-=cp->length_ref;
   }
-  (*offset)+=length*8;
+  cp->length_width=bit_width(max_length);
+  if (cp->length_width == 0) {
+    cp->length_width=1;
+  }
+// octets needed for the first values and for the sign and magnitude of 'omin'
+  cp->order_vals_width=1;
+  long long max_first= (cp->first_vals[0] > cp->first_vals[1]) ? cp->first_vals[0] : cp->first_vals[1];
+  long long abs_omin= (omin < 0) ? -omin : omin;
+  while (bit_width(max_first) > cp->order_vals_width*8 || bit_width(abs_omin) > cp->order_vals_width*8-1) {
+    ++cp->order_vals_width;
+  }
+  if (cp->order_vals_width > 4) {
+    return 1;
+  }
+  size_t data_bits=0;
+  for (int n=0; n < cp->num_groups; ++n) {
+    data_bits+=(size_t)cp->lengths[n]*cp->widths[n];
+  }
+  cp->ds_len=5+3*cp->order_vals_width+(cp->num_groups*cp->ref_width+7)/8+(cp->num_groups*cp->width_width+7)/8+(cp->num_groups*cp->length_width+7)/8+(data_bits+7)/8;
+  return 0;
 }
 
-void pack_DRS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+void pack_complex_DRS(GRIBMessage *msg,ComplexPacking *cp,unsigned char *grib2_buffer,size_t *offset)
 {
 // length of the DRS
-  size_t length=21;
+  size_t length=49;
   set_bits(grib2_buffer,length,*offset,32);
 // section number
   set_bits(grib2_buffer,5,*offset+32,8);
-// number of data points
+// number of data points - all gridpoints are coded in the Data Section
   set_bits(grib2_buffer,msg->nx*msg->ny,*offset+40,32);
 // template number
-  set_bits(grib2_buffer,0,*offset+72,16);
+  set_bits(grib2_buffer,3,*offset+72,16);
 // reference value
   union {
     float f;
@@ -2588,155 +1515,774 @@ void pack_DRS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
     D=0x8000-D;
   }
   set_bits(grib2_buffer,D,*offset+136,16);
-// packed value width
-  set_bits(grib2_buffer,msg->pack_width,*offset+152,8);
+// bit width of the group reference values
+  set_bits(grib2_buffer,cp->ref_width,*offset+152,8);
 // type of original values
   set_bits(grib2_buffer,0,*offset+160,8);
+// group splitting method
+  set_bits(grib2_buffer,1,*offset+168,8);
+// missing value management - primary missing values are in the data values
+  set_bits(grib2_buffer,cp->miss_val_mgmt,*offset+176,8);
+// primary and secondary missing value substitutes
+  u.f=GRIB_MISSING_VALUE;
+  set_bits(grib2_buffer,u.i,*offset+184,32);
+  set_bits(grib2_buffer,u.i,*offset+216,32);
+// number of groups
+  set_bits(grib2_buffer,cp->num_groups,*offset+248,32);
+// reference and bit width for the group widths
+  set_bits(grib2_buffer,0,*offset+280,8);
+  set_bits(grib2_buffer,cp->width_width,*offset+288,8);
+// reference, increment, last length and bit width for the group lengths
+  set_bits(grib2_buffer,cp->length_ref,*offset+296,32);
+  set_bits(grib2_buffer,1,*offset+328,8);
+  set_bits(grib2_buffer,cp->lengths[cp->num_groups-1],*offset+336,32);
+  set_bits(grib2_buffer,cp->length_width,*offset+368,8);
+// order of spatial differencing
+  set_bits(grib2_buffer,2,*offset+376,8);
+// number of octets for the extra descriptors
+  set_bits(grib2_buffer,cp->order_vals_width,*offset+384,8);
   (*offset)+=length*8;
 }
 
-void pack_BMS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+void pack_complex_DS(ComplexPacking *cp,unsigned char *grib2_buffer,size_t *offset)
 {
-// length of the BMS
-  size_t length=6;
-  if (msg->bms_included) {
-    length+=(msg->bitmap_len+7)/8;
+// length of the DS
+  set_bits(grib2_buffer,cp->ds_len,*offset,32);
+// section number
+  set_bits(grib2_buffer,7,*offset+32,8);
+  BitWriter bw;
+  bitwriter_init(&bw,grib2_buffer,*offset+40);
+// first values and the overall minimum of the differences
+  int ovw_bits=cp->order_vals_width*8;
+  for (size_t n=0; n < 2; ++n) {
+    bitwriter_put(&bw,cp->first_vals[n],ovw_bits);
+  }
+  if (cp->omin < 0) {
+    bitwriter_put(&bw,1,1);
+    bitwriter_put(&bw,-cp->omin,ovw_bits-1);
+  }
+  else {
+    bitwriter_put(&bw,cp->omin,ovw_bits);
+  }
+// group reference values, widths and lengths, each padded to an octet boundary
+  for (int n=0; n < cp->num_groups; ++n) {
+    bitwriter_put(&bw,cp->ref_vals[n],cp->ref_width);
+  }
+  bitwriter_init(&bw,grib2_buffer,(bitwriter_flush(&bw)+7)/8*8);
+  for (int n=0; n < cp->num_groups; ++n) {
+    bitwriter_put(&bw,cp->widths[n],cp->width_width);
+  }
+  bitwriter_init(&bw,grib2_buffer,(bitwriter_flush(&bw)+7)/8*8);
+  for (int n=0; n < cp->num_groups-1; ++n) {
+    bitwriter_put(&bw,cp->lengths[n]-cp->length_ref,cp->length_width);
+  }
+  bitwriter_put(&bw,0,cp->length_width);
+  bitwriter_init(&bw,grib2_buffer,(bitwriter_flush(&bw)+7)/8*8);
+// the packed differences
+  size_t idx=0;
+  for (int n=0; n < cp->num_groups; ++n) {
+    int width=cp->widths[n];
+    if (width == 0) {
+	idx+=cp->lengths[n];
+	continue;
+    }
+    unsigned int miss_val=(1U << width)-1;
+    for (size_t end=idx+cp->lengths[n]; idx < end; ++idx) {
+	bitwriter_put(&bw,(cp->miss[idx] == 1) ? miss_val : (unsigned int)(cp->vals[idx]-cp->ref_vals[n]),width);
+    }
+  }
+  bitwriter_flush(&bw);
+  (*offset)+=cp->ds_len*8;
+}
+
+/* CompressedPacking holds a field that has been compressed for JPEG 2000 (DRS
+**   Template 5.40) or CCSDS (DRS Template 5.42) packing
+**   pvals:      the scaled values of the gridpoints that are not missing
+**   num_vals:   the number of values in 'pvals'
+**   pcapacity:  the capacity of 'pvals'
+**   samples:    'pvals' as a stream of big-endian samples for the CCSDS
+**                 encoder
+**   scapacity:  the capacity of 'samples'
+**   data:       the compressed code stream for the Data Section
+**   data_len:   the length in octets of the compressed code stream
+**   dcapacity:  the capacity of 'data'
+*/
+typedef struct {
+  int *pvals;
+  size_t num_vals,pcapacity;
+  unsigned char *samples;
+  size_t scapacity;
+  unsigned char *data;
+  size_t data_len,dcapacity;
+} CompressedPacking;
+
+void initialize_compressed_packing(CompressedPacking *cmp)
+{
+  cmp->pvals=NULL;
+  cmp->num_vals=cmp->pcapacity=0;
+  cmp->samples=NULL;
+  cmp->scapacity=0;
+  cmp->data=NULL;
+  cmp->data_len=cmp->dcapacity=0;
+}
+
+/* scale_values fills 'pvals' with the scaled values of the gridpoints that are
+**   not missing, exactly as pack_DS would pack them
+*/
+void scale_values(GRIBMessage *msg,CompressedPacking *cmp)
+{
+  size_t num_points=msg->nx*msg->ny;
+  if (num_points > cmp->pcapacity) {
+    if (cmp->pvals != NULL) {
+	free(cmp->pvals);
+    }
+    cmp->pcapacity=num_points;
+    cmp->pvals=(int *)malloc(cmp->pcapacity*sizeof(int));
+  }
+  float d=pow(10.,msg->D);
+  float e=pow(2.,msg->E);
+  cmp->num_vals=0;
+  for (size_t n=0; n < num_points; ++n) {
+    if (msg->gridpoints[n] != GRIB_MISSING_VALUE) {
+	cmp->pvals[cmp->num_vals++]=lround((msg->gridpoints[n]-msg->ref_val)*d/e);
+    }
+  }
+}
+
+void reserve_compressed_data(CompressedPacking *cmp,size_t len)
+{
+  if (len > cmp->dcapacity) {
+    if (cmp->data != NULL) {
+	free(cmp->data);
+    }
+    cmp->dcapacity=len;
+    cmp->data=(unsigned char *)malloc(cmp->dcapacity*sizeof(unsigned char));
+  }
+}
+
+#ifdef AEC
+/* CCSDS encoder options for DRS Template 5.42: samples are preprocessed and
+**   stored most significant byte first, and 17- to 24-bit samples are stored
+**   in three octets
+*/
+const int CCSDS_FLAGS=AEC_DATA_3BYTE | AEC_DATA_MSB | AEC_DATA_PREPROCESS;
+const int CCSDS_BLOCK_SIZE=32;
+const int CCSDS_RSI=128;
+
+/* prepare_ccsds_packing compresses the field with the CCSDS encoder
+**   returns 0 if the field was compressed, or 1 if it should be written with
+**   simple packing instead
+*/
+int prepare_ccsds_packing(GRIBMessage *msg,CompressedPacking *cmp)
+{
+// constant fields have no data values to compress
+  if (msg->pack_width == 0) {
+    return 1;
+  }
+  scale_values(msg,cmp);
+  if (cmp->num_vals == 0) {
+    return 1;
+  }
+  size_t nbytes=(msg->pack_width+7)/8;
+  size_t samples_len=cmp->num_vals*nbytes;
+  if (samples_len > cmp->scapacity) {
+    if (cmp->samples != NULL) {
+	free(cmp->samples);
+    }
+    cmp->scapacity=samples_len;
+    cmp->samples=(unsigned char *)malloc(cmp->scapacity*sizeof(unsigned char));
+  }
+  unsigned char *s=cmp->samples;
+  for (size_t n=0; n < cmp->num_vals; ++n) {
+    unsigned int pval=cmp->pvals[n];
+    for (size_t m=nbytes; m > 0; --m) {
+	*s++=pval >> ((m-1)*8);
+    }
+  }
+// the encoded stream can be slightly larger than the samples for noisy data
+  reserve_compressed_data(cmp,samples_len+samples_len/16+256);
+  struct aec_stream strm;
+  strm.next_in=cmp->samples;
+  strm.avail_in=samples_len;
+  strm.next_out=cmp->data;
+  strm.avail_out=cmp->dcapacity;
+  strm.bits_per_sample=msg->pack_width;
+  strm.block_size=CCSDS_BLOCK_SIZE;
+  strm.rsi=CCSDS_RSI;
+  strm.flags=CCSDS_FLAGS;
+  if (aec_buffer_encode(&strm) != AEC_OK) {
+    fprintf(stderr,"Warning: CCSDS encoding failed for GRIB1 parameter %d - using simple packing\n",msg->param);
+    return 1;
+  }
+  cmp->data_len=strm.total_out;
+  return 0;
+}
+#endif
+
+#ifdef OPENJPEG
+/* J2KStream is the in-memory destination of the JPEG 2000 encoder */
+typedef struct {
+  CompressedPacking *cmp;
+  size_t pos;
+} J2KStream;
+
+OPJ_SIZE_T j2k_write(void *src,OPJ_SIZE_T nbytes,void *user_data)
+{
+  J2KStream *j=(J2KStream *)user_data;
+  if (j->pos+nbytes > j->cmp->dcapacity) {
+    size_t capacity=(j->pos+nbytes)*2;
+    unsigned char *data=(unsigned char *)malloc(capacity*sizeof(unsigned char));
+    if (j->cmp->data != NULL) {
+	memcpy(data,j->cmp->data,j->cmp->data_len);
+	free(j->cmp->data);
+    }
+    j->cmp->data=data;
+    j->cmp->dcapacity=capacity;
+  }
+  memcpy(&j->cmp->data[j->pos],src,nbytes);
+  j->pos+=nbytes;
+  if (j->pos > j->cmp->data_len) {
+    j->cmp->data_len=j->pos;
+  }
+  return nbytes;
+}
+
+OPJ_OFF_T j2k_skip(OPJ_OFF_T nbytes,void *user_data)
+{
+  J2KStream *j=(J2KStream *)user_data;
+  j->pos+=nbytes;
+  return nbytes;
+}
+
+OPJ_BOOL j2k_seek(OPJ_OFF_T pos,void *user_data)
+{
+  J2KStream *j=(J2KStream *)user_data;
+  j->pos=pos;
+  return OPJ_TRUE;
+}
+
+/* prepare_jpeg2000_packing compresses the field losslessly with the JPEG 2000
+**   encoder
+**   returns 0 if the field was compressed, or 1 if it should be written with
+**   simple packing instead
+*/
+int prepare_jpeg2000_packing(GRIBMessage *msg,CompressedPacking *cmp)
+{
+// constant fields have no data values to compress
+  if (msg->pack_width == 0 || msg->pack_width > 31) {
+    return 1;
   }
+  scale_values(msg,cmp);
+  if (cmp->num_vals == 0) {
+    return 1;
+  }
+// the image is the grid, unless there is a bitmap, in which case it is a
+// single row of the values that are not missing
+  size_t width=msg->nx,height=msg->ny;
+  if (cmp->num_vals != width*height) {
+    width=cmp->num_vals;
+    height=1;
+  }
+  opj_image_cmptparm_t cmptparm;
+  memset(&cmptparm,0,sizeof(cmptparm));
+  cmptparm.dx=cmptparm.dy=1;
+  cmptparm.w=width;
+  cmptparm.h=height;
+  cmptparm.prec=msg->pack_width;
+  cmptparm.sgnd=0;
+  opj_image_t *image=opj_image_create(1,&cmptparm,OPJ_CLRSPC_GRAY);
+  if (image == NULL) {
+    return 1;
+  }
+  image->x0=image->y0=0;
+  image->x1=width;
+  image->y1=height;
+  memcpy(image->comps[0].data,cmp->pvals,cmp->num_vals*sizeof(int));
+  opj_cparameters_t parameters;
+  opj_set_default_encoder_parameters(&parameters);
+// lossless, single quality layer; the number of resolutions is limited by the
+// smaller image dimension
+  parameters.tcp_numlayers=1;
+  parameters.tcp_rates[0]=0;
+  parameters.cp_disto_alloc=1;
+  parameters.irreversible=0;
+  size_t min_dim=(width < height) ? width : height;
+  parameters.numresolution=1;
+  while (parameters.numresolution < 6 && (min_dim >> parameters.numresolution) > 0) {
+    ++parameters.numresolution;
+  }
+  opj_codec_t *codec=opj_create_compress(OPJ_CODEC_J2K);
+  opj_stream_t *stream=opj_stream_default_create(OPJ_FALSE);
+  J2KStream j;
+  j.cmp=cmp;
+  j.pos=0;
+  cmp->data_len=0;
+  opj_stream_set_write_function(stream,j2k_write);
+  opj_stream_set_skip_function(stream,j2k_skip);
+  opj_stream_set_seek_function(stream,j2k_seek);
+  opj_stream_set_user_data(stream,&j,NULL);
+  int status=0;
+  if (!opj_setup_encoder(codec,&parameters,image) || !opj_start_compress(codec,image,stream) || !opj_encode(codec,stream) || !opj_end_compress(codec,stream)) {
+    fprintf(stderr,"Warning: JPEG 2000 encoding failed for GRIB1 parameter %d - using simple packing\n",msg->param);
+    status=1;
+  }
+  opj_stream_destroy(stream);
+  opj_destroy_codec(codec);
+  opj_image_destroy(image);
+  return status;
+}
+#endif
+
+/* pack_compressed_DRS packs the DRS for JPEG 2000 (Template 5.40) and CCSDS
+**   (Template 5.42) packing
+*/
+void pack_compressed_DRS(GRIBMessage *msg,CompressedPacking *cmp,int drs_templ_num,unsigned char *grib2_buffer,size_t *offset)
+{
+// length of the DRS
+  size_t length=(drs_templ_num == 42) ? 25 : 23;
   set_bits(grib2_buffer,length,*offset,32);
 // section number
-  set_bits(grib2_buffer,6,*offset+32,8);
-  if (length > 6) {
-// bitmap indicator
-    set_bits(grib2_buffer,0,*offset+40,8);
-// bitmap
-    size_t off=*offset+48;
-    for (size_t n=0; n < msg->bitmap_len; ++n) {
-	int bval=msg->bitmap[n];
-	set_bits(grib2_buffer,bval,off,1);
-	++off;
-    }
+  set_bits(grib2_buffer,5,*offset+32,8);
+// number of data points - only the values that are not missing are coded
+  set_bits(grib2_buffer,cmp->num_vals,*offset+40,32);
+// template number
+  set_bits(grib2_buffer,drs_templ_num,*offset+72,16);
+// reference value
+  union {
+    float f;
+    int i;
+  } u;
+  u.f=msg->ref_val*pow(10.,msg->D);
+  set_bits(grib2_buffer,u.i,*offset+88,32);
+// binary scale factor
+  float E=msg->E;
+  if (E < 0) {
+    E=0x8000-E;
+  }
+  set_bits(grib2_buffer,E,*offset+120,16);
+// decimal scale factor
+  float D=msg->D;
+  if (D < 0) {
+    D=0x8000-D;
+  }
+  set_bits(grib2_buffer,D,*offset+136,16);
+// packed value width
+  set_bits(grib2_buffer,msg->pack_width,*offset+152,8);
+// type of original values
+  set_bits(grib2_buffer,0,*offset+160,8);
+  if (drs_templ_num == 42) {
+#ifdef AEC
+// CCSDS compression options, block size and reference sample interval
+    set_bits(grib2_buffer,CCSDS_FLAGS,*offset+168,8);
+    set_bits(grib2_buffer,CCSDS_BLOCK_SIZE,*offset+176,8);
+    set_bits(grib2_buffer,CCSDS_RSI,*offset+184,16);
+#endif
   }
   else {
-// bitmap indicator
-    set_bits(grib2_buffer,255,*offset+40,8);
+// type of compression (lossless) and target compression ratio (missing)
+    set_bits(grib2_buffer,0,*offset+168,8);
+    set_bits(grib2_buffer,255,*offset+176,8);
   }
   (*offset)+=length*8;
 }
 
-void pack_DS(GRIBMessage *msg,unsigned char *grib2_buffer,size_t *offset)
+void pack_compressed_DS(CompressedPacking *cmp,unsigned char *grib2_buffer,size_t *offset)
 {
 // length of the DS
-  size_t length=5+(msg->nx*msg->ny*msg->pack_width+7)/8;
+  size_t length=5+cmp->data_len;
   set_bits(grib2_buffer,length,*offset,32);
 // section number
   set_bits(grib2_buffer,7,*offset+32,8);
-  size_t off=*offset+40;
-  float d=pow(10.,msg->D);
-  float e=pow(2.,msg->E);
-  for (size_t n=0; n < msg->nx*msg->ny; ++n) {
-    if (msg->gridpoints[n] != GRIB_MISSING_VALUE) {
-	int pval=lround((msg->gridpoints[n]-msg->ref_val)*d/e);
-	set_bits(grib2_buffer,pval,off,msg->pack_width);
-	off+=msg->pack_width;
-    }
-  }
+  memcpy(&grib2_buffer[*offset/8+5],cmp->data,cmp->data_len);
   (*offset)+=length*8;
 }
 
-int main(int argc,char **argv)
+/* Conversion holds everything needed to convert one GRIB1 message into GRIB2
+**   (see grib_convert.c)
+**   grib_msg:        the GRIB1 message
+**   drs_templ_num:   the requested DRS Template for the GRIB2 message
+**   cp:              work space for complex packing
+**   cmp:             work space for JPEG 2000 and CCSDS packing
+*/
+struct Conversion {
+  GRIBMessage grib_msg;
+  int drs_templ_num;
+  ComplexPacking cp;
+  CompressedPacking cmp;
+};
+
+/* create_conversion returns a new Conversion for the DRS Template that
+**   'options' points to
+*/
+Conversion *create_conversion(const void *options,int num_threads)
 {
-  if (argc != 3) {
-    fprintf(stderr,"usage: %s GRIB1_file_name GRIB2_file_name\n",argv[0]);
-    exit(1);
+  Conversion *conv=(Conversion *)malloc(sizeof(Conversion));
+  if (conv == NULL) {
+    return NULL;
   }
-  FILE *ifile;
-  if ( (ifile=fopen(argv[1],"rb")) == NULL) {
-    fprintf(stderr,"Error opening input file %s\n",argv[1]);
-    exit(1);
+  initialize(&conv->grib_msg);
+  conv->grib_msg.num_threads=num_threads;
+  conv->drs_templ_num=*(const int *)options;
+  initialize_complex_packing(&conv->cp);
+  initialize_compressed_packing(&conv->cmp);
+  return conv;
+}
+
+void free_conversion(Conversion *conv)
+{
+  free_grib_message(&conv->grib_msg);
+  free(conv->cp.vals);
+  free(conv->cp.miss);
+  free(conv->cp.ref_vals);
+  free(conv->cp.widths);
+  free(conv->cp.lengths);
+  free(conv->cmp.pvals);
+  free(conv->cmp.samples);
+  free(conv->cmp.data);
+  free(conv);
+}
+
+/* convert_message unpacks a GRIB1 message that has been read by unpack_IS and
+**   packs it, as a complete GRIB2 message, directly into 'ow'; it returns 1,
+**   or 0 if the message can't be unpacked and is skipped with a warning
+*/
+size_t convert_message(Conversion *conv,OutputWriter *ow)
+{
+  GRIBMessage *grib_msg=&conv->grib_msg;
+  if (unpack_PDS(grib_msg) != 0 || (grib_msg->gds_included == 1 && unpack_GDS(grib_msg) != 0) || unpack_BDS_header(grib_msg) != 0) {
+    fprintf(stderr,"Warning: skipping a message: %s\n",grib_msg->error);
+    return 0;
   }
-  FILE *ofile;
-  if ( (ofile=fopen(argv[2],"wb")) == NULL) {
-    fprintf(stderr,"Error opening output file %s\n",argv[2]);
-    exit(1);
+// simple packing copies the packed data values from the GRIB1 message when it
+// can, so that the gridpoints don't have to be unpacked and packed again
+  size_t num_to_copy=0;
+  int copy_data=(conv->drs_templ_num == 0 && can_copy_packed_data(grib_msg,&num_to_copy));
+  if (!copy_data && unpack_BDS_data(grib_msg) != 0) {
+    fprintf(stderr,"Warning: skipping a message: %s\n",grib_msg->error);
+    return 0;
   }
-  GRIBMessage grib_msg;
-  initialize(&grib_msg);
-  int status;
-  size_t nmsg=0;
-  size_t max_buffer_length=0;
-  unsigned char *grib2_buffer=NULL;
-  char head[]={'G','R','I','B',0,0,0,2,0,0,0,0,0,0,0,0};
-  char tail[]={'7','7','7','7'};
-  long long length;
-  while ( (status=unpackgrib1(ifile,&grib_msg)) == 0) {
-    ++nmsg;
 // Identification Section
-    length=21;
+  size_t length=21;
 // Grid Definition Section
-    if (grib_msg.data_rep == 3) {
-	length+=81;
-    }
-    else {
-	length+=72;
-    }
+  if (grib_msg->data_rep == 3) {
+    length+=81;
+  }
+  else {
+    length+=72;
+  }
 // Product Definition Section
-    if (grib_msg.t_range <= 1 || grib_msg.t_range == 10) {
-	length+=34;
+  if (grib_msg->t_range <= 1 || grib_msg->t_range == 10) {
+    length+=34;
+  }
+  else if (grib_msg->t_range >= 2 && grib_msg->t_range <= 4) {
+    length+=58;
+  }
+  else {
+    fprintf(stderr,"Unable to convert time range indicator %d\n",grib_msg->t_range);
+    exit(1);
+  }
+// the packing falls back to simple packing for fields that can't be packed as
+// requested
+  int drs_templ_num=0;
+  switch (conv->drs_templ_num) {
+    case 3:
+    {
+	if (prepare_complex_packing(grib_msg,&conv->cp) == 0) {
+	  drs_templ_num=3;
+	}
+	break;
     }
-    else if (grib_msg.t_range >= 2 && grib_msg.t_range <= 4) {
-	length+=58;
+#ifdef OPENJPEG
+    case 40:
+    {
+	if (prepare_jpeg2000_packing(grib_msg,&conv->cmp) == 0) {
+	  drs_templ_num=40;
+	}
+	break;
     }
-    else {
-	fprintf(stderr,"Unable to convert time range indicator %d\n",grib_msg.t_range);
-	exit(1);
+#endif
+#ifdef AEC
+    case 42:
+    {
+	if (prepare_ccsds_packing(grib_msg,&conv->cmp) == 0) {
+	  drs_templ_num=42;
+	}
+	break;
     }
+#endif
+  }
+  switch (drs_templ_num) {
+    case 0:
+    {
 // Data Representation Section
-    length+=21;
+	length+=21;
 // Bit-map Section
-    length+=6;
-    if (grib_msg.bms_included) {
-	length+=(grib_msg.bitmap_len+7)/8;
-    }
+	length+=6;
+	if (grib_msg->bms_included) {
+	  length+=(grib_msg->bitmap_len+7)/8;
+	}
 // Data Section
-    length+=5+(grib_msg.nx*grib_msg.ny*grib_msg.pack_width+7)/8;
-// allocate enough memory for the GRIB2 buffer
-    if (length > max_buffer_length) {
-	if (grib2_buffer != NULL) {
-	  free(grib2_buffer);
+	if (copy_data) {
+	  length+=5+(num_to_copy*grib_msg->pack_width+7)/8;
+	}
+	else {
+	  length+=5+(grib_msg->nx*grib_msg->ny*grib_msg->pack_width+7)/8;
 	}
-	max_buffer_length=length;
-	grib2_buffer=(unsigned char *)malloc(max_buffer_length*sizeof(unsigned char));
+	break;
     }
-    int discipline,parameter_category,parameter_number;
-    map_GRIB1_parameter_into_GRIB2(&grib_msg,&discipline,&parameter_category,&parameter_number);
-    if (discipline == 255) {
-	fprintf(stderr,"Warning: unable to map GRIB1 parameter %d (ctr-%d table_ver-%d) into GRIB2\n",grib_msg.param,grib_msg.center_id,grib_msg.table_ver);
+    case 3:
+    {
+// Data Representation Section
+	length+=49;
+// Bit-map Section - missing values are coded in the Data Section
+	length+=6;
+// Data Section
+	length+=conv->cp.ds_len;
+	break;
+    }
+    default:
+    {
+// Data Representation Section
+	length+=(drs_templ_num == 42) ? 25 : 23;
+// Bit-map Section
+	length+=6;
+	if (grib_msg->bms_included) {
+	  length+=(grib_msg->bitmap_len+7)/8;
+	}
+// Data Section
+	length+=5+conv->cmp.data_len;
     }
-    size_t offset=0;
+  }
+// build the GRIB2 message, including the Indicator Section and the End
+// Section, directly in the output buffer
+  length+=16+4;
+  unsigned char *is=reserve_output(ow,length);
+  int discipline,parameter_category,parameter_number;
+  map_GRIB1_parameter_into_GRIB2(grib_msg,&discipline,&parameter_category,&parameter_number);
+  if (discipline == 255) {
+    fprintf(stderr,"Warning: unable to map GRIB1 parameter %d (ctr-%d table_ver-%d) into GRIB2\n",grib_msg->param,grib_msg->center_id,grib_msg->table_ver);
+  }
+// pack the Indicator Section
+  memcpy(is,"GRIB",4);
+  is[4]=is[5]=0;
+  is[6]=discipline;
+  is[7]=2;
+  set_bits(is,(length >> 32),64,32);
+  set_bits(is,(length & 0xffffffff),96,32);
+// Sections 1 through 7 follow the Indicator Section
+  unsigned char *grib2_buffer=&is[16];
+  size_t offset=0;
 // pack the Identification Section
-    pack_IDS(&grib_msg,grib2_buffer,&offset);
+  pack_IDS(grib_msg,grib2_buffer,&offset);
 // pack the Grid Definition Section
-    pack_GDS(&grib_msg,grib2_buffer,&offset);
+  pack_GDS(grib_msg,grib2_buffer,&offset);
 // pack the Product Definition Section
-    pack_PDS(&grib_msg,parameter_category,parameter_number,grib2_buffer,&offset);
+  pack_PDS(grib_msg,parameter_category,parameter_number,grib2_buffer,&offset);
+  switch (drs_templ_num) {
+    case 0:
+    {
+	if (copy_data) {
+// pack the Data Representation Section with the GRIB1 reference value, so that
+// the copied values decode exactly as they did in GRIB1
+	  pack_DRS(grib_msg,ibm2real(grib_msg->buffer,grib_msg->bds_off+48),grib2_buffer,&offset);
+// copy the Bit Map Section
+	  copy_BMS(grib_msg,grib2_buffer,&offset);
+// copy the Data Section
+	  copy_DS(grib_msg,num_to_copy,grib2_buffer,&offset);
+	}
+	else {
+// pack the Data Representation Section
+	  pack_DRS(grib_msg,grib_msg->ref_val*pow(10.,grib_msg->D),grib2_buffer,&offset);
+// pack the Bit Map Section
+	  pack_BMS(grib_msg,1,grib2_buffer,&offset);
+// pack the Data Section
+	  pack_DS(grib_msg,grib2_buffer,&offset);
+	}
+	break;
+    }
+    case 3:
+    {
+// pack the Data Representation Section
+	pack_complex_DRS(grib_msg,&conv->cp,grib2_buffer,&offset);
+// pack the Bit Map Section
+	pack_BMS(grib_msg,0,grib2_buffer,&offset);
+// pack the Data Section
+	pack_complex_DS(&conv->cp,grib2_buffer,&offset);
+	break;
+    }
+    default:
+    {
 // pack the Data Representation Section
-    pack_DRS(&grib_msg,grib2_buffer,&offset);
+	pack_compressed_DRS(grib_msg,&conv->cmp,drs_templ_num,grib2_buffer,&offset);
 // pack the Bit Map Section
-    pack_BMS(&grib_msg,grib2_buffer,&offset);
+	pack_BMS(grib_msg,1,grib2_buffer,&offset);
 // pack the Data Section
-    pack_DS(&grib_msg,grib2_buffer,&offset);
-// output the GRIB2 message
-    size_t l=length+20;
-    set_bits(&head[8],(l >> 32),0,32);
-    set_bits(&head[12],(l & 0xffffffff),0,32);
-    fwrite(head,1,16,ofile);
-    fwrite(grib2_buffer,1,length,ofile);
-    fwrite(tail,1,4,ofile);
+	pack_compressed_DS(&conv->cmp,grib2_buffer,&offset);
+    }
+  }
+// pack the End Section and add the message to the output
+  memcpy(&grib2_buffer[offset/8],"7777",4);
+  commit_output(ow,length);
+  return 1;
+}
+
+/* read_message reads the next message into 'conv' with unpack_IS, skipping
+**   any message whose Indicator Section is damaged, and returns the status of
+**   unpack_IS: 0, GRIB_EOF or GRIB_READ_ERROR
+*/
+int read_message(FILE *fp,Conversion *conv)
+{
+  int status;
+  while ( (status=unpack_IS(fp,&conv->grib_msg)) != 0 && status != GRIB_EOF && status != GRIB_READ_ERROR) {
+    fprintf(stderr,"Warning: skipping a message: %s\n",conv->grib_msg.error);
+  }
+  return status;
+}
+
+void usage(char *program)
+{
+#ifdef PTHREADS
+  fprintf(stderr,"usage: %s [-p packing] [-t threads] [-b megabytes] [-d] GRIB1_file_name GRIB2_file_name\n",program);
+  fprintf(stderr,"       %s [-p packing] [-t threads] [-b megabytes] [-d] -m manifest|directory [-o template]\n",program);
+#else
+  fprintf(stderr,"usage: %s [-p packing] [-b megabytes] [-d] GRIB1_file_name GRIB2_file_name\n",program);
+  fprintf(stderr,"       %s [-p packing] [-b megabytes] [-d] -m manifest|directory [-o template]\n",program);
+#endif
+  fprintf(stderr,"  packing is the data representation of the GRIB2 output:\n");
+  fprintf(stderr,"    simple   - simple packing (DRS Template 5.0); the default\n");
+  fprintf(stderr,"    complex  - complex packing with second-order spatial differencing (DRS\n");
+  fprintf(stderr,"               Template 5.3)\n");
+#ifdef OPENJPEG
+  fprintf(stderr,"    jpeg2000 - lossless JPEG 2000 compression (DRS Template 5.40)\n");
+#endif
+#ifdef AEC
+  fprintf(stderr,"    ccsds    - CCSDS lossless compression (DRS Template 5.42)\n");
+#endif
+#ifdef PTHREADS
+  fprintf(stderr,"  threads is the number of threads that convert messages, or files in batch\n");
+  fprintf(stderr,"    mode (default 1)\n");
+#endif
+  fprintf(stderr,"  megabytes is the size of the output buffer (default 4)\n");
+  fprintf(stderr,"  -d writes the output with direct I/O (O_DIRECT), bypassing the page cache\n");
+  fprintf(stderr,"  -m converts every file named in a manifest (one input file per line,\n");
+  fprintf(stderr,"     optionally followed by its output file), or every file in a directory\n");
+  fprintf(stderr,"  template names the output files in batch mode (default \"%%b.grb2\"); %%f is\n");
+  fprintf(stderr,"     the input file name without its directory and %%b is the same without\n");
+  fprintf(stderr,"     its extension\n");
+  exit(1);
+}
+
+int main(int argc,char **argv)
+{
+  int drs_templ_num=0;
+  int nthreads=1;
+  int output_buffer_size=4;
+  int direct=0;
+  char *batch_list=NULL;
+  char *default_template="%b.grb2";
+  char *output_template=default_template;
+  int next=1;
+  while (next < argc && argv[next][0] == '-') {
+    if (strcmp(argv[next],"-p") == 0 && next+1 < argc) {
+	++next;
+	if (strcmp(argv[next],"simple") == 0) {
+	  drs_templ_num=0;
+	}
+	else if (strcmp(argv[next],"complex") == 0) {
+	  drs_templ_num=3;
+	}
+#ifdef OPENJPEG
+	else if (strcmp(argv[next],"jpeg2000") == 0) {
+	  drs_templ_num=40;
+	}
+#endif
+#ifdef AEC
+	else if (strcmp(argv[next],"ccsds") == 0) {
+	  drs_templ_num=42;
+	}
+#endif
+	else {
+	  usage(argv[0]);
+	}
+    }
+#ifdef PTHREADS
+    else if (strcmp(argv[next],"-t") == 0 && next+1 < argc) {
+	++next;
+	nthreads=atoi(argv[next]);
+	if (nthreads < 1) {
+	  usage(argv[0]);
+	}
+    }
+#endif
+    else if (strcmp(argv[next],"-b") == 0 && next+1 < argc) {
+	++next;
+	output_buffer_size=atoi(argv[next]);
+	if (output_buffer_size < 1) {
+	  usage(argv[0]);
+	}
+    }
+    else if (strcmp(argv[next],"-d") == 0) {
+	direct=1;
+    }
+    else if (strcmp(argv[next],"-m") == 0 && next+1 < argc) {
+	batch_list=argv[++next];
+    }
+    else if (strcmp(argv[next],"-o") == 0 && next+1 < argc) {
+	output_template=argv[++next];
+    }
+    else {
+	usage(argv[0]);
+    }
+    ++next;
+  }
+  build_parameter_hash();
+  if (batch_list != NULL) {
+    if (argc-next != 0) {
+	usage(argv[0]);
+    }
+    Batch batch;
+    initialize_batch(&batch,&drs_templ_num,"GRIB1 messages","GRIB2 messages",(size_t)output_buffer_size*1024*1024,direct);
+    read_batch(&batch,batch_list,output_template);
+    size_t nfail=run_batch(&batch,nthreads);
+    free_batch(&batch);
+    return (nfail == 0) ? 0 : 1;
+  }
+  if (argc-next != 2 || output_template != default_template) {
+    usage(argv[0]);
+  }
+  FILE *ifile;
+  if ( (ifile=fopen(argv[next],"rb")) == NULL) {
+    fprintf(stderr,"Error opening input file %s\n",argv[next]);
+    exit(1);
+  }
+  OutputWriter ow;
+  initialize_output(&ow,(size_t)output_buffer_size*1024*1024);
+  if (open_output(&ow,argv[next+1],direct) != 0) {
+    fprintf(stderr,"Error opening output file %s\n",argv[next+1]);
+    exit(1);
+  }
+  int status;
+  size_t nmsg=0,nout=0;
+#ifdef PTHREADS
+  if (nthreads > 1) {
+    status=run_pipeline(ifile,&ow,nthreads,&drs_templ_num,&nmsg,&nout);
+  }
+  else
+#endif
+  {
+    Conversion *conv;
+    if ( (conv=create_conversion(&drs_templ_num,1)) == NULL) {
+	fprintf(stderr,"Error allocating the conversion\n");
+	exit(1);
+    }
+    status=convert_file(conv,ifile,&ow,&nmsg,&nout);
+    free_conversion(conv);
   }
   if (status != -1) {
     fprintf(stderr,"Read error after %d messages\n",nmsg);
   }
-  printf("Number of GRIB2 messages written to output: %d\n",nmsg);
+  printf("Number of GRIB2 messages written to output: %d\n",nout);
   fclose(ifile);
-  fclose(ofile);
+  close_output(&ow);
+  free(ow.buf);
 }
@@ -0,0 +1,317 @@
+/*
+** File: grib1to2_parameter_map.c
+**
+** Generated by build_parameter_map from tables/parameters/GRIB1/GRIB1_to_GRIB2.txt;
+**   do not edit - change the map and run build_parameter_map again
+*/
+#ifndef GRIB1TO2_PARAMETER_MAP_C
+#define GRIB1TO2_PARAMETER_MAP_C
+
+const ParameterMapEntry PARAMETER_MAP[]={
+// param center sub-center table_ver, discipline category number
+  {  1, -1, -1, -1,   0,  3,  0},
+  {  1, 98, -1,228,   0,  7,  7},
+  {  2, -1, -1, -1,   0,  3,  1},
+  {  3, -1, -1, -1,   0,  3,  2},
+  {  3, 98, -1,228,  10,  0, 17},
+  {  4, -1, -1, -1,   0,  2, 14},
+  {  5, -1, -1, -1,   0,  3,  3},
+  {  6, -1, -1, -1,   0,  3,  4},
+  {  7, -1, -1, -1,   0,  3,  5},
+  {  8, -1, -1, -1,   0,  3,  6},
+  {  8, 78, -1,174,   2,  0, 34},
+  {  9, -1, -1, -1,   0,  3,  7},
+  { 10, -1, -1, -1,   0, 14,  0},
+  { 10, 98, -1,200,   0, 14,  2},
+  { 11, -1, -1, -1,   0,  0,  0},
+  { 12, -1, -1, -1,   0,  0,  1},
+  { 13, -1, -1, -1,   0,  0,  2},
+  { 14, -1, -1, -1,   0,  0,  3},
+  { 15, -1, -1, -1,   0,  0,  4},
+  { 16, -1, -1, -1,   0,  0,  5},
+  { 17, -1, -1, -1,   0,  0,  6},
+  { 18, -1, -1, -1,   0,  0,  7},
+  { 19, -1, -1, -1,   0,  0,  8},
+  { 20, -1, -1, -1,   0, 19,  0},
+  { 21, -1, -1, -1,   0, 15,  6},
+  { 21, 98, -1,128,   0,  0, 28},
+  { 22, -1, -1, -1,   0, 15,  7},
+  { 22, 98, -1,128,   0,  3, 31},
+  { 23, -1, -1, -1,   0, 15,  8},
+  { 23, 98, -1,128,   0,  2, 45},
+  { 24, -1, -1, -1,   0,  7,  0},
+  { 25, -1, -1, -1,   0,  0,  9},
+  { 26, -1, -1, -1,   0,  3,  8},
+  { 27, -1, -1, -1,   0,  3,  9},
+  { 28, -1, -1, -1,  10,  0,  0},
+  { 29, -1, -1, -1,  10,  0,  1},
+  { 30, -1, -1, -1,  10,  0,  2},
+  { 30, 98, -1,203,   0,  7,  8},
+  { 31, -1, -1, -1,   0,  2,  0},
+  { 32, -1, -1, -1,   0,  2,  1},
+  { 33, -1, -1, -1,   0,  2,  2},
+  { 33, 98, -1, -1, 255,255,255},
+  { 33, 98, -1,201,   0,  1, 82},
+  { 33, 98, -1,203,   0,  2, 46},
+  { 34, -1, -1, -1,   0,  2,  3},
+  { 35, -1, -1, -1,   0,  2,  4},
+  { 36, -1, -1, -1,   0,  2,  5},
+  { 37, -1, -1, -1,   0,  2,  6},
+  { 38, -1, -1, -1,   0,  2,  7},
+  { 39, -1, -1, -1,   0,  2,  8},
+  { 40, -1, -1, -1,   0,  2,  9},
+  { 41, -1, -1, -1,   0,  2, 10},
+  { 41, 98, -1,201,   0,  1, 78},
+  { 42, -1, -1, -1,   0,  2, 11},
+  { 43, -1, -1, -1,   0,  2, 12},
+  { 44, -1, -1, -1,   0,  2, 13},
+  { 45, -1, -1, -1,   0,  2, 15},
+  { 46, -1, -1, -1,   0,  2, 16},
+  { 46, 98, -1,202,   0,  3, 20},
+  { 47, -1, -1, -1,  10,  1,  0},
+  { 47, 98, -1,202,   0,  3, 24},
+  { 48, -1, -1, -1,  10,  1,  1},
+  { 48, 98, -1,202,   0,  3, 21},
+  { 49, -1, -1, -1,  10,  1,  2},
+  { 49, 98, -1,202,   0,  3, 22},
+  { 50, -1, -1, -1,  10,  1,  3},
+  { 51, -1, -1, -1,   0,  1,  0},
+  { 52, -1, -1, -1,   0,  1,  1},
+  { 53, -1, -1, -1,   0,  1,  2},
+  { 54, -1, -1, -1,   0,  1,  3},
+  { 54, 98, -1,  2,   0,  1, 64},
+  { 55, -1, -1, -1,   0,  1,  4},
+  { 56, -1, -1, -1,   0,  1,  5},
+  { 57, -1, -1, -1,   0,  1,  6},
+  { 58, -1, -1, -1,   0,  6,  0},
+  { 58, 98, -1,  2,   0,  1, 70},
+  { 59, -1, -1, -1,   0,  1,  7},
+  { 59, 98, -1,128,   0,  7,  6},
+  { 60, -1, -1, -1,   0, 19,  2},
+  { 61, -1, -1, -1,   0,  1,  8},
+  { 61, 98, -1,202,   2,  0, 28},
+  { 62, -1, -1, -1,   0,  1,  9},
+  { 62, 98, -1,202,   2,  0, 32},
+  { 63, -1, -1, -1,   0,  1, 10},
+  { 64, -1, -1, -1,   0,  1, 12},
+  { 65, -1, -1, -1,   0,  1, 13},
+  { 66, -1, -1, -1,   0,  1, 11},
+  { 67, -1, -1, -1,   0, 19,  3},
+  { 68, -1, -1, -1,  10,  4,  2},
+  { 68, 98, -1,201,   0,  6, 26},
+  { 69, -1, -1, -1,  10,  4,  0},
+  { 69, 98, -1,201,   0,  6, 27},
+  { 70, -1, -1, -1,  10,  4,  1},
+  { 71, -1, -1, -1,   0,  6,  1},
+  { 72, -1, -1, -1,   0,  6,  2},
+  { 73, -1, -1, -1,   0,  6,  3},
+  { 74, -1, -1, -1,   0,  6,  4},
+  { 75, -1, -1, -1,   0,  6,  5},
+  { 75, 98, -1, -1, 255,255,255},
+  { 75, 98, -1,128,   0,  1, 85},
+  { 75, 98, -1,202,   2,  0, 29},
+  { 76, -1, -1, -1,   0,  6,  6},
+  { 76, 98, -1, -1, 255,255,255},
+  { 76, 98, -1,  2,   0,  1, 69},
+  { 76, 98, -1,128,   0,  1, 86},
+  { 76, 98, -1,202,   2,  0, 30},
+  { 77, -1, -1, -1,   0,  7,  1},
+  { 77, 98, -1,128,   0,  2, 32},
+  { 78, -1, -1, -1,   0,  1, 14},
+  { 78, 98, -1,202,   2,  0, 31},
+  { 79, -1, -1, -1,   0,  1, 15},
+  { 80, -1, -1, -1,  10,  3,  0},
+  { 81, -1, -1, -1,   1,  2,  8},
+  { 82, -1, -1, -1,  10,  3,  1},
+  { 83, -1, -1, -1,   2,  0,  1},
+  { 84, -1, -1, -1,   0, 19,  1},
+  { 85, -1, -1, -1,   2,  0,  2},
+  { 86, -1, -1, -1,   2,  0,  3},
+  { 87, -1, -1, -1,   2,  0,  4},
+  { 88, -1, -1, -1,  10,  4,  3},
+  { 89, -1, -1, -1,   0,  3, 10},
+  { 90, -1, -1, -1,   2,  0,  5},
+  { 91, -1, -1, -1,   1,  2,  7},
+  { 92, -1, -1, -1,  10,  2,  1},
+  { 93, -1, -1, -1,  10,  2,  2},
+  { 94, -1, -1, -1,  10,  2,  3},
+  { 95, -1, -1, -1,  10,  2,  4},
+  { 96, -1, -1, -1,  10,  2,  5},
+  { 97, -1, -1, -1,  10,  2,  6},
+  { 98, -1, -1, -1,  10,  2,  7},
+  { 99, -1, -1, -1,   0,  1, 16},
+  { 99, 98, -1,203,   0, 19, 25},
+  {100, -1, -1, -1,  10,  0,  3},
+  {100, 98, -1,201,   0,  1, 77},
+  {101, -1, -1, -1,  10,  0,  4},
+  {102, -1, -1, -1,  10,  0,  5},
+  {103, -1, -1, -1,  10,  0,  6},
+  {104, -1, -1, -1,  10,  0,  7},
+  {105, -1, -1, -1,  10,  0,  8},
+  {106, -1, -1, -1,  10,  0,  9},
+  {107, -1, -1, -1,  10,  0, 10},
+  {108, -1, -1, -1,  10,  0, 11},
+  {109, -1, -1, -1,  10,  0, 12},
+  {109, 98, -1, -1, 255,255,255},
+  {109, 98, -1,162,   0,  0, 20},
+  {109, 98, -1,228,   0,  6, 13},
+  {110, -1, -1, -1,  10,  0, 13},
+  {111, -1, -1, -1,   0,  4,  0},
+  {111, 98, -1,201,   0,  1, 76},
+  {112, -1, -1, -1,   0,  5,  0},
+  {112, 98, -1,201,   0,  1, 55},
+  {113, -1, -1, -1,   0,  4,  1},
+  {114, -1, -1, -1,   0,  5,  1},
+  {115, -1, -1, -1,   0,  5,  2},
+  {116, -1, -1, -1,   0,  4,  2},
+  {117, -1, -1, -1,   0,  4,  3},
+  {118, -1, -1, -1,   0,  4,  4},
+  {119, -1, -1, -1,   0,  4,  5},
+  {120, -1, -1, -1,   0,  4,  6},
+  {121, -1, -1, -1,   0,  0, 10},
+  {121, 98, -1,228,   0,  7,  2},
+  {122, -1, -1, -1,   0,  0, 11},
+  {123, -1, -1, -1,   0,  2, 20},
+  {123, 98, -1,228,   0,  7,  4},
+  {124, -1, -1, -1,   0,  2, 17},
+  {125, -1, -1, -1,   0,  2, 18},
+  {126, -1, -1, -1,   0,  2, 19},
+  {131,  7, -1,  2,   0,  1, 70},
+  {131,  7, -1,129,   0,  1, 43},
+  {132,  7, -1,  2,   0,  7, 11},
+  {132,  7, -1,129,   0,  6, 21},
+  {133,  7, -1,  2,   0,  7,  2},
+  {133,  7, -1,129,   0,  1, 44},
+  {133, 98, -1,201,   0,  1, 61},
+  {134,  7, -1,  2,   0,  7,  5},
+  {134,  7, -1,129,   0,  6, 16},
+  {135,  7, -1,  2,   0,  1, 38},
+  {135,  7, -1,129,   0,  1, 21},
+  {136,  7, -1,  2,   0,  2, 25},
+  {136,  7, -1,129,   0,  1, 69},
+  {137,  7, -1,129,   0,  1, 70},
+  {137,  7, -1,131,   0, 17,  0},
+  {138,  7, -1,129,   0,  1, 45},
+  {139,  7, -1,129,   0,  1, 46},
+  {140,  7, -1,  2,   0,  1, 33},
+  {140,  7, -1,129,   0,  6, 20},
+  {140, 98, -1,203,   0,  7,  3},
+  {141,  7, -1,  2,   0,  1, 34},
+  {142,  7, -1,  2,   0,  1, 35},
+  {143,  7, -1,  2,   0,  1, 36},
+  {144,  7, -1,  2,   2,  0,  9},
+  {144,  7, -1,128,  10,  3,  2},
+  {145,  7, -1,131,   0,  1, 41},
+  {146,  7, -1,  2,   0,  6, 15},
+  {146, 98, -1,200,   0,  6, 15},
+  {147,  7, -1,  2,   0,  3, 16},
+  {147, 98, -1,201,   0, 19, 24},
+  {147, 98, -1,254,   0,  2, 27},
+  {148,  7, -1,  2,   0,  3, 17},
+  {148, 98, -1,254,   0,  2, 28},
+  {152, 98, -1,201,   0, 19, 11},
+  {153,  7, -1,  2,   0,  1, 22},
+  {153, 98, -1,201,   0,  2, 31},
+  {154,  7, -1,  2,   0, 14,  1},
+  {155,  7, -1,  2,   2,  0, 10},
+  {155, 98, -1,200,   2,  0, 10},
+  {156,  7, -1,  2,   0,  7,  7},
+  {157,  7, -1,  2,   0,  7,  6},
+  {158,  7, -1,  2,   0, 19, 11},
+  {159,  7, -1,130,   0, 19, 17},
+  {160,  7, -1,  2,   0,  4, 53},
+  {160,  7, -1,130,   2,  3,  5},
+  {163,  7, -1,  2,   0,  5,  8},
+  {170,  7, -1,  2,   0,  1, 24},
+  {170,  7, -1,130,   0, 19, 18},
+  {171,  7, -1,  2,   0,  1, 25},
+  {171,  7, -1,130,   2,  3,  6},
+  {171, 98, -1,201,   0,  0, 19},
+  {171, 98, -1,228,   2,  0, 26},
+  {172,  7, -1,  2,   0,  2, 26},
+  {174,  7, -1,140,   0,  6, 25},
+  {178,  7, -1,  2,   0,  1, 23},
+  {180,  7, -1,130,   0,  1, 17},
+  {180, 98, -1,128,   0,  2, 38},
+  {180, 98, -1,202,   0, 14,  1},
+  {181,  7, -1,130,   2,  0, 15},
+  {181, 98, -1,128,   0,  2, 37},
+  {182,  7, -1,130,   2,  0, 28},
+  {184,  7, -1,130,   0, 19, 19},
+  {189,  7, -1,  2,   0,  0, 15},
+  {190,  7, -1,  2,   0,  7,  8},
+  {191,  7, -1,133,   0,  6, 33},
+  {192,  7, -1,133,  10,191,  1},
+  {193,  7, -1,131,   0,  0, 21},
+  {194,  7, -1,  2,   0,  1, 39},
+  {195,  7, -1,128,  10,  4,  4},
+  {196,  7, -1,  2,   0,  2, 27},
+  {196,  7, -1,128,  10,  4,  5},
+  {196,  7, -1,130,   2,  0,  7},
+  {197,  7, -1,  2,   0,  2, 28},
+  {197,  7, -1,128,  10,  4,  6},
+  {200, 98, -1,201,   2,  0, 13},
+  {202, 98, -1,133,   0,  3, 27},
+  {202, 98, -1,200,   2,  0,  6},
+  {203,  7, -1,130,   2,  0, 16},
+  {203, 98, -1,201,   0,  0, 18},
+  {204,  7, -1,  2,   0,  4,  7},
+  {204, 98, -1,200,   0,  4,  7},
+  {205,  7, -1,  2,   0,  5,  3},
+  {205, 98, -1,200,   0,  5,  3},
+  {206,  7, -1,130,   0, 15,  3},
+  {207,  7, -1,  2,   2,  0, 11},
+  {208,  7, -1,  2,   2,  0, 12},
+  {209,  7, -1,133,   0,  3, 28},
+  {211,  7, -1,  2,   0,  4,  8},
+  {211,  7, -1,129,   0, 16,  4},
+  {211,  7, -1,130,   0,  4,  8},
+  {211,  7, -1,131,   0,  4,  8},
+  {211, 98, -1,200,   0,  4,  8},
+  {212,  7, -1,  2,   0,  5,  4},
+  {212, 98, -1,200,   0,  5,  4},
+  {212, 98, -1,201,   2,  0, 16},
+  {214,  7, -1,  2,   0,  1, 37},
+  {218,  7, -1,129,   0,  1, 27},
+  {219,  7, -1,129,   0,  6, 13},
+  {219,  7, -1,130,   2,  0, 17},
+  {219, 98, -1,200,   0,  2, 21},
+  {221,  7, -1,  2,   0,  3, 18},
+  {222,  7, -1,  2,   0,  3, 15},
+  {223,  7, -1,  2,   2,  0, 13},
+  {223,  7, -1,129,   0,  1, 65},
+  {224,  7, -1,  2,   2,  3,  0},
+  {224,  7, -1,129,   0,  1, 66},
+  {225,  7, -1,129,   0,  1, 67},
+  {226,  7, -1,  2,   2,  0, 14},
+  {226,  7, -1,129,   0,  1, 68},
+  {227,  7, -1,129,   0,  7, 15},
+  {228,  7, -1,  2,   0,  1, 40},
+  {229,  7, -1,  2,   0,  0, 16},
+  {230,  7, -1,  2,   0,  3, 19},
+  {230,  7, -1,130,   2,  3,  7},
+  {230, 98, -1,201,   0, 15,  1},
+  {231,  7, -1,130,   2,  3,  8},
+  {233, 98, -1,140,  10,  0, 16},
+  {234,  7, -1,  2,   1,  0,  5},
+  {235,  7, -1,  2,   1,  0,  6},
+  {235, 98, -1,128,   0,  0, 17},
+  {238,  7, -1,  2,   0,  1, 42},
+  {239,  7, -1,  2,   0,  0, 18},
+  {240,  7, -1,129,   0, 16,  3},
+  {240,  7, -1,130,   2,  3,  9},
+  {246,  7, -1,130,   2,  0, 18},
+  {246, 98, -1,128,   0,  1, 83},
+  {247,  7, -1,130,   2,  0, 19},
+  {247, 98, -1,128,   0,  1, 84},
+  {248,  7, -1,130,   2,  0, 20},
+  {248, 98, -1,128,   0,  6, 32},
+  {249,  7, -1,130,   2,  0, 21},
+  {250,  7, -1,129,   2,  4,  2},
+  {252,  7, -1,  2,   0,  2, 29},
+  {253,  7, -1,  2,   0,  2, 30},
+  {253, 98, -1,140,  10,  0, 44},
+  {254,  7, -1,  2,   0,  7, 12}
+};
+
+#endif
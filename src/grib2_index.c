@@ -0,0 +1,445 @@
+/*
+** File: grib2_index.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to index the grids in a GRIB2 file by parameter, level and time, so
+**          that the messages holding the grids that are wanted can be read
+**          directly, without reading the rest of the file
+**
+** Notes:   1) The index of a file is kept next to it, in a file with the same
+**             name followed by ".g2idx".  open_grib2_index uses the index file
+**             if it was made from the current version of the GRIB2 file (the
+**             size and modification time of the GRIB2 file are kept in the
+**             index); otherwise it indexes the GRIB2 file, and replaces the
+**             index file with a rename when it has been asked to save it.
+**             An index that can't be saved (for example, in a read-only
+**             archive) is only kept in memory.
+**
+**          2) Indexing a file reads every message in full, but only decodes
+**             it as far as the Product Definition Sections: the grids are
+**             rejected by a filter (see unpack_sections), so none of them is
+**             unpacked.  Messages that can't be read are left out of the
+**             index, with a warning.
+**
+**          3) The index is in the byte order of the machine that made it; an
+**             index with another byte order or format version is made again.
+**
+** example C syntax for using an index:
+**    GRIB2Message grib2_msg;
+**    GRIB2Index index;
+**    GRIB2Match match={0,0,0,100,255,50000.,0.,GRIB_ANY,GRIB_ANY,GRIB_ANY,
+**        GRIB_ANY};
+**
+**    initialize(&grib2_msg);
+**    if (open_grib2_index("my_GRIB2_file",1,&grib2_msg,&index) == 0) {
+**      for (n=0; n < index.num_entries; ++n) {
+**        if (grib2_index_matches(&index.entries[n],&match)) {
+**          fseek(fp,index.entries[n].offset,SEEK_SET);
+**          unpackgrib2(fp,&grib2_msg);
+**          ...
+**        }
+**      }
+**      free_grib2_index(&index);
+**    }
+**
+** Layout of an index file:
+**   header:   GRIB2IndexHeader
+**   entries:  a GRIB2IndexEntry for each grid, in the order of the grids in
+**               the GRIB2 file
+*/
+#ifndef GRIB2_INDEX_C
+#define GRIB2_INDEX_C
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "unpackgrib2.c"
+
+#define GRIB2_INDEX_MAGIC "GRIB2IX"
+#define GRIB2_INDEX_VERSION 1
+#define GRIB2_INDEX_BYTE_ORDER 0x01020304
+
+/* GRIB2IndexHeader is the first thing in an index file
+**   magic:        GRIB2_INDEX_MAGIC
+**   version:      GRIB2_INDEX_VERSION
+**   byte_order:   GRIB2_INDEX_BYTE_ORDER, as written by the indexer
+**   num_entries:  the number of grids in the index
+**   file_size:    the size of the GRIB2 file that was indexed
+**   file_mtime:   the modification time of the GRIB2 file that was indexed
+*/
+typedef struct {
+  char magic[8];
+  uint32_t version,byte_order;
+  uint64_t num_entries;
+  uint64_t file_size;
+  int64_t file_mtime;
+} GRIB2IndexHeader;
+
+/* GRIB2IndexEntry describes one grid
+**   offset:       the offset in bytes of its message in the GRIB2 file
+**   ref_time:     the reference time of the message, as YYYYMMDDHHMMSS
+**   valid_time:   the valid time of the grid, as YYYYMMDDHHMMSS (the end of
+**                   the period for statistically processed grids)
+**   lvl1, lvl2:   the values of the first and second levels
+**   length:       the length in bytes of its message
+**   fcst_time:    the forecast time, in units of 'time_unit'
+**   perturb_num:  the perturbation number of an ensemble member, or -1
+**   grid_num:     the number of the grid in its message, starting at 0
+**   disc, param_cat, param_num, lvl1_type, lvl2_type, gen_proc, time_unit:
+**                 the codes from the message
+*/
+typedef struct {
+  uint64_t offset;
+  int64_t ref_time,valid_time;
+  double lvl1,lvl2;
+  uint32_t length;
+  int32_t fcst_time,perturb_num;
+  uint16_t grid_num;
+  uint8_t disc,param_cat,param_num,lvl1_type,lvl2_type,gen_proc,time_unit;
+  uint8_t unused[3];
+} GRIB2IndexEntry;
+
+/* GRIB2Index holds the index of a GRIB2 file
+**   entries:      the grids in the file
+**   num_entries:  the number of grids
+**   capacity:     the capacity of 'entries'
+*/
+typedef struct {
+  GRIB2IndexEntry *entries;
+  size_t num_entries,capacity;
+} GRIB2Index;
+
+/* grib2_days_from_civil returns the number of days from 1 Jan 1970 to a date of
+**   the proleptic Gregorian calendar
+*/
+long long grib2_days_from_civil(long long yr,int mo,int dy)
+{
+  yr-= (mo <= 2) ? 1 : 0;
+  long long era=((yr >= 0) ? yr : yr-399)/400;
+  long long yoe=yr-era*400;
+  long long doy=(153*(mo+((mo > 2) ? -3 : 9))+2)/5+dy-1;
+  long long doe=yoe*365+yoe/4-yoe/100+doy;
+  return era*146097+doe-719468;
+}
+
+void grib2_civil_from_days(long long days,int *yr,int *mo,int *dy)
+{
+  days+=719468;
+  long long era=((days >= 0) ? days : days-146096)/146097;
+  long long doe=days-era*146097;
+  long long yoe=(doe-doe/1460+doe/36524-doe/146096)/365;
+  long long doy=doe-(365*yoe+yoe/4-yoe/100);
+  long long mp=(5*doy+2)/153;
+  *dy=doy-(153*mp+2)/5+1;
+  *mo= (mp < 10) ? mp+3 : mp-9;
+  *yr=yoe+era*400+((*mo <= 2) ? 1 : 0);
+}
+
+/* grib2_add_time returns the date and time YYYYMMDDHHMMSS after 'amount' units
+**   of time (GRIB2 Code Table 4.4) from the date 'yr', 'mo', 'dy' and time
+**   HHMMSS 'time'; it returns -1 for a unit that it doesn't know
+*/
+long long grib2_add_time(int yr,int mo,int dy,int time,long long amount,int time_unit)
+{
+  long long seconds;
+  switch (time_unit) {
+    case 0:
+    {
+	seconds=amount*60;
+	break;
+    }
+    case 1:
+    {
+	seconds=amount*3600;
+	break;
+    }
+    case 2:
+    {
+	seconds=amount*86400;
+	break;
+    }
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+    {
+/* months, years, decades, normals (30 years) and centuries move the calendar
+**   date, keeping the day of the month unless the new month is shorter */
+	static const int months[]={1,12,120,360,1200};
+	long long m=(long long)yr*12+(mo-1)+amount*months[time_unit-3];
+	yr=(m >= 0) ? m/12 : -((-m+11)/12);
+	mo=m-(long long)yr*12+1;
+	int last_day=grib2_days_from_civil(yr+mo/12,mo % 12+1,1)-grib2_days_from_civil(yr,mo,1);
+	if (dy > last_day) {
+	  dy=last_day;
+	}
+	seconds=0;
+	break;
+    }
+    case 10:
+    {
+	seconds=amount*10800;
+	break;
+    }
+    case 11:
+    {
+	seconds=amount*21600;
+	break;
+    }
+    case 12:
+    {
+	seconds=amount*43200;
+	break;
+    }
+    case 13:
+    {
+	seconds=amount;
+	break;
+    }
+    default:
+    {
+	return -1;
+    }
+  }
+  long long t=grib2_days_from_civil(yr,mo,dy)*86400+(time/10000)*3600+(time/100 % 100)*60+(time % 100)+seconds;
+  long long days=(t >= 0) ? t/86400 : -((-t+86399)/86400);
+  long long secs=t-days*86400;
+  grib2_civil_from_days(days,&yr,&mo,&dy);
+  return (((long long)yr*100+mo)*100+dy)*1000000+(secs/3600)*10000+(secs/60 % 60)*100+secs % 60;
+}
+
+/* grib2_valid_time returns the valid time YYYYMMDDHHMMSS of a grid: the end of
+**   the period of a statistically processed grid, or the reference time plus
+**   the forecast time; it returns -1 if the forecast time has a unit that it
+**   doesn't know
+*/
+long long grib2_valid_time(const GRIB2Message *grib2_msg,const GRIB2Metadata *md)
+{
+  if (md->stat_proc.num_ranges > 0) {
+    return (((long long)md->stat_proc.eyr*100+md->stat_proc.emo)*100+md->stat_proc.edy)*1000000+md->stat_proc.etime;
+  }
+  return grib2_add_time(grib2_msg->yr,grib2_msg->mo,grib2_msg->dy,grib2_msg->time,md->fcst_time,md->time_unit);
+}
+
+/* GRIB2Indexer is what the filter that indexes the grids of a message needs
+**   index:     the index that is being built
+**   offset:    the offset of the message
+**   grid_num:  the number of the next grid in the message
+*/
+typedef struct {
+  GRIB2Index *index;
+  uint64_t offset;
+  int grid_num;
+} GRIB2Indexer;
+
+/* index_grid is a filter that adds each grid of a message to an index, and
+**   rejects it, so that none of the grids is unpacked
+*/
+int index_grid(const GRIB2Message *grib2_msg,const GRIB2Metadata *md,void *arg)
+{
+  GRIB2Indexer *indexer=(GRIB2Indexer *)arg;
+  GRIB2Index *index=indexer->index;
+  if (index->num_entries == index->capacity) {
+    size_t capacity= (index->capacity > 0) ? index->capacity*2 : 256;
+    GRIB2IndexEntry *entries=(GRIB2IndexEntry *)realloc(index->entries,capacity*sizeof(GRIB2IndexEntry));
+    if (entries == NULL) {
+	return 0;
+    }
+    index->entries=entries;
+    index->capacity=capacity;
+  }
+  GRIB2IndexEntry *e=&index->entries[index->num_entries++];
+  memset(e,0,sizeof(GRIB2IndexEntry));
+  e->offset=indexer->offset;
+  e->length=grib2_msg->total_len;
+  e->grid_num=indexer->grid_num++;
+  e->ref_time=(((long long)grib2_msg->yr*100+grib2_msg->mo)*100+grib2_msg->dy)*1000000+grib2_msg->time;
+  e->valid_time=grib2_valid_time(grib2_msg,md);
+  e->disc=grib2_msg->disc;
+  e->param_cat=md->param_cat;
+  e->param_num=md->param_num;
+  e->lvl1_type=md->lvl1_type;
+  e->lvl1=md->lvl1;
+  e->lvl2_type=md->lvl2_type;
+  e->lvl2=md->lvl2;
+  e->gen_proc=md->gen_proc;
+  e->time_unit=md->time_unit;
+  e->fcst_time=md->fcst_time;
+  e->perturb_num= (md->ens_type >= 0) ? md->perturb_num : -1;
+  return 0;
+}
+
+/* build_grib2_index indexes the GRIB2 file that is open on 'fp', reading its
+**   messages into 'grib2_msg'; the filters and 'unpack_simple' of the message
+**   are put back when it is done
+*/
+int build_grib2_index(FILE *fp,const char *path,GRIB2Message *grib2_msg,GRIB2Index *index)
+{
+  const GRIB2Match *matches=grib2_msg->matches;
+  size_t num_matches=grib2_msg->num_matches;
+  int (*filter)(const GRIB2Message *,const GRIB2Metadata *,void *)=grib2_msg->filter;
+  void *filter_arg=grib2_msg->filter_arg;
+  int unpack_simple=grib2_msg->unpack_simple;
+  GRIB2Indexer indexer;
+  indexer.index=index;
+  grib2_msg->matches=NULL;
+  grib2_msg->num_matches=0;
+  grib2_msg->filter=index_grid;
+  grib2_msg->filter_arg=&indexer;
+  grib2_msg->unpack_simple=0;
+  size_t nmsg=0;
+  int status;
+  while ( (status=unpack_IS(fp,grib2_msg)) != GRIB_EOF && status != GRIB_READ_ERROR) {
+    ++nmsg;
+    indexer.offset=ftell(fp)-grib2_msg->total_len;
+    indexer.grid_num=0;
+    size_t num_entries=index->num_entries;
+/* a message that can't be read is left out completely, even if some of its
+**   grids were indexed */
+    if (status != 0 || ( (status=unpack_sections(grib2_msg)) != 0 && status != GRIB_NO_MATCH)) {
+	fprintf(stderr,"Warning: not indexing message %zu of %s: %s\n",nmsg,path,grib2_msg->error);
+	index->num_entries=num_entries;
+    }
+    else if (index->num_entries-num_entries != (size_t)indexer.grid_num) {
+	fprintf(stderr,"Error allocating the index of %s\n",path);
+	status=GRIB_READ_ERROR;
+	break;
+    }
+  }
+  grib2_msg->matches=matches;
+  grib2_msg->num_matches=num_matches;
+  grib2_msg->filter=filter;
+  grib2_msg->filter_arg=filter_arg;
+  grib2_msg->unpack_simple=unpack_simple;
+  if (status == GRIB_READ_ERROR) {
+    fprintf(stderr,"Read error in %s after %zu messages\n",path,nmsg);
+    return 1;
+  }
+  return 0;
+}
+
+/* read_grib2_index reads the index file 'index_path' into 'index', and returns
+**   0, or 1 if it doesn't exist or isn't a current index of a file with the
+**   size and modification time in 'st'
+*/
+int read_grib2_index(const char *index_path,const struct stat *st,GRIB2Index *index)
+{
+  FILE *fp;
+  if ( (fp=fopen(index_path,"rb")) == NULL) {
+    return 1;
+  }
+  GRIB2IndexHeader h;
+  if (fread(&h,sizeof(h),1,fp) != 1 || memcmp(h.magic,GRIB2_INDEX_MAGIC,8) != 0 || h.version != GRIB2_INDEX_VERSION || h.byte_order != GRIB2_INDEX_BYTE_ORDER || h.file_size != (uint64_t)st->st_size || h.file_mtime != (int64_t)st->st_mtime) {
+    fclose(fp);
+    return 1;
+  }
+  index->entries=(GRIB2IndexEntry *)malloc((h.num_entries+1)*sizeof(GRIB2IndexEntry));
+  if (index->entries == NULL || fread(index->entries,sizeof(GRIB2IndexEntry),h.num_entries,fp) != h.num_entries) {
+    free(index->entries);
+    index->entries=NULL;
+    fclose(fp);
+    return 1;
+  }
+  fclose(fp);
+  index->num_entries=index->capacity=h.num_entries;
+  return 0;
+}
+
+/* write_grib2_index writes 'index' to a temporary file and renames it to
+**   'index_path'
+*/
+int write_grib2_index(const char *index_path,const struct stat *st,const GRIB2Index *index)
+{
+  GRIB2IndexHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,GRIB2_INDEX_MAGIC,8);
+  h.version=GRIB2_INDEX_VERSION;
+  h.byte_order=GRIB2_INDEX_BYTE_ORDER;
+  h.num_entries=index->num_entries;
+  h.file_size=st->st_size;
+  h.file_mtime=st->st_mtime;
+  char *tmp_path=(char *)malloc(strlen(index_path)+32);
+  if (tmp_path == NULL) {
+    return 1;
+  }
+  sprintf(tmp_path,"%s.tmp.%d",index_path,(int)getpid());
+  FILE *fp;
+  if ( (fp=fopen(tmp_path,"wb")) == NULL) {
+    free(tmp_path);
+    return 1;
+  }
+  int status=0;
+  if (fwrite(&h,sizeof(h),1,fp) != 1 || fwrite(index->entries,sizeof(GRIB2IndexEntry),index->num_entries,fp) != index->num_entries) {
+    status=1;
+  }
+  if (fclose(fp) != 0) {
+    status=1;
+  }
+  if (status == 0 && rename(tmp_path,index_path) != 0) {
+    fprintf(stderr,"Error renaming %s to %s: %s\n",tmp_path,index_path,strerror(errno));
+    status=1;
+  }
+  if (status != 0) {
+    unlink(tmp_path);
+  }
+  free(tmp_path);
+  return status;
+}
+
+void free_grib2_index(GRIB2Index *index)
+{
+  free(index->entries);
+  index->entries=NULL;
+  index->num_entries=index->capacity=0;
+}
+
+/* open_grib2_index fills 'index' with the index of the GRIB2 file 'path',
+**   from its index file if that is current, and otherwise by indexing the file
+**   with 'grib2_msg' (and saving the index file if 'save' is not 0); it returns
+**   0, or 1 if the GRIB2 file can't be read
+*/
+int open_grib2_index(const char *path,int save,GRIB2Message *grib2_msg,GRIB2Index *index)
+{
+  index->entries=NULL;
+  index->num_entries=index->capacity=0;
+  struct stat st;
+  FILE *fp;
+  if (stat(path,&st) != 0 || (fp=fopen(path,"rb")) == NULL) {
+    fprintf(stderr,"Error opening %s\n",path);
+    return 1;
+  }
+  char *index_path=(char *)malloc(strlen(path)+7);
+  if (index_path == NULL) {
+    fclose(fp);
+    return 1;
+  }
+  sprintf(index_path,"%s.g2idx",path);
+  int status=0;
+  if (read_grib2_index(index_path,&st,index) != 0) {
+    if ( (status=build_grib2_index(fp,path,grib2_msg,index)) == 0 && save) {
+	write_grib2_index(index_path,&st,index);
+    }
+  }
+  fclose(fp);
+  free(index_path);
+  if (status != 0) {
+    free_grib2_index(index);
+  }
+  return status;
+}
+
+/* grib2_index_matches returns 1 if a grid in an index passes 'match', with the
+**   same rules as the filters of unpack_sections, otherwise 0
+*/
+int grib2_index_matches(const GRIB2IndexEntry *e,const GRIB2Match *m)
+{
+  return (m->disc == GRIB_ANY || m->disc == e->disc) && (m->param_cat == GRIB_ANY || m->param_cat == e->param_cat) && (m->param_num == GRIB_ANY || m->param_num == e->param_num) && (m->lvl1_type == GRIB_ANY || m->lvl1_type == e->lvl1_type) && grib2_level_matches(m->lvl1,e->lvl1) && (m->lvl2_type == GRIB_ANY || m->lvl2_type == e->lvl2_type) && grib2_level_matches(m->lvl2,e->lvl2) && (m->gen_proc == GRIB_ANY || m->gen_proc == e->gen_proc) && (m->time_unit == GRIB_ANY || m->time_unit == e->time_unit) && (m->fcst_time == GRIB_ANY || m->fcst_time == e->fcst_time) && (m->perturb_num == GRIB_ANY || (e->perturb_num >= 0 && m->perturb_num == e->perturb_num));
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+** File: grib2_keywords.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to print the CF standard name and the GCMD keywords of each grid in
+**          GRIB2 files
+**
+** Usage: grib2_keywords parameter_cache GRIB2_file [GRIB2_file ...]
+**   parameter_cache is built from the parameter tables with
+**     build_parameter_cache
+**
+**   each grid is printed on one line:
+**     file message grid discipline.category.number level CF GCMD
+**   where 'level' is the first level type and value (and the second level
+**   type, for a layer), a missing CF standard name is printed as "-", and the
+**   GCMD UUIDs are separated by ';'
+**
+** Compile with:
+**   cc -std=c99 -o grib2_keywords grib2_keywords.c -lm
+**   (add -DJASPER or -DAEC and their libraries to decode grids packed with
+**   JPEG 2000 or CCSDS; only the metadata of the grids is used)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "keyword_resolver.c"
+
+int main(int argc,char **argv)
+{
+  if (argc < 3) {
+    fprintf(stderr,"usage: %s parameter_cache GRIB2_file [GRIB2_file ...]\n",argv[0]);
+    exit(1);
+  }
+  ParameterCache cache;
+  if (open_parameter_cache(argv[1],&cache) != 0) {
+    exit(1);
+  }
+  KeywordResolver resolver;
+  if (build_keyword_resolver(&cache,&resolver) != 0) {
+    close_parameter_cache(&cache);
+    exit(1);
+  }
+  GRIB2Message msg;
+  initialize(&msg);
+// the grids are never used, so leave the ones with simple packing packed
+  msg.unpack_simple=0;
+  int status=0;
+  for (int n=2; n < argc; ++n) {
+    FILE *fp;
+    if ( (fp=fopen(argv[n],"rb")) == NULL) {
+	fprintf(stderr,"Error opening %s\n",argv[n]);
+	status=1;
+	continue;
+    }
+    size_t nmsg=0;
+    int read_status;
+    while ( (read_status=unpack_IS(fp,&msg)) != GRIB_EOF && read_status != GRIB_READ_ERROR) {
+	++nmsg;
+	if (read_status != 0 || unpack_sections(&msg) != 0) {
+	  fprintf(stderr,"Warning: skipping message %zu of %s: %s\n",nmsg,argv[n],msg.error);
+	  continue;
+	}
+	for (size_t m=0; m < msg.num_grids; ++m) {
+	  const GRIB2Metadata *md=&msg.grids[m].md;
+	  printf("%s %zu %zu %d.%d.%d %d/%g",argv[n],nmsg,m+1,msg.disc,md->param_cat,md->param_num,md->lvl1_type,md->lvl1);
+	  if (md->lvl2_type != 255) {
+	    printf("-%d/%g",md->lvl2_type,md->lvl2);
+	  }
+	  KeywordResult result;
+	  if (resolve_grid_keywords(&resolver,&msg,m,&result) != 0) {
+	    printf(" - -\n");
+	    continue;
+	  }
+	  printf(" %s ",(result.cf != NULL) ? result.cf : "-");
+	  if (result.num_gcmd == 0) {
+	    printf("-");
+	  }
+	  for (size_t k=0; k < result.num_gcmd; ++k) {
+	    printf("%s%s",(k > 0) ? ";" : "",result.gcmd[k]);
+	  }
+	  printf("\n");
+	}
+    }
+    fclose(fp);
+  }
+  free_keyword_resolver(&resolver);
+  close_parameter_cache(&cache);
+  return status;
+}
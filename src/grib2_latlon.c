@@ -0,0 +1,99 @@
+/*
+** File: grib2_latlon.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to print the latitude, longitude and value of each gridpoint of the
+**          grids in GRIB2 files
+**
+** Usage: grib2_latlon [-s stride] GRIB2_file [GRIB2_file ...]
+**   -s  print only every 'stride'-th gridpoint of every 'stride'-th row, which
+**         are the only gridpoints that are unpacked (default 1)
+**
+**   each grid starts with a line:
+**     file message grid discipline.category.number level nx ny
+**   where 'level' is the first level type and value (and the second level
+**   type, for a layer), followed by one line for each gridpoint, in the order
+**   of the gridpoints:
+**     latitude longitude value
+**   a missing value is printed as "-"
+**
+**   the coordinates of each grid definition are computed once and shared by
+**   all of the grids that use it (see coordinate_cache.c)
+**
+** Compile with:
+**   cc -std=c99 -o grib2_latlon grib2_latlon.c -lm
+**   (add -DJASPER or -DAEC and their libraries to decode grids packed with
+**   JPEG 2000 or CCSDS)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coordinate_cache.c"
+
+int main(int argc,char **argv)
+{
+  int stride=1;
+  int next=1;
+  if (next+1 < argc && strcmp(argv[next],"-s") == 0) {
+    stride=atoi(argv[next+1]);
+    next+=2;
+  }
+  if (argc-next < 1 || stride < 1) {
+    fprintf(stderr,"usage: %s [-s stride] GRIB2_file [GRIB2_file ...]\n",argv[0]);
+    exit(1);
+  }
+  CoordinateCache cache;
+  if (initialize_coordinate_cache(&cache,16) != 0) {
+    fprintf(stderr,"Error initializing the coordinate cache\n");
+    exit(1);
+  }
+  GRIB2Message msg;
+  initialize(&msg);
+  msg.stride=stride;
+  int status=0;
+  for (int n=next; n < argc; ++n) {
+    FILE *fp;
+    if ( (fp=fopen(argv[n],"rb")) == NULL) {
+	fprintf(stderr,"Error opening %s\n",argv[n]);
+	status=1;
+	continue;
+    }
+    size_t nmsg=0;
+    int read_status;
+    while ( (read_status=unpack_IS(fp,&msg)) != GRIB_EOF && read_status != GRIB_READ_ERROR) {
+	++nmsg;
+	if (read_status != 0 || unpack_sections(&msg) != 0) {
+	  fprintf(stderr,"Warning: skipping message %zu of %s: %s\n",nmsg,argv[n],msg.error);
+	  continue;
+	}
+	for (size_t m=0; m < msg.num_grids; ++m) {
+	  const GRIB2Metadata *md=&msg.grids[m].md;
+	  const GridCoordinates *coords;
+	  if (acquire_grid_coordinates(&cache,&msg,m,&coords) != 0) {
+	    fprintf(stderr,"Warning: skipping grid %zu of message %zu of %s: %s\n",m+1,nmsg,argv[n],msg.error);
+	    continue;
+	  }
+	  printf("%s %zu %zu %d.%d.%d %d/%g",argv[n],nmsg,m+1,msg.disc,md->param_cat,md->param_num,md->lvl1_type,md->lvl1);
+	  if (md->lvl2_type != 255) {
+	    printf("-%d/%g",md->lvl2_type,md->lvl2);
+	  }
+	  printf(" %d %d\n",md->nx,md->ny);
+	  const double *values=msg.grids[m].gridpoints;
+	  for (size_t k=0; k < coords->num_points; ++k) {
+	    if (values[k] == GRIB_MISSING_VALUE) {
+		printf("%.6f %.6f -\n",coords->lats[k],coords->lons[k]);
+	    }
+	    else {
+		printf("%.6f %.6f %g\n",coords->lats[k],coords->lons[k],values[k]);
+	    }
+	  }
+	  release_grid_coordinates(&cache,coords);
+	}
+    }
+    fclose(fp);
+  }
+  free_coordinate_cache(&cache);
+  return status;
+}
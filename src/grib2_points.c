@@ -0,0 +1,128 @@
+/*
+** File: grib2_points.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to print the values of the grids in GRIB2 files at a list of
+**          stations, interpolated bilinearly from the four gridpoints around
+**          each station
+**
+** Usage: grib2_points station_file GRIB2_file [GRIB2_file ...]
+**   station_file has one station on each line:
+**     id latitude longitude
+**   with the latitude in degrees north and the longitude in degrees east; lines
+**   that start with '#' are ignored
+**
+**   each grid is printed on one line:
+**     file message grid discipline.category.number level value [value ...]
+**   where 'level' is the first level type and value (and the second level
+**   type, for a layer), and there is one value for each station, in the order
+**   of the station file; a missing value is printed as "-"
+**
+** Compile with:
+**   cc -std=c99 -o grib2_points grib2_points.c -lm
+**   (add -DJASPER or -DAEC and their libraries to decode grids packed with
+**   JPEG 2000 or CCSDS)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "point_extractor.c"
+
+int main(int argc,char **argv)
+{
+  if (argc < 3) {
+    fprintf(stderr,"usage: %s station_file GRIB2_file [GRIB2_file ...]\n",argv[0]);
+    exit(1);
+  }
+  FILE *fp;
+  if ( (fp=fopen(argv[1],"r")) == NULL) {
+    fprintf(stderr,"Error opening %s\n",argv[1]);
+    exit(1);
+  }
+  double *lats=NULL,*lons=NULL;
+  size_t num_stations=0,capacity=0;
+  char line[256];
+  while (fgets(line,sizeof(line),fp) != NULL) {
+    char id[128];
+    double lat,lon;
+    if (sscanf(line," %127s",id) != 1 || id[0] == '#') {
+	continue;
+    }
+    if (sscanf(line,"%*s %lf %lf",&lat,&lon) != 2) {
+	fprintf(stderr,"Warning: skipping station line '%s' of %s\n",strtok(line,"\n"),argv[1]);
+	continue;
+    }
+    if (num_stations == capacity) {
+	capacity= (capacity > 0) ? capacity*2 : 64;
+	lats=(double *)realloc(lats,capacity*sizeof(double));
+	lons=(double *)realloc(lons,capacity*sizeof(double));
+	if (lats == NULL || lons == NULL) {
+	  fprintf(stderr,"Error allocating %zu stations\n",capacity);
+	  exit(1);
+	}
+    }
+    lats[num_stations]=lat;
+    lons[num_stations]=lon;
+    ++num_stations;
+  }
+  fclose(fp);
+  if (num_stations == 0) {
+    fprintf(stderr,"Error: no stations in %s\n",argv[1]);
+    exit(1);
+  }
+  PointExtractor extractor;
+  double *values=(double *)malloc(num_stations*sizeof(double));
+  if (values == NULL || initialize_point_extractor(&extractor,lats,lons,num_stations) != 0) {
+    fprintf(stderr,"Error allocating %zu stations\n",num_stations);
+    exit(1);
+  }
+  free(lats);
+  free(lons);
+  GRIB2Message msg;
+  initialize(&msg);
+// only the gridpoints around the stations are unpacked from grids with simple
+//   packing
+  msg.unpack_simple=0;
+  int status=0;
+  for (int n=2; n < argc; ++n) {
+    if ( (fp=fopen(argv[n],"rb")) == NULL) {
+	fprintf(stderr,"Error opening %s\n",argv[n]);
+	status=1;
+	continue;
+    }
+    size_t nmsg=0;
+    int read_status;
+    while ( (read_status=unpack_IS(fp,&msg)) != GRIB_EOF && read_status != GRIB_READ_ERROR) {
+	++nmsg;
+	if (read_status != 0 || unpack_sections(&msg) != 0) {
+	  fprintf(stderr,"Warning: skipping message %zu of %s: %s\n",nmsg,argv[n],msg.error);
+	  continue;
+	}
+	for (size_t m=0; m < msg.num_grids; ++m) {
+	  const GRIB2Metadata *md=&msg.grids[m].md;
+	  if (extract_points(&extractor,&msg,m,values) != 0) {
+	    fprintf(stderr,"Warning: skipping grid %zu of message %zu of %s: %s\n",m+1,nmsg,argv[n],msg.error);
+	    continue;
+	  }
+	  printf("%s %zu %zu %d.%d.%d %d/%g",argv[n],nmsg,m+1,msg.disc,md->param_cat,md->param_num,md->lvl1_type,md->lvl1);
+	  if (md->lvl2_type != 255) {
+	    printf("-%d/%g",md->lvl2_type,md->lvl2);
+	  }
+	  for (size_t k=0; k < num_stations; ++k) {
+	    if (values[k] == GRIB_MISSING_VALUE) {
+		printf(" -");
+	    }
+	    else {
+		printf(" %g",values[k]);
+	    }
+	  }
+	  printf("\n");
+	}
+    }
+    fclose(fp);
+  }
+  free(values);
+  free_point_extractor(&extractor);
+  return status;
+}
@@ -22,8 +22,12 @@ int main(int argc,char **argv)
   initialize(&grib2_msg);
   int status;
   size_t nmsg=0;
-  while ( (status=unpackgrib2(fp,&grib2_msg)) == 0) {
+  while ( (status=unpackgrib2(fp,&grib2_msg)) != GRIB_EOF && status != GRIB_READ_ERROR) {
     ++nmsg;
+    if (status != 0) {
+	printf("Message Number: %zu  skipped: %s\n",nmsg,grib2_msg.error);
+	continue;
+    }
 /* print some header information */
     int hr=grib2_msg.time/10000;
     int min=(grib2_msg.time/100) % 100;
@@ -75,7 +79,7 @@ int main(int argc,char **argv)
 	}
     }
   }
-  if (status == -1) {
+  if (status == GRIB_EOF) {
     printf("EOF - end of file found\n");
   }
   else {
@@ -0,0 +1,183 @@
+/*
+** File: grib2_timeseries.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to print the time series of a GRIB2 parameter at stations, or in a
+**          latitude/longitude box, from many GRIB2 files
+**
+** Usage: grib2_timeseries [-t threads] [-n] -p discipline.category.number
+**            [-l type/value[-type/value]] [-f forecast_time]
+**            (-s latitude,longitude [-s ...] | -b south,north,west,east)
+**            GRIB2_file [GRIB2_file ...]
+**   -t  the number of threads that read files (only when compiled with
+**         -DPTHREADS; default 1)
+**   -n  don't save the indexes of the files that have to be indexed
+**   -p  the parameter
+**   -l  the level (the first level type and value, and the second level type
+**         and value of a layer)
+**   -f  the forecast time, in the units of the grids
+**   -s  a station; the values are interpolated bilinearly to the station
+**   -b  a box; the values are the gridpoints in the box, in rows
+**
+**   the first line names the columns, and then each time is printed on one
+**   line:
+**     valid_time reference_time value [value ...]
+**   with the times as YYYYMMDDHHMM, in order of valid time; a missing value is
+**   printed as "-"
+**
+**   the index of each file is saved next to it as file.g2idx (see
+**   grib2_index.c), so the next time series from the same files only reads
+**   the messages that it needs
+**
+** Compile with:
+**   cc -std=c99 -o grib2_timeseries grib2_timeseries.c -lm
+**   (add -DPTHREADS and -lpthread to read the files in parallel; add -DJASPER
+**   or -DAEC and their libraries to decode grids packed with JPEG 2000 or
+**   CCSDS)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "time_series.c"
+
+void usage(char *program)
+{
+#ifdef PTHREADS
+  fprintf(stderr,"usage: %s [-t threads] [-n] -p discipline.category.number\n",program);
+#else
+  fprintf(stderr,"usage: %s [-n] -p discipline.category.number\n",program);
+#endif
+  fprintf(stderr,"           [-l type/value[-type/value]] [-f forecast_time]\n");
+  fprintf(stderr,"           (-s latitude,longitude [-s ...] | -b south,north,west,east)\n");
+  fprintf(stderr,"           GRIB2_file [GRIB2_file ...]\n");
+  exit(1);
+}
+
+/* print_time prints a time YYYYMMDDHHMMSS as YYYYMMDDHHMM after 'separator' */
+void print_time(const char *separator,long long t)
+{
+  if (t < 0) {
+    printf("%s-",separator);
+  }
+  else {
+    printf("%s%012lld",separator,t/100);
+  }
+}
+
+int main(int argc,char **argv)
+{
+  int nthreads=1;
+  TimeSeriesQuery query;
+  initialize_time_series_query(&query);
+  double *lats=NULL,*lons=NULL;
+  size_t num_stations=0,capacity=0;
+  int box=0;
+  int next=1;
+  while (next < argc && argv[next][0] == '-') {
+#ifdef PTHREADS
+    if (strcmp(argv[next],"-t") == 0 && next+1 < argc) {
+	++next;
+	nthreads=atoi(argv[next]);
+	if (nthreads < 1) {
+	  usage(argv[0]);
+	}
+    }
+    else
+#endif
+    if (strcmp(argv[next],"-n") == 0) {
+	query.save_indexes=0;
+    }
+    else if (strcmp(argv[next],"-p") == 0 && next+1 < argc) {
+	++next;
+	if (sscanf(argv[next],"%d.%d.%d",&query.match.disc,&query.match.param_cat,&query.match.param_num) != 3) {
+	  usage(argv[0]);
+	}
+    }
+    else if (strcmp(argv[next],"-l") == 0 && next+1 < argc) {
+	++next;
+	int n=sscanf(argv[next],"%d/%lf-%d/%lf",&query.match.lvl1_type,&query.match.lvl1,&query.match.lvl2_type,&query.match.lvl2);
+	if (n == 2) {
+	  query.match.lvl2_type=255;
+	}
+	else if (n != 4) {
+	  usage(argv[0]);
+	}
+    }
+    else if (strcmp(argv[next],"-f") == 0 && next+1 < argc) {
+	++next;
+	if (sscanf(argv[next],"%d",&query.match.fcst_time) != 1) {
+	  usage(argv[0]);
+	}
+    }
+    else if (strcmp(argv[next],"-s") == 0 && next+1 < argc) {
+	++next;
+	if (num_stations == capacity) {
+	  capacity= (capacity > 0) ? capacity*2 : 16;
+	  lats=(double *)realloc(lats,capacity*sizeof(double));
+	  lons=(double *)realloc(lons,capacity*sizeof(double));
+	  if (lats == NULL || lons == NULL) {
+	    fprintf(stderr,"Error allocating %zu stations\n",capacity);
+	    exit(1);
+	  }
+	}
+	if (sscanf(argv[next],"%lf,%lf",&lats[num_stations],&lons[num_stations]) != 2) {
+	  usage(argv[0]);
+	}
+	++num_stations;
+    }
+    else if (strcmp(argv[next],"-b") == 0 && next+1 < argc) {
+	++next;
+	if (sscanf(argv[next],"%lf,%lf,%lf,%lf",&query.south,&query.north,&query.west,&query.east) != 4 || query.south > query.north) {
+	  usage(argv[0]);
+	}
+	box=1;
+    }
+    else {
+	usage(argv[0]);
+    }
+    ++next;
+  }
+  if (argc-next < 1 || query.match.disc == GRIB_ANY || (num_stations > 0) == box) {
+    usage(argv[0]);
+  }
+  query.lats=lats;
+  query.lons=lons;
+  query.num_stations=num_stations;
+  TimeSeries ts;
+  int status=extract_time_series(&query,&argv[next],argc-next,nthreads,&ts);
+  if (status == 2) {
+    free(lats);
+    free(lons);
+    exit(1);
+  }
+  printf("valid_time reference_time");
+  if (box) {
+    printf(" (%zu rows of %zu gridpoints)",ts.nj,ts.ni);
+  }
+  else {
+    for (size_t n=0; n < num_stations; ++n) {
+	printf(" %g,%g",lats[n],lons[n]);
+    }
+  }
+  printf("\n");
+  for (size_t n=0; n < ts.num_times; ++n) {
+    print_time("",ts.valid_times[n]);
+    print_time(" ",ts.ref_times[n]);
+    for (size_t m=0; m < ts.num_columns; ++m) {
+	double value=ts.values[m*ts.num_times+n];
+	if (value == GRIB_MISSING_VALUE) {
+	  printf(" -");
+	}
+	else {
+	  printf(" %g",value);
+	}
+    }
+    printf("\n");
+  }
+  free_time_series(&ts);
+  free(lats);
+  free(lons);
+  return status;
+}
@@ -43,13 +43,72 @@
 **               - fixed missing value check for bitmap inclusion - some GRIB2
 **                 data representations (e.g. DRS Template 5.3) don't require a
 **                 bitmap in the GRIB2 message
+**   18 Oct 2026 - ieee2ibm works on the IEEE bit pattern instead of normalizing
+**                 with loops; the fraction is rounded to the nearest IBM
+**                 value, so the last bit can differ from the old conversion
+**                 (e.g. -17592185348082.418 is now 0xcbffffff instead of
+**                 0xcc100000, which is farther from it)
+**               - pack the bitmap and the data values with a buffered bit
+**                 writer instead of calling set_bits for every value
+**               - scale each grid in a single pass into a reused buffer; the
+**                 reference value is now the minimum of the grid, so packed
+**                 values can't be negative, and the packing width is the
+**                 fewest bits that hold the largest packed value
+**               - grids with simple packing (DRS Template 5.0) are copied
+**                 into the GRIB1 BDS and BMS without unpacking them; other
+**                 templates (e.g. 5.3 and 5.40) are still unpacked and packed
+**                 again
+**               - grids are built complete (including the Indicator and End
+**                 Sections) directly in a large output buffer, which is
+**                 written in batches, optionally with direct I/O
+**               - with -t, messages are converted by a pipeline of threads
+**                 that reads, converts and writes at the same time, keeping the
+**                 output in input order
+**               - added a batch mode (-m) that converts a list of files, or a
+**                 directory, on a pool of threads
+**               - parameters, levels and time ranges are mapped with tables
+**                 and perfect hashes; grids whose level or time range can't be
+**                 represented in GRIB1 are skipped with a warning instead of
+**                 ending the program
+**               - messages and grids that the decoder can't unpack are skipped
+**                 with a warning instead of ending the program
+**               - batch mode runs each file as a task on the work-stealing
+**                 scheduler in grib_scheduler.c, and the grids of the
+**                 messages are unpacked in parallel on the same pool
+**               - the bit writer and the output buffer are shared with
+**                 grib1to2.c in grib_convert.c
+**               - the number included in averages and the number missing are
+**                 packed into octets 22-24 of the PDS, which were left unset
+**               - the pipeline of threads (-t) is shared with grib1to2.c in
+**                 grib_convert.c, and the buffers of each conversion are freed
+**               - the notice about the PDS extension is printed once under a
+**                 mutex, since grids are packed on several threads
+**               - in batch mode, a failure to create the threads or the
+**                 conversions is reported for each file instead of ending the
+**                 program
+**               - batch mode is shared with grib1to2.c in grib_convert.c; a
+**                 file whose output file can't be opened is skipped like one
+**                 whose input file can't be opened, and files whose output
+**                 files would have the same name are rejected
+**               - the keys of the mapping tables give "any center" its own
+**                 value, which can't be confused with the missing center (255)
+**               - the parameter, level and time range maps are kept as tables
+**                 in tables/ and compiled into grib2to1_maps.c by
+**                 build_grib2to1_maps.c
+**               - the perfect hashes of the maps are shared with grib1to2.c in
+**                 grib_convert.c; duplicate entries are reported by
+**                 build_grib2to1_maps.c instead of when the program starts
 **
 ** Contact Bob Dattore at dattore@ucar.edu to get conversions for other products
 ** and grid definitions added.
 **
 ** You will need to download the GRIB2 decoder:
 **    https://raw.githubusercontent.com/rda-dattore/GRIB/master/src/unpackgrib2.c
-** It must be in the same directory as this program.
+** the code that is shared with grib1to2.c:
+**    https://raw.githubusercontent.com/rda-dattore/GRIB/master/src/grib_convert.c
+** and the mapping tables:
+**    https://raw.githubusercontent.com/rda-dattore/GRIB/master/src/grib2to1_maps.c
+** They must be in the same directory as this program.
 **
 ** If you want to decode jpeg-compressed grids (widely used by NCEP), you will
 **   also need to link with the JasPer library, which needs the JPEG-6b library.
@@ -71,14 +130,47 @@
 **   include the math library in the compile
 **      e.g. % cc -std=c99 -o grib2to1 grib2to1.c -lm
 **
+** To convert several messages at the same time, compile with -DPTHREADS
+**      e.g. % cc -std=c99 -DPTHREADS -o grib2to1 grib2to1.c -lm -lpthread
+**
 ** To use the program:
-**    % grib2to1 <name of GRIB2 file to convert> <name of GRIB1 file to create>
+**    % grib2to1 [-t threads] [-b megabytes] [-d] <name of GRIB2 file to convert> <name of GRIB1 file to create>
+**      where -t sets the number of worker threads that convert messages
+**        (requires -DPTHREADS), -b sets the size in megabytes of the output
+**        buffer (default 4), and -d writes the output with direct I/O
+**        (O_DIRECT) for file systems that perform best with large, unbuffered
+**        writes
+**
+** To convert many files at once:
+**    % grib2to1 [-t threads] [-b megabytes] [-d] -m <manifest or directory> [-o template]
+**      where the manifest names one GRIB2 file per line, optionally followed by
+**        the name of its GRIB1 file (blank lines and lines starting with '#'
+**        are ignored), or the directory holds the GRIB2 files
+**      and the template names the GRIB1 files that are not named in the
+**        manifest; %f is replaced by the name of the GRIB2 file without its
+**        directory and %b by the same without its extension (the default is
+**        "%b.grb", in the current directory)
+**      a file whose output file has the same name as that of an earlier file
+**        (e.g. input files with the same name in different directories) is
+**        skipped, as is a file whose input or output file can't be opened
+**      the files are converted by 'threads' threads, each of which reuses its
+**        buffers from one file to the next, and the throughput is printed at
+**        the end; with -DPTHREADS, threads that run out of files help to
+**        unpack the large grids of the files that are still being converted
+**        (grib_scheduler.c must be in the same directory as this program)
 */
 
+/* O_DIRECT is a GNU extension */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#ifdef PTHREADS
+#include <pthread.h>
+#endif
 #include "unpackgrib2.c"
+#include "grib_convert.c"
 
 /* set_bits sets the contents of the various GRIB octets
 **   buf is the GRIB buffer as a stream of bytes
@@ -146,2280 +238,300 @@ void set_bits(unsigned char *buf,int src,size_t off,size_t bits)
   }
 }
 
+/* In the mapping tables below, a center of -1 matches any center; an entry for
+**   a specific center overrides the entry for any center.  Keys are packed
+**   into 64 bits with the center in the low nine bits, where -1 becomes
+**   ANY_CENTER, which is outside 0-255, so that an entry for the missing
+**   center (255) is not taken for an entry for any center.
+*/
+const unsigned long long ANY_CENTER=0x100;
+
+/* ParameterMapEntry maps a GRIB2 parameter into a GRIB1 parameter table and
+**   code
+*/
+typedef struct {
+  short discipline,category,number,center;
+  unsigned char table_version,parameter_code;
+} ParameterMapEntry;
+
+/* LevelMapEntry maps a GRIB2 level type, or layer if 'layer' is 1, into a GRIB1
+**   level type; the GRIB1 level values are
+**     level1 = offset + lvl1*mul1/div
+**     level2 = offset + lvl2*mul2/div (layers only; 0 otherwise)
+*/
+typedef struct {
+  short lvl1_type,layer,center;
+  unsigned char level_type;
+  double offset,mul1,mul2,div;
+} LevelMapEntry;
+
+/* TimeRangeMapEntry maps a GRIB2 statistical process, over one or (for the
+**   NCEP CFSR monthly grids) two time ranges, into a GRIB1 time range indicator
+*/
+typedef struct {
+  short proc_code,num_ranges,center;
+  unsigned char t_range;
+} TimeRangeMapEntry;
+
+/* PARAMETER_MAP, LEVEL_MAP and TIME_RANGE_MAP are in
+**   tables/parameters/GRIB2/GRIB2_to_GRIB1.txt, tables/GRIB2_to_GRIB1_levels.txt
+**   and tables/GRIB2_to_GRIB1_time_ranges.txt, which build_grib2to1_maps.c
+**   compiles into grib2to1_maps.c
+*/
+#include "grib2to1_maps.c"
+
+PerfectHash parameter_hash,level_hash,time_range_hash;
+
+unsigned long long center_key(int center)
+{
+  return (center < 0) ? ANY_CENTER : (unsigned long long)(center & 0xff);
+}
+
+unsigned long long parameter_key(int discipline,int category,int number,int center)
+{
+  return (unsigned long long)(discipline & 0xff) << 33 | (unsigned long long)(category & 0xff) << 25 | (unsigned long long)(number & 0xff) << 17 | center_key(center);
+}
+
+unsigned long long level_key(int lvl1_type,int layer,int center)
+{
+  return (unsigned long long)(lvl1_type & 0xff) << 17 | (unsigned long long)layer << 9 | center_key(center);
+}
+
+unsigned long long time_range_key(int proc_code,int num_ranges,int center)
+{
+  return (unsigned long long)(proc_code & 0xff) << 17 | (unsigned long long)num_ranges << 9 | center_key(center);
+}
+
+/* build_map_hashes builds the perfect hashes of the mapping tables; it must be
+**   called before any messages are converted
+*/
+void build_map_hashes(void)
+{
+  size_t num=sizeof(PARAMETER_MAP)/sizeof(PARAMETER_MAP[0]);
+  unsigned long long *keys=(unsigned long long *)malloc(num*sizeof(unsigned long long));
+  for (size_t n=0; n < num; ++n) {
+    const ParameterMapEntry *e=&PARAMETER_MAP[n];
+    keys[n]=parameter_key(e->discipline,e->category,e->number,e->center);
+  }
+  build_perfect_hash(&parameter_hash,keys,num);
+  free(keys);
+  num=sizeof(LEVEL_MAP)/sizeof(LEVEL_MAP[0]);
+  keys=(unsigned long long *)malloc(num*sizeof(unsigned long long));
+  for (size_t n=0; n < num; ++n) {
+    const LevelMapEntry *e=&LEVEL_MAP[n];
+    keys[n]=level_key(e->lvl1_type,e->layer,e->center);
+  }
+  build_perfect_hash(&level_hash,keys,num);
+  free(keys);
+  num=sizeof(TIME_RANGE_MAP)/sizeof(TIME_RANGE_MAP[0]);
+  keys=(unsigned long long *)malloc(num*sizeof(unsigned long long));
+  for (size_t n=0; n < num; ++n) {
+    const TimeRangeMapEntry *e=&TIME_RANGE_MAP[n];
+    keys[n]=time_range_key(e->proc_code,e->num_ranges,e->center);
+  }
+  build_perfect_hash(&time_range_hash,keys,num);
+  free(keys);
+}
+
 typedef struct {
   int table_version;
   int parameter_code;
 } ParameterData;
 
-ParameterData map_parameter_data(GRIB2Message *msg,int grid_number)
+/* map_parameter_data returns 0 and fills 'pdata', or 1 if the parameter has no
+**   GRIB1 code
+*/
+int map_parameter_data(GRIB2Message *msg,int grid_number,ParameterData *pdata)
 {
-  ParameterData pdata;
-  switch (msg->disc) {
-// meteorological products
-    case 0:
-    {
-	switch (msg->grids[grid_number].md.param_cat) {
-// temperature parameters
-	  case 0:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=11;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=12;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=13;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=14;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=15;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=16;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=17;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=18;
-		  return pdata;
-		}
-		case 8:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=19;
-		  return pdata;
-		}
-		case 9:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=25;
-		  return pdata;
-		}
-		case 10:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=121;
-		  return pdata;
-		}
-		case 11:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=122;
-		  return pdata;
-		}
-		case 21:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=131;
-			pdata.parameter_code=193;
-			return pdata;
-		    }
-		  }
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=229;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// moisture parameters
-	  case 1:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=51;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=52;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=53;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=54;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=55;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=56;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=57;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=59;
-		  return pdata;
-		}
-		case 8:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=61;
-		  return pdata;
-		}
-		case 9:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=62;
-		  return pdata;
-		}
-		case 10:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=63;
-		  return pdata;
-		}
-		case 11:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=66;
-		  return pdata;
-		}
-		case 12:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=64;
-		  return pdata;
-		}
-		case 13:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=65;
-		  return pdata;
-		}
-		case 14:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=78;
-		  return pdata;
-		}
-		case 15:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=79;
-		  return pdata;
-		}
-		case 16:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=99;
-		  return pdata;
-		}
-		case 22:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=153;
-			return pdata;
-		    }
-		  }
-		}
-		case 39:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=194;
-			return pdata;
-		    }
-		  }
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-			pdata.table_version=3;
-			pdata.parameter_code=140;
-			return pdata;
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=141;
-			return pdata;
-		    }
-		  }
-		}
-		case 194:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=142;
-			return pdata;
-		    }
-		  }
-		}
-		case 195:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=143;
-			return pdata;
-		    }
-		  }
-		}
-		case 196:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=214;
-			return pdata;
-		    }
-		  }
-		}
-		case 197:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=135;
-			return pdata;
-		    }
-		  }
-		}
-		case 199:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=228;
-			return pdata;
-		    }
-		  }
-		}
-		case 200:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=145;
-			return pdata;
-		    }
-		  }
-		}
-		case 201:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=238;
-			return pdata;
-		    }
-		  }
-		}
-		case 206:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=186;
-			return pdata;
-		    }
-		  }
-		}
-		case 207:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=198;
-			return pdata;
-		    }
-		  }
-		}
-		case 208:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=239;
-			return pdata;
-		    }
-		  }
-		}
-		case 213:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=243;
-			return pdata;
-		    }
-		  }
-		}
-		case 214:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=245;
-			return pdata;
-		    }
-		  }
-		}
-		case 215:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=249;
-			return pdata;
-		    }
-		  }
-		}
-		case 216:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=159;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// momentum parameters
-	  case 2:
-	  {
-	    switch(msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=31;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=32;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=33;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=34;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=35;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=36;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=37;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=38;
-		  return pdata;
-		}
-		case 8:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=39;
-		  return pdata;
-		}
-		case 9:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=40;
-		  return pdata;
-		}
-		case 10:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=41;
-		  return pdata;
-		}
-		case 11:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=42;
-		  return pdata;
-		}
-		case 12:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=43;
-		  return pdata;
-		}
-		case 13:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=44;
-		  return pdata;
-		}
-		case 14:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=4;
-		  return pdata;
-		}
-		case 15:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=45;
-		  return pdata;
-		}
-		case 16:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=46;
-		  return pdata;
-		}
-		case 17:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=124;
-		  return pdata;
-		}
-		case 18:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=125;
-		  return pdata;
-		}
-		case 19:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=126;
-		  return pdata;
-		}
-		case 20:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=123;
-		  return pdata;
-		}
-		case 22:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=180;
-			return pdata;
-		    }
-		  }
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=136;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=172;
-			return pdata;
-		    }
-		  }
-		}
-		case 194:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=196;
-			return pdata;
-		    }
-		  }
-		}
-		case 195:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=197;
-			return pdata;
-		    }
-		  }
-		}
-		case 196:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=252;
-			return pdata;
-		    }
-		  }
-		}
-		case 197:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=253;
-			return pdata;
-		    }
-		  }
-		}
-		case 224:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=129;
-			pdata.parameter_code=241;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// mass parameters
-	  case 3:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=1;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=2;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=3;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=5;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=6;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=7;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=8;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=9;
-		  return pdata;
-		}
-		case 8:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=26;
-		  return pdata;
-		}
-		case 9:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=27;
-		  return pdata;
-		}
-		case 10:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=89;
-		  return pdata;
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=130;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=222;
-			return pdata;
-		    }
-		  }
-		}
-		case 194:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=147;
-			return pdata;
-		    }
-		  }
-		}
-		case 195:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=148;
-			return pdata;
-		    }
-		  }
-		}
-		case 196:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=221;
-			return pdata;
-		    }
-		  }
-		}
-		case 197:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=230;
-			return pdata;
-		    }
-		  }
-		}
-		case 198:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=129;
-			return pdata;
-		    }
-		  }
-		}
-		case 199:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=137;
-			return pdata;
-		    }
-		  }
-		}
-		case 200:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=129;
-			pdata.parameter_code=141;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// short-wave radiation parameters
-	  case 4:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=111;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=113;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=116;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=117;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=118;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=119;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=120;
-		  return pdata;
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=204;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=211;
-			return pdata;
-		    }
-		  }
-		}
-		case 196:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=161;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// long-wave radiation parameters
-	  case 5:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=112;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=114;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=115;
-		  return pdata;
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=205;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=212;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// cloud parameters
-	  case 6:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=58;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=71;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=72;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=73;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=74;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=75;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=76;
-		  return pdata;
-		}
-		case 25:
-		{
-		  switch (msg->center_id) {
-		    case 74:
-		    {
-			pdata.table_version=140;
-			pdata.parameter_code=174;
-			return pdata;
-		    }
-		  }
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=213;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=146;
-			return pdata;
-		    }
-		  }
-		}
-		case 201:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=133;
-			pdata.parameter_code=191;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// thermodynamic stability index parameters
-	  case 7:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=24;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=77;
-		  return pdata;
-		}
-		case 6:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=157;
-			return pdata;
-		    }
-		  }
-		}
-		case 7:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=156;
-			return pdata;
-		    }
-		  }
-		}
-		case 8:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=190;
-			return pdata;
-		    }
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=131;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=132;
-			return pdata;
-		    }
-		  }
-		}
-		case 194:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=254;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// aerosol parameters
-	  case 13:
-	  {
-	    break;
-	  }
-// trace gas parameters
-	  case 14:
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=10;
-		  return pdata;
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=154;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-// radar parameters
-	  case 15:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=21;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=22;
-		  return pdata;
-		}
-		case 8:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=23;
-		  return pdata;
-		}
-	    }
-	    break;
-	  }
-// forecast radar imagery parameters
-	  case 16:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 195:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=129;
-			pdata.parameter_code=211;
-			return pdata;
-		    }
-		  }
-		}
-		case 196:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=129;
-			pdata.parameter_code=212;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	  }
-// nuclear/radiology parameters
-	  case 18:
-	  {
-	    break;
-	  }
-// physical atmospheric property parameters
-	  case 19:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=20;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=84;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=60;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=67;
-		  return pdata;
-		}
-		case 20:
-		{
-		  switch (msg->center_id) {
-		    case 74:
-		    {
-			switch (msg->md.spatial_proc.type) {
-			  case 0:
-			  {
-			    pdata.table_version=3;
-			    pdata.parameter_code=168;
-			    return pdata;
-			  }
-			  case 2:
-			  {
-			    pdata.table_version=3;
-			    pdata.parameter_code=169;
-			    return pdata;
-			  }
-			}
-		    }
-		  }
-		}
-		case 21:
-		{
-		  switch (msg->center_id) {
-		    case 74:
-		    {
-			switch (msg->md.spatial_proc.type) {
-			  case 0:
-			  {
-			    pdata.table_version=3;
-			    pdata.parameter_code=170;
-			    return pdata;
-			  }
-			  case 2:
-			  {
-			    pdata.table_version=3;
-			    pdata.parameter_code=171;
-			    return pdata;
-			  }
-			}
-		    }
-		  }
-		}
-		case 22:
-		{
-		  switch (msg->center_id) {
-		    case 74:
-		    {
-			switch (msg->md.spatial_proc.type) {
-			  case 0:
-			  {
-			    pdata.table_version=3;
-			    pdata.parameter_code=172;
-			    return pdata;
-			  }
-			  case 2:
-			  {
-			    pdata.table_version=3;
-			    pdata.parameter_code=173;
-			    return pdata;
-			  }
-			}
-		    }
-		  }
-		}
-		case 204:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-			pdata.table_version=3;
-			pdata.parameter_code=209;
-			return pdata;
-		  }
-		}
-	    }
-	    break;
-	  }
-	}
-	break;
-    }
-// hydrologic products
-    case 1:
-    {
-	switch (msg->grids[grid_number].md.param_cat) {
-// hydrology basic products
-	  case 0:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=234;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=235;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	  }
-	  case 1:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=195;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=194;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-	}
-	break;
-    }
-// land surface products
-    case 2:
-    {
-	switch (msg->grids[grid_number].md.param_cat) {
-// vegetation/biomass
-	  case 0:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=81;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=83;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=85;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=86;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=87;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=90;
-		  return pdata;
-		}
-		case 192:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=144;
-			return pdata;
-		    }
-		  }
-		}
-		case 193:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=155;
-			return pdata;
-		    }
-		  }
-		}
-		case 194:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=207;
-			return pdata;
-		    }
-		  }
-		}
-		case 195:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=208;
-			return pdata;
-		    }
-		  }
-		}
-		case 196:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=223;
-			return pdata;
-		    }
-		  }
-		}
-		case 197:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=226;
-			return pdata;
-		    }
-		  }
-		}
-		case 198:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=225;
-			return pdata;
-		    }
-		  }
-		}
-		case 201:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=130;
-			pdata.parameter_code=219;
-			return pdata;
-		    }
-		  }
-		}
-		case 207:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=3;
-			pdata.parameter_code=201;
-			return pdata;
-		    }
-		  }
-		}
-		case 218:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=131;
-			pdata.parameter_code=189;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-	  case 3:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 203:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=130;
-			pdata.parameter_code=220;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-	  case 4:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 2:
-		{
-		  switch (msg->center_id) {
-		    case 7:
-		    {
-			pdata.table_version=129;
-			pdata.parameter_code=250;
-			return pdata;
-		    }
-		  }
-		}
-	    }
-	    break;
-	  }
-	}
-	break;
-    }
-// oceanographic products
-    case 10:
-    {
-	switch (msg->grids[grid_number].md.param_cat) {
-// waves parameters
-	  case 0:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=28;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=29;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=30;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=100;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=101;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=102;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=103;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=104;
-		  return pdata;
-		}
-		case 8:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=105;
-		  return pdata;
-		}
-		case 9:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=106;
-		  return pdata;
-		}
-		case 10:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=107;
-		  return pdata;
-		}
-		case 11:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=108;
-		  return pdata;
-		}
-		case 12:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=109;
-		  return pdata;
-		}
-		case 13:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=110;
-		  return pdata;
-		}
-	    }
-	    break;
-	  }
-// currents parameters
-	  case 1:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=47;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=48;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=49;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=50;
-		  return pdata;
-		}
-	    }
-	    break;
-	  }
-// ice parameters
-	  case 2:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=91;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=92;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=93;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=94;
-		  return pdata;
-		}
-		case 4:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=95;
-		  return pdata;
-		}
-		case 5:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=96;
-		  return pdata;
-		}
-		case 6:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=97;
-		  return pdata;
-		}
-		case 7:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=98;
-		  return pdata;
-		}
-	    }
-	    break;
-	  }
-// surface properties parameters
-	  case 3:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=80;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=82;
-		  return pdata;
-		}
-	    }
-	    break;
-	  }
-// sub-surface properties parameters
-	  case 4:
-	  {
-	    switch (msg->grids[grid_number].md.param_num) {
-		case 0:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=69;
-		  return pdata;
-		}
-		case 1:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=70;
-		  return pdata;
-		}
-		case 2:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=68;
-		  return pdata;
-		}
-		case 3:
-		{
-		  pdata.table_version=3;
-		  pdata.parameter_code=88;
-		  return pdata;
-		}
-	    }
-	    break;
-	  }
-	}
-	break;
-    }
+  GRIB2Grid *grid=&msg->grids[grid_number];
+  int n=find_key(&parameter_hash,parameter_key(msg->disc,grid->md.param_cat,grid->md.param_num,msg->center_id));
+  int any=find_key(&parameter_hash,parameter_key(msg->disc,grid->md.param_cat,grid->md.param_num,-1));
+  n= (n >= 0) ? n : any;
+  if (n < 0) {
+    return 1;
   }
-  fprintf(stderr,"Warning: no GRIB1 parameter code for discipline %d, parameter category %d, parameter number %d, center %d; setting to 255\n",msg->disc,msg->grids[grid_number].md.param_cat,msg->grids[grid_number].md.param_num,msg->center_id);
-  pdata.table_version=3;
-  pdata.parameter_code=255;
-  return pdata;
+  pdata->table_version=PARAMETER_MAP[n].table_version;
+  pdata->parameter_code=PARAMETER_MAP[n].parameter_code;
+  return 0;
 }
 
+/* map_level_data returns 0 and fills the GRIB1 level type and values, or 1 if
+**   the level can't be represented in GRIB1
+*/
 int map_level_data(GRIB2Grid *grid,int *level_type,int *level1,int *level2,int center)
 {
   if (grid->md.lvl2_type != 255 && grid->md.lvl1_type != grid->md.lvl2_type) {
     fprintf(stderr,"Unable to indicate a layer bounded by different level types %d and %d in GRIB1\n",grid->md.lvl1_type,grid->md.lvl2_type);
-    exit(1);
+    return 1;
   }
-  *level1=*level2=0;
-  switch (grid->md.lvl1_type) {
-    case 1:
-    {
-	*level_type=1;
-	break;
-    }
-    case 2:
-    {
-	*level_type=2;
-	break;
-    }
-    case 3:
-    {
-	*level_type=3;
-	break;
-    }
-    case 4:
-    {
-	*level_type=4;
-	break;
-    }
-    case 5:
-    {
-	*level_type=5;
-	break;
-    }
-    case 6:
-    {
-	*level_type=6;
-	break;
-    }
-    case 7:
-    {
-	*level_type=7;
-	break;
-    }
-    case 8:
-    {
-	*level_type=8;
-	break;
-    }
-    case 9:
-    {
-	*level_type=9;
-	break;
-    }
-    case 20:
-    {
-	*level_type=20;
-	break;
-    }
-    case 100:
-    {
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=100;
-	  *level1=grid->md.lvl1/100.;
-	}
-	else {
-	  *level_type=101;
-	  *level1=grid->md.lvl1/1000.;
-	  *level2=grid->md.lvl2/1000.;
-	}
-	break;
-    }
-    case 101:
-    {
-	*level_type=102;
-	break;
-    }
-    case 102:
-    {
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=103;
-	  *level1=grid->md.lvl1;
-	}
-	else {
-	  *level_type=104;
-	  *level1=grid->md.lvl1/100.;
-	  *level2=grid->md.lvl2/100.;
-	}
-	break;
-    }
-    case 103:
-    {
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=105;
-	  *level1=grid->md.lvl1;
-	}
-	else {
-	  *level_type=106;
-	  *level1=grid->md.lvl1/100.;
-	  *level2=grid->md.lvl2/100.;
-	}
-	break;
-    }
-    case 104:
-    {
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=107;
-	  *level1=grid->md.lvl1*10000.;
-	}
-	else {
-	  *level_type=108;
-	  *level1=grid->md.lvl1*100.;
-	  *level2=grid->md.lvl2*100.;
-	}
-	break;
-    }
-    case 105:
-    {
-	*level1=grid->md.lvl1;
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=109;
-	}
-	else {
-	  *level_type=110;
-	  *level2=grid->md.lvl2;
-	}
-	break;
-    }
-    case 106:
-    {
-	*level1=grid->md.lvl1*100.;
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=111;
-	}
-	else {
-	  *level_type=112;
-	  *level2=grid->md.lvl2*100.;
-	}
-	break;
-    }
-    case 107:
-    {
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=113;
-	  *level1=grid->md.lvl1;
-	}
-	else {
-	  *level_type=114;
-	  *level1=475.-grid->md.lvl1;
-	  *level2=475.-grid->md.lvl2;
-	}
-	break;
-    }
-    case 108:
-    {
-	*level1=grid->md.lvl1/100.;
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=115;
-	}
-	else {
-	  *level_type=116;
-	  *level2=grid->md.lvl2/100.;
-	}
-	break;
-    }
-    case 109:
-    {
-	*level_type=117;
-	*level1=grid->md.lvl1*1000000000.;
-	break;
-    }
-    case 111:
-    {
-	if (grid->md.lvl2_type == 255) {
-	  *level_type=119;
-	  *level1=grid->md.lvl1*10000.;
-	}
-	else {
-	  *level_type=120;
-	  *level1=grid->md.lvl1*100.;
-	  *level2=grid->md.lvl2*100.;
-	}
-	break;
-    }
-    case 117:
-    {
-	fprintf(stderr,"There is no GRIB1 level code for 'Mixed layer depth'\n");
-	exit(1);
-    }
-    case 160:
-    {
-	*level_type=160;
-	*level1=grid->md.lvl1;
-	break;
-    }
-    case 200:
-    {
-	switch (center) {
-	  case 7:
-	  {
-	    *level_type=200;
-	    break;
-	  }
-	}
-	break;
-    }
+  int layer= (grid->md.lvl2_type != 255) ? 1 : 0;
+  int n=find_key(&level_hash,level_key(grid->md.lvl1_type,layer,center));
+  int any=find_key(&level_hash,level_key(grid->md.lvl1_type,layer,-1));
+  n= (n >= 0) ? n : any;
+  if (n < 0) {
+    fprintf(stderr,"Unable to map level type %d to GRIB1\n",grid->md.lvl1_type);
+    return 1;
   }
+  const LevelMapEntry *e=&LEVEL_MAP[n];
+  *level_type=e->level_type;
+  *level1=e->offset+grid->md.lvl1*e->mul1/e->div;
+  *level2= (layer == 1) ? e->offset+grid->md.lvl2*e->mul2/e->div : 0;
+  return 0;
 }
 
-int map_statistical_end_time(GRIB2Message *msg,GRIB2Grid *grid)
+/* map_statistical_end_time returns 0 and sets 'p2' to the end of the
+**   statistical process, or 1 if the time unit can't be used
+*/
+int map_statistical_end_time(GRIB2Message *msg,GRIB2Grid *grid,int *p2)
 {
   switch (grid->md.time_unit) {
     case 0:
     {
-	return (grid->md.stat_proc.etime/100 % 100)-(msg->time/100 % 100);
+	*p2=(grid->md.stat_proc.etime/100 % 100)-(msg->time/100 % 100);
+	return 0;
     }
     case 1:
     {
-	 return (grid->md.stat_proc.etime/10000-msg->time/10000);
+	*p2=(grid->md.stat_proc.etime/10000-msg->time/10000);
+	return 0;
     }
     case 2:
     {
-	return (grid->md.stat_proc.edy-msg->dy);
+	*p2=(grid->md.stat_proc.edy-msg->dy);
+	return 0;
     }
     case 3:
     {
-	return (grid->md.stat_proc.emo-msg->mo);
+	*p2=(grid->md.stat_proc.emo-msg->mo);
+	return 0;
     }
     case 4:
     {
-	return (grid->md.stat_proc.eyr-msg->yr);
+	*p2=(grid->md.stat_proc.eyr-msg->yr);
+	return 0;
     }
     default:
     {
 	fprintf(stderr,"Unable to map end time with units %d to GRIB1\n",grid->md.time_unit);
-	exit(1);
+	return 1;
     }
   }
 }
 
-void map_time_range(GRIB2Message *msg,GRIB2Grid *grid,int *p1,int *p2,int *t_range,int *n_avg,int *n_missing,int center)
+/* map_time_range returns 0 and fills the GRIB1 time range, or 1 if the time
+**   range can't be represented in GRIB1
+*/
+int map_time_range(GRIB2Message *msg,GRIB2Grid *grid,int *p1,int *p2,int *t_range,int *n_avg,int *n_missing,int center)
 {
-  size_t n;
-
   switch (grid->md.pds_templ_num) {
     case 0:
     case 1:
     case 2:
     case 15:
     {
-	if (grid->md.time_unit == 0) {
-	  *t_range=10;
-	}
-	else {
-	  *t_range=0;
-	}
+	*t_range= (grid->md.time_unit == 0) ? 10 : 0;
 	*p1=grid->md.fcst_time;
 	*p2=0;
 	*n_avg=*n_missing=0;
-	break;
+	return 0;
     }
     case 8:
     case 11:
     case 12:
     {
-	if (grid->md.stat_proc.num_ranges > 1) {
-	  if (center == 7 && grid->md.stat_proc.num_ranges == 2) {
-/* NCEP CFSR monthly grids */
-	    *p2=grid->md.stat_proc.incr_length[0];
-	    *p1=*p2-grid->md.stat_proc.time_length[1];
-	    *n_avg=grid->md.stat_proc.time_length[0];
-	    switch (grid->md.stat_proc.proc_code[0]) {
-		case 193:
-		{
-		  *t_range=113;
-		  break;
-		}
-		case 194:
-		{
-		  *t_range=123;
-		  break;
-		}
-		case 195:
-		{
-		  *t_range=128;
-		  break;
-		}
-		case 196:
-		{
-		  *t_range=129;
-		  break;
-		}
-		case 197:
-		{
-		  *t_range=130;
-		  break;
-		}
-		case 198:
-		{
-		  *t_range=131;
-		  break;
-		}
-		case 199:
-		{
-		  *t_range=132;
-		  break;
-		}
-		case 200:
-		{
-		  *t_range=133;
-		  break;
-		}
-		case 201:
-		{
-		  *t_range=134;
-		  break;
-		}
-		case 202:
-		{
-		  *t_range=135;
-		  break;
-		}
-		case 203:
-		{
-		  *t_range=136;
-		  break;
-		}
-		case 204:
-		{
-		  *t_range=137;
-		  break;
-		}
-		case 205:
-		{
-		  *t_range=138;
-		  break;
-		}
-		case 206:
-		{
-		  *t_range=139;
-		  break;
-		}
-		case 207:
-		{
-		  *t_range=140;
-		  break;
-		}
-		default:
-		{
-		  fprintf(stderr,"Unable to map NCEP statistical process code %d to GRIB1\n",grid->md.stat_proc.proc_code[0]);
-		  exit(1);
-		}
-	    }
+	int num_ranges=grid->md.stat_proc.num_ranges;
+	if (num_ranges < 1) {
+	  num_ranges=1;
+	}
+	else if (num_ranges > 2) {
+	  num_ranges=3;
+	}
+	int proc_code=grid->md.stat_proc.proc_code[0];
+// patch for NCEP grids: maximum/minimum temperature
+	if (proc_code == 255 && center == 7 && num_ranges == 1 && msg->disc == 0 && grid->md.param_cat == 0 && (grid->md.param_num == 4 || grid->md.param_num == 5)) {
+	  proc_code=2;
+	}
+	int n=find_key(&time_range_hash,time_range_key(proc_code,num_ranges,center));
+	int any=find_key(&time_range_hash,time_range_key(proc_code,num_ranges,-1));
+	n= (n >= 0) ? n : any;
+	if (n < 0) {
+	  if (num_ranges > 1) {
+	    fprintf(stderr,"Unable to map multiple statistical processes (code %d) to GRIB1\n",proc_code);
 	  }
 	  else {
-	    fprintf(stderr,"Unable to map multiple statistical processes to GRIB1\n");
-	    exit(1);
+	    fprintf(stderr,"Unable to map statistical process %d to GRIB1\n",proc_code);
 	  }
+	  return 1;
+	}
+	*t_range=TIME_RANGE_MAP[n].t_range;
+	if (num_ranges > 1) {
+/* NCEP CFSR monthly grids */
+	  *p2=grid->md.stat_proc.incr_length[0];
+	  *p1=*p2-grid->md.stat_proc.time_length[1];
+	  *n_avg=grid->md.stat_proc.time_length[0];
 	}
 	else {
-	  switch (grid->md.stat_proc.proc_code[0]) {
-	    case 0:
-	    case 1:
-	    case 4:
-	    {
-		switch (grid->md.stat_proc.proc_code[0]) {
-/* average */
-		  case 0:
-		  {
-		    *t_range=3;
-		    break;
-		  }
-/* accumulation */
-		  case 1:
-		  {
-		    *t_range=4;
-		    break;
-		  }
-/* difference */
-		  case 4:
-		  {
-		    *t_range=5;
-		    break;
-		  }
-		}
-		*p1=grid->md.fcst_time;
-		*p2=map_statistical_end_time(msg,grid);
-		if (grid->md.stat_proc.incr_length[0] == 0) {
-		  *n_avg=0;
-		}
-		else {
-		  fprintf(stderr,"Unable to map discrete processing to GRIB1\n");
-		  exit(1);
-		}
-		break;
-	    }
-// maximum
-	    case 2:
-// minimum
-	    case 3:
-	    {
-		*t_range=2;
-		*p1=grid->md.fcst_time;
-		*p2=map_statistical_end_time(msg,grid);
-		if (grid->md.stat_proc.incr_length[0] == 0) {
-		  *n_avg=0;
-		}
-		else {
-		  fprintf(stderr,"Unable to map discrete processing to GRIB1\n");
-		  exit(1);
-		}
-		break;
-	    }
-	    default:
-	    {
-// patch for NCEP grids
-		if (grid->md.stat_proc.proc_code[0] == 255 && center == 7) {
- 		  if (msg->disc == 0) {
-		    if (grid->md.param_cat == 0) {
-			switch (grid->md.param_num) {
-			  case 4:
-			  case 5:
-			  {
-			    *t_range=2;
-			    *p1=grid->md.fcst_time;
-			    *p2=map_statistical_end_time(msg,grid);
-			    if (grid->md.stat_proc.incr_length[0] == 0) {
-				*n_avg=0;
-			    }
-			    else {
-				fprintf(stderr,"Unable to map discrete processing to GRIB1\n");
-				exit(1);
-			    }
-			    break;
-			  }
-			}
-		    }
-		  }
-		}
-		else {
-		  fprintf(stderr,"Unable to map statistical process %d to GRIB1\n",grid->md.stat_proc.proc_code[0]);
-		  exit(1);
-		}
-	    }
+	  if (grid->md.stat_proc.incr_length[0] != 0) {
+	    fprintf(stderr,"Unable to map discrete processing to GRIB1\n");
+	    return 1;
+	  }
+	  *p1=grid->md.fcst_time;
+	  if (map_statistical_end_time(msg,grid,p2) != 0) {
+	    return 1;
 	  }
+	  *n_avg=0;
 	}
 	*n_missing=grid->md.stat_proc.nmiss;
-	break;
+	return 0;
     }
     default:
     {
 	fprintf(stderr,"Unable to map time range for Product Definition Template %d into GRIB1\n",grid->md.pds_templ_num);
-	exit(1);
+	return 1;
     }
   }
 }
 
-void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_points,unsigned char *grib1_buffer,size_t *offset)
+/* first_notice returns 1 the first time that it is called, and 0 after that, so
+**   that the notice about the octets packed into the extension of the PDS is
+**   printed only once, even when grids are converted on several threads
+*/
+#ifdef PTHREADS
+pthread_mutex_t notice_lock=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+int first_notice(void)
 {
-  int level_type,level1,level2,p1,p2,t_range,n_avg,n_missing,D;
   static short warned=0;
+#ifdef PTHREADS
+  pthread_mutex_lock(&notice_lock);
+#endif
+  int first=(warned == 0);
+  warned=1;
+#ifdef PTHREADS
+  pthread_mutex_unlock(&notice_lock);
+#endif
+  return first;
+}
+
+/* pack_PDS returns 0, or 1 if the grid can't be represented in GRIB1
+*/
+int pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_points,unsigned char *grib1_buffer,size_t *offset)
+{
+  int level_type,level1,level2,p1,p2,t_range,n_avg,n_missing,D;
 
   ParameterData pdata;
-  pdata=map_parameter_data(msg,grid_number);
+  if (map_parameter_data(msg,grid_number,&pdata) != 0) {
+    fprintf(stderr,"Warning: no GRIB1 parameter code for discipline %d, parameter category %d, parameter number %d, center %d; setting to 255\n",msg->disc,msg->grids[grid_number].md.param_cat,msg->grids[grid_number].md.param_num,msg->center_id);
+    pdata.table_version=3;
+    pdata.parameter_code=255;
+  }
+  if (map_level_data(&msg->grids[grid_number],&level_type,&level1,&level2,msg->center_id) != 0) {
+    return 1;
+  }
+  if (map_time_range(msg,&msg->grids[grid_number],&p1,&p2,&t_range,&n_avg,&n_missing,msg->center_id) != 0) {
+    return 1;
+  }
 // length of the PDS
   set_bits(grib1_buffer,28,*offset,24);
 // GRIB1 tables version number
@@ -2439,7 +551,6 @@ void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_po
   }
 // parameter code
   set_bits(grib1_buffer,pdata.parameter_code,*offset+64,8);
-  map_level_data(&msg->grids[grid_number],&level_type,&level1,&level2,msg->center_id);
 // level type code
   set_bits(grib1_buffer,level_type,*offset+72,8);
   if (msg->grids[grid_number].md.lvl2_type == 255) {
@@ -2466,7 +577,6 @@ void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_po
   else {
     set_bits(grib1_buffer,msg->md.time_unit,*offset+136,8);
   }
-  map_time_range(msg,&msg->grids[grid_number],&p1,&p2,&t_range,&n_avg,&n_missing,msg->center_id);
   if (t_range == 10) {
     set_bits(grib1_buffer,p1,*offset+144,16);
   }
@@ -2475,6 +585,9 @@ void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_po
     set_bits(grib1_buffer,p2,*offset+152,8);
   }
   set_bits(grib1_buffer,t_range,*offset+160,8);
+// number included in average, and number missing from averages
+  set_bits(grib1_buffer,n_avg,*offset+168,16);
+  set_bits(grib1_buffer,n_missing,*offset+184,8);
 // century of year
   set_bits(grib1_buffer,(msg->yr/100)+1,*offset+192,8);
 // originating sub-center ID
@@ -2493,12 +606,11 @@ void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_po
     set_bits(grib1_buffer,msg->md.perturb_num,*offset+104,8);
     set_bits(grib1_buffer,msg->md.nfcst_in_ensemble,*offset+112,8);
     (*offset)+=120;
-    if (warned == 0) {
+    if (first_notice()) {
 	fprintf(stderr,"Notice: the 'Ensemble type code', the 'Perturbation Number', and the\n");
 	fprintf(stderr,"'Number of forecasts in ensemble' from Product Definition Template 4.1 and/or\n");
 	fprintf(stderr,"Product Definition Template 4.12 have been packed in octets 41, 42, and 43 of\n");
 	fprintf(stderr,"the GRIB1 Product Definition Section\n");
-	warned=1;
     }
   }
   else if (msg->md.derived_fcst_code >= 0) {
@@ -2507,11 +619,10 @@ void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_po
     set_bits(grib1_buffer,msg->md.derived_fcst_code,*offset+96,8);
     set_bits(grib1_buffer,msg->md.nfcst_in_ensemble,*offset+104,8);
     (*offset)+=112;
-    if (warned == 0) {
+    if (first_notice()) {
 	fprintf(stderr,"Notice: the 'Derived forecast code' and the 'Number of forecasts in ensemble'\n");
 	fprintf(stderr,"from Product Definition Template 4.2 and/or Product Definition Template 4.12\n");
 	fprintf(stderr,"have been packed in octets 41 and 42 of the GRIB1 Product Definition Section\n");
-	warned=1;
     }
   }
   else if (msg->md.spatial_proc.type >= 0) {
@@ -2521,13 +632,13 @@ void pack_PDS(GRIB2Message *msg,int grid_number,size_t num_to_pack,size_t num_po
     set_bits(grib1_buffer,msg->md.spatial_proc.type,*offset+104,8);
     set_bits(grib1_buffer,msg->md.spatial_proc.num_points,*offset+112,8);
     (*offset)+=120;
-    if (warned == 0) {
+    if (first_notice()) {
 	fprintf(stderr,"Notice: the Spatial processing codes: 'statistical process', 'type' and\n");
 	fprintf(stderr,"'number of data points' from Product Definition Template 4.15 have been\n");
 	fprintf(stderr,"packed in octets 41, 42, and 43 of the GRIB1 Product Definition Section\n");
-	warned=1;
     }
   }
+  return 0;
 }
 
 void pack_GDS(GRIB2Message *msg,int grid_number,unsigned char *grib1_buffer,size_t *offset)
@@ -2742,8 +853,7 @@ void pack_GDS(GRIB2Message *msg,int grid_number,unsigned char *grib1_buffer,size
 void pack_BMS(GRIB2Message *msg,int grid_number,unsigned char *grib1_buffer,size_t *offset,size_t num_points)
 {
   int length=6+(num_points+7)/8;
-  int ub=8-(num_points % 8);
-  size_t n,off;
+  int ub=(8-(num_points % 8)) % 8;
 
 // length of the BMS
   set_bits(grib1_buffer,length,*offset,24);
@@ -2751,231 +861,594 @@ void pack_BMS(GRIB2Message *msg,int grid_number,unsigned char *grib1_buffer,size
   set_bits(grib1_buffer,ub,*offset+24,8);
 // table reference
   set_bits(grib1_buffer,0,*offset+32,16);
-// the bitmap
-  off=*offset+48;
-  for (n=0; n < num_points; ++n) {
-    if (msg->grids[grid_number].gridpoints[n] == GRIB_MISSING_VALUE) {
-	set_bits(grib1_buffer,0,off++,1);
+// the bitmap - the section starts on an octet boundary, so build the bitmap a
+// whole octet at a time
+  unsigned char *b=&grib1_buffer[*offset/8+6];
+  double *gridpoints=msg->grids[grid_number].gridpoints;
+  size_t n=0;
+  for (; n+8 <= num_points; n+=8) {
+    unsigned char octet=0;
+    for (size_t m=0; m < 8; ++m) {
+	octet=(octet << 1) | (gridpoints[n+m] != GRIB_MISSING_VALUE);
     }
-    else {
-	set_bits(grib1_buffer,1,off++,1);
+    *b++=octet;
+  }
+  if (n < num_points) {
+    unsigned char octet=0;
+    for (size_t m=0; n+m < num_points; ++m) {
+	octet|=(gridpoints[n+m] != GRIB_MISSING_VALUE) << (7-m);
     }
+    *b=octet;
   }
   (*offset)+=length*8;
 }
 
+/* copy_BMS packs the Bitmap Section from the bitmap in the GRIB2 Bit Map
+**   Section, without unpacking it
+*/
+void copy_BMS(GRIB2Message *msg,int grid_number,unsigned char *grib1_buffer,size_t *offset,size_t num_points)
+{
+  int length=6+(num_points+7)/8;
+  int ub=(8-(num_points % 8)) % 8;
+
+// length of the BMS
+  set_bits(grib1_buffer,length,*offset,24);
+// unused bits at end of section
+  set_bits(grib1_buffer,ub,*offset+24,8);
+// table reference
+  set_bits(grib1_buffer,0,*offset+32,16);
+// the bitmap
+  copy_bits(&grib1_buffer[*offset/8+6],&msg->buffer[msg->grids[grid_number].md.bms_off/8+6],num_points);
+  (*offset)+=length*8;
+}
+
+/* ieee2ibm_bits converts a native double to the 32 bits of an IBM single-
+**   precision float, working directly on the IEEE bit pattern; the fraction is
+**   rounded to 24 bits, values too small for the IBM format become 0 and values
+**   too large are set to the largest IBM magnitude
+*/
+unsigned int ieee2ibm_bits(double ieee)
+{
+  union {
+    double d;
+    unsigned long long u;
+  } v;
+  v.d=ieee;
+  unsigned int sign=(v.u >> 32) & 0x80000000;
+  int e2=(v.u >> 52) & 0x7ff;
+  if (e2 == 0) {
+/* zero, or an IEEE denormal, which is far below the range of IBM floats */
+    return 0;
+  }
+  if (e2 == 0x7ff) {
+    return sign | 0x7fffffff;
+  }
+  unsigned long long m=(v.u & 0xfffffffffffffULL) | (1ULL << 52);
+/* the value is m/2^53 * 2^(e2-1022); find the hexadecimal exponent k so that
+**   the value is (m/2^53 * 2^-s) * 16^k, with s=0..3 */
+  int k=(e2-1022+1027)/4-256;
+  int s=4*k-(e2-1022);
+  unsigned long long fr=(m+(1ULL << (28+s))) >> (29+s);
+  if (fr > 0xffffff) {
+/* rounding carried into a new hexadecimal digit */
+    fr>>=4;
+    ++k;
+  }
+  int exp=k+64;
+  if (exp > 127) {
+    return sign | 0x7fffffff;
+  }
+  if (exp < 0) {
+/* unnormalized fraction with the smallest exponent */
+    if (exp < -6) {
+	return 0;
+    }
+    fr>>=-4*exp;
+    if (fr == 0) {
+	return 0;
+    }
+    exp=0;
+  }
+  return sign | ((unsigned int)exp << 24) | (unsigned int)fr;
+}
+
+/* ieee2ibm returns the IBM representation of 'ieee' in an int whose bytes are
+**   in GRIB (big-endian) order, so that it can be copied directly into a GRIB1
+**   buffer
+*/
 int ieee2ibm(double ieee)
 {
   int ibm_real=0;
   unsigned char *ir=(unsigned char *)&ibm_real;
-  int sign=0,fr=0;
-  int exp=64;
-  const double full=0xffffff;
-  size_t size=sizeof(int)*8,off=0;
+  unsigned int bits=ieee2ibm_bits(ieee);
+  ir[0]=bits >> 24;
+  ir[1]=bits >> 16;
+  ir[2]=bits >> 8;
+  ir[3]=bits;
+  return ibm_real;
+}
+
+/* ibm_bits2ieee returns the value of the 32 bits of an IBM single-precision
+**   float
+*/
+double ibm_bits2ieee(unsigned int ibm)
+{
+  double value=ldexp((double)(ibm & 0xffffff),4*(int)((ibm >> 24) & 0x7f)-280);
+  return ((ibm & 0x80000000) != 0) ? -value : value;
+}
 
-  if (ieee != 0.) {
-    if (ieee < 0.) {
-      sign=1;
-      ieee=-ieee;
+/* ibm_next_lower returns the IBM float that is next lower in value than 'ibm' */
+unsigned int ibm_next_lower(unsigned int ibm)
+{
+  unsigned int sign=ibm & 0x80000000;
+  int exp=(ibm >> 24) & 0x7f;
+  unsigned int fr=ibm & 0xffffff;
+  if (fr == 0) {
+    return 0x80000001;
+  }
+  if (sign == 0) {
+    --fr;
+    if (fr < 0x100000 && exp > 0) {
+	fr=(fr << 4) | 0xf;
+	--exp;
     }
-    ieee/=pow(2.,-24.);
-    while (exp > 0 && ieee < full) {
-      ieee*=16.;
-      exp--;
+  }
+  else {
+    ++fr;
+    if (fr > 0xffffff) {
+	fr=0x100000;
+	++exp;
+    }
+  }
+  return sign | ((unsigned int)exp << 24) | fr;
+}
+
+/* GridPacking holds a grid that has been scaled for packing into a GRIB1 BDS;
+**   it is reused from grid to grid to avoid memory allocations
+**   pvals:        the scaled values of the gridpoints that are not missing
+**   capacity:     the capacity of 'pvals'
+**   num_to_pack:  the number of values in 'pvals'
+**   ref_bits:     the reference value, as the 32 bits of an IBM float
+**   E:            the binary scale factor
+**   pack_width:   the number of bits needed for each scaled value
+**   packed:       if not NULL, the values are already packed 'pack_width' bits
+**                   wide at the beginning of 'packed', and are copied instead
+**                   of 'pvals'
+*/
+typedef struct {
+  int *pvals;
+  size_t capacity,num_to_pack;
+  unsigned char *packed;
+  unsigned int ref_bits;
+  int E,pack_width;
+} GridPacking;
+
+void initialize_grid_packing(GridPacking *gp)
+{
+  gp->pvals=NULL;
+  gp->capacity=gp->num_to_pack=0;
+  gp->packed=NULL;
+  gp->ref_bits=0;
+  gp->E=gp->pack_width=0;
+}
+
+/* scale_grid scales the gridpoints that are not missing for packing into a
+**   GRIB1 BDS
+**   the reference value is set to the minimum of the grid, rounded down to a
+**   value that an IBM float can hold, so that no scaled value is negative; the
+**   binary scale factor of the GRIB2 grid is kept unless the scaled values
+**   would not fit in 31 bits
+**   the loops have no dependencies between iterations so that the compiler can
+**   vectorize them
+*/
+void scale_grid(GRIB2Grid *grid,size_t num_points,GridPacking *gp)
+{
+  double *gridpoints=grid->gridpoints;
+  if (num_points > gp->capacity) {
+    if (gp->pvals != NULL) {
+	free(gp->pvals);
     }
-    while (ieee > full) {
-      ieee/=16.;
-      exp++;
+    gp->capacity=num_points;
+    gp->pvals=(int *)malloc(gp->capacity*sizeof(int));
+  }
+// count the values to pack and find their range in a single pass; missing
+// gridpoints are never less than the minimum
+  size_t num_to_pack=0;
+  double min=GRIB_MISSING_VALUE,max=-GRIB_MISSING_VALUE;
+  for (size_t n=0; n < num_points; ++n) {
+    double v=gridpoints[n];
+    int not_missing=(v != GRIB_MISSING_VALUE);
+    num_to_pack+=not_missing;
+    min=(v < min) ? v : min;
+    max=(not_missing && v > max) ? v : max;
+  }
+  gp->num_to_pack=num_to_pack;
+  gp->packed=NULL;
+  gp->E=grid->md.E;
+  if (num_to_pack == 0) {
+    gp->ref_bits=0;
+    gp->pack_width=0;
+    return;
+  }
+// the reference value, in the decimal-scaled units of the BDS
+  double d=pow(10.,grid->md.D);
+  double smin=min*d;
+  gp->ref_bits=ieee2ibm_bits(smin);
+  while (ibm_bits2ieee(gp->ref_bits) > smin) {
+    gp->ref_bits=ibm_next_lower(gp->ref_bits);
+  }
+  double R=ibm_bits2ieee(gp->ref_bits);
+  double e=ldexp(1.,-gp->E);
+  double range=(max*d-R)*e;
+  while (range >= 2147483647.) {
+    ++gp->E;
+    e*=0.5;
+    range*=0.5;
+  }
+  gp->pack_width=bit_width((unsigned long long)(range+0.5));
+// scale the values; every scaled value is non-negative, so adding 0.5 and
+// truncating rounds to the nearest integer
+  int *pvals=gp->pvals;
+  if (num_to_pack == num_points) {
+    for (size_t n=0; n < num_points; ++n) {
+	pvals[n]=(gridpoints[n]*d-R)*e+0.5;
     }
-    fr=ieee+0.5;
-    if (size > 32) {
-      off=size-32;
-      set_bits(ir,0,0,off);
+  }
+  else {
+    size_t cnt=0;
+    for (size_t n=0; n < num_points; ++n) {
+	if (gridpoints[n] != GRIB_MISSING_VALUE) {
+	  pvals[cnt++]=(gridpoints[n]*d-R)*e+0.5;
+	}
     }
-    set_bits(ir,sign,off,1);
-    set_bits(ir,exp,off+1,7);
-    set_bits(ir,fr,off+8,24);
   }
-  return ibm_real;
 }
 
-void pack_BDS(GRIB2Message *msg,int grid_number,unsigned char *grib1_buffer,size_t *offset,int *pvals,size_t num_to_pack,size_t pack_width)
+/* can_copy_packed_data returns 1 if the packed values of a grid with simple
+**   packing (DRS Template 5.0) that was left packed can be copied directly
+**   into a GRIB1 BDS, which uses the same stream of fixed-width values, and
+**   sets up 'gp' to copy them; otherwise it returns 0 and the grid has to be
+**   unpacked and packed again
+*/
+int can_copy_packed_data(GRIB2Message *msg,int grid_number,size_t num_points,GridPacking *gp)
+{
+  GRIB2Metadata *md=&msg->grids[grid_number].md;
+  if (msg->unpack_simple == 1 || md->drs_templ_num != 0) {
+    return 0;
+  }
+// GRIB1 decoders unpack the values into 32-bit integers
+  if (md->pack_width > 31) {
+    return 0;
+  }
+// the number of values is the number of gridpoints that are on in the bitmap
+  size_t num_to_pack=num_points;
+  if (md->bitmap != NULL) {
+    num_to_pack=0;
+    for (size_t n=0; n < num_points; ++n) {
+	num_to_pack+=md->bitmap[n];
+    }
+  }
+// the reference value, as it was packed in the GRIB2 DRS
+  union {
+    float f;
+    int i;
+  } u;
+  get_bits(msg->buffer,&u.i,md->drs_off+88,32);
+  gp->ref_bits=ieee2ibm_bits(u.f);
+  gp->E=md->E;
+  gp->pack_width=md->pack_width;
+  gp->num_to_pack=num_to_pack;
+// the packed values start 5 octets into the GRIB2 Data Section
+  gp->packed=&msg->buffer[md->ds_off/8+5];
+  return 1;
+}
+
+void pack_BDS(GridPacking *gp,unsigned char *grib1_buffer,size_t *offset)
 {
-  int length=11+(num_to_pack*pack_width+7)/8;
-  size_t m,off;
-  int E,ibm_rep;
+  int length=11+(gp->num_to_pack*gp->pack_width+7)/8;
 
 // length of the BDS
   set_bits(grib1_buffer,length,*offset,24);
 // flag
   set_bits(grib1_buffer,0,*offset+24,4);
 // unused bits
-  set_bits(grib1_buffer,(length-11)*8-(num_to_pack*pack_width),*offset+28,4);
+  set_bits(grib1_buffer,(length-11)*8-(gp->num_to_pack*gp->pack_width),*offset+28,4);
 // scale factor E
-  E=msg->grids[grid_number].md.E;
+  int E=gp->E;
   if (E < 0) {
     E=-E+0x8000;
   }
   set_bits(grib1_buffer,E,*offset+32,16);
 // Reference value
-  ibm_rep=ieee2ibm(msg->grids[grid_number].md.R*pow(10.,msg->grids[grid_number].md.D));
-  memcpy(&grib1_buffer[(*offset+48)/8],&ibm_rep,4);
+  set_bits(grib1_buffer,gp->ref_bits,*offset+48,32);
 // width in bits of each packed value
-  set_bits(grib1_buffer,pack_width,*offset+80,8);
+  set_bits(grib1_buffer,gp->pack_width,*offset+80,8);
 // packed data values
-  off=*offset+88;
-  for (m=0; m < num_to_pack; m++) {
-    set_bits(grib1_buffer,pvals[m],off,pack_width);
-    off+=pack_width;
+  if (gp->packed != NULL) {
+    copy_bits(&grib1_buffer[*offset/8+11],gp->packed,gp->num_to_pack*gp->pack_width);
+  }
+  else {
+    pack_bits(grib1_buffer,gp->pvals,*offset+88,gp->pack_width,gp->num_to_pack);
+  }
+}
+
+/* Conversion holds everything needed to convert one GRIB2 message into GRIB1
+**   grids (see grib_convert.c)
+**   msg:      the GRIB2 message
+**   gp:       work space for scaling the grids
+*/
+struct Conversion {
+  GRIB2Message msg;
+  GridPacking gp;
+};
+
+/* create_conversion returns a new Conversion; there are no options */
+Conversion *create_conversion(const void *options,int num_threads)
+{
+  Conversion *conv=(Conversion *)malloc(sizeof(Conversion));
+  if (conv == NULL) {
+    return NULL;
+  }
+  initialize(&conv->msg);
+  conv->msg.num_threads=num_threads;
+// grids with simple packing are left packed so that their packed values can be
+// copied into the GRIB1 BDS
+  conv->msg.unpack_simple=0;
+  initialize_grid_packing(&conv->gp);
+  return conv;
+}
+
+void free_conversion(Conversion *conv)
+{
+  free_grib2_message(&conv->msg);
+  free(conv->gp.pvals);
+  free(conv);
+}
+
+/* convert_message unpacks a GRIB2 message that has been read by unpack_IS,
+**   adds each of its grids, as a complete GRIB1 grid, to 'ow', and returns the
+**   number of grids added
+*/
+size_t convert_message(Conversion *conv,OutputWriter *ow)
+{
+  GRIB2Message *msg=&conv->msg;
+  GridPacking *gp=&conv->gp;
+  size_t ngrid=0;
+  if (unpack_sections(msg) != 0) {
+    fprintf(stderr,"Warning: skipping a message with center %d, discipline %d: %s\n",msg->center_id,msg->disc,msg->error);
+    return 0;
+  }
+  for (size_t n=0; n < msg->num_grids; ++n) {
+// calculate the octet length of the GRIB1 grid (minus the Indicator and End
+// Sections, which are both fixed in length
+    int length;
+    switch (msg->md.pds_templ_num) {
+      case 0:
+      case 8:
+      {
+	length=28;
+	break;
+      }
+      case 1:
+      case 11:
+      {
+	length=43;
+	break;
+      }
+      case 2:
+      case 12:
+      {
+	length=42;
+	break;
+      }
+      case 15:
+      {
+	length=43;
+	break;
+      }
+      default:
+      {
+	fprintf(stderr,"Unable to map Product Definition Template %d into GRIB1\n",msg->md.pds_templ_num);
+	exit(1);
+      }
+    }
+    size_t num_points;
+    switch (msg->md.gds_templ_num) {
+      case 0:
+      {
+	length+=32;
+	num_points=msg->md.nx*msg->md.ny;
+	break;
+      }
+      case 30:
+      {
+	length+=42;
+	num_points=msg->md.nx*msg->md.ny;
+	break;
+      }
+      default:
+      {
+	fprintf(stderr,"Unable to map Grid Definition Template %d into GRIB1\n",msg->md.gds_templ_num);
+	exit(1);
+      }
+    }
+// grids with simple packing are copied when they can be, otherwise they are
+// unpacked and scaled again
+    int copy_data=can_copy_packed_data(msg,n,num_points,gp);
+    if (!copy_data) {
+      if (msg->unpack_simple == 0 && msg->grids[n].md.drs_templ_num == 0 && unpack_simple_packing(msg,n) != 0) {
+	fprintf(stderr,"Warning: skipping grid %zu of a message with center %d, discipline %d: %s\n",n+1,msg->center_id,msg->disc,msg->error);
+	continue;
+      }
+      scale_grid(&msg->grids[n],num_points,gp);
+    }
+    size_t num_to_pack=gp->num_to_pack;
+    if (num_to_pack != num_points) {
+      length+=6+(num_points+7)/8;
+    }
+    length+=11+(num_to_pack*gp->pack_width+7)/8;
+// build the GRIB1 grid directly in the output buffer; the buffer holds the
+// grids that were built before, so reserved octets are cleared first
+    unsigned char *grib1_msg=reserve_output(ow,length+12);
+    memset(grib1_msg,0,length+12);
+// pack the Indicator Section
+    memcpy(grib1_msg,"GRIB",4);
+    set_bits(grib1_msg,length+12,32,24);
+    grib1_msg[7]=1;
+// the remaining sections follow the Indicator Section
+    unsigned char *grib1_buffer=&grib1_msg[8];
+    size_t offset=0;
+// pack the Product Definition Section; a grid that can't be represented in
+// GRIB1 is left uncommitted in the output buffer
+    if (pack_PDS(msg,n,num_to_pack,num_points,grib1_buffer,&offset) != 0) {
+      fprintf(stderr,"Warning: skipping grid %zu of a message with center %d, discipline %d\n",n+1,msg->center_id,msg->disc);
+      continue;
+    }
+// pack the Grid Definition Section
+    pack_GDS(msg,n,grib1_buffer,&offset);
+// pack the Bitmap Section, if it exists
+    if (num_to_pack != num_points) {
+      if (copy_data) {
+	copy_BMS(msg,n,grib1_buffer,&offset,num_points);
+      }
+      else {
+	pack_BMS(msg,n,grib1_buffer,&offset,num_points);
+      }
+    }
+// pack the Binary Data Section
+    pack_BDS(gp,grib1_buffer,&offset);
+// pack the End Section and add the grid to the output
+    memcpy(&grib1_buffer[length],"7777",4);
+    commit_output(ow,length+12);
+    ++ngrid;
+  }
+  return ngrid;
+}
+
+/* read_message reads the next message into 'conv' with unpack_IS, skipping
+**   any message whose Indicator Section is damaged, and returns the status of
+**   unpack_IS: 0, GRIB_EOF or GRIB_READ_ERROR
+*/
+int read_message(FILE *fp,Conversion *conv)
+{
+  int status;
+  while ( (status=unpack_IS(fp,&conv->msg)) != 0 && status != GRIB_EOF && status != GRIB_READ_ERROR) {
+    fprintf(stderr,"Warning: skipping a message: %s\n",conv->msg.error);
   }
+  return status;
+}
+
+void usage(char *program)
+{
+#ifdef PTHREADS
+  fprintf(stderr,"usage: %s [-t threads] [-b megabytes] [-d] GRIB2_file_name GRIB1_file_name\n",program);
+  fprintf(stderr,"       %s [-t threads] [-b megabytes] [-d] -m manifest|directory [-o template]\n",program);
+  fprintf(stderr,"  threads is the number of threads that convert messages, or files in batch\n");
+  fprintf(stderr,"    mode (default 1)\n");
+#else
+  fprintf(stderr,"usage: %s [-b megabytes] [-d] GRIB2_file_name GRIB1_file_name\n",program);
+  fprintf(stderr,"       %s [-b megabytes] [-d] -m manifest|directory [-o template]\n",program);
+#endif
+  fprintf(stderr,"  megabytes is the size of the output buffer (default 4)\n");
+  fprintf(stderr,"  -d writes the output with direct I/O (O_DIRECT), bypassing the page cache\n");
+  fprintf(stderr,"  -m converts every file named in a manifest (one input file per line,\n");
+  fprintf(stderr,"     optionally followed by its output file), or every file in a directory\n");
+  fprintf(stderr,"  template names the output files in batch mode (default \"%%b.grb\"); %%f is\n");
+  fprintf(stderr,"     the input file name without its directory and %%b is the same without\n");
+  fprintf(stderr,"     its extension\n");
+  exit(1);
 }
 
 int main(int argc,char **argv)
 {
-  if (argc != 3) {
-    fprintf(stderr,"usage: %s GRIB2_file_name GRIB1_file_name\n",argv[0]);
-    exit(1);
+  int nthreads=1;
+  int output_buffer_size=4;
+  int direct=0;
+  char *batch_list=NULL;
+  char *default_template="%b.grb";
+  char *output_template=default_template;
+  int next=1;
+  while (next < argc && argv[next][0] == '-') {
+#ifdef PTHREADS
+    if (strcmp(argv[next],"-t") == 0 && next+1 < argc) {
+	++next;
+	nthreads=atoi(argv[next]);
+	if (nthreads < 1) {
+	  usage(argv[0]);
+	}
+    }
+    else
+#endif
+    if (strcmp(argv[next],"-b") == 0 && next+1 < argc) {
+	++next;
+	output_buffer_size=atoi(argv[next]);
+	if (output_buffer_size < 1) {
+	  usage(argv[0]);
+	}
+    }
+    else if (strcmp(argv[next],"-d") == 0) {
+	direct=1;
+    }
+    else if (strcmp(argv[next],"-m") == 0 && next+1 < argc) {
+	batch_list=argv[++next];
+    }
+    else if (strcmp(argv[next],"-o") == 0 && next+1 < argc) {
+	output_template=argv[++next];
+    }
+    else {
+	usage(argv[0]);
+    }
+    ++next;
+  }
+  build_map_hashes();
+  if (batch_list != NULL) {
+    if (argc-next != 0) {
+	usage(argv[0]);
+    }
+    Batch batch;
+    initialize_batch(&batch,NULL,"GRIB2 messages","GRIB1 grids",(size_t)output_buffer_size*1024*1024,direct);
+    read_batch(&batch,batch_list,output_template);
+    size_t nfail=run_batch(&batch,nthreads);
+    free_batch(&batch);
+    return (nfail == 0) ? 0 : 1;
+  }
+  if (argc-next != 2 || output_template != default_template) {
+    usage(argv[0]);
   }
   FILE *fp;
-  if ( (fp=fopen(argv[1],"rb")) == NULL) {
-    fprintf(stderr,"Error opening input file %s\n",argv[1]);
+  if ( (fp=fopen(argv[next],"rb")) == NULL) {
+    fprintf(stderr,"Error opening input file %s\n",argv[next]);
     exit(1);
   }
-  FILE *ofp;
-  if ( (ofp=fopen(argv[2],"wb")) == NULL) {
-    fprintf(stderr,"Error opening output file %s\n",argv[2]);
+  OutputWriter ow;
+  initialize_output(&ow,(size_t)output_buffer_size*1024*1024);
+  if (open_output(&ow,argv[next+1],direct) != 0) {
+    fprintf(stderr,"Error opening output file %s\n",argv[next+1]);
     exit(1);
   }
-  GRIB2Message grib2_msg;
-  initialize(&grib2_msg);
   int status;
   size_t nmsg=0;
   size_t ngrid=0;
-  int max_length=0;
-  unsigned char *grib1_buffer=NULL;
-  char *head="GRIB",*tail="7777";
-  while ( (status=unpackgrib2(fp,&grib2_msg)) == 0) {
-    ++nmsg;
-    for (size_t n=0; n < grib2_msg.num_grids; ++n) {
-// calculate the octet length of the GRIB1 grid (minus the Indicator and End
-// Sections, which are both fixed in length
-	int length;
-	switch (grib2_msg.md.pds_templ_num) {
-	  case 0:
-	  case 8:
-	  {
-	    length=28;
-	    break;
-	  }
-	  case 1:
-	  case 11:
-	  {
-	    length=43;
-	    break;
-	  }
-	  case 2:
-	  case 12:
-	  {
-	    length=42;
-	    break;
-	  }
-	  case 15:
-	  {
-	    length=43;
-	    break;
-	  }
-	  default:
-	  {
-	    fprintf(stderr,"Unable to map Product Definition Template %d into GRIB1\n",grib2_msg.md.pds_templ_num);
-	    exit(1);
-	  }
-	}
-	size_t num_points;
-	switch (grib2_msg.md.gds_templ_num) {
-	  case 0:
-	  {
-	    length+=32;
-	    num_points=grib2_msg.md.nx*grib2_msg.md.ny;
-	    break;
-	  }
-	  case 30:
-	  {
-	    length+=42;
-	    num_points=grib2_msg.md.nx*grib2_msg.md.ny;
-	    break;
-	  }
-	  default:
-	  {
-	    fprintf(stderr,"Unable to map Grid Definition Template %d into GRIB1\n",grib2_msg.md.gds_templ_num);
-	    exit(1);
-	  }
-	}
-	size_t num_to_pack=0;
-	for (size_t m=0; m < num_points; ++m) {
-	  if (grib2_msg.grids[n].gridpoints[m] != GRIB_MISSING_VALUE) {
-	    ++num_to_pack;
-	  }
-	}
-	if (num_to_pack != num_points) {
-	  length+=6+(num_points+7)/8;
-	}
-	int *pvals=(int *)malloc(sizeof(int)*num_to_pack);
-	size_t max_pack=0;
-	size_t cnt=0;
-	for (size_t m=0; m < num_points; ++m) {
-	  if (grib2_msg.grids[n].gridpoints[m] != GRIB_MISSING_VALUE) {
-	    if (cnt == num_to_pack) {
-		fprintf(stderr,"Error: conflicting number of missing gridpoints\n");
-		exit(1);
-	    }
-	    pvals[cnt]=lround((grib2_msg.grids[n].gridpoints[m]-grib2_msg.grids[n].md.R)*pow(10.,grib2_msg.grids[n].md.D)/pow(2.,grib2_msg.grids[n].md.E));
-	    if (pvals[cnt] > max_pack) {
-		max_pack=pvals[cnt];
-	    }
-	    ++cnt;
-	  }
-	}
-	size_t pack_width=1;
-	while (pow(2.,pack_width)-1 < max_pack) {
-	  ++pack_width;
-	}
-	length+=11+(num_to_pack*pack_width+7)/8;
-// allocate enough memory for the GRIB1 buffer
-	if (length > max_length) {
-	  if (grib1_buffer != NULL) {
-	    free(grib1_buffer);
-	  }
-	  grib1_buffer=(unsigned char *)malloc(length*sizeof(unsigned char));
-	  max_length=length;
-	}
-	size_t offset=0;
-// pack the Product Definition Section
-	pack_PDS(&grib2_msg,n,num_to_pack,num_points,grib1_buffer,&offset);
-// pack the Grid Definition Section
-	pack_GDS(&grib2_msg,n,grib1_buffer,&offset);
-// pack the Bitmap Section, if it exists
-	if (num_to_pack != num_points) {
-	  pack_BMS(&grib2_msg,n,grib1_buffer,&offset,num_points);
-	}
-// pack the Binary Data Section
-	pack_BDS(&grib2_msg,n,grib1_buffer,&offset,pvals,num_to_pack,pack_width);
-	free(pvals);
-// output the GRIB1 grid
-	fwrite(head,1,4,ofp);
-	unsigned char dum[3];
-	set_bits(dum,length+12,0,24);
-	fwrite(dum,1,3,ofp);
-	dum[0]=1;
-	fwrite(dum,1,1,ofp);
-	fwrite(grib1_buffer,1,length,ofp);
-	fwrite(tail,1,4,ofp);
-	++ngrid;
+#ifdef PTHREADS
+  if (nthreads > 1) {
+    status=run_pipeline(fp,&ow,nthreads,NULL,&nmsg,&ngrid);
+  }
+  else
+#endif
+  {
+    Conversion *conv;
+    if ( (conv=create_conversion(NULL,1)) == NULL) {
+	fprintf(stderr,"Error allocating the conversion\n");
+	exit(1);
     }
+    status=convert_file(conv,fp,&ow,&nmsg,&ngrid);
+    free_conversion(conv);
   }
   if (status != -1) {
     printf("Read error after %d messages\n",nmsg);
   }
   printf("Number of GRIB1 grids written to output: %d\n",ngrid);
   fclose(fp);
-  fclose(ofp);
+  close_output(&ow);
+  free(ow.buf);
 }
@@ -0,0 +1,294 @@
+/*
+** File: grib2to1_maps.c
+**
+** Generated by build_grib2to1_maps from tables/parameters/GRIB2/GRIB2_to_GRIB1.txt,
+**   tables/GRIB2_to_GRIB1_levels.txt and tables/GRIB2_to_GRIB1_time_ranges.txt;
+**   do not edit - change the maps and run build_grib2to1_maps again
+*/
+#ifndef GRIB2TO1_MAPS_C
+#define GRIB2TO1_MAPS_C
+
+const ParameterMapEntry PARAMETER_MAP[]={
+// discipline category number center, table_version parameter_code
+  {  0,  0,  0, -1,   3, 11},
+  {  0,  0,  1, -1,   3, 12},
+  {  0,  0,  2, -1,   3, 13},
+  {  0,  0,  3, -1,   3, 14},
+  {  0,  0,  4, -1,   3, 15},
+  {  0,  0,  5, -1,   3, 16},
+  {  0,  0,  6, -1,   3, 17},
+  {  0,  0,  7, -1,   3, 18},
+  {  0,  0,  8, -1,   3, 19},
+  {  0,  0,  9, -1,   3, 25},
+  {  0,  0, 10, -1,   3,121},
+  {  0,  0, 11, -1,   3,122},
+  {  0,  0, 21,  7, 131,193},
+  {  0,  0,192,  7,   3,229},
+  {  0,  1,  0, -1,   3, 51},
+  {  0,  1,  1, -1,   3, 52},
+  {  0,  1,  2, -1,   3, 53},
+  {  0,  1,  3, -1,   3, 54},
+  {  0,  1,  4, -1,   3, 55},
+  {  0,  1,  5, -1,   3, 56},
+  {  0,  1,  6, -1,   3, 57},
+  {  0,  1,  7, -1,   3, 59},
+  {  0,  1,  8, -1,   3, 61},
+  {  0,  1,  9, -1,   3, 62},
+  {  0,  1, 10, -1,   3, 63},
+  {  0,  1, 11, -1,   3, 66},
+  {  0,  1, 12, -1,   3, 64},
+  {  0,  1, 13, -1,   3, 65},
+  {  0,  1, 14, -1,   3, 78},
+  {  0,  1, 15, -1,   3, 79},
+  {  0,  1, 16, -1,   3, 99},
+  {  0,  1, 22,  7,   3,153},
+  {  0,  1, 39,  7,   3,194},
+  {  0,  1,192,  7,   3,140},
+  {  0,  1,193,  7,   3,141},
+  {  0,  1,194,  7,   3,142},
+  {  0,  1,195,  7,   3,143},
+  {  0,  1,196,  7,   3,214},
+  {  0,  1,197,  7,   3,135},
+  {  0,  1,199,  7,   3,228},
+  {  0,  1,200,  7,   3,145},
+  {  0,  1,201,  7,   3,238},
+  {  0,  1,206,  7,   3,186},
+  {  0,  1,207,  7,   3,198},
+  {  0,  1,208,  7,   3,239},
+  {  0,  1,213,  7,   3,243},
+  {  0,  1,214,  7,   3,245},
+  {  0,  1,215,  7,   3,249},
+  {  0,  1,216,  7,   3,159},
+  {  0,  2,  0, -1,   3, 31},
+  {  0,  2,  1, -1,   3, 32},
+  {  0,  2,  2, -1,   3, 33},
+  {  0,  2,  3, -1,   3, 34},
+  {  0,  2,  4, -1,   3, 35},
+  {  0,  2,  5, -1,   3, 36},
+  {  0,  2,  6, -1,   3, 37},
+  {  0,  2,  7, -1,   3, 38},
+  {  0,  2,  8, -1,   3, 39},
+  {  0,  2,  9, -1,   3, 40},
+  {  0,  2, 10, -1,   3, 41},
+  {  0,  2, 11, -1,   3, 42},
+  {  0,  2, 12, -1,   3, 43},
+  {  0,  2, 13, -1,   3, 44},
+  {  0,  2, 14, -1,   3,  4},
+  {  0,  2, 15, -1,   3, 45},
+  {  0,  2, 16, -1,   3, 46},
+  {  0,  2, 17, -1,   3,124},
+  {  0,  2, 18, -1,   3,125},
+  {  0,  2, 19, -1,   3,126},
+  {  0,  2, 20, -1,   3,123},
+  {  0,  2, 22,  7,   3,180},
+  {  0,  2,192,  7,   3,136},
+  {  0,  2,193,  7,   3,172},
+  {  0,  2,194,  7,   3,196},
+  {  0,  2,195,  7,   3,197},
+  {  0,  2,196,  7,   3,252},
+  {  0,  2,197,  7,   3,253},
+  {  0,  2,224,  7, 129,241},
+  {  0,  3,  0, -1,   3,  1},
+  {  0,  3,  1, -1,   3,  2},
+  {  0,  3,  2, -1,   3,  3},
+  {  0,  3,  3, -1,   3,  5},
+  {  0,  3,  4, -1,   3,  6},
+  {  0,  3,  5, -1,   3,  7},
+  {  0,  3,  6, -1,   3,  8},
+  {  0,  3,  7, -1,   3,  9},
+  {  0,  3,  8, -1,   3, 26},
+  {  0,  3,  9, -1,   3, 27},
+  {  0,  3, 10, -1,   3, 89},
+  {  0,  3,192,  7,   3,130},
+  {  0,  3,193,  7,   3,222},
+  {  0,  3,194,  7,   3,147},
+  {  0,  3,195,  7,   3,148},
+  {  0,  3,196,  7,   3,221},
+  {  0,  3,197,  7,   3,230},
+  {  0,  3,198,  7,   3,129},
+  {  0,  3,199,  7,   3,137},
+  {  0,  3,200,  7, 129,141},
+  {  0,  4,  0, -1,   3,111},
+  {  0,  4,  1, -1,   3,113},
+  {  0,  4,  2, -1,   3,116},
+  {  0,  4,  3, -1,   3,117},
+  {  0,  4,  4, -1,   3,118},
+  {  0,  4,  5, -1,   3,119},
+  {  0,  4,  6, -1,   3,120},
+  {  0,  4,192,  7,   3,204},
+  {  0,  4,193,  7,   3,211},
+  {  0,  4,196,  7,   3,161},
+  {  0,  5,  0, -1,   3,112},
+  {  0,  5,  1, -1,   3,114},
+  {  0,  5,  2, -1,   3,115},
+  {  0,  5,192,  7,   3,205},
+  {  0,  5,193,  7,   3,212},
+  {  0,  6,  0, -1,   3, 58},
+  {  0,  6,  1, -1,   3, 71},
+  {  0,  6,  2, -1,   3, 72},
+  {  0,  6,  3, -1,   3, 73},
+  {  0,  6,  4, -1,   3, 74},
+  {  0,  6,  5, -1,   3, 75},
+  {  0,  6,  6, -1,   3, 76},
+  {  0,  6, 25,  7,   3,213},
+  {  0,  6, 25, 74, 140,174},
+  {  0,  6,192,  7,   3,213},
+  {  0,  6,193,  7,   3,146},
+  {  0,  6,201,  7, 133,191},
+  {  0,  7,  0, -1,   3, 24},
+  {  0,  7,  1, -1,   3, 77},
+  {  0,  7,  6,  7,   3,157},
+  {  0,  7,  7,  7,   3,156},
+  {  0,  7,  8,  7,   3,190},
+  {  0,  7,192,  7,   3,131},
+  {  0,  7,193,  7,   3,132},
+  {  0,  7,194,  7,   3,254},
+  {  0, 14,  0, -1,   3, 10},
+  {  0, 14,192,  7,   3,154},
+  {  0, 15,  6, -1,   3, 21},
+  {  0, 15,  7, -1,   3, 22},
+  {  0, 15,  8, -1,   3, 23},
+  {  0, 16,195,  7, 129,211},
+  {  0, 16,196,  7, 129,212},
+  {  0, 19,  0, -1,   3, 20},
+  {  0, 19,  1, -1,   3, 84},
+  {  0, 19,  2, -1,   3, 60},
+  {  0, 19,  3, -1,   3, 67},
+  {  0, 19, 20,  7,   3,209},
+  {  0, 19, 20, 74,   3,168},
+  {  0, 19, 21,  7,   3,209},
+  {  0, 19, 21, 74,   3,170},
+  {  0, 19, 22,  7,   3,209},
+  {  0, 19, 22, 74,   3,172},
+  {  0, 19,204,  7,   3,209},
+  {  1,  0,192,  7,   3,234},
+  {  1,  0,193,  7,   3,235},
+  {  1,  1,192,  7,   3,195},
+  {  1,  1,193,  7,   3,194},
+  {  2,  0,  0, -1,   3, 81},
+  {  2,  0,  1, -1,   3, 83},
+  {  2,  0,  2, -1,   3, 85},
+  {  2,  0,  3, -1,   3, 86},
+  {  2,  0,  4, -1,   3, 87},
+  {  2,  0,  5, -1,   3, 90},
+  {  2,  0,192,  7,   3,144},
+  {  2,  0,193,  7,   3,155},
+  {  2,  0,194,  7,   3,207},
+  {  2,  0,195,  7,   3,208},
+  {  2,  0,196,  7,   3,223},
+  {  2,  0,197,  7,   3,226},
+  {  2,  0,198,  7,   3,225},
+  {  2,  0,201,  7, 130,219},
+  {  2,  0,207,  7,   3,201},
+  {  2,  0,218,  7, 131,189},
+  {  2,  3,203,  7, 130,220},
+  {  2,  4,  2,  7, 129,250},
+  { 10,  0,  0, -1,   3, 28},
+  { 10,  0,  1, -1,   3, 29},
+  { 10,  0,  2, -1,   3, 30},
+  { 10,  0,  3, -1,   3,100},
+  { 10,  0,  4, -1,   3,101},
+  { 10,  0,  5, -1,   3,102},
+  { 10,  0,  6, -1,   3,103},
+  { 10,  0,  7, -1,   3,104},
+  { 10,  0,  8, -1,   3,105},
+  { 10,  0,  9, -1,   3,106},
+  { 10,  0, 10, -1,   3,107},
+  { 10,  0, 11, -1,   3,108},
+  { 10,  0, 12, -1,   3,109},
+  { 10,  0, 13, -1,   3,110},
+  { 10,  1,  0, -1,   3, 47},
+  { 10,  1,  1, -1,   3, 48},
+  { 10,  1,  2, -1,   3, 49},
+  { 10,  1,  3, -1,   3, 50},
+  { 10,  2,  0, -1,   3, 91},
+  { 10,  2,  1, -1,   3, 92},
+  { 10,  2,  2, -1,   3, 93},
+  { 10,  2,  3, -1,   3, 94},
+  { 10,  2,  4, -1,   3, 95},
+  { 10,  2,  5, -1,   3, 96},
+  { 10,  2,  6, -1,   3, 97},
+  { 10,  2,  7, -1,   3, 98},
+  { 10,  3,  0, -1,   3, 80},
+  { 10,  3,  1, -1,   3, 82},
+  { 10,  4,  0, -1,   3, 69},
+  { 10,  4,  1, -1,   3, 70},
+  { 10,  4,  2, -1,   3, 68},
+  { 10,  4,  3, -1,   3, 88}
+};
+
+const LevelMapEntry LEVEL_MAP[]={
+// lvl1_type layer center, level_type offset mul1 mul2 div
+  {  1,0,-1,   1,   0.,         0.,   0.,   1.},
+  {  1,1,-1,   1,   0.,         0.,   0.,   1.},
+  {  2,0,-1,   2,   0.,         0.,   0.,   1.},
+  {  2,1,-1,   2,   0.,         0.,   0.,   1.},
+  {  3,0,-1,   3,   0.,         0.,   0.,   1.},
+  {  3,1,-1,   3,   0.,         0.,   0.,   1.},
+  {  4,0,-1,   4,   0.,         0.,   0.,   1.},
+  {  4,1,-1,   4,   0.,         0.,   0.,   1.},
+  {  5,0,-1,   5,   0.,         0.,   0.,   1.},
+  {  5,1,-1,   5,   0.,         0.,   0.,   1.},
+  {  6,0,-1,   6,   0.,         0.,   0.,   1.},
+  {  6,1,-1,   6,   0.,         0.,   0.,   1.},
+  {  7,0,-1,   7,   0.,         0.,   0.,   1.},
+  {  7,1,-1,   7,   0.,         0.,   0.,   1.},
+  {  8,0,-1,   8,   0.,         0.,   0.,   1.},
+  {  8,1,-1,   8,   0.,         0.,   0.,   1.},
+  {  9,0,-1,   9,   0.,         0.,   0.,   1.},
+  {  9,1,-1,   9,   0.,         0.,   0.,   1.},
+  { 20,0,-1,  20,   0.,         0.,   0.,   1.},
+  { 20,1,-1,  20,   0.,         0.,   0.,   1.},
+  {100,0,-1, 100,   0.,         1.,   0., 100.},
+  {100,1,-1, 101,   0.,         1.,   1.,1000.},
+  {101,0,-1, 102,   0.,         0.,   0.,   1.},
+  {101,1,-1, 102,   0.,         0.,   0.,   1.},
+  {102,0,-1, 103,   0.,         1.,   0.,   1.},
+  {102,1,-1, 104,   0.,         1.,   1., 100.},
+  {103,0,-1, 105,   0.,         1.,   0.,   1.},
+  {103,1,-1, 106,   0.,         1.,   1., 100.},
+  {104,0,-1, 107,   0.,     10000.,   0.,   1.},
+  {104,1,-1, 108,   0.,       100., 100.,   1.},
+  {105,0,-1, 109,   0.,         1.,   0.,   1.},
+  {105,1,-1, 110,   0.,         1.,   1.,   1.},
+  {106,0,-1, 111,   0.,       100.,   0.,   1.},
+  {106,1,-1, 112,   0.,       100., 100.,   1.},
+  {107,0,-1, 113,   0.,         1.,   0.,   1.},
+  {107,1,-1, 114, 475.,        -1.,  -1.,   1.},
+  {108,0,-1, 115,   0.,         1.,   0., 100.},
+  {108,1,-1, 116,   0.,         1.,   1., 100.},
+  {109,0,-1, 117,   0.,1000000000.,   0.,   1.},
+  {109,1,-1, 117,   0.,1000000000.,   0.,   1.},
+  {111,0,-1, 119,   0.,     10000.,   0.,   1.},
+  {111,1,-1, 120,   0.,       100., 100.,   1.},
+  {160,0,-1, 160,   0.,         1.,   0.,   1.},
+  {160,1,-1, 160,   0.,         1.,   0.,   1.},
+  {200,0, 7, 200,   0.,         0.,   0.,   1.},
+  {200,1, 7, 200,   0.,         0.,   0.,   1.}
+};
+
+const TimeRangeMapEntry TIME_RANGE_MAP[]={
+// proc_code num_ranges center, t_range
+  {  0,1,-1,   3},
+  {  1,1,-1,   4},
+  {  2,1,-1,   2},
+  {  3,1,-1,   2},
+  {  4,1,-1,   5},
+  {193,2, 7, 113},
+  {194,2, 7, 123},
+  {195,2, 7, 128},
+  {196,2, 7, 129},
+  {197,2, 7, 130},
+  {198,2, 7, 131},
+  {199,2, 7, 132},
+  {200,2, 7, 133},
+  {201,2, 7, 134},
+  {202,2, 7, 135},
+  {203,2, 7, 136},
+  {204,2, 7, 137},
+  {205,2, 7, 138},
+  {206,2, 7, 139},
+  {207,2, 7, 140}
+};
+
+#endif
@@ -0,0 +1,1086 @@
+/*
+** File: grib_convert.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to provide the code that grib1to2.c and grib2to1.c share for
+**          packing the sections of the messages that they write, for
+**          writing the messages through a large output buffer, for looking
+**          up the entries of their mapping tables with perfect hashes, for
+**          converting the messages of a file on a pipeline of threads, and for
+**          converting lists of files in batch mode
+**
+** Notes:   1) grib1to2.c and grib2to1.c include this file, so it must be in
+**             the same directory as them.
+**
+**          2) Direct I/O (O_DIRECT) is a GNU extension, so a program that
+**             wants it defines _GNU_SOURCE before including any header.
+**
+**          3) The program defines what a conversion is (see Conversion), and
+**             this file runs the conversions; compile with -DPTHREADS and link
+**             with -lpthread for the pipeline and for batch mode on several
+**             threads, which also need grib_scheduler.c (included by the
+**             decoders).
+*/
+#ifndef GRIB_CONVERT_C
+#define GRIB_CONVERT_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <time.h>
+#ifdef PTHREADS
+#include <pthread.h>
+#endif
+
+/* BitWriter packs a stream of bit fields into a GRIB buffer through a 64-bit
+**   accumulator, so that the buffer is written an octet at a time instead of
+**   with a read-modify-write for every field
+**   buf is the GRIB buffer as a stream of bytes
+**   pos is the index of the next octet of 'buf' to be written
+**   acc holds the pending bits, right-justified
+**   nbits is the number of pending bits in 'acc'
+*/
+typedef struct {
+  unsigned char *buf;
+  size_t pos;
+  unsigned long long acc;
+  int nbits;
+} BitWriter;
+
+/* bitwriter_init starts a BitWriter at bit offset 'off' of 'buf'; bits that
+**   are already in the octet containing 'off' are preserved
+*/
+void bitwriter_init(BitWriter *bw,unsigned char *buf,size_t off)
+{
+  bw->buf=buf;
+  bw->pos=off/8;
+  bw->nbits=off % 8;
+  bw->acc= (bw->nbits > 0) ? (buf[bw->pos] >> (8-bw->nbits)) : 0;
+}
+
+/* bitwriter_put appends the low 'bits' bits (at most 32) of 'src' */
+void bitwriter_put(BitWriter *bw,unsigned int src,int bits)
+{
+  bw->acc=(bw->acc << bits) | (src & ((1ULL << bits)-1));
+  bw->nbits+=bits;
+  if (bw->nbits >= 32) {
+    bw->nbits-=32;
+    unsigned int word=bw->acc >> bw->nbits;
+    unsigned char *b=&bw->buf[bw->pos];
+    b[0]=word >> 24;
+    b[1]=word >> 16;
+    b[2]=word >> 8;
+    b[3]=word;
+    bw->pos+=4;
+  }
+}
+
+/* bitwriter_flush writes any pending bits, setting the unused bits of the last
+**   octet to zero, and returns the bit offset following the last field
+*/
+size_t bitwriter_flush(BitWriter *bw)
+{
+  size_t off=bw->pos*8+bw->nbits;
+  while (bw->nbits >= 8) {
+    bw->nbits-=8;
+    bw->buf[bw->pos++]=bw->acc >> bw->nbits;
+  }
+  if (bw->nbits > 0) {
+    bw->buf[bw->pos++]=bw->acc << (8-bw->nbits);
+    bw->nbits=0;
+  }
+  bw->acc=0;
+  return off;
+}
+
+/* pack_bits packs 'num' values from 'src' into 'buf', each 'bits' wide,
+**   starting at bit offset 'off'; octet-aligned streams of 8-, 16-, 24- and
+**   32-bit values are stored directly
+*/
+void pack_bits(unsigned char *buf,int *src,size_t off,size_t bits,size_t num)
+{
+  if (bits == 0 || num == 0) {
+    return;
+  }
+  if ( (off % 8) == 0 && (bits % 8) == 0 && bits <= 32) {
+    unsigned char *b=&buf[off/8];
+    switch (bits) {
+	case 8:
+	{
+	  for (size_t n=0; n < num; ++n) {
+	    b[n]=src[n];
+	  }
+	  return;
+	}
+	case 16:
+	{
+	  for (size_t n=0; n < num; ++n) {
+	    b[0]=src[n] >> 8;
+	    b[1]=src[n];
+	    b+=2;
+	  }
+	  return;
+	}
+	case 24:
+	{
+	  for (size_t n=0; n < num; ++n) {
+	    b[0]=src[n] >> 16;
+	    b[1]=src[n] >> 8;
+	    b[2]=src[n];
+	    b+=3;
+	  }
+	  return;
+	}
+	case 32:
+	{
+	  for (size_t n=0; n < num; ++n) {
+	    b[0]=(unsigned int)src[n] >> 24;
+	    b[1]=src[n] >> 16;
+	    b[2]=src[n] >> 8;
+	    b[3]=src[n];
+	    b+=4;
+	  }
+	  return;
+	}
+    }
+  }
+  BitWriter bw;
+  bitwriter_init(&bw,buf,off);
+  for (size_t n=0; n < num; ++n) {
+    bitwriter_put(&bw,src[n],bits);
+  }
+  bitwriter_flush(&bw);
+}
+
+/* copy_bits copies 'bits' bits from the beginning of 'src' to the beginning of
+**   'dst' and sets the unused bits of the last octet to zero
+*/
+void copy_bits(unsigned char *dst,unsigned char *src,size_t bits)
+{
+  size_t len=(bits+7)/8;
+  memcpy(dst,src,len);
+  if ( (bits % 8) > 0) {
+    dst[len-1]&=0xff << (8-(bits % 8));
+  }
+}
+
+/* bit_width returns the number of bits needed to hold the value 'v' */
+int bit_width(unsigned long long v)
+{
+  if (v == 0) {
+    return 0;
+  }
+#if defined(__GNUC__)
+  return sizeof(unsigned long long)*8-__builtin_clzll(v);
+#else
+  int n=0;
+  while (v > 0) {
+    ++n;
+    v>>=1;
+  }
+  return n;
+#endif
+}
+
+/* PerfectHash is a perfect hash of the 64-bit keys of a mapping table, built
+**   with hash and displace: every key hashes to a bucket, and every bucket has a
+**   displacement, found when the hash is built, that sends each of its keys to
+**   its own slot; a lookup is then one probe and one compare
+**   keys:        the key in each slot
+**   entries:     the index in the table of the entry in each slot, or -1
+**   disp:        the displacement of each bucket
+**   num_buckets: the number of buckets
+**   num_slots:   the number of slots
+*/
+typedef struct {
+  unsigned long long *keys;
+  int *entries;
+  unsigned int *disp;
+  unsigned int num_buckets,num_slots;
+} PerfectHash;
+
+unsigned long long hash_key(unsigned long long key,unsigned int seed)
+{
+  key^=seed*0x9e3779b97f4a7c15ULL;
+  key^=key >> 30;
+  key*=0xbf58476d1ce4e5b9ULL;
+  key^=key >> 27;
+  key*=0x94d049bb133111ebULL;
+  key^=key >> 31;
+  return key;
+}
+
+/* build_perfect_hash builds the perfect hash of the 'num_keys' keys of a table,
+**   where keys[n] is the key of entry n; the programs that generate the tables
+**   reject duplicate keys, but a duplicate that gets through anyway is left out
+**   (the first entry wins) so that the keys can still be placed
+*/
+void build_perfect_hash(PerfectHash *ph,const unsigned long long *keys,size_t num_keys)
+{
+  ph->num_buckets=num_keys/4+1;
+  ph->num_slots=num_keys+num_keys/4+1;
+  ph->keys=(unsigned long long *)calloc(ph->num_slots,sizeof(unsigned long long));
+  ph->entries=(int *)malloc(ph->num_slots*sizeof(int));
+  ph->disp=(unsigned int *)calloc(ph->num_buckets,sizeof(unsigned int));
+  for (size_t n=0; n < ph->num_slots; ++n) {
+    ph->entries[n]=-1;
+  }
+// sort the keys by bucket, with a counting sort
+  size_t *first=(size_t *)calloc(ph->num_buckets+1,sizeof(size_t));
+  size_t *members=(size_t *)malloc((num_keys+1)*sizeof(size_t));
+  for (size_t n=0; n < num_keys; ++n) {
+    ++first[hash_key(keys[n],0) % ph->num_buckets+1];
+  }
+  for (size_t n=0; n < ph->num_buckets; ++n) {
+    first[n+1]+=first[n];
+  }
+  size_t *next=(size_t *)malloc(ph->num_buckets*sizeof(size_t));
+  memcpy(next,first,ph->num_buckets*sizeof(size_t));
+  size_t max_size=0;
+  for (size_t n=0; n < num_keys; ++n) {
+    size_t b=hash_key(keys[n],0) % ph->num_buckets;
+    size_t m=first[b];
+    while (m < next[b] && keys[members[m]] != keys[n]) {
+	++m;
+    }
+    if (m == next[b]) {
+	members[next[b]++]=n;
+	if (next[b]-first[b] > max_size) {
+	  max_size=next[b]-first[b];
+	}
+    }
+  }
+// place the largest buckets first, while most of the slots are still empty
+  size_t *slot=(size_t *)malloc((max_size+1)*sizeof(size_t));
+  for (size_t size=max_size; size > 0; --size) {
+    for (size_t b=0; b < ph->num_buckets; ++b) {
+	if (next[b]-first[b] != size) {
+	  continue;
+	}
+	unsigned int d=0;
+	while (1) {
+	  size_t m=0;
+	  for (; m < size; ++m) {
+	    slot[m]=hash_key(keys[members[first[b]+m]],d+1) % ph->num_slots;
+	    if (ph->entries[slot[m]] >= 0) {
+		break;
+	    }
+	    size_t k=0;
+	    while (k < m && slot[k] != slot[m]) {
+		++k;
+	    }
+	    if (k < m) {
+		break;
+	    }
+	  }
+	  if (m == size) {
+	    break;
+	  }
+	  ++d;
+	}
+	ph->disp[b]=d;
+	for (size_t m=0; m < size; ++m) {
+	  ph->entries[slot[m]]=members[first[b]+m];
+	  ph->keys[slot[m]]=keys[members[first[b]+m]];
+	}
+    }
+  }
+  free(first);
+  free(members);
+  free(next);
+  free(slot);
+}
+
+/* find_key returns the table index of 'key', or -1 if it is not in the table;
+**   the compare compiles to a conditional move, not a branch
+*/
+int find_key(const PerfectHash *ph,unsigned long long key)
+{
+  unsigned int n=hash_key(key,ph->disp[hash_key(key,0) % ph->num_buckets]+1) % ph->num_slots;
+  return (ph->keys[n] == key) ? ph->entries[n] : -1;
+}
+
+/* OutputWriter collects GRIB messages in a large buffer so that many messages
+**   are written with a single system call
+**   fd:        the output file descriptor
+**   buf:       the buffer of messages waiting to be written
+**   len:       the number of octets in 'buf'
+**   capacity:  the capacity of 'buf'
+**   direct:    1 if the file was opened for direct I/O (O_DIRECT), in which
+**                case only whole blocks are written until the file is closed
+*/
+typedef struct {
+  int fd;
+  unsigned char *buf;
+  size_t len,capacity;
+  int direct;
+} OutputWriter;
+
+/* the alignment of the buffer, and of the writes, for direct I/O */
+const size_t OUTPUT_BLOCK_SIZE=4096;
+
+/* write_output writes all of the octets described by 'iov', retrying after
+**   partial writes
+*/
+void write_output(int fd,struct iovec *iov,int iovcnt)
+{
+  while (iovcnt > 0) {
+    ssize_t n=writev(fd,iov,iovcnt);
+    if (n < 0) {
+	if (errno == EINTR) {
+	  continue;
+	}
+	fprintf(stderr,"Error writing output: %s\n",strerror(errno));
+	exit(1);
+    }
+    while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+	n-=iov->iov_len;
+	++iov;
+	--iovcnt;
+    }
+    if (iovcnt > 0) {
+	iov->iov_base=(char *)iov->iov_base+n;
+	iov->iov_len-=n;
+    }
+  }
+}
+
+void allocate_output_buffer(OutputWriter *ow,size_t capacity)
+{
+  unsigned char *buf;
+  if (posix_memalign((void **)&buf,OUTPUT_BLOCK_SIZE,capacity) != 0) {
+    fprintf(stderr,"Error allocating %zu octets for the output buffer\n",capacity);
+    exit(1);
+  }
+  if (ow->buf != NULL) {
+    memcpy(buf,ow->buf,ow->len);
+    free(ow->buf);
+  }
+  ow->buf=buf;
+  ow->capacity=capacity;
+}
+
+/* initialize_output sets up an OutputWriter with a buffer of 'capacity' octets,
+**   which is rounded up to a whole number of blocks; until a file is opened with
+**   open_output, the messages are only collected in the buffer
+*/
+void initialize_output(OutputWriter *ow,size_t capacity)
+{
+  ow->fd=-1;
+  ow->direct=0;
+  ow->buf=NULL;
+  ow->len=0;
+  capacity=(capacity+OUTPUT_BLOCK_SIZE-1)/OUTPUT_BLOCK_SIZE*OUTPUT_BLOCK_SIZE;
+  allocate_output_buffer(ow,(capacity > 0) ? capacity : OUTPUT_BLOCK_SIZE);
+}
+
+/* open_output opens 'path' for writing; if 'direct' is 1, the file is opened
+**   for direct I/O where the system supports it; the buffer is kept from one
+**   file to the next
+**   it returns 0, or 1 if the file can't be opened
+*/
+int open_output(OutputWriter *ow,const char *path,int direct)
+{
+  int flags=O_WRONLY | O_CREAT | O_TRUNC;
+  ow->direct=0;
+#ifdef O_DIRECT
+  if (direct) {
+    flags|=O_DIRECT;
+    ow->direct=1;
+  }
+#else
+  if (direct) {
+    fprintf(stderr,"Warning: direct I/O is not supported on this system\n");
+  }
+#endif
+  if ( (ow->fd=open(path,flags,0666)) < 0) {
+    return 1;
+  }
+  ow->len=0;
+  return 0;
+}
+
+/* flush_output writes the buffered messages; with direct I/O, only whole
+**   blocks are written and the rest stays in the buffer
+*/
+void flush_output(OutputWriter *ow)
+{
+  size_t len=ow->len;
+  if (ow->direct) {
+    len=len/OUTPUT_BLOCK_SIZE*OUTPUT_BLOCK_SIZE;
+  }
+// an OutputWriter without a file only collects messages
+  if (len == 0 || ow->fd < 0) {
+    return;
+  }
+  struct iovec iov;
+  iov.iov_base=ow->buf;
+  iov.iov_len=len;
+  write_output(ow->fd,&iov,1);
+  ow->len-=len;
+  if (ow->len > 0) {
+    memmove(ow->buf,&ow->buf[len],ow->len);
+  }
+}
+
+/* reserve_output returns space for a message of 'len' octets at the end of the
+**   buffer, writing the buffered messages first if there is not enough room;
+**   the message is added to the output by commit_output
+*/
+unsigned char *reserve_output(OutputWriter *ow,size_t len)
+{
+  if (ow->len+len > ow->capacity) {
+    flush_output(ow);
+    if (ow->len+len > ow->capacity) {
+	allocate_output_buffer(ow,(ow->len+len+OUTPUT_BLOCK_SIZE-1)/OUTPUT_BLOCK_SIZE*OUTPUT_BLOCK_SIZE);
+    }
+  }
+  return &ow->buf[ow->len];
+}
+
+void commit_output(OutputWriter *ow,size_t len)
+{
+  ow->len+=len;
+}
+
+/* write_message adds a complete message to the output; a message that does not
+**   fit in the buffer is written together with the buffered messages in a
+**   single call, without copying it
+*/
+void write_message(OutputWriter *ow,unsigned char *msg,size_t len)
+{
+  if (ow->len+len > ow->capacity && !ow->direct && ow->fd >= 0) {
+    struct iovec iov[2];
+    iov[0].iov_base=ow->buf;
+    iov[0].iov_len=ow->len;
+    iov[1].iov_base=msg;
+    iov[1].iov_len=len;
+    write_output(ow->fd,iov,2);
+    ow->len=0;
+    return;
+  }
+  memcpy(reserve_output(ow,len),msg,len);
+  commit_output(ow,len);
+}
+
+/* close_output writes any buffered messages and closes the file, keeping the
+**   buffer for the next file; the final partial block of a direct I/O file is
+**   written after turning direct I/O off
+*/
+void close_output(OutputWriter *ow)
+{
+  flush_output(ow);
+#ifdef O_DIRECT
+  if (ow->len > 0) {
+    fcntl(ow->fd,F_SETFL,fcntl(ow->fd,F_GETFL) & ~O_DIRECT);
+    ow->direct=0;
+    flush_output(ow);
+  }
+#endif
+  close(ow->fd);
+  ow->fd=-1;
+}
+
+/* Conversion is defined by the program that includes this file, as
+**   'struct Conversion': it holds everything that is needed to convert one
+**   message, so that several messages can be converted at the same time; the
+**   program also defines these functions, which convert_file and the pipeline
+**   use:
+**
+**   create_conversion: returns a new Conversion, or NULL if it can't be
+**                        allocated; 'options' is passed on from the caller,
+**                        and 'num_threads' is the number of threads that can
+**                        unpack one message
+**   free_conversion:   frees a Conversion and all of its buffers
+**   read_message:      reads the next message of 'fp' into 'conv' and returns
+**                        0, GRIB_EOF or GRIB_READ_ERROR
+**   convert_message:   converts the message that was read into 'conv', adds
+**                        the messages that it converts to to 'ow', and returns
+**                        the number of them (0 if it was skipped)
+*/
+typedef struct Conversion Conversion;
+Conversion *create_conversion(const void *options,int num_threads);
+void free_conversion(Conversion *conv);
+int read_message(FILE *fp,Conversion *conv);
+size_t convert_message(Conversion *conv,OutputWriter *ow);
+
+/* convert_file converts all of the messages in 'fp', one at a time, with
+**   'conv', building the converted messages directly in the output buffer, and
+**   returns the status of the last call to read_message; 'nmsg' and 'nout' are
+**   increased by the number of messages read and written
+*/
+int convert_file(Conversion *conv,FILE *fp,OutputWriter *ow,size_t *nmsg,size_t *nout)
+{
+  int status;
+  while ( (status=read_message(fp,conv)) == 0) {
+    ++(*nmsg);
+    (*nout)+=convert_message(conv,ow);
+  }
+  return status;
+}
+
+#ifdef PTHREADS
+/* Pipeline converts messages on several threads while keeping the output in the
+**   same order as the input: the main thread reads the messages into a ring of
+**   conversion slots, the workers convert them in any order into the output
+**   buffer of their slot, and the writer thread writes the slots in the order
+**   that they were read
+**   ow:             the output file
+**   slots:          the ring of conversions
+**   outs:           the output buffer of each slot, which only collects
+**                     messages
+**   num_out:        the number of messages in each output buffer
+**   converted:      1 for each slot whose messages are ready to be written
+**   num_slots:      the number of slots in the ring
+**   num_read:       the number of messages read
+**   num_taken:      the number of messages taken by the workers
+**   num_written:    the number of slots written
+**   num_messages:   the number of converted messages written
+**   done_reading:   1 after the last message has been read
+**   lock:           protects all of the above except 'ow'
+**   slot_free:      signaled when a slot has been written
+**   slot_read:      signaled when a message has been read
+**   slot_converted: signaled when the next slot to write has been converted
+*/
+typedef struct {
+  OutputWriter *ow;
+  Conversion **slots;
+  OutputWriter *outs;
+  size_t *num_out;
+  int *converted;
+  size_t num_slots,num_read,num_taken,num_written,num_messages;
+  int done_reading;
+  pthread_mutex_t lock;
+  pthread_cond_t slot_free,slot_read,slot_converted;
+} Pipeline;
+
+void *pipeline_worker(void *arg)
+{
+  Pipeline *p=(Pipeline *)arg;
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    while (p->num_taken == p->num_read && !p->done_reading) {
+	pthread_cond_wait(&p->slot_read,&p->lock);
+    }
+    if (p->num_taken == p->num_read) {
+	break;
+    }
+    size_t seq=p->num_taken++;
+    size_t n=seq % p->num_slots;
+    pthread_mutex_unlock(&p->lock);
+    size_t num_out=convert_message(p->slots[n],&p->outs[n]);
+    pthread_mutex_lock(&p->lock);
+    p->num_out[n]=num_out;
+    p->converted[n]=1;
+    if (seq == p->num_written) {
+	pthread_cond_signal(&p->slot_converted);
+    }
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+void *pipeline_writer(void *arg)
+{
+  Pipeline *p=(Pipeline *)arg;
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    size_t n=p->num_written % p->num_slots;
+    while ( (p->num_written == p->num_read || !p->converted[n]) && !(p->done_reading && p->num_written == p->num_read)) {
+	pthread_cond_wait(&p->slot_converted,&p->lock);
+    }
+    if (p->num_written == p->num_read) {
+	break;
+    }
+    pthread_mutex_unlock(&p->lock);
+    OutputWriter *out=&p->outs[n];
+    if (out->len > 0) {
+	write_message(p->ow,out->buf,out->len);
+	out->len=0;
+    }
+    pthread_mutex_lock(&p->lock);
+    p->num_messages+=p->num_out[n];
+    p->converted[n]=0;
+    ++p->num_written;
+    pthread_cond_signal(&p->slot_free);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+/* run_pipeline is convert_file with 'nthreads' workers, each slot of which is
+**   created with 'options'
+*/
+int run_pipeline(FILE *fp,OutputWriter *ow,int nthreads,const void *options,size_t *nmsg,size_t *nout)
+{
+  Pipeline p;
+  p.ow=ow;
+// two slots per worker keep the workers busy while the writer waits for the
+// oldest message
+  p.num_slots=2*nthreads;
+  p.slots=(Conversion **)calloc(p.num_slots,sizeof(Conversion *));
+  p.outs=(OutputWriter *)malloc(p.num_slots*sizeof(OutputWriter));
+  p.num_out=(size_t *)calloc(p.num_slots,sizeof(size_t));
+  p.converted=(int *)calloc(p.num_slots,sizeof(int));
+  pthread_t *tids=(pthread_t *)malloc((nthreads+1)*sizeof(pthread_t));
+  if (p.slots == NULL || p.outs == NULL || p.num_out == NULL || p.converted == NULL || tids == NULL) {
+    fprintf(stderr,"Error allocating the conversion pipeline\n");
+    exit(1);
+  }
+  for (size_t n=0; n < p.num_slots; ++n) {
+// the messages are converted in parallel already, so each one is unpacked by
+// a single thread
+    if ( (p.slots[n]=create_conversion(options,1)) == NULL) {
+	fprintf(stderr,"Error allocating the conversion pipeline\n");
+	exit(1);
+    }
+    initialize_output(&p.outs[n],OUTPUT_BLOCK_SIZE);
+  }
+  p.num_read=p.num_taken=p.num_written=p.num_messages=0;
+  p.done_reading=0;
+  pthread_mutex_init(&p.lock,NULL);
+  pthread_cond_init(&p.slot_free,NULL);
+  pthread_cond_init(&p.slot_read,NULL);
+  pthread_cond_init(&p.slot_converted,NULL);
+  for (int n=0; n <= nthreads; ++n) {
+    if (pthread_create(&tids[n],NULL,(n < nthreads) ? pipeline_worker : pipeline_writer,&p) != 0) {
+	fprintf(stderr,"Error creating conversion thread\n");
+	exit(1);
+    }
+  }
+// read the messages, waiting whenever the ring is full
+  int status;
+  pthread_mutex_lock(&p.lock);
+  while (1) {
+    while (p.num_read-p.num_written == p.num_slots) {
+	pthread_cond_wait(&p.slot_free,&p.lock);
+    }
+    size_t n=p.num_read % p.num_slots;
+    pthread_mutex_unlock(&p.lock);
+    status=read_message(fp,p.slots[n]);
+    pthread_mutex_lock(&p.lock);
+    if (status != 0) {
+	break;
+    }
+    ++p.num_read;
+    pthread_cond_signal(&p.slot_read);
+  }
+  p.done_reading=1;
+  pthread_cond_broadcast(&p.slot_read);
+  pthread_cond_broadcast(&p.slot_converted);
+  pthread_mutex_unlock(&p.lock);
+  for (int n=0; n <= nthreads; ++n) {
+    pthread_join(tids[n],NULL);
+  }
+  *nmsg+=p.num_written;
+  *nout+=p.num_messages;
+  for (size_t n=0; n < p.num_slots; ++n) {
+    free_conversion(p.slots[n]);
+    free(p.outs[n].buf);
+  }
+  free(tids);
+  free(p.slots);
+  free(p.outs);
+  free(p.num_out);
+  free(p.converted);
+  pthread_mutex_destroy(&p.lock);
+  pthread_cond_destroy(&p.slot_free);
+  pthread_cond_destroy(&p.slot_read);
+  pthread_cond_destroy(&p.slot_converted);
+  return status;
+}
+#endif
+
+
+/* BatchFile is one file of a batch conversion
+**   input:    the name of the file to convert
+**   output:   the name of the converted file
+**   nmsg:     the number of messages read
+**   nout:     the number of messages (or grids) written
+**   in_size:  the size of the input file in octets
+**   out_size: the size of the output file in octets
+**   status:   0 if the file was converted, 1 if there was a read error, -1 if
+**               it was not converted, and -2 if it was rejected because an
+**               earlier file of the batch has the same output file
+*/
+typedef struct {
+  char *input,*output;
+  size_t nmsg,nout;
+  off_t in_size,out_size;
+  int status;
+} BatchFile;
+
+/* Batch is a list of files that are converted by a pool of threads; each file
+**   is a task on a GRIBScheduler, and each worker of the scheduler converts
+**   with its own Conversion and OutputWriter ('convs' and 'writers', indexed
+**   by the number of the worker), which are reused for all of the files that
+**   it converts
+**   options:      passed to create_conversion
+**   input_units:  what the input files hold, for the summary
+**   output_units: what the output files hold, for the summary
+*/
+typedef struct {
+  BatchFile *files;
+  size_t num_files,capacity;
+  const void *options;
+  const char *input_units,*output_units;
+  size_t output_buffer_size;
+  int direct;
+#ifdef PTHREADS
+  Conversion **convs;
+  OutputWriter *writers;
+#endif
+} Batch;
+
+void initialize_batch(Batch *batch,const void *options,const char *input_units,const char *output_units,size_t output_buffer_size,int direct)
+{
+  batch->files=NULL;
+  batch->num_files=batch->capacity=0;
+  batch->options=options;
+  batch->input_units=input_units;
+  batch->output_units=output_units;
+  batch->output_buffer_size=output_buffer_size;
+  batch->direct=direct;
+}
+
+void free_batch(Batch *batch)
+{
+  for (size_t n=0; n < batch->num_files; ++n) {
+    free(batch->files[n].input);
+    free(batch->files[n].output);
+  }
+  free(batch->files);
+  batch->files=NULL;
+  batch->num_files=batch->capacity=0;
+}
+
+/* output_name builds the name of an output file from 'template', where %f is
+**   replaced by the name of the input file without its directory, %b by the
+**   same without its extension, and %% by %
+*/
+char *output_name(const char *template,const char *input)
+{
+  const char *f=strrchr(input,'/');
+  f= (f == NULL) ? input : f+1;
+  size_t flen=strlen(f);
+  const char *ext=strrchr(f,'.');
+  size_t blen= (ext == NULL || ext == f) ? flen : (size_t)(ext-f);
+  char *name=(char *)malloc((strlen(template)+1)*(flen+1));
+  size_t n=0;
+  for (const char *t=template; *t != '\0'; ++t) {
+    if (t[0] == '%' && (t[1] == 'f' || t[1] == 'b')) {
+	size_t len= (t[1] == 'f') ? flen : blen;
+	memcpy(&name[n],f,len);
+	n+=len;
+	++t;
+    }
+    else if (t[0] == '%' && t[1] == '%') {
+	name[n++]='%';
+	++t;
+    }
+    else {
+	name[n++]=*t;
+    }
+  }
+  name[n]='\0';
+  return name;
+}
+
+/* add_batch_file adds a file to the batch, which takes over 'input' and
+**   'output'
+*/
+void add_batch_file(Batch *batch,char *input,char *output)
+{
+  if (batch->num_files == batch->capacity) {
+    batch->capacity= (batch->capacity > 0) ? 2*batch->capacity : 64;
+    batch->files=(BatchFile *)realloc(batch->files,batch->capacity*sizeof(BatchFile));
+    if (batch->files == NULL) {
+	fprintf(stderr,"Error allocating the list of files\n");
+	exit(1);
+    }
+  }
+  BatchFile *file=&batch->files[batch->num_files++];
+  file->input=input;
+  file->output=output;
+  file->nmsg=file->nout=0;
+  file->in_size=file->out_size=0;
+  file->status=-1;
+}
+
+int compare_batch_files(const void *a,const void *b)
+{
+  return strcmp(((const BatchFile *)a)->input,((const BatchFile *)b)->input);
+}
+
+/* compare_batch_outputs orders pointers to the files of a batch by the names of
+**   their output files, and then by their order in the batch
+*/
+int compare_batch_outputs(const void *a,const void *b)
+{
+  const BatchFile *fa=*(const BatchFile **)a,*fb=*(const BatchFile **)b;
+  int cmp=strcmp(fa->output,fb->output);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return (fa < fb) ? -1 : (fa > fb);
+}
+
+/* reject_duplicate_outputs rejects every file of the batch whose output file
+**   is also the output file of an earlier file, e.g. when a template is used
+**   for input files in different directories that have the same name; the
+**   earlier file is still converted
+*/
+void reject_duplicate_outputs(Batch *batch)
+{
+  if (batch->num_files < 2) {
+    return;
+  }
+  BatchFile **by_output=(BatchFile **)malloc(batch->num_files*sizeof(BatchFile *));
+  if (by_output == NULL) {
+    fprintf(stderr,"Error allocating the list of files\n");
+    exit(1);
+  }
+  for (size_t n=0; n < batch->num_files; ++n) {
+    by_output[n]=&batch->files[n];
+  }
+  qsort(by_output,batch->num_files,sizeof(BatchFile *),compare_batch_outputs);
+  size_t first=0;
+  for (size_t n=1; n < batch->num_files; ++n) {
+    if (strcmp(by_output[n]->output,by_output[first]->output) == 0) {
+	fprintf(stderr,"Skipping %s: its output file %s is also the output file of %s\n",by_output[n]->input,by_output[n]->output,by_output[first]->input);
+	by_output[n]->status=-2;
+    }
+    else {
+	first=n;
+    }
+  }
+  free(by_output);
+}
+
+/* read_batch fills 'batch' from 'list', which is either a directory, in which
+**   case all of the regular files in it are converted in name order, or a
+**   manifest with the name of one input file per line, optionally followed by
+**   the name of its output file; blank lines and lines starting with '#' are
+**   ignored, and output files that are not named are named with 'template'
+**   files whose output file would be the same as that of an earlier file are
+**   rejected
+*/
+void read_batch(Batch *batch,const char *list,const char *template)
+{
+  struct stat st;
+  if (stat(list,&st) != 0) {
+    fprintf(stderr,"Error opening %s\n",list);
+    exit(1);
+  }
+  if (S_ISDIR(st.st_mode)) {
+    DIR *dir;
+    if ( (dir=opendir(list)) == NULL) {
+	fprintf(stderr,"Error opening directory %s\n",list);
+	exit(1);
+    }
+    struct dirent *entry;
+    while ( (entry=readdir(dir)) != NULL) {
+	if (entry->d_name[0] == '.') {
+	  continue;
+	}
+	char *input=(char *)malloc(strlen(list)+strlen(entry->d_name)+2);
+	sprintf(input,"%s/%s",list,entry->d_name);
+	if (stat(input,&st) == 0 && S_ISREG(st.st_mode)) {
+	  add_batch_file(batch,input,output_name(template,input));
+	}
+	else {
+	  free(input);
+	}
+    }
+    closedir(dir);
+    qsort(batch->files,batch->num_files,sizeof(BatchFile),compare_batch_files);
+  }
+  else {
+    FILE *fp;
+    if ( (fp=fopen(list,"r")) == NULL) {
+	fprintf(stderr,"Error opening manifest %s\n",list);
+	exit(1);
+    }
+    char line[4096],input[4096],output[4096];
+    while (fgets(line,sizeof(line),fp) != NULL) {
+	int n=sscanf(line,"%4095s %4095s",input,output);
+	if (n < 1 || input[0] == '#') {
+	  continue;
+	}
+	add_batch_file(batch,strdup(input),(n == 2) ? strdup(output) : output_name(template,input));
+    }
+    fclose(fp);
+  }
+  reject_duplicate_outputs(batch);
+}
+
+/* convert_batch_file converts one file of a batch; a file that can't be opened
+**   is skipped with a message, and is counted as not converted
+*/
+void convert_batch_file(BatchFile *file,Conversion *conv,OutputWriter *ow,int direct)
+{
+  if (file->status == -2) {
+    return;
+  }
+  if (strcmp(file->input,file->output) == 0) {
+    fprintf(stderr,"Skipping %s: the output file would replace it\n",file->input);
+    return;
+  }
+  FILE *fp;
+  if ( (fp=fopen(file->input,"rb")) == NULL) {
+    fprintf(stderr,"Error opening input file %s\n",file->input);
+    return;
+  }
+  if (open_output(ow,file->output,direct) != 0) {
+    fprintf(stderr,"Error opening output file %s\n",file->output);
+    fclose(fp);
+    return;
+  }
+  int status=convert_file(conv,fp,ow,&file->nmsg,&file->nout);
+  if (status != -1) {
+    fprintf(stderr,"Read error in %s after %zu messages\n",file->input,file->nmsg);
+  }
+  file->status= (status == -1) ? 0 : 1;
+  struct stat st;
+  if (fstat(fileno(fp),&st) == 0) {
+    file->in_size=st.st_size;
+  }
+  fclose(fp);
+  close_output(ow);
+  if (stat(file->output,&st) == 0) {
+    file->out_size=st.st_size;
+  }
+}
+
+#ifdef PTHREADS
+/* BatchTask is the conversion of one file of a batch */
+typedef struct {
+  Batch *batch;
+  BatchFile *file;
+} BatchTask;
+
+void batch_task(void *t)
+{
+  BatchTask *task=(BatchTask *)t;
+  int id=grib_worker_id();
+  convert_batch_file(task->file,task->batch->convs[id],&task->batch->writers[id],task->batch->direct);
+}
+#endif
+
+/* skip_batch reports that none of the files in 'batch' are converted, when the
+**   conversions can't be started, so that each file is listed as not converted
+**   in the same way as a file that can't be opened
+*/
+void skip_batch(Batch *batch,const char *reason)
+{
+  fprintf(stderr,"Error: %s\n",reason);
+  for (size_t n=0; n < batch->num_files; ++n) {
+    if (batch->files[n].status != -2) {
+	fprintf(stderr,"Skipping %s: %s\n",batch->files[n].input,reason);
+	batch->files[n].status=-1;
+    }
+  }
+}
+
+/* run_batch converts the files in 'batch' on 'nthreads' threads, prints a
+**   summary of the throughput, and returns the number of files that were not
+**   converted completely; if the threads or the conversions can't be created,
+**   no file is converted and all of them are counted
+*/
+size_t run_batch(Batch *batch,int nthreads)
+{
+  struct timespec start,end;
+  clock_gettime(CLOCK_MONOTONIC,&start);
+#ifdef PTHREADS
+// the decoders spawn the grids and the chunks of large grids as tasks on the
+//   same pool, so a worker that runs out of files helps with the others
+  GRIBScheduler *scheduler=grib_scheduler_create(nthreads);
+  batch->convs=(Conversion **)calloc(nthreads,sizeof(Conversion *));
+  batch->writers=(OutputWriter *)malloc(nthreads*sizeof(OutputWriter));
+  BatchTask *tasks=(BatchTask *)malloc(batch->num_files*sizeof(BatchTask));
+  int num_created=0;
+  if (scheduler != NULL && batch->convs != NULL && batch->writers != NULL && (tasks != NULL || batch->num_files == 0)) {
+    while (num_created < nthreads && (batch->convs[num_created]=create_conversion(batch->options,nthreads)) != NULL) {
+	initialize_output(&batch->writers[num_created],batch->output_buffer_size);
+	++num_created;
+    }
+  }
+  if (num_created == nthreads) {
+    GRIBTaskGroup group;
+    grib_task_group_init(&group);
+    for (size_t n=0; n < batch->num_files; ++n) {
+	tasks[n].batch=batch;
+	tasks[n].file=&batch->files[n];
+	grib_task_spawn(scheduler,&group,batch_task,&tasks[n]);
+    }
+    grib_task_wait(scheduler,&group);
+  }
+  else {
+    skip_batch(batch,"the conversion threads could not be created");
+  }
+  if (scheduler != NULL) {
+    grib_scheduler_destroy(scheduler);
+  }
+  for (int n=0; n < num_created; ++n) {
+    free_conversion(batch->convs[n]);
+    free(batch->writers[n].buf);
+  }
+  free(tasks);
+  free(batch->convs);
+  free(batch->writers);
+#else
+// the files are converted one at a time without -DPTHREADS
+  (void)nthreads;
+  Conversion *conv;
+  if ( (conv=create_conversion(batch->options,1)) != NULL) {
+    OutputWriter ow;
+    initialize_output(&ow,batch->output_buffer_size);
+    for (size_t n=0; n < batch->num_files; ++n) {
+	convert_batch_file(&batch->files[n],conv,&ow,batch->direct);
+    }
+    free_conversion(conv);
+    free(ow.buf);
+  }
+  else {
+    skip_batch(batch,"the conversion could not be allocated");
+  }
+#endif
+  clock_gettime(CLOCK_MONOTONIC,&end);
+  double seconds=(end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1.e9;
+  size_t nconv=0,nfail=0,nmsg=0,nout=0;
+  double in_size=0.,out_size=0.;
+  for (size_t n=0; n < batch->num_files; ++n) {
+    BatchFile *file=&batch->files[n];
+    if (file->status == 0) {
+	++nconv;
+    }
+    else {
+	++nfail;
+    }
+    nmsg+=file->nmsg;
+    nout+=file->nout;
+    in_size+=file->in_size;
+    out_size+=file->out_size;
+  }
+  in_size/=1024.*1024.;
+  out_size/=1024.*1024.;
+  if (seconds <= 0.) {
+    seconds=1.e-9;
+  }
+  printf("Files converted: %zu of %zu\n",nconv,batch->num_files);
+  printf("Number of %s read: %zu\n",batch->input_units,nmsg);
+  printf("Number of %s written to output: %zu\n",batch->output_units,nout);
+  printf("Read %.1f MB and wrote %.1f MB in %.2f seconds\n",in_size,out_size,seconds);
+  printf("Throughput: %.1f messages/s, %.1f MB/s read, %.1f MB/s written\n",nmsg/seconds,in_size/seconds,out_size/seconds);
+  return nfail;
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+** File: grib_parallel.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to split the gridpoints of a large grid (or any other range of
+**          items) into chunks and unpack the chunks in parallel
+**
+** Notes:   1) unpackgrib1.c and unpackgrib2.c both include this file, so that a
+**             program that includes both decoders gets one copy of it.
+**
+**          2) The chunks run on threads of their own when compiled with
+**             -DPTHREADS, or as tasks on the pool of a GRIBScheduler when the
+**             caller is one of its tasks (see grib_scheduler.c); otherwise
+**             they run one after another in the calling thread.
+*/
+#ifndef GRIB_PARALLEL_C
+#define GRIB_PARALLEL_C
+
+#include <stdlib.h>
+#include <limits.h>
+#ifdef PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#include "grib_scheduler.c"
+#endif
+
+/* grids are unpacked by more than one thread only if each thread gets at least
+**   this many gridpoints
+*/
+#ifndef GRIB_POINTS_PER_THREAD
+#define GRIB_POINTS_PER_THREAD 131072
+#endif
+
+/* grib_default_threads returns the number of threads that 'initialize' sets in
+**   a message: the number of online processors when compiled with -DPTHREADS,
+**   otherwise 1
+*/
+int grib_default_threads(void)
+{
+#ifdef PTHREADS
+  long num_procs=sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_procs > 1) {
+    return (num_procs < INT_MAX) ? num_procs : INT_MAX;
+  }
+#endif
+  return 1;
+}
+
+/* grib_num_chunks returns the number of chunks that grib_parallel_for splits
+**   'num_items' items into for 'num_threads' threads
+*/
+size_t grib_num_chunks(size_t num_items,int num_threads)
+{
+  size_t num_chunks=num_items/GRIB_POINTS_PER_THREAD;
+  if (num_threads < 1) {
+    num_threads=1;
+  }
+  if (num_chunks > (size_t)num_threads) {
+    num_chunks=num_threads;
+  }
+  return (num_chunks > 0) ? num_chunks : 1;
+}
+
+typedef struct {
+  void (*func)(void *,size_t,size_t,size_t);
+  void *arg;
+  size_t chunk,start,end;
+} GRIBChunk;
+
+#ifdef PTHREADS
+void *grib_chunk_thread(void *c)
+{
+  GRIBChunk *chunk=(GRIBChunk *)c;
+  chunk->func(chunk->arg,chunk->chunk,chunk->start,chunk->end);
+  return NULL;
+}
+
+void grib_chunk_task(void *c)
+{
+  grib_chunk_thread(c);
+}
+#endif
+
+/* grib_run_chunks splits the items 0 to 'num_items'-1 into 'num_chunks'
+**   contiguous chunks of nearly equal size and calls func(arg,chunk,start,end)
+**   for each one, where 'chunk' is the number of the chunk and its items are
+**   'start' to 'end'-1
+**
+**   the chunks run on separate threads when compiled with -DPTHREADS (a chunk
+**   whose thread can't be started runs in the calling thread), and they have
+**   all finished when grib_run_chunks returns; when the caller is a task of a
+**   GRIBScheduler, the chunks are spawned as tasks on its pool instead, so
+**   that nested parallelism doesn't start more threads than the pool has
+*/
+void grib_run_chunks(size_t num_items,size_t num_chunks,void (*func)(void *,size_t,size_t,size_t),void *arg)
+{
+  GRIBChunk *chunks=NULL;
+#ifdef PTHREADS
+  GRIBScheduler *scheduler=grib_current_scheduler();
+  if (scheduler != NULL && num_chunks > 1 && (chunks=(GRIBChunk *)malloc(num_chunks*sizeof(GRIBChunk))) != NULL) {
+    GRIBTaskGroup group;
+    grib_task_group_init(&group);
+    for (size_t n=1; n < num_chunks; ++n) {
+	chunks[n].func=func;
+	chunks[n].arg=arg;
+	chunks[n].chunk=n;
+	chunks[n].start=num_items*n/num_chunks;
+	chunks[n].end=num_items*(n+1)/num_chunks;
+	grib_task_spawn(scheduler,&group,grib_chunk_task,&chunks[n]);
+    }
+    func(arg,0,0,num_items/num_chunks);
+    grib_task_wait(scheduler,&group);
+    free(chunks);
+    return;
+  }
+  pthread_t *tids=NULL;
+  int *started=NULL;
+  if (num_chunks > 1) {
+    chunks=(GRIBChunk *)malloc(num_chunks*sizeof(GRIBChunk));
+    tids=(pthread_t *)malloc(num_chunks*sizeof(pthread_t));
+    started=(int *)calloc(num_chunks,sizeof(int));
+  }
+  if (chunks != NULL && tids != NULL && started != NULL) {
+    for (size_t n=1; n < num_chunks; ++n) {
+	chunks[n].func=func;
+	chunks[n].arg=arg;
+	chunks[n].chunk=n;
+	chunks[n].start=num_items*n/num_chunks;
+	chunks[n].end=num_items*(n+1)/num_chunks;
+	started[n]=(pthread_create(&tids[n],NULL,grib_chunk_thread,&chunks[n]) == 0);
+    }
+    func(arg,0,0,num_items/num_chunks);
+    for (size_t n=1; n < num_chunks; ++n) {
+	if (started[n]) {
+	  pthread_join(tids[n],NULL);
+	}
+	else {
+	  func(arg,n,chunks[n].start,chunks[n].end);
+	}
+    }
+  }
+  else {
+    free(chunks);
+    chunks=NULL;
+  }
+  free(tids);
+  free(started);
+#endif
+  if (chunks == NULL) {
+    for (size_t n=0; n < num_chunks; ++n) {
+	func(arg,n,num_items*n/num_chunks,num_items*(n+1)/num_chunks);
+    }
+  }
+  free(chunks);
+}
+
+/* grib_parallel_for runs the items 0 to 'num_items'-1 in
+**   grib_num_chunks(num_items,num_threads) chunks with grib_run_chunks
+*/
+void grib_parallel_for(size_t num_items,int num_threads,void (*func)(void *,size_t,size_t,size_t),void *arg)
+{
+  grib_run_chunks(num_items,grib_num_chunks(num_items,num_threads),func,arg);
+}
+
+#endif
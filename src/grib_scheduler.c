@@ -0,0 +1,425 @@
+/*
+** File: grib_scheduler.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**          18 Oct 2026 - a worker that waits for a group keeps running the
+**                        tasks of other workers until the group finishes
+**
+** Purpose: to run the work of unpacking GRIB data (files, messages, grids and
+**          the chunks of large grids) as tasks on a fixed pool of threads
+**
+** Notes:   1) Each worker thread has its own queue of tasks.  A worker runs the
+**             newest task in its own queue first, and when its queue is empty,
+**             it steals the oldest task from the queue of another worker, so
+**             the work is balanced no matter how unevenly it was spawned.
+**             Tasks that are spawned by threads that aren't workers go to a
+**             shared queue that the workers take from when they have nothing
+**             else to do.
+**
+**          2) Tasks can spawn tasks and wait for them.  A worker that waits
+**             for a group doesn't block while there is other work: it runs
+**             the tasks in its own queue, and steals from the queues of the
+**             other workers, until the group has finished.  So nested
+**             parallelism (a file task that unpacks a message whose grids are
+**             split into chunks) never needs more threads than the pool has,
+**             and no thread sits idle while it waits.  A waiting worker
+**             doesn't take tasks from the shared queue: those are the
+**             outermost tasks (e.g. files), which may use the buffers of the
+**             worker (see grib_worker_id) that the waiting task is using.
+**
+**          3) unpackgrib1.c and unpackgrib2.c include this file when they are
+**             compiled with -DPTHREADS.  When they are called from a task, the
+**             grids of a message and the chunks of a large grid are spawned as
+**             tasks on the same pool instead of on threads of their own.
+**
+**          4) Compile with -DPTHREADS and link with -lpthread.
+**
+** example C syntax for using the scheduler:
+**    void unpack_file(void *name)
+**    {
+**      ... open 'name' and unpack its messages ...
+**    }
+**
+**    GRIBScheduler *scheduler=grib_scheduler_create(8);
+**    GRIBTaskGroup group;
+**
+**    grib_task_group_init(&group);
+**    for (n=1; n < argc; ++n) {
+**      grib_task_spawn(scheduler,&group,unpack_file,argv[n]);
+**    }
+**    grib_task_wait(scheduler,&group);
+**    grib_scheduler_destroy(scheduler);
+*/
+#ifndef GRIB_SCHEDULER_C
+#define GRIB_SCHEDULER_C
+
+#include <stdlib.h>
+#include <pthread.h>
+
+/* GRIBTaskGroup counts the tasks that have been spawned in it and haven't
+**   finished yet; initialize it with grib_task_group_init
+*/
+typedef struct {
+  size_t pending;
+} GRIBTaskGroup;
+
+typedef struct {
+  void (*func)(void *);
+  void *arg;
+  GRIBTaskGroup *group;
+} GRIBTask;
+
+/* GRIBTaskQueue is a double-ended queue of tasks; the owner pushes and pops at
+**   the bottom, and thieves steal from the top
+*/
+typedef struct {
+  pthread_mutex_t lock;
+  GRIBTask *tasks;
+  size_t capacity,top,bottom;
+} GRIBTaskQueue;
+
+/* GRIBScheduler is a pool of worker threads
+**   queues:      the queue of each worker, and the shared queue of tasks that
+**                  were spawned by other threads at index 'num_workers'
+**   lock:        protects 'num_queued', 'shutdown' and the counts of the task
+**                  groups
+**   cond:        signalled when a task is queued or a group finishes
+*/
+typedef struct {
+  int num_workers;
+  pthread_t *tids;
+  GRIBTaskQueue *queues;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  size_t num_queued;
+  int shutdown;
+} GRIBScheduler;
+
+/* GRIBWorker identifies the worker that is running in a thread */
+typedef struct {
+  GRIBScheduler *scheduler;
+  int id;
+} GRIBWorker;
+
+pthread_key_t grib_worker_key;
+pthread_once_t grib_worker_once=PTHREAD_ONCE_INIT;
+
+void grib_create_worker_key(void)
+{
+  pthread_key_create(&grib_worker_key,NULL);
+}
+
+/* grib_current_worker returns the worker that is running in the calling
+**   thread, or NULL if the thread isn't a worker
+*/
+GRIBWorker *grib_current_worker(void)
+{
+  pthread_once(&grib_worker_once,grib_create_worker_key);
+  return (GRIBWorker *)pthread_getspecific(grib_worker_key);
+}
+
+/* grib_current_scheduler returns the scheduler of the calling thread, or NULL
+**   if the thread isn't a worker
+*/
+GRIBScheduler *grib_current_scheduler(void)
+{
+  GRIBWorker *worker=grib_current_worker();
+  return (worker != NULL) ? worker->scheduler : NULL;
+}
+
+/* grib_worker_id returns the number (0 to num_workers-1) of the worker that is
+**   running in the calling thread, or -1 if the thread isn't a worker; it can
+**   be used to give each worker its own buffers
+*/
+int grib_worker_id(void)
+{
+  GRIBWorker *worker=grib_current_worker();
+  return (worker != NULL) ? worker->id : -1;
+}
+
+void grib_task_group_init(GRIBTaskGroup *group)
+{
+  group->pending=0;
+}
+
+/* grib_queue_push adds a task to the bottom of a queue; it returns 0, or -1 if
+**   the queue can't grow
+*/
+int grib_queue_push(GRIBTaskQueue *queue,GRIBTask *task)
+{
+  pthread_mutex_lock(&queue->lock);
+  if (queue->bottom == queue->capacity) {
+    if (queue->top > 0) {
+/* slide the tasks down to the beginning of the queue */
+	for (size_t n=queue->top; n < queue->bottom; ++n) {
+	  queue->tasks[n-queue->top]=queue->tasks[n];
+	}
+	queue->bottom-=queue->top;
+	queue->top=0;
+    }
+    else {
+	size_t capacity= (queue->capacity > 0) ? queue->capacity*2 : 64;
+	GRIBTask *tasks=(GRIBTask *)realloc(queue->tasks,capacity*sizeof(GRIBTask));
+	if (tasks == NULL) {
+	  pthread_mutex_unlock(&queue->lock);
+	  return -1;
+	}
+	queue->tasks=tasks;
+	queue->capacity=capacity;
+    }
+  }
+  queue->tasks[queue->bottom++]=*task;
+  pthread_mutex_unlock(&queue->lock);
+  return 0;
+}
+
+/* grib_queue_pop takes the newest task of a queue if 'group' is NULL or the
+**   task belongs to 'group'; it returns 1 if it took a task, otherwise 0
+*/
+int grib_queue_pop(GRIBTaskQueue *queue,GRIBTaskGroup *group,GRIBTask *task)
+{
+  int found=0;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->bottom > queue->top && (group == NULL || queue->tasks[queue->bottom-1].group == group)) {
+    *task=queue->tasks[--queue->bottom];
+    found=1;
+  }
+  if (queue->bottom == queue->top) {
+    queue->top=queue->bottom=0;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+/* grib_queue_steal takes the oldest task of a queue; it returns 1 if it took a
+**   task, otherwise 0
+*/
+int grib_queue_steal(GRIBTaskQueue *queue,GRIBTask *task)
+{
+  int found=0;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->bottom > queue->top) {
+    *task=queue->tasks[queue->top++];
+    found=1;
+  }
+  if (queue->bottom == queue->top) {
+    queue->top=queue->bottom=0;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+/* grib_find_task finds a task for worker 'id': the newest task in its own
+**   queue, or else the oldest task in the queue of another worker, or else the
+**   oldest task in the shared queue
+*/
+int grib_find_task(GRIBScheduler *scheduler,int id,GRIBTask *task)
+{
+  if (grib_queue_pop(&scheduler->queues[id],NULL,task)) {
+    return 1;
+  }
+  for (int n=1; n < scheduler->num_workers; ++n) {
+    if (grib_queue_steal(&scheduler->queues[(id+n) % scheduler->num_workers],task)) {
+	return 1;
+    }
+  }
+  return grib_queue_steal(&scheduler->queues[scheduler->num_workers],task);
+}
+
+/* grib_run_task runs a task that has been taken from a queue and counts it as
+**   finished in its group
+*/
+void grib_run_task(GRIBScheduler *scheduler,GRIBTask *task)
+{
+  pthread_mutex_lock(&scheduler->lock);
+  --scheduler->num_queued;
+  pthread_mutex_unlock(&scheduler->lock);
+  task->func(task->arg);
+  pthread_mutex_lock(&scheduler->lock);
+  if (--task->group->pending == 0) {
+    pthread_cond_broadcast(&scheduler->cond);
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+void *grib_worker_thread(void *w)
+{
+  GRIBWorker *worker=(GRIBWorker *)w;
+  GRIBScheduler *scheduler=worker->scheduler;
+  pthread_once(&grib_worker_once,grib_create_worker_key);
+  pthread_setspecific(grib_worker_key,worker);
+  while (1) {
+    GRIBTask task;
+    if (grib_find_task(scheduler,worker->id,&task)) {
+	grib_run_task(scheduler,&task);
+	continue;
+    }
+    pthread_mutex_lock(&scheduler->lock);
+    while (scheduler->num_queued == 0 && !scheduler->shutdown) {
+	pthread_cond_wait(&scheduler->cond,&scheduler->lock);
+    }
+    int shutdown=(scheduler->num_queued == 0 && scheduler->shutdown);
+    pthread_mutex_unlock(&scheduler->lock);
+    if (shutdown) {
+	break;
+    }
+  }
+  free(worker);
+  return NULL;
+}
+
+/* grib_task_spawn queues func(arg) as a task of 'group'; a worker queues it in
+**   its own queue, and any other thread queues it in the shared queue; if the
+**   task can't be queued, it runs before grib_task_spawn returns
+*/
+void grib_task_spawn(GRIBScheduler *scheduler,GRIBTaskGroup *group,void (*func)(void *),void *arg)
+{
+  GRIBWorker *worker=grib_current_worker();
+  int id= (worker != NULL && worker->scheduler == scheduler) ? worker->id : scheduler->num_workers;
+  GRIBTask task;
+  task.func=func;
+  task.arg=arg;
+  task.group=group;
+  pthread_mutex_lock(&scheduler->lock);
+  ++group->pending;
+  ++scheduler->num_queued;
+  pthread_mutex_unlock(&scheduler->lock);
+  if (grib_queue_push(&scheduler->queues[id],&task) != 0) {
+    grib_run_task(scheduler,&task);
+    return;
+  }
+  pthread_mutex_lock(&scheduler->lock);
+  pthread_cond_broadcast(&scheduler->cond);
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+/* grib_find_nested_task finds a task for worker 'id' that is waiting for a
+**   group: the newest task in its own queue, or else the oldest task in the
+**   queue of another worker; the shared queue is left to the workers that
+**   aren't in the middle of a task
+*/
+int grib_find_nested_task(GRIBScheduler *scheduler,int id,GRIBTask *task)
+{
+  if (grib_queue_pop(&scheduler->queues[id],NULL,task)) {
+    return 1;
+  }
+  for (int n=1; n < scheduler->num_workers; ++n) {
+    if (grib_queue_steal(&scheduler->queues[(id+n) % scheduler->num_workers],task)) {
+	return 1;
+    }
+  }
+  return 0;
+}
+
+/* grib_task_wait returns when all of the tasks of 'group' have finished; a
+**   worker runs other tasks while it waits (see grib_find_nested_task), and
+**   only blocks when there are none left to run
+*/
+void grib_task_wait(GRIBScheduler *scheduler,GRIBTaskGroup *group)
+{
+  GRIBWorker *worker=grib_current_worker();
+  int helping=(worker != NULL && worker->scheduler == scheduler);
+  pthread_mutex_lock(&scheduler->lock);
+  while (group->pending > 0) {
+    if (helping) {
+	pthread_mutex_unlock(&scheduler->lock);
+	GRIBTask task;
+	int found=grib_find_nested_task(scheduler,worker->id,&task);
+	if (found) {
+	  grib_run_task(scheduler,&task);
+	}
+	pthread_mutex_lock(&scheduler->lock);
+	if (found || group->pending == 0) {
+	  continue;
+	}
+    }
+/* the cond is signalled when a task is queued or a group finishes */
+    pthread_cond_wait(&scheduler->cond,&scheduler->lock);
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+/* grib_stop_workers stops the first 'num_started' workers after they have run
+**   all of the tasks that are queued, and frees the scheduler
+*/
+void grib_stop_workers(GRIBScheduler *scheduler,int num_started)
+{
+  pthread_mutex_lock(&scheduler->lock);
+  scheduler->shutdown=1;
+  pthread_cond_broadcast(&scheduler->cond);
+  pthread_mutex_unlock(&scheduler->lock);
+  for (int n=0; n < num_started; ++n) {
+    pthread_join(scheduler->tids[n],NULL);
+  }
+  for (int n=0; n < scheduler->num_workers+1; ++n) {
+    pthread_mutex_destroy(&scheduler->queues[n].lock);
+    free(scheduler->queues[n].tasks);
+  }
+  pthread_mutex_destroy(&scheduler->lock);
+  pthread_cond_destroy(&scheduler->cond);
+  free(scheduler->tids);
+  free(scheduler->queues);
+  free(scheduler);
+}
+
+/* grib_scheduler_create starts a pool of 'num_workers' worker threads; it
+**   returns NULL if the pool can't be started
+*/
+GRIBScheduler *grib_scheduler_create(int num_workers)
+{
+  if (num_workers < 1) {
+    num_workers=1;
+  }
+  GRIBScheduler *scheduler=(GRIBScheduler *)malloc(sizeof(GRIBScheduler));
+  if (scheduler == NULL) {
+    return NULL;
+  }
+  scheduler->tids=(pthread_t *)malloc(num_workers*sizeof(pthread_t));
+  scheduler->queues=(GRIBTaskQueue *)malloc((num_workers+1)*sizeof(GRIBTaskQueue));
+  if (scheduler->tids == NULL || scheduler->queues == NULL) {
+    free(scheduler->tids);
+    free(scheduler->queues);
+    free(scheduler);
+    return NULL;
+  }
+  for (int n=0; n <= num_workers; ++n) {
+    pthread_mutex_init(&scheduler->queues[n].lock,NULL);
+    scheduler->queues[n].tasks=NULL;
+    scheduler->queues[n].capacity=scheduler->queues[n].top=scheduler->queues[n].bottom=0;
+  }
+  pthread_mutex_init(&scheduler->lock,NULL);
+  pthread_cond_init(&scheduler->cond,NULL);
+  scheduler->num_queued=0;
+  scheduler->shutdown=0;
+  scheduler->num_workers=num_workers;
+  int num_started=0;
+  while (num_started < num_workers) {
+    GRIBWorker *worker=(GRIBWorker *)malloc(sizeof(GRIBWorker));
+    if (worker == NULL) {
+	break;
+    }
+    worker->scheduler=scheduler;
+    worker->id=num_started;
+    if (pthread_create(&scheduler->tids[num_started],NULL,grib_worker_thread,worker) != 0) {
+	free(worker);
+	break;
+    }
+    ++num_started;
+  }
+  if (num_started < num_workers) {
+    grib_stop_workers(scheduler,num_started);
+    return NULL;
+  }
+  return scheduler;
+}
+
+/* grib_scheduler_destroy stops the workers after they have run all of the
+**   tasks that are queued, and frees the scheduler
+*/
+void grib_scheduler_destroy(GRIBScheduler *scheduler)
+{
+  grib_stop_workers(scheduler,scheduler->num_workers);
+}
+
+#endif
@@ -0,0 +1,415 @@
+/*
+** File: keyword_resolver.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**          18 Oct 2026 - build_keyword_resolver returns an error instead of
+**                        exiting when it runs out of memory or level classes
+**
+** Purpose: to find the CF standard name and the GCMD keywords of a GRIB2 grid,
+**          honoring the 'ifLevelType' and 'ifLevelValue' conditions of the
+**          parameter tables
+**
+** Notes:   1) The keywords come from a parameter cache (see parameter_cache.c
+**             and build_parameter_cache.c).  build_keyword_resolver compiles
+**             the conditions of every parameter in the cache into decision
+**             rows once, so resolving a grid is a table lookup and, at most,
+**             a comparison of level values; no strings are compared.
+**
+**          2) The conditions of a parameter are applied in the order of the
+**             XML: the first CF (or GCMD) element whose conditions match the
+**             level of the grid wins.  A condition on a single level type
+**             ("106") doesn't match a layer, and a layer condition ("106-106")
+**             doesn't match a single level.
+**
+**          3) This file includes unpackgrib2.c and parameter_cache.c; both
+**             are guarded, so a program may also include them itself.
+**
+** example C syntax for using the resolver:
+**    ParameterCache cache;
+**    KeywordResolver resolver;
+**    KeywordResult result;
+**
+**    if (open_parameter_cache("parameters.cache",&cache) != 0 ||
+**        build_keyword_resolver(&cache,&resolver) != 0) {
+**      exit(1);
+**    }
+**    ...
+**    if (resolve_grid_keywords(&resolver,&grib2_msg,n,&result) == 0) {
+**      if (result.cf != NULL) {
+**        printf("CF: %s\n",result.cf);
+**      }
+**      for (size_t m=0; m < result.num_gcmd; ++m) {
+**        printf("GCMD: %s\n",result.gcmd[m]);
+**      }
+**    }
+**    ...
+**    free_keyword_resolver(&resolver);
+**    close_parameter_cache(&cache);
+*/
+#include <math.h>
+#include "unpackgrib2.c"
+#include "parameter_cache.c"
+
+/* LevelClass is one of the level conditions that appear in the cache; every
+**   level that doesn't match one of them is in class 0
+**   lvl1_type, lvl2_type: the condition (lvl2_type is 255 for a single level)
+**   next:                 the next layer class with the same 'lvl1_type', or 0
+*/
+typedef struct {
+  uint8_t lvl1_type,lvl2_type;
+  uint16_t next;
+} LevelClass;
+
+/* KeywordDecision is the outcome of the conditions of one kind of keyword (CF
+**   or GCMD) for one level class; when the level value matches one of the
+**   'num_values' ValueDecisions starting at 'first_value', that one is the
+**   outcome instead
+**   keyword:     CF: the string offset of the standard name, or 0 for none
+**                GCMD: the index in 'uuids' of the first UUID
+**   num:         CF: 1, or 0 for none; GCMD: the number of UUIDs
+*/
+typedef struct {
+  uint32_t keyword,num;
+  uint32_t first_value,num_values;
+} KeywordDecision;
+
+typedef struct {
+  double level_value;
+  uint32_t keyword,num;
+} ValueDecision;
+
+/* KeywordResolver holds the compiled conditions of every parameter in a cache
+**   cache:          the parameter cache
+**   single_class:   the class of each single level type
+**   layer_class:    the first layer class of each first level type
+**   classes:        the level classes; class 0 is "any other level"
+**   num_classes:    the number of level classes
+**   entry_row:      for each entry in the cache, its first decision row
+**   entry_rows:     for each entry, 1 if it has a row for each level class,
+**                     or 0 if its one row applies to every level
+**   decisions:      the decision rows; a row has a CF and a GCMD decision
+**   values:         the decisions that depend on the level value
+**   uuids:          the GCMD UUIDs (GCMD elements can have several, separated
+**                     by ';')
+**   outcomes:       while building, the keyword and count of each keyword in
+**                     the cache
+*/
+typedef struct {
+  const ParameterCache *cache;
+  uint16_t single_class[256],layer_class[256];
+  LevelClass *classes;
+  size_t num_classes;
+  uint32_t *entry_row;
+  uint8_t *entry_rows;
+  KeywordDecision *decisions;
+  size_t num_decisions,decisions_capacity;
+  ValueDecision *values;
+  size_t num_values,values_capacity;
+  char **uuids;
+  size_t num_uuids,uuids_capacity;
+  uint32_t *outcomes;
+} KeywordResolver;
+
+/* KeywordResult is the result of resolve_keywords; the pointers are valid
+**   while the resolver and its cache are
+**   cf:       the CF standard name, or NULL if there isn't one for the grid
+**   gcmd:     the GCMD UUIDs
+**   num_gcmd: the number of GCMD UUIDs
+*/
+typedef struct {
+  const char *cf;
+  char * const *gcmd;
+  size_t num_gcmd;
+} KeywordResult;
+
+/* grow_resolver_array returns 'array' with room for 'needed' elements, or NULL
+**   if it can't be grown, in which case 'array' and 'capacity' are unchanged
+*/
+void *grow_resolver_array(void *array,size_t *capacity,size_t needed,size_t size)
+{
+  if (needed > *capacity) {
+    size_t new_capacity= (*capacity == 0) ? 1024 : *capacity*2;
+    if (new_capacity < needed) {
+	new_capacity=needed;
+    }
+    array=realloc(array,new_capacity*size);
+    if (array != NULL) {
+	*capacity=new_capacity;
+    }
+  }
+  return array;
+}
+
+int keyword_level_class(const KeywordResolver *r,int lvl1_type,int lvl2_type)
+{
+  if (lvl1_type < 0 || lvl1_type > 255) {
+    return 0;
+  }
+  if (lvl2_type == 255) {
+    return r->single_class[lvl1_type];
+  }
+  int c=r->layer_class[lvl1_type];
+  while (c != 0 && r->classes[c].lvl2_type != lvl2_type) {
+    c=r->classes[c].next;
+  }
+  return c;
+}
+
+/* keyword_outcome finds the keyword and count that a cache keyword resolves
+**   to, splitting GCMD UUID lists, and returns 0, or returns 1 if it runs out
+**   of memory
+*/
+int keyword_outcome(KeywordResolver *r,const ParameterCacheKeyword *k,uint32_t *keyword,uint32_t *num)
+{
+  if (k->type == CF_KEYWORD) {
+    *keyword=k->keyword;
+    *num= (k->keyword != 0) ? 1 : 0;
+    return 0;
+  }
+  const char *s=&r->cache->strings[k->keyword];
+  *keyword=r->num_uuids;
+  *num=0;
+  while (*s != '\0') {
+    size_t len=strcspn(s,";");
+    if (len > 0) {
+	char **uuids=(char **)grow_resolver_array(r->uuids,&r->uuids_capacity,r->num_uuids+1,sizeof(char *));
+	if (uuids == NULL) {
+	  return 1;
+	}
+	r->uuids=uuids;
+	char *uuid=(char *)malloc(len+1);
+	if (uuid == NULL) {
+	  return 1;
+	}
+	memcpy(uuid,s,len);
+	uuid[len]='\0';
+	r->uuids[r->num_uuids++]=uuid;
+	++(*num);
+    }
+    s+=len;
+    if (*s == ';') {
+	++s;
+    }
+  }
+  return 0;
+}
+
+/* compile_decision fills the decision for one kind of keyword of an entry, for
+**   the level class 'c', from the entry's keywords in XML order: value
+**   conditions are collected until the first keyword whose conditions don't
+**   depend on the level value, which is the outcome otherwise; it returns 0,
+**   or 1 if it runs out of memory
+*/
+int compile_decision(KeywordResolver *r,const ParameterCacheEntry *e,int type,int c,KeywordDecision *d)
+{
+  memset(d,0,sizeof(KeywordDecision));
+  d->first_value=r->num_values;
+  for (size_t n=0; n < e->num_keywords; ++n) {
+    const ParameterCacheKeyword *k=&r->cache->keywords[e->first_keyword+n];
+    if (k->type != type) {
+	continue;
+    }
+    if (k->lvl1_type != 255 && keyword_level_class(r,k->lvl1_type,k->lvl2_type) != c) {
+	continue;
+    }
+    if (k->has_value) {
+	if (k->lvl1_type == 255) {
+// a value without a level type can't be interpreted
+	  continue;
+	}
+	ValueDecision *values=(ValueDecision *)grow_resolver_array(r->values,&r->values_capacity,r->num_values+1,sizeof(ValueDecision));
+	if (values == NULL) {
+	  return 1;
+	}
+	r->values=values;
+	ValueDecision *v=&r->values[r->num_values++];
+	v->level_value=k->level_value;
+	v->keyword=r->outcomes[(e->first_keyword+n)*2];
+	v->num=r->outcomes[(e->first_keyword+n)*2+1];
+	++d->num_values;
+    }
+    else {
+	d->keyword=r->outcomes[(e->first_keyword+n)*2];
+	d->num=r->outcomes[(e->first_keyword+n)*2+1];
+	return 0;
+    }
+  }
+  return 0;
+}
+
+void free_keyword_resolver(KeywordResolver *r)
+{
+  for (size_t n=0; n < r->num_uuids; ++n) {
+    free(r->uuids[n]);
+  }
+  free(r->uuids);
+  free(r->classes);
+  free(r->entry_row);
+  free(r->entry_rows);
+  free(r->decisions);
+  free(r->values);
+  free(r->outcomes);
+  memset(r,0,sizeof(KeywordResolver));
+}
+
+/* build_keyword_resolver compiles the keyword conditions of every parameter in
+**   'cache' and returns 0, or returns 1 if it can't; 'r' is then empty, and
+**   doesn't need to be freed
+*/
+int build_keyword_resolver(const ParameterCache *cache,KeywordResolver *r)
+{
+  memset(r,0,sizeof(KeywordResolver));
+  r->cache=cache;
+// find the level classes
+  size_t classes_capacity=0;
+  if ( (r->classes=(LevelClass *)grow_resolver_array(NULL,&classes_capacity,1,sizeof(LevelClass))) == NULL) {
+    fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+    return 1;
+  }
+  memset(&r->classes[0],0,sizeof(LevelClass));
+  r->num_classes=1;
+  for (size_t n=0; n < cache->header->num_keywords; ++n) {
+    const ParameterCacheKeyword *k=&cache->keywords[n];
+    if (k->lvl1_type == 255 || keyword_level_class(r,k->lvl1_type,k->lvl2_type) != 0) {
+	continue;
+    }
+    if (r->num_classes == 65535) {
+	fprintf(stderr,"Error: too many level conditions in the parameter cache\n");
+	free_keyword_resolver(r);
+	return 1;
+    }
+    LevelClass *classes=(LevelClass *)grow_resolver_array(r->classes,&classes_capacity,r->num_classes+1,sizeof(LevelClass));
+    if (classes == NULL) {
+	fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+	free_keyword_resolver(r);
+	return 1;
+    }
+    r->classes=classes;
+    LevelClass *c=&r->classes[r->num_classes];
+    c->lvl1_type=k->lvl1_type;
+    c->lvl2_type=k->lvl2_type;
+    if (k->lvl2_type == 255) {
+	c->next=0;
+	r->single_class[k->lvl1_type]=r->num_classes;
+    }
+    else {
+	c->next=r->layer_class[k->lvl1_type];
+	r->layer_class[k->lvl1_type]=r->num_classes;
+    }
+    ++r->num_classes;
+  }
+  if ( (r->outcomes=(uint32_t *)malloc((cache->header->num_keywords+1)*2*sizeof(uint32_t))) == NULL) {
+    fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+    free_keyword_resolver(r);
+    return 1;
+  }
+  for (size_t n=0; n < cache->header->num_keywords; ++n) {
+    if (keyword_outcome(r,&cache->keywords[n],&r->outcomes[n*2],&r->outcomes[n*2+1]) != 0) {
+	fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+	free_keyword_resolver(r);
+	return 1;
+    }
+  }
+// compile a row for each level class of the entries with level conditions, and
+// one row for the others
+  size_t num_entries=cache->header->num_entries;
+  r->entry_row=(uint32_t *)malloc((num_entries+1)*sizeof(uint32_t));
+  r->entry_rows=(uint8_t *)malloc(num_entries+1);
+  if (r->entry_row == NULL || r->entry_rows == NULL) {
+    fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+    free_keyword_resolver(r);
+    return 1;
+  }
+  for (size_t n=0; n < num_entries; ++n) {
+    const ParameterCacheEntry *e=&cache->entries[n];
+    int conditional=0;
+    for (size_t m=0; m < e->num_keywords; ++m) {
+	if (cache->keywords[e->first_keyword+m].lvl1_type != 255) {
+	  conditional=1;
+	}
+    }
+    size_t num_rows= (conditional) ? r->num_classes : 1;
+    r->entry_row[n]=r->num_decisions/2;
+    r->entry_rows[n]=conditional;
+    KeywordDecision *decisions=(KeywordDecision *)grow_resolver_array(r->decisions,&r->decisions_capacity,r->num_decisions+num_rows*2,sizeof(KeywordDecision));
+    if (decisions == NULL) {
+	fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+	free_keyword_resolver(r);
+	return 1;
+    }
+    r->decisions=decisions;
+    for (size_t c=0; c < num_rows; ++c) {
+	if (compile_decision(r,e,CF_KEYWORD,c,&r->decisions[r->num_decisions]) != 0 || compile_decision(r,e,GCMD_KEYWORD,c,&r->decisions[r->num_decisions+1]) != 0) {
+	  fprintf(stderr,"Error: unable to allocate memory for the keyword resolver\n");
+	  free_keyword_resolver(r);
+	  return 1;
+	}
+	r->num_decisions+=2;
+    }
+  }
+  free(r->outcomes);
+  r->outcomes=NULL;
+  return 0;
+}
+
+/* apply_decision returns the keyword and count of a decision for a level
+**   value
+*/
+void apply_decision(const KeywordResolver *r,const KeywordDecision *d,double lvl1,uint32_t *keyword,uint32_t *num)
+{
+  for (size_t n=0; n < d->num_values; ++n) {
+    const ValueDecision *v=&r->values[d->first_value+n];
+    if (fabs(lvl1-v->level_value) <= 1.e-6*fmax(1.,fabs(v->level_value))) {
+	*keyword=v->keyword;
+	*num=v->num;
+	return;
+    }
+  }
+  *keyword=d->keyword;
+  *num=d->num;
+}
+
+/* resolve_keywords fills 'result' with the CF standard name and GCMD UUIDs of
+**   a parameter at a level and returns 0, or returns 1 if the parameter isn't
+**   in the cache; the parameter is found as in lookup_parameter
+*/
+int resolve_keywords(const KeywordResolver *r,int center,int sub_center,int master_ver,int local_ver,int discipline,int category,int number,int lvl1_type,int lvl2_type,double lvl1,KeywordResult *result)
+{
+  const ParameterCache *cache=r->cache;
+  const ParameterCacheEntry *e=NULL;
+  int table=find_parameter_table(cache,center,sub_center,master_ver,local_ver);
+  if (table >= 0) {
+    e=find_parameter_entry(cache,table,discipline,category,number);
+  }
+  if (e == NULL || e->num_keywords == 0) {
+    const ParameterCacheEntry *master=find_master_entry(cache,master_ver,discipline,category,number);
+    if (master != NULL) {
+	e=master;
+    }
+  }
+  if (e == NULL) {
+    return 1;
+  }
+  size_t n=e-cache->entries;
+  size_t row=r->entry_row[n];
+  if (r->entry_rows[n]) {
+    row+=keyword_level_class(r,lvl1_type,lvl2_type);
+  }
+  uint32_t keyword,num;
+  apply_decision(r,&r->decisions[row*2],lvl1,&keyword,&num);
+  result->cf= (num > 0) ? &cache->strings[keyword] : NULL;
+  apply_decision(r,&r->decisions[row*2+1],lvl1,&keyword,&num);
+  result->gcmd= (num > 0) ? &r->uuids[keyword] : NULL;
+  result->num_gcmd=num;
+  return 0;
+}
+
+/* resolve_grid_keywords resolves the keywords of grid 'grid_number' of a GRIB2
+**   message
+*/
+int resolve_grid_keywords(const KeywordResolver *r,const GRIB2Message *msg,int grid_number,KeywordResult *result)
+{
+  const GRIB2Metadata *md=&msg->grids[grid_number].md;
+  return resolve_keywords(r,msg->center_id,msg->sub_center_id,msg->table_ver,msg->local_table_ver,msg->disc,md->param_cat,md->param_num,md->lvl1_type,md->lvl2_type,md->lvl1,result);
+}
@@ -0,0 +1,463 @@
+/*
+** File: parameter_cache.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**          18 Oct 2026 - check the tables, entries and string offsets of a
+**                        cache when it is opened; match a center's tables by
+**                        local version and the nearest master version; take
+**                        each missing field of a parameter from the first
+**                        table that has it
+**
+** Purpose: to look up GRIB2 parameter metadata (short names, descriptions,
+**          units, and CF and GCMD keywords) in a compiled parameter cache,
+**          without parsing the XML parameter tables
+**
+** Notes:   1) The cache is built from the tables/parameters tree by
+**             build_parameter_cache.c.  It is mapped into memory with mmap,
+**             and processes that open the same cache share its pages.  Every
+**             table, entry and keyword is checked once when the cache is
+**             opened, so that a damaged cache can't make a lookup read
+**             outside of it.
+**
+**          2) The cache is in the byte order of the machine that built it;
+**             open_parameter_cache refuses a cache with another byte order or
+**             another format version.  Rebuild the cache after updating the
+**             tables or this file.
+**
+**          3) A cache that is being used should be replaced by renaming a new
+**             file over it (build_parameter_cache does this), never by
+**             rewriting it in place.
+**
+** example C syntax for using the parameter cache:
+**    ParameterCache cache;
+**    ParameterInfo info;
+**
+**    if (open_parameter_cache("parameters.cache",&cache) != 0) {
+**      exit(1);
+**    }
+**    if (lookup_parameter(&cache,grib2_msg.center_id,grib2_msg.sub_center_id,
+**        grib2_msg.table_ver,grib2_msg.local_table_ver,grib2_msg.disc,
+**        grib2_msg.grids[n].md.param_cat,grib2_msg.grids[n].md.param_num,
+**        &info) == 0) {
+**      printf("%s (%s)\n",info.description,info.units);
+**    }
+**    ...
+**    close_parameter_cache(&cache);
+**
+** Layout of the cache (all offsets are in bytes from the start of the file,
+**   and each section starts on an 8-byte boundary):
+**   header:   ParameterCacheHeader
+**   tables:   a ParameterCacheTable for each parameter table, sorted by
+**               center, sub-center, master version and local version; the
+**               WMO master tables have center and sub-center 65535 and local
+**               version 255 (the GRIB2 missing values), so they sort last
+**   entries:  a ParameterCacheEntry for each parameter, grouped by table and
+**               sorted by code within each table
+**   keywords: the ParameterCacheKeywords of all of the entries, grouped by
+**               entry in the order they appear in the XML
+**   strings:  the string pool; every string is stored once and ends with a
+**               null, and offset 0 is the empty string
+*/
+#ifndef PARAMETER_CACHE_C
+#define PARAMETER_CACHE_C
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PARAMETER_CACHE_MAGIC "GRIBPTC"
+#define PARAMETER_CACHE_VERSION 1
+#define PARAMETER_CACHE_BYTE_ORDER 0x01020304
+
+#define CF_KEYWORD 1
+#define GCMD_KEYWORD 2
+
+/* ParameterCacheHeader is the first thing in the cache
+**   magic:        PARAMETER_CACHE_MAGIC
+**   version:      PARAMETER_CACHE_VERSION
+**   byte_order:   PARAMETER_CACHE_BYTE_ORDER, as written by the builder
+**   num_tables:   the number of parameter tables
+**   num_entries:  the number of parameters in all of the tables
+**   num_keywords: the number of keywords of all of the parameters
+**   *_off:        the offsets of the sections
+**   strings_len:  the length of the string pool
+**   file_size:    the length of the cache
+*/
+typedef struct {
+  char magic[8];
+  uint32_t version,byte_order;
+  uint32_t num_tables,num_entries,num_keywords;
+  uint32_t tables_off,entries_off,keywords_off,strings_off,strings_len;
+  uint32_t file_size;
+} ParameterCacheHeader;
+
+/* ParameterCacheTable describes one parameter table
+**   center, sub_center:     the originating center and sub-center, or 65535
+**   master_ver, local_ver:  the master and local table versions; local_ver is
+**                             255 for a WMO master table
+**   first_entry:            the index of the table's first entry
+**   num_entries:            the number of entries in the table
+**   title:                  the string offset of the table's title
+*/
+typedef struct {
+  uint16_t center,sub_center;
+  uint8_t master_ver,local_ver,unused[2];
+  uint32_t first_entry,num_entries,title;
+} ParameterCacheTable;
+
+/* ParameterCacheEntry describes one parameter
+**   code:                       discipline << 16 | category << 8 | number
+**   short_name, description,
+**     units:                    string offsets, 0 if the table has no value
+**   first_keyword:              the index of the first keyword
+**   num_keywords:               the number of keywords
+*/
+typedef struct {
+  uint32_t code;
+  uint32_t short_name,description,units;
+  uint32_t first_keyword,num_keywords;
+} ParameterCacheEntry;
+
+/* ParameterCacheKeyword is a CF or GCMD keyword of a parameter, which may only
+**   apply at some levels
+**   keyword:     the string offset of the keyword (GCMD keywords can be a
+**                  list of UUIDs separated by ';')
+**   type:        CF_KEYWORD or GCMD_KEYWORD
+**   lvl1_type:   the level type that the keyword applies to, or 255 for any
+**                  level
+**   lvl2_type:   the type of the second level of a layer that the keyword
+**                  applies to, or 255 if it applies to a single level
+**   has_value:   1 if the keyword only applies at 'level_value'
+**   level_value: the value of the (first) level, in the units of the level
+**                  type
+*/
+typedef struct {
+  uint32_t keyword;
+  uint8_t type,lvl1_type,lvl2_type,has_value;
+  double level_value;
+} ParameterCacheKeyword;
+
+/* ParameterCache is an open cache
+**   map:      the mapped cache
+**   map_size: the length of the mapping
+**   header:   the header of the cache
+**   tables, entries, keywords, strings: the sections of the cache
+*/
+typedef struct {
+  void *map;
+  size_t map_size;
+  const ParameterCacheHeader *header;
+  const ParameterCacheTable *tables;
+  const ParameterCacheEntry *entries;
+  const ParameterCacheKeyword *keywords;
+  const char *strings;
+} ParameterCache;
+
+/* ParameterInfo is the result of lookup_parameter; the pointers point into the
+**   cache and are valid until it is closed
+**   short_name, description, units: never NULL, but may be empty
+**   keywords:                      the keywords of the parameter
+**   num_keywords:                  the number of keywords
+*/
+typedef struct {
+  const char *short_name,*description,*units;
+  const ParameterCacheKeyword *keywords;
+  size_t num_keywords;
+} ParameterInfo;
+
+size_t align_parameter_cache_offset(size_t off)
+{
+  return (off+7) & ~(size_t)7;
+}
+
+unsigned long long parameter_table_key(int center,int sub_center,int master_ver,int local_ver)
+{
+  return (unsigned long long)center << 32 | (unsigned long long)sub_center << 16 | (unsigned long long)master_ver << 8 | (unsigned long long)local_ver;
+}
+
+/* check_parameter_cache returns 0 if the tables, entries and keywords of an
+**   open cache only refer to entries, keywords and strings that are in it, and
+**   the tables and their entries are in the order that the lookups expect, or
+**   returns 1 if they don't
+*/
+int check_parameter_cache(const ParameterCache *cache)
+{
+  const ParameterCacheHeader *h=cache->header;
+// every string, including the last one, has to end inside the pool
+  if (cache->strings[h->strings_len-1] != '\0') {
+    return 1;
+  }
+  for (size_t n=0; n < h->num_tables; ++n) {
+    const ParameterCacheTable *t=&cache->tables[n];
+    if (t->first_entry > h->num_entries || t->num_entries > h->num_entries-t->first_entry || t->title >= h->strings_len) {
+	return 1;
+    }
+    if (n > 0 && parameter_table_key(t[-1].center,t[-1].sub_center,t[-1].master_ver,t[-1].local_ver) >= parameter_table_key(t->center,t->sub_center,t->master_ver,t->local_ver)) {
+	return 1;
+    }
+    const ParameterCacheEntry *e=&cache->entries[t->first_entry];
+    for (size_t m=1; m < t->num_entries; ++m) {
+	if (e[m].code <= e[m-1].code) {
+	  return 1;
+	}
+    }
+  }
+  for (size_t n=0; n < h->num_entries; ++n) {
+    const ParameterCacheEntry *e=&cache->entries[n];
+    if (e->first_keyword > h->num_keywords || e->num_keywords > h->num_keywords-e->first_keyword || e->short_name >= h->strings_len || e->description >= h->strings_len || e->units >= h->strings_len) {
+	return 1;
+    }
+  }
+  for (size_t n=0; n < h->num_keywords; ++n) {
+    if (cache->keywords[n].keyword >= h->strings_len) {
+	return 1;
+    }
+  }
+  return 0;
+}
+
+/* open_parameter_cache maps the cache in 'path' into 'cache' and returns 0, or
+**   returns 1 if the cache can't be opened or isn't a valid cache
+*/
+int open_parameter_cache(const char *path,ParameterCache *cache)
+{
+  int fd=open(path,O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr,"Error opening parameter cache %s\n",path);
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd,&st) != 0 || (size_t)st.st_size < sizeof(ParameterCacheHeader)) {
+    fprintf(stderr,"Error: %s is not a parameter cache\n",path);
+    close(fd);
+    return 1;
+  }
+  cache->map_size=st.st_size;
+  cache->map=mmap(NULL,cache->map_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (cache->map == MAP_FAILED) {
+    fprintf(stderr,"Error mapping parameter cache %s\n",path);
+    return 1;
+  }
+  const ParameterCacheHeader *h=(const ParameterCacheHeader *)cache->map;
+  if (memcmp(h->magic,PARAMETER_CACHE_MAGIC,8) != 0) {
+    fprintf(stderr,"Error: %s is not a parameter cache\n",path);
+    munmap(cache->map,cache->map_size);
+    return 1;
+  }
+  if (h->byte_order != PARAMETER_CACHE_BYTE_ORDER || h->version != PARAMETER_CACHE_VERSION) {
+    fprintf(stderr,"Error: parameter cache %s was built with a different format version or byte order; rebuild it\n",path);
+    munmap(cache->map,cache->map_size);
+    return 1;
+  }
+// the sections must lie inside the file, so that a truncated cache can't be
+// read past its end
+  if (h->file_size != cache->map_size || h->tables_off+(size_t)h->num_tables*sizeof(ParameterCacheTable) > cache->map_size || h->entries_off+(size_t)h->num_entries*sizeof(ParameterCacheEntry) > cache->map_size || h->keywords_off+(size_t)h->num_keywords*sizeof(ParameterCacheKeyword) > cache->map_size || h->strings_len == 0 || h->strings_off+(size_t)h->strings_len > cache->map_size) {
+    fprintf(stderr,"Error: parameter cache %s is truncated or damaged\n",path);
+    munmap(cache->map,cache->map_size);
+    return 1;
+  }
+  const char *base=(const char *)cache->map;
+  cache->header=h;
+  cache->tables=(const ParameterCacheTable *)&base[h->tables_off];
+  cache->entries=(const ParameterCacheEntry *)&base[h->entries_off];
+  cache->keywords=(const ParameterCacheKeyword *)&base[h->keywords_off];
+  cache->strings=&base[h->strings_off];
+  if (check_parameter_cache(cache) != 0) {
+    fprintf(stderr,"Error: parameter cache %s is truncated or damaged\n",path);
+    munmap(cache->map,cache->map_size);
+    return 1;
+  }
+  return 0;
+}
+
+void close_parameter_cache(ParameterCache *cache)
+{
+  munmap(cache->map,cache->map_size);
+  cache->map=NULL;
+  cache->map_size=0;
+}
+
+/* find_parameter_table returns the index of the center's table with local
+**   version 'local_ver', or -1 if there isn't one; a center's local version
+**   doesn't depend on the master version, so the table for 'master_ver' is
+**   used if there is one, or else the newest one for an earlier master
+**   version, or else the oldest one for a later master version
+*/
+int find_parameter_table(const ParameterCache *cache,int center,int sub_center,int master_ver,int local_ver)
+{
+// find the center's first table
+  unsigned long long key=parameter_table_key(center,sub_center,0,0);
+  size_t lo=0,hi=cache->header->num_tables;
+  while (lo < hi) {
+    size_t mid=(lo+hi)/2;
+    const ParameterCacheTable *t=&cache->tables[mid];
+    if (parameter_table_key(t->center,t->sub_center,t->master_ver,t->local_ver) < key) {
+	lo=mid+1;
+    }
+    else {
+	hi=mid;
+    }
+  }
+// the center's tables are in order of master version
+  int table=-1;
+  for (size_t n=lo; n < cache->header->num_tables && cache->tables[n].center == center && cache->tables[n].sub_center == sub_center; ++n) {
+    const ParameterCacheTable *t=&cache->tables[n];
+    if (t->local_ver != local_ver) {
+	continue;
+    }
+    if (t->master_ver == master_ver) {
+	return n;
+    }
+    if (t->master_ver < master_ver) {
+	table=n;
+    }
+    else {
+	if (table < 0) {
+	  table=n;
+	}
+	break;
+    }
+  }
+  return table;
+}
+
+/* find_parameter_entry returns the entry for the discipline, category and
+**   number in the table at index 'table', or NULL if the table doesn't have one
+*/
+const ParameterCacheEntry *find_parameter_entry(const ParameterCache *cache,int table,int discipline,int category,int number)
+{
+  const ParameterCacheTable *t=&cache->tables[table];
+  uint32_t code=(uint32_t)discipline << 16 | (uint32_t)category << 8 | (uint32_t)number;
+  const ParameterCacheEntry *e=&cache->entries[t->first_entry];
+  size_t lo=0,hi=t->num_entries;
+  while (lo < hi) {
+    size_t mid=(lo+hi)/2;
+    if (e[mid].code < code) {
+	lo=mid+1;
+    }
+    else {
+	hi=mid;
+    }
+  }
+  return (lo < t->num_entries && e[lo].code == code) ? &e[lo] : NULL;
+}
+
+/* find_master_table returns the index of the 'n'-th WMO master table to search
+**   for a parameter, or -1 if there are fewer than n+1 of them; WMO parameters
+**   are never removed, so the oldest master table at or after 'master_ver' is
+**   searched first, then the later ones, and then the earlier ones from newest
+**   to oldest
+*/
+int find_master_table(const ParameterCache *cache,int master_ver,size_t n)
+{
+// the master tables are last, in order of version
+  size_t first=cache->header->num_tables;
+  while (first > 0 && cache->tables[first-1].local_ver == 255 && cache->tables[first-1].center == 65535) {
+    --first;
+  }
+  size_t start=first;
+  while (start < cache->header->num_tables && cache->tables[start].master_ver < master_ver) {
+    ++start;
+  }
+  if (n < cache->header->num_tables-start) {
+    return start+n;
+  }
+  n-=cache->header->num_tables-start;
+  return (n < start-first) ? (int)(start-1-n) : -1;
+}
+
+/* find_master_entry returns the entry for the parameter in the first WMO
+**   master table that has it, searched as in find_master_table, or NULL if
+**   none of them has it
+*/
+const ParameterCacheEntry *find_master_entry(const ParameterCache *cache,int master_ver,int discipline,int category,int number)
+{
+  int table;
+  for (size_t n=0; (table=find_master_table(cache,master_ver,n)) >= 0; ++n) {
+    const ParameterCacheEntry *e=find_parameter_entry(cache,table,discipline,category,number);
+    if (e != NULL) {
+	return e;
+    }
+  }
+  return NULL;
+}
+
+/* lookup_parameter fills 'info' with the metadata of a GRIB2 parameter and
+**   returns 0, or returns 1 if no table has the parameter; the center's own
+**   table is used first, and anything that it leaves out (e.g. the units) is
+**   taken from the first WMO master table that has it; a short name that the
+**   center's table leaves out is taken from the center's local version 0
+**   table, which names the WMO parameters that the center uses
+*/
+int lookup_parameter(const ParameterCache *cache,int center,int sub_center,int master_ver,int local_ver,int discipline,int category,int number,ParameterInfo *info)
+{
+  const ParameterCacheEntry *local=NULL,*names=NULL;
+  int table=find_parameter_table(cache,center,sub_center,master_ver,local_ver);
+  if (table >= 0) {
+    local=find_parameter_entry(cache,table,discipline,category,number);
+  }
+  if ((local == NULL || local->short_name == 0) && local_ver != 0 && (table=find_parameter_table(cache,center,sub_center,master_ver,0)) >= 0) {
+    names=find_parameter_entry(cache,table,discipline,category,number);
+  }
+  uint32_t short_name=0,description=0,units=0;
+  const ParameterCacheEntry *keywords=NULL;
+  int found=0;
+  if (local != NULL) {
+    short_name=local->short_name;
+    description=local->description;
+    units=local->units;
+    if (local->num_keywords > 0) {
+	keywords=local;
+    }
+    found=1;
+  }
+  if (names != NULL) {
+    short_name=names->short_name;
+    found=1;
+  }
+// the keywords of a parameter that the center's table doesn't have keywords
+// for come from the first master table that has the parameter, as in
+// resolve_keywords
+  for (size_t n=0; (short_name == 0 || description == 0 || units == 0 || keywords == NULL) && (table=find_master_table(cache,master_ver,n)) >= 0; ++n) {
+    const ParameterCacheEntry *master=find_parameter_entry(cache,table,discipline,category,number);
+    if (master == NULL) {
+	continue;
+    }
+    if (short_name == 0) {
+	short_name=master->short_name;
+    }
+    if (description == 0) {
+	description=master->description;
+    }
+    if (units == 0) {
+	units=master->units;
+    }
+    if (keywords == NULL) {
+	keywords=master;
+    }
+    found=1;
+  }
+  if (!found) {
+    return 1;
+  }
+  info->short_name=&cache->strings[short_name];
+  info->description=&cache->strings[description];
+  info->units=&cache->strings[units];
+  if (keywords != NULL) {
+    info->keywords=&cache->keywords[keywords->first_keyword];
+    info->num_keywords=keywords->num_keywords;
+  }
+  else {
+    info->keywords=cache->keywords;
+    info->num_keywords=0;
+  }
+  return 0;
+}
+
+#endif
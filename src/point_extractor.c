@@ -0,0 +1,580 @@
+/*
+** File: point_extractor.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**
+** Purpose: to extract the values of GRIB2 grids at a list of stations, with
+**          bilinear interpolation
+**
+** Notes:   1) The four gridpoints around each station and their weights are
+**             computed once for each grid definition and kept in the
+**             extractor, so every other grid on the same grid only costs a
+**             weighted sum per station.  Grid definitions are compared by the
+**             GDS values that unpack_GDS puts in the GRIB2Metadata.
+**
+**          2) When a grid with simple packing (DRS Template 5.0) has been left
+**             packed ('unpack_simple' set to 0 before unpacking the message),
+**             only the gridpoints around the stations are unpacked, straight
+**             from the packed data.  Other grids are read from their
+**             gridpoints.
+**
+**          3) Latitude/longitude (GDS Template 3.0), Mercator (3.10), Lambert
+**             conformal (3.30) and Gaussian (3.40) grids are supported.  The
+**             projections use a spherical earth, with a radius of 6367470 m
+**             for shape 0, 6371200 m for shape 8 and 6371229 m for the other
+**             shapes.
+**
+**          4) A gridpoint around a station that is missing (its bit in the
+**             bitmap is 0) doesn't count, and the weights of the others are
+**             scaled up; a station is missing if it is outside of the grid or
+**             all four of its gridpoints are missing.
+**
+**          5) This file includes unpackgrib2.c, which is guarded, so a program
+**             may also include it itself.  An extractor must not be used by
+**             more than one thread at the same time.
+**
+** example C syntax for using the extractor:
+**    PointExtractor extractor;
+**    double *values=(double *)malloc(num_stations*sizeof(double));
+**
+**    initialize_point_extractor(&extractor,lats,lons,num_stations);
+**    grib2_msg.unpack_simple=0;
+**    while (unpackgrib2(fp,&grib2_msg) != GRIB_EOF) {
+**      ...
+**      for (n=0; n < grib2_msg.num_grids; ++n) {
+**        if (extract_points(&extractor,&grib2_msg,n,values) == 0) {
+**          ... values[m] is the value at station m, or GRIB_MISSING_VALUE ...
+**        }
+**      }
+**    }
+**    free_point_extractor(&extractor);
+*/
+#ifndef POINT_EXTRACTOR_C
+#define POINT_EXTRACTOR_C
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "unpackgrib2.c"
+
+/* PointGrid holds the interpolation of the stations for one grid definition
+**   md:         the grid definition
+**   corners:    the four gridpoints around each station, as indexes into
+**                 'points', or SIZE_MAX for none
+**   weights:    the bilinear weight of each corner
+**   points:     the gridpoints that are around any station, in increasing
+**                 order of their position in the grid
+**   num_points: the number of gridpoints in 'points'
+*/
+typedef struct {
+  GRIB2Metadata md;
+  size_t *corners;
+  double *weights;
+  size_t *points;
+  size_t num_points;
+} PointGrid;
+
+/* PointExtractor extracts the values of grids at a list of stations
+**   lats, lons:        the location of each station
+**   num_stations:      the number of stations
+**   grids:             the interpolations that have been computed
+**   num_grids:         the number of grids in 'grids'
+**   grid_capacity:     the capacity of 'grids'
+**   point_values:      the values of the gridpoints of the grid that is being
+**                        extracted
+**   packed_offsets:    the offsets of the packed values of those gridpoints
+**   point_capacity:    the capacity of 'point_values' and 'packed_offsets'
+*/
+typedef struct {
+  double *lats,*lons;
+  size_t num_stations;
+  PointGrid *grids;
+  size_t num_grids,grid_capacity;
+  double *point_values;
+  size_t *packed_offsets;
+  size_t point_capacity;
+} PointExtractor;
+
+/* initialize_point_extractor copies the locations of the stations into the
+**   extractor; it returns 0, or GRIB_BAD_MESSAGE if they can't be allocated
+*/
+int initialize_point_extractor(PointExtractor *pe,const double *lats,const double *lons,size_t num_stations)
+{
+  pe->num_stations=num_stations;
+  pe->lats=(double *)malloc((num_stations+1)*sizeof(double));
+  pe->lons=(double *)malloc((num_stations+1)*sizeof(double));
+  pe->grids=NULL;
+  pe->num_grids=pe->grid_capacity=0;
+  pe->point_values=NULL;
+  pe->packed_offsets=NULL;
+  pe->point_capacity=0;
+  if (pe->lats == NULL || pe->lons == NULL) {
+    free(pe->lats);
+    free(pe->lons);
+    pe->lats=pe->lons=NULL;
+    pe->num_stations=0;
+    return GRIB_BAD_MESSAGE;
+  }
+  memcpy(pe->lats,lats,num_stations*sizeof(double));
+  memcpy(pe->lons,lons,num_stations*sizeof(double));
+  return 0;
+}
+
+void free_point_extractor(PointExtractor *pe)
+{
+  for (size_t n=0; n < pe->num_grids; ++n) {
+    free(pe->grids[n].corners);
+    free(pe->grids[n].weights);
+    free(pe->grids[n].points);
+  }
+  free(pe->grids);
+  free(pe->lats);
+  free(pe->lons);
+  free(pe->point_values);
+  free(pe->packed_offsets);
+  pe->grids=NULL;
+  pe->lats=pe->lons=NULL;
+  pe->point_values=NULL;
+  pe->packed_offsets=NULL;
+  pe->num_grids=pe->grid_capacity=pe->num_stations=pe->point_capacity=0;
+}
+
+/* same_grid_definition returns 1 if two grids have the same grid definition,
+**   otherwise 0
+*/
+int same_grid_definition(const GRIB2Metadata *a,const GRIB2Metadata *b)
+{
+  if (a->gds_templ_num != b->gds_templ_num || a->earth_shape != b->earth_shape || a->nx != b->nx || a->ny != b->ny || a->scan_mode != b->scan_mode || a->slat != b->slat || a->slon != b->slon || a->lats.elat != b->lats.elat || a->lons.elon != b->lons.elon || a->xinc.loinc != b->xinc.loinc || a->yinc.lainc != b->yinc.lainc) {
+    return 0;
+  }
+  switch (a->gds_templ_num) {
+    case 10:
+    {
+	return (a->latin1 == b->latin1);
+    }
+    case 30:
+    {
+	return (a->latin1 == b->latin1 && a->latin2 == b->latin2 && a->proj_flag == b->proj_flag);
+    }
+  }
+  return 1;
+}
+
+double earth_radius(int earth_shape)
+{
+  switch (earth_shape) {
+    case 0:
+    {
+	return 6367470.;
+    }
+    case 8:
+    {
+	return 6371200.;
+    }
+  }
+  return 6371229.;
+}
+
+/* gaussian_latitudes fills 'lats' with the latitudes, from north to south, of
+**   the 'nlat' rows of a global Gaussian grid, which are the zeros of the
+**   Legendre polynomial of degree 'nlat'
+*/
+void gaussian_latitudes(int nlat,double *lats)
+{
+  double pi=acos(-1.);
+  for (int n=0; n < nlat/2; ++n) {
+    double z=cos(pi*(n+0.75)/(nlat+0.5));
+    for (int iter=0; iter < 100; ++iter) {
+	double p1=1.,p2=0.;
+	for (int m=1; m <= nlat; ++m) {
+	  double p3=p2;
+	  p2=p1;
+	  p1=((2.*m-1.)*z*p2-(m-1.)*p3)/m;
+	}
+	double dz=p1/(nlat*(z*p1-p2)/(z*z-1.));
+	z-=dz;
+	if (fabs(dz) < 1.e-15) {
+	  break;
+	}
+    }
+    lats[n]=asin(z)*180./pi;
+    lats[nlat-1-n]=-lats[n];
+  }
+}
+
+/* normalize_longitude returns 'lon' in the range 0 to 360 */
+double normalize_longitude(double lon)
+{
+  lon=fmod(lon,360.);
+  return (lon < 0.) ? lon+360. : lon;
+}
+
+/* grid_coordinates finds the column 'x' and the row 'y', as fractions, of a
+**   location on a grid; 'rows' has the latitude of each row of a Gaussian grid
+*/
+void grid_coordinates(const GRIB2Metadata *md,const double *rows,double lat,double lon,double *x,double *y)
+{
+  double rad=acos(-1.)/180.;
+  double radius=earth_radius(md->earth_shape);
+  switch (md->gds_templ_num) {
+    case 0:
+    case 40:
+    {
+	double dlon=md->xinc.loinc;
+	*x= ((md->scan_mode & 0x80) == 0) ? normalize_longitude(lon-md->slon)/dlon : normalize_longitude(md->slon-lon)/dlon;
+/* a location just before the first column is at a small negative x */
+	if (*x > md->nx-1 && fabs(md->nx*dlon-360.) >= dlon/2. && *x-360./dlon > -1.e-6) {
+	  *x-=360./dlon;
+	}
+	if (md->gds_templ_num == 0) {
+	  double dlat= (md->lats.elat >= md->slat) ? md->yinc.lainc : -md->yinc.lainc;
+	  *y= (md->ny > 1) ? (lat-md->slat)/dlat : 0.;
+	}
+	else {
+/* find the two rows around the latitude; the rows are in order, either
+**   increasing or decreasing */
+	  int dir= (rows[md->ny-1] > rows[0]) ? 1 : -1;
+	  if (md->ny == 1) {
+	    *y= (fabs(lat-rows[0]) < 1.e-6) ? 0. : -1.;
+	    break;
+	  }
+	  if ((lat-rows[0])*dir < 0. || (lat-rows[md->ny-1])*dir > 0.) {
+	    *y=-1.;
+	    break;
+	  }
+	  int lo=0,hi=md->ny-1;
+	  while (hi-lo > 1) {
+	    int mid=(lo+hi)/2;
+	    if ((lat-rows[mid])*dir >= 0.) {
+		lo=mid;
+	    }
+	    else {
+		hi=mid;
+	    }
+	  }
+	  *y=lo+(lat-rows[lo])/(rows[hi]-rows[lo]);
+	}
+	break;
+    }
+    case 10:
+    {
+	double scale=radius*cos(md->latin1*rad);
+	double dlon= ((md->scan_mode & 0x80) == 0) ? normalize_longitude(lon-md->slon) : normalize_longitude(md->slon-lon);
+	*x=scale*dlon*rad/md->xinc.dxinc;
+	*y=scale*(log(tan((45.+lat/2.)*rad))-log(tan((45.+md->slat/2.)*rad)))/md->yinc.dyinc;
+	if ((md->scan_mode & 0x40) == 0) {
+	  *y=-*y;
+	}
+	break;
+    }
+    case 30:
+    {
+	double quarter_pi=atan(1.);
+	double phi1=md->latin1*rad,phi2=md->latin2*rad;
+	double n= (fabs(md->latin1-md->latin2) < 1.e-6) ? sin(phi1) : log(cos(phi1)/cos(phi2))/log(tan(quarter_pi+phi2/2.)/tan(quarter_pi+phi1/2.));
+	double f=cos(phi1)*pow(tan(quarter_pi+phi1/2.),n)/n;
+	double rho=radius*f/pow(tan(quarter_pi+lat*rad/2.),n);
+	double rho0=radius*f/pow(tan(quarter_pi+md->slat*rad/2.),n);
+	double theta=n*(normalize_longitude(lon-md->lons.lov+180.)-180.)*rad;
+	double theta0=n*(normalize_longitude(md->slon-md->lons.lov+180.)-180.)*rad;
+	*x=(rho*sin(theta)-rho0*sin(theta0))/md->xinc.dxinc;
+	*y=(rho0*cos(theta0)-rho*cos(theta))/md->yinc.dyinc;
+	if ((md->scan_mode & 0x80) != 0) {
+	  *x=-*x;
+	}
+	if ((md->scan_mode & 0x40) == 0) {
+	  *y=-*y;
+	}
+	break;
+    }
+  }
+}
+
+/* point_index returns the position in the grid of the gridpoint in column 'i'
+**   and row 'j'
+*/
+size_t point_index(const GRIB2Metadata *md,size_t i,size_t j)
+{
+  if ((md->scan_mode & 0x20) == 0) {
+    if ((md->scan_mode & 0x10) != 0 && (j % 2) == 1) {
+	i=md->nx-1-i;
+    }
+    return j*md->nx+i;
+  }
+  if ((md->scan_mode & 0x10) != 0 && (i % 2) == 1) {
+    j=md->ny-1-j;
+  }
+  return i*md->ny+j;
+}
+
+int compare_points(const void *a,const void *b)
+{
+  size_t pa=*(const size_t *)a,pb=*(const size_t *)b;
+  return (pa < pb) ? -1 : (pa > pb);
+}
+
+/* build_point_grid computes the corners and weights of the stations on the grid
+**   described by 'md'
+*/
+int build_point_grid(PointExtractor *pe,GRIB2Message *grib2_msg,const GRIB2Metadata *md,PointGrid *pg)
+{
+  switch (md->gds_templ_num) {
+    case 0:
+    case 10:
+    case 30:
+    case 40:
+    {
+	break;
+    }
+    default:
+    {
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"points can't be extracted from grids with GDS Template 3.%d",md->gds_templ_num);
+    }
+  }
+  if ((md->gds_templ_num == 0 && (md->xinc.loinc <= 0. || (md->ny > 1 && md->yinc.lainc <= 0.))) || (md->gds_templ_num == 40 && (md->xinc.loinc <= 0. || md->yinc.lainc < 1. || md->ny > 2*md->yinc.lainc)) || ((md->gds_templ_num == 10 || md->gds_templ_num == 30) && (md->xinc.dxinc <= 0. || md->yinc.dyinc <= 0.))) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid definition is not valid");
+  }
+  double *rows=NULL;
+  if (md->gds_templ_num == 40) {
+/* the rows of the grid are a run of the rows of the global grid, starting at
+**   the one that is nearest to the first latitude */
+    int nlat=2*md->yinc.lainc;
+    double *lats=(double *)malloc(nlat*sizeof(double));
+    rows=(double *)malloc(md->ny*sizeof(double));
+    if (lats == NULL || rows == NULL) {
+	free(lats);
+	free(rows);
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the latitudes of the grid");
+    }
+    gaussian_latitudes(nlat,lats);
+    int first=0;
+    for (int n=1; n < nlat; ++n) {
+	if (fabs(lats[n]-md->slat) < fabs(lats[first]-md->slat)) {
+	  first=n;
+	}
+    }
+    int dir= (md->lats.elat <= md->slat) ? 1 : -1;
+    if (first+dir*(md->ny-1) < 0 || first+dir*(md->ny-1) >= nlat) {
+	free(lats);
+	free(rows);
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid definition is not valid");
+    }
+    for (int n=0; n < md->ny; ++n) {
+	rows[n]=lats[first+dir*n];
+    }
+    free(lats);
+  }
+  pg->md=*md;
+  pg->corners=(size_t *)malloc((4*pe->num_stations+1)*sizeof(size_t));
+  pg->weights=(double *)malloc((4*pe->num_stations+1)*sizeof(double));
+  pg->points=(size_t *)malloc((4*pe->num_stations+1)*sizeof(size_t));
+  if (pg->corners == NULL || pg->weights == NULL || pg->points == NULL) {
+    free(rows);
+    free(pg->corners);
+    free(pg->weights);
+    free(pg->points);
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the weights of %zu stations",pe->num_stations);
+  }
+  int global= (md->gds_templ_num == 0 || md->gds_templ_num == 40) && fabs(md->nx*md->xinc.loinc-360.) < md->xinc.loinc/2.;
+  for (size_t n=0; n < pe->num_stations; ++n) {
+    size_t *corners=&pg->corners[n*4];
+    double *weights=&pg->weights[n*4];
+    for (size_t m=0; m < 4; ++m) {
+	corners[m]=SIZE_MAX;
+	weights[m]=0.;
+    }
+    double x,y;
+    grid_coordinates(md,rows,pe->lats[n],pe->lons[n],&x,&y);
+    if (x > -1.e-6 && x < md->nx-1+1.e-6) {
+	x= (x < 0.) ? 0. : ((x > md->nx-1) ? md->nx-1 : x);
+    }
+    else if (!global || x < 0. || x >= md->nx) {
+	continue;
+    }
+    if (y > -1.e-6 && y < md->ny-1+1.e-6) {
+	y= (y < 0.) ? 0. : ((y > md->ny-1) ? md->ny-1 : y);
+    }
+    else {
+	continue;
+    }
+/* the gridpoints to the east of the last column of a global grid are in the
+**   first column */
+    size_t i0=floor(x),j0=floor(y);
+    double fx=x-i0,fy=y-j0;
+    size_t i1= (i0+1 < (size_t)md->nx) ? i0+1 : ((global) ? 0 : i0);
+    size_t j1= (j0+1 < (size_t)md->ny) ? j0+1 : j0;
+    corners[0]=point_index(md,i0,j0);
+    corners[1]=point_index(md,i1,j0);
+    corners[2]=point_index(md,i0,j1);
+    corners[3]=point_index(md,i1,j1);
+    weights[0]=(1.-fx)*(1.-fy);
+    weights[1]=fx*(1.-fy);
+    weights[2]=(1.-fx)*fy;
+    weights[3]=fx*fy;
+  }
+  free(rows);
+/* replace the gridpoints with their index in the sorted list of gridpoints */
+  size_t num_points=0;
+  for (size_t n=0; n < 4*pe->num_stations; ++n) {
+    if (pg->corners[n] != SIZE_MAX) {
+	pg->points[num_points++]=pg->corners[n];
+    }
+  }
+  qsort(pg->points,num_points,sizeof(size_t),compare_points);
+  pg->num_points=0;
+  for (size_t n=0; n < num_points; ++n) {
+    if (n == 0 || pg->points[n] != pg->points[pg->num_points-1]) {
+	pg->points[pg->num_points++]=pg->points[n];
+    }
+  }
+  for (size_t n=0; n < 4*pe->num_stations; ++n) {
+    if (pg->corners[n] != SIZE_MAX) {
+	size_t *p=(size_t *)bsearch(&pg->corners[n],pg->points,pg->num_points,sizeof(size_t),compare_points);
+	pg->corners[n]=p-pg->points;
+    }
+  }
+  return 0;
+}
+
+/* find_point_grid sets 'pg' to the interpolation of the stations for the grid
+**   definition 'md', computing it if this is the first grid on that grid
+*/
+int find_point_grid(PointExtractor *pe,GRIB2Message *grib2_msg,const GRIB2Metadata *md,PointGrid **pg)
+{
+  for (size_t n=pe->num_grids; n > 0; --n) {
+    if (same_grid_definition(&pe->grids[n-1].md,md)) {
+	*pg=&pe->grids[n-1];
+	return 0;
+    }
+  }
+  if (pe->num_grids == pe->grid_capacity) {
+    size_t capacity= (pe->grid_capacity > 0) ? pe->grid_capacity*2 : 4;
+    PointGrid *grids=(PointGrid *)realloc(pe->grids,capacity*sizeof(PointGrid));
+    if (grids == NULL) {
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the grid definitions");
+    }
+    pe->grids=grids;
+    pe->grid_capacity=capacity;
+  }
+  int status;
+  if ( (status=build_point_grid(pe,grib2_msg,md,&pe->grids[pe->num_grids])) != 0) {
+    return status;
+  }
+  *pg=&pe->grids[pe->num_grids++];
+  return 0;
+}
+
+/* unpack_packed_points unpacks the gridpoints of 'pg' straight from the packed
+**   data of a grid with simple packing; with a bitmap, the packed value of each
+**   gridpoint is found by counting the bits that are set in the bitmap since
+**   the previous one
+*/
+int unpack_packed_points(PointExtractor *pe,GRIB2Message *grib2_msg,const GRIB2Metadata *md,const PointGrid *pg)
+{
+  int status;
+  if ( (status=check_grid_values(grib2_msg,md,0,NULL)) != 0) {
+    return status;
+  }
+  const unsigned char *bits= (md->bitmap != NULL) ? &grib2_msg->buffer[md->bms_off/8+6] : NULL;
+  size_t pos=0,count=0,num_values=0;
+  for (size_t n=0; n < pg->num_points; ++n) {
+    size_t p=pg->points[n];
+    if (bits == NULL) {
+	pe->packed_offsets[n]=p;
+	num_values=p+1;
+    }
+    else {
+	count+=grib2_count_bits(bits,pos,p);
+	pos=p;
+	if (((bits[p/8] >> (7-(p & 7))) & 0x1) == 1) {
+	  pe->packed_offsets[n]=count;
+	  num_values=count+1;
+	}
+	else {
+	  pe->packed_offsets[n]=SIZE_MAX;
+	}
+    }
+  }
+  if ( (status=check_data_length(grib2_msg,md,num_values,md->pack_width)) != 0) {
+    return status;
+  }
+  float D=pow(10.,md->D);
+  float E=pow(2.,md->E);
+  for (size_t n=0; n < pg->num_points; ++n) {
+    if (pe->packed_offsets[n] == SIZE_MAX) {
+	pe->point_values[n]=GRIB_MISSING_VALUE;
+    }
+    else {
+	int pval=0;
+	if (md->pack_width > 0) {
+	  get_bits(grib2_msg->buffer,&pval,md->ds_off+40+pe->packed_offsets[n]*md->pack_width,md->pack_width);
+	}
+	pe->point_values[n]=md->R+pval*E/D;
+    }
+  }
+  return 0;
+}
+
+/* extract_points fills 'values', which must hold a value for each station,
+**   with the values of grid 'grid_num' of a message at the stations; it returns
+**   0, or a status code with the reason in the 'error' of the message
+*/
+int extract_points(PointExtractor *pe,GRIB2Message *grib2_msg,int grid_num,double *values)
+{
+  GRIB2Grid *grid=&grib2_msg->grids[grid_num];
+  PointGrid *pg;
+  int status;
+  if ( (status=find_point_grid(pe,grib2_msg,&grid->md,&pg)) != 0) {
+    return status;
+  }
+  if (pg->num_points > pe->point_capacity) {
+    free(pe->point_values);
+    free(pe->packed_offsets);
+    pe->point_values=(double *)malloc(pg->num_points*sizeof(double));
+    pe->packed_offsets=(size_t *)malloc(pg->num_points*sizeof(size_t));
+    if (pe->point_values == NULL || pe->packed_offsets == NULL) {
+	free(pe->point_values);
+	free(pe->packed_offsets);
+	pe->point_values=NULL;
+	pe->packed_offsets=NULL;
+	pe->point_capacity=0;
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu gridpoints",pg->num_points);
+    }
+    pe->point_capacity=pg->num_points;
+  }
+  if (grid->md.drs_templ_num == 0 && grib2_msg->unpack_simple == 0) {
+    if ( (status=unpack_packed_points(pe,grib2_msg,&grid->md,pg)) != 0) {
+	return status;
+    }
+  }
+  else {
+    if (grid->gridpoints == NULL) {
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid has not been unpacked");
+    }
+    for (size_t n=0; n < pg->num_points; ++n) {
+	pe->point_values[n]=grid->gridpoints[pg->points[n]];
+    }
+  }
+  for (size_t n=0; n < pe->num_stations; ++n) {
+    const size_t *corners=&pg->corners[n*4];
+    const double *weights=&pg->weights[n*4];
+    double sum=0.,wsum=0.;
+    for (size_t m=0; m < 4; ++m) {
+	if (corners[m] != SIZE_MAX && pe->point_values[corners[m]] != GRIB_MISSING_VALUE) {
+	  sum+=weights[m]*pe->point_values[corners[m]];
+	  wsum+=weights[m];
+	}
+    }
+    if (wsum > 0.) {
+	values[n]=sum/wsum;
+    }
+    else {
+	values[n]=GRIB_MISSING_VALUE;
+    }
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,511 @@
+/*
+** File: time_series.c
+**
+** Revision History:
+**          18 Oct 2026 - first version
+**          18 Oct 2026 - extract_time_series returns an error instead of
+**                        exiting when it runs out of memory, and frees the
+**                        messages of its threads
+**
+** Purpose: to extract time series of a GRIB2 parameter at a list of stations,
+**          or in a latitude/longitude box, from many GRIB2 files
+**
+** Notes:   1) The grids are found with the index of each file (see
+**             grib2_index.c), and only the messages that hold a matching grid
+**             are read; within a file they are read in the order in which
+**             they are in the file, so the reads stay sequential.  Compiled
+**             with -DPTHREADS, the files are read at the same time on the
+**             task scheduler, and the large grids of a file can also be
+**             unpacked in parallel chunks on the same threads.
+**
+**          2) The values at stations are interpolated with a PointExtractor,
+**             which only unpacks the gridpoints around the stations from grids
+**             with simple packing.  A box is unpacked with
+**             unpack_simple_subset from grids with simple packing, and copied
+**             out of the unpacked grid otherwise; it must be on a
+**             latitude/longitude grid (GDS Template 3.0), and the box must
+**             have the same number of gridpoints in every grid.
+**
+**          3) The result is columnar: the values of each column (a station,
+**             or a gridpoint of the box) are together, in order of time.  The
+**             times are sorted by valid time and then by reference time, and
+**             grids with the same times stay in the order of the files.
+**
+**          4) Grids that can't be read are skipped with a warning.  When the
+**             extraction threads can't be started, the files are read one at
+**             a time.
+**
+** example C syntax for extracting a time series:
+**    TimeSeriesQuery query;
+**    TimeSeries ts;
+**    double lat=40.,lon=-105.;
+**
+**    initialize_time_series_query(&query);
+**    query.match.disc=0;
+**    query.match.param_cat=0;
+**    query.match.param_num=0;
+**    query.lats=&lat;
+**    query.lons=&lon;
+**    query.num_stations=1;
+**    if (extract_time_series(&query,files,num_files,num_threads,&ts) == 0) {
+**      for (n=0; n < ts.num_times; ++n) {
+**        ... ts.valid_times[n] and ts.values[m*ts.num_times+n] is the value
+**            of column m ...
+**      }
+**      free_time_series(&ts);
+**    }
+*/
+#ifndef TIME_SERIES_C
+#define TIME_SERIES_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_index.c"
+#include "point_extractor.c"
+
+/* TimeSeriesQuery describes a time series
+**   match:         the grids of the time series
+**   lats, lons:    the locations of the stations
+**   num_stations:  the number of stations, or 0 for a box
+**   south, north,
+**     west, east:  the box, which crosses the date line if 'east' is less than
+**                    'west'
+**   save_indexes:  1 to save the indexes that have to be made, otherwise 0
+*/
+typedef struct {
+  GRIB2Match match;
+  const double *lats,*lons;
+  size_t num_stations;
+  double south,north,west,east;
+  int save_indexes;
+} TimeSeriesQuery;
+
+/* TimeSeries is an extracted time series
+**   num_times:    the number of times
+**   num_columns:  the number of stations, or of gridpoints in the box
+**   ni, nj:       the number of columns and rows of the box (the gridpoints of
+**                   the box are in rows, from the first row of the grid)
+**   valid_times,
+**     ref_times:  the valid and reference time of each time, as
+**                   YYYYMMDDHHMMSS
+**   values:       num_columns*num_times values; column m is at
+**                   values[m*num_times], and missing values are
+**                   GRIB_MISSING_VALUE
+*/
+typedef struct {
+  size_t num_times,num_columns;
+  size_t ni,nj;
+  long long *valid_times,*ref_times;
+  double *values;
+} TimeSeries;
+
+/* FileSeries holds the part of a time series that comes from one file
+**   path:         the file
+**   valid_times,
+**     ref_times:  the times of the grids
+**   values:       the values of each grid, in rows of 'num_columns'
+**   num_rows:     the number of grids
+**   capacity:     the capacity of the arrays
+**   num_columns:  the number of values in each row
+**   ni, nj:       the shape of the box
+**   status:       0, or 1 if the file couldn't be read
+*/
+typedef struct {
+  const char *path;
+  long long *valid_times,*ref_times;
+  double *values;
+  size_t num_rows,capacity,num_columns;
+  size_t ni,nj;
+  int status;
+} FileSeries;
+
+/* SeriesWorker holds the buffers of one thread
+**   msg:        the message that the files are read into
+**   extractor:  interpolates the stations
+*/
+typedef struct {
+  GRIB2Message msg;
+  PointExtractor extractor;
+} SeriesWorker;
+
+/* SeriesRun is what every file of an extraction needs
+**   query:    the time series
+**   workers:  a SeriesWorker for each thread
+**   files:    a FileSeries for each file
+*/
+typedef struct {
+  const TimeSeriesQuery *query;
+  SeriesWorker *workers;
+  FileSeries *files;
+} SeriesRun;
+
+/* SeriesTask is the extraction from one file */
+typedef struct {
+  SeriesRun *run;
+  FileSeries *file;
+} SeriesTask;
+
+void initialize_time_series_query(TimeSeriesQuery *query)
+{
+  query->match.disc=query->match.param_cat=query->match.param_num=GRIB_ANY;
+  query->match.lvl1_type=query->match.lvl2_type=GRIB_ANY;
+  query->match.lvl1=query->match.lvl2=GRIB_ANY;
+  query->match.gen_proc=query->match.time_unit=query->match.fcst_time=GRIB_ANY;
+  query->match.perturb_num=GRIB_ANY;
+  query->lats=query->lons=NULL;
+  query->num_stations=0;
+  query->south=-90.;
+  query->north=90.;
+  query->west=0.;
+  query->east=360.;
+  query->save_indexes=1;
+}
+
+void free_time_series(TimeSeries *ts)
+{
+  free(ts->valid_times);
+  free(ts->ref_times);
+  free(ts->values);
+  ts->valid_times=ts->ref_times=NULL;
+  ts->values=NULL;
+  ts->num_times=ts->num_columns=0;
+}
+
+/* copy_grid_subset copies the gridpoints of a box out of an unpacked grid, in
+**   the same order as unpack_simple_subset
+*/
+int copy_grid_subset(GRIB2Message *grib2_msg,int grid_num,const GRIB2Subset *subset,double *values)
+{
+  const GRIB2Metadata *md=&grib2_msg->grids[grid_num].md;
+  const double *gridpoints=grib2_msg->grids[grid_num].gridpoints;
+  if ((md->scan_mode & 0x10) != 0) {
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"subsets can't be unpacked from grids whose rows alternate direction");
+  }
+  if (gridpoints == NULL) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid has not been unpacked");
+  }
+  size_t nx=md->nx,ny=md->ny;
+  for (size_t j=subset->j1; j <= (size_t)subset->j2; ++j) {
+    double *row=&values[(j-subset->j1)*subset->ni];
+    for (size_t k=0; k < subset->ni; ++k) {
+	size_t i=(subset->i1+k) % nx;
+	row[k]= ((md->scan_mode & 0x20) == 0) ? gridpoints[j*nx+i] : gridpoints[i*ny+j];
+    }
+  }
+  return 0;
+}
+
+/* add_series_row makes room for one more grid in 'file', and returns its row
+**   of values, or NULL if there isn't enough memory
+*/
+double *add_series_row(FileSeries *file,size_t num_columns)
+{
+  if (file->num_rows == 0) {
+    file->num_columns=num_columns;
+  }
+  if (file->num_rows == file->capacity) {
+    size_t capacity= (file->capacity > 0) ? file->capacity*2 : 16;
+    long long *valid_times=(long long *)realloc(file->valid_times,capacity*sizeof(long long));
+    if (valid_times != NULL) {
+	file->valid_times=valid_times;
+    }
+    long long *ref_times=(long long *)realloc(file->ref_times,capacity*sizeof(long long));
+    if (ref_times != NULL) {
+	file->ref_times=ref_times;
+    }
+    double *values=(double *)realloc(file->values,capacity*num_columns*sizeof(double));
+    if (values != NULL) {
+	file->values=values;
+    }
+    if (valid_times == NULL || ref_times == NULL || values == NULL) {
+	return NULL;
+    }
+    file->capacity=capacity;
+  }
+  return &file->values[file->num_rows*num_columns];
+}
+
+/* extract_grid adds grid 'grid_num' of the message in 'worker' to 'file' */
+int extract_grid(const TimeSeriesQuery *query,SeriesWorker *worker,FileSeries *file,int grid_num)
+{
+  GRIB2Message *grib2_msg=&worker->msg;
+  const GRIB2Metadata *md=&grib2_msg->grids[grid_num].md;
+  double *row;
+  int status;
+  if (query->num_stations > 0) {
+    if ( (row=add_series_row(file,query->num_stations)) == NULL) {
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the time series");
+    }
+    if ( (status=extract_points(&worker->extractor,grib2_msg,grid_num,row)) != 0) {
+	return status;
+    }
+  }
+  else {
+    GRIB2Subset subset;
+    if ( (status=grib2_latlon_subset(grib2_msg,grid_num,query->south,query->north,query->west,query->east,&subset)) != 0) {
+	return status;
+    }
+    if (file->num_rows > 0 && (subset.ni != file->ni || subset.nj != file->nj)) {
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"the box is %zux%zu gridpoints in this grid, but %zux%zu in an earlier one",subset.ni,subset.nj,file->ni,file->nj);
+    }
+    if ( (row=add_series_row(file,subset.ni*subset.nj)) == NULL) {
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the time series");
+    }
+    file->ni=subset.ni;
+    file->nj=subset.nj;
+    if (md->drs_templ_num == 0 && grib2_msg->unpack_simple == 0) {
+	status=unpack_simple_subset(grib2_msg,grid_num,&subset,row);
+    }
+    else {
+	status=copy_grid_subset(grib2_msg,grid_num,&subset,row);
+    }
+    if (status != 0) {
+	return status;
+    }
+  }
+  file->ref_times[file->num_rows]=(((long long)grib2_msg->yr*100+grib2_msg->mo)*100+grib2_msg->dy)*1000000+grib2_msg->time;
+  file->valid_times[file->num_rows]=grib2_valid_time(grib2_msg,md);
+  ++file->num_rows;
+  return 0;
+}
+
+/* extract_file adds the matching grids of one file to 'file' */
+void extract_file(const TimeSeriesQuery *query,SeriesWorker *worker,FileSeries *file)
+{
+  GRIB2Message *grib2_msg=&worker->msg;
+  GRIB2Index index;
+  if (open_grib2_index(file->path,query->save_indexes,grib2_msg,&index) != 0) {
+    file->status=1;
+    return;
+  }
+  FILE *fp;
+  if ( (fp=fopen(file->path,"rb")) == NULL) {
+    fprintf(stderr,"Error opening %s\n",file->path);
+    free_grib2_index(&index);
+    file->status=1;
+    return;
+  }
+/* the index is in the order of the file, so the messages are read in order;
+**   each message is read once, and the filter of the message only unpacks its
+**   matching grids */
+  uint64_t last_offset=UINT64_MAX;
+  for (size_t n=0; n < index.num_entries; ++n) {
+    const GRIB2IndexEntry *e=&index.entries[n];
+    if (e->offset == last_offset || !grib2_index_matches(e,&query->match)) {
+	continue;
+    }
+    last_offset=e->offset;
+    int status;
+    if (fseek(fp,e->offset,SEEK_SET) != 0 || (status=unpack_IS(fp,grib2_msg)) == GRIB_EOF || status == GRIB_READ_ERROR) {
+	fprintf(stderr,"Read error in %s at offset %llu\n",file->path,(unsigned long long)e->offset);
+	file->status=1;
+	break;
+    }
+    if (status != 0 || (status=unpack_sections(grib2_msg)) != 0) {
+	fprintf(stderr,"Warning: skipping the message at offset %llu of %s: %s\n",(unsigned long long)e->offset,file->path,grib2_msg->error);
+	continue;
+    }
+    for (int m=0; m < grib2_msg->num_grids; ++m) {
+	if (extract_grid(query,worker,file,m) != 0) {
+	  fprintf(stderr,"Warning: skipping grid %d of the message at offset %llu of %s: %s\n",m+1,(unsigned long long)e->offset,file->path,grib2_msg->error);
+	}
+    }
+  }
+  fclose(fp);
+  free_grib2_index(&index);
+}
+
+/* initialize_series_worker returns 0, or 1 if the stations can't be
+**   allocated; the worker can be freed with free_series_worker either way
+*/
+int initialize_series_worker(const TimeSeriesQuery *query,SeriesWorker *worker,int num_threads)
+{
+  initialize(&worker->msg);
+  worker->msg.num_threads=num_threads;
+  worker->msg.unpack_simple=0;
+  worker->msg.matches=&query->match;
+  worker->msg.num_matches=1;
+  if (initialize_point_extractor(&worker->extractor,query->lats,query->lons,query->num_stations) != 0) {
+    fprintf(stderr,"Error allocating %zu stations\n",query->num_stations);
+    return 1;
+  }
+  return 0;
+}
+
+void free_series_worker(SeriesWorker *worker)
+{
+  free_grib2_message(&worker->msg);
+  free_point_extractor(&worker->extractor);
+}
+
+/* free_series_run frees the files and the first 'num_workers' workers of a run
+*/
+void free_series_run(SeriesRun *run,size_t num_files,int num_workers)
+{
+  if (run->files != NULL) {
+    for (size_t n=0; n < num_files; ++n) {
+	free(run->files[n].valid_times);
+	free(run->files[n].ref_times);
+	free(run->files[n].values);
+    }
+    free(run->files);
+  }
+  if (run->workers != NULL) {
+    for (int n=0; n < num_workers; ++n) {
+	free_series_worker(&run->workers[n]);
+    }
+    free(run->workers);
+  }
+}
+
+#ifdef PTHREADS
+void series_task(void *t)
+{
+  SeriesTask *task=(SeriesTask *)t;
+  extract_file(task->run->query,&task->run->workers[grib_worker_id()],task->file);
+}
+#endif
+
+/* SeriesRow identifies one grid of a time series, for sorting */
+typedef struct {
+  long long valid_time,ref_time;
+  size_t file,row;
+} SeriesRow;
+
+int compare_series_rows(const void *a,const void *b)
+{
+  const SeriesRow *ra=(const SeriesRow *)a,*rb=(const SeriesRow *)b;
+  if (ra->valid_time != rb->valid_time) {
+    return (ra->valid_time < rb->valid_time) ? -1 : 1;
+  }
+  if (ra->ref_time != rb->ref_time) {
+    return (ra->ref_time < rb->ref_time) ? -1 : 1;
+  }
+  if (ra->file != rb->file) {
+    return (ra->file < rb->file) ? -1 : 1;
+  }
+  return (ra->row < rb->row) ? -1 : (ra->row > rb->row);
+}
+
+/* extract_time_series fills 'ts' with the time series described by 'query'
+**   from the files in 'paths', on 'num_threads' threads; it returns 0, or 1 if
+**   any of the files couldn't be read (the time series then has the grids of
+**   the other files), or 2 if the time series couldn't be extracted at all (it
+**   is then empty, and doesn't need to be freed)
+*/
+int extract_time_series(const TimeSeriesQuery *query,char **paths,size_t num_files,int num_threads,TimeSeries *ts)
+{
+  memset(ts,0,sizeof(TimeSeries));
+  SeriesRun run;
+  run.query=query;
+  run.files=(FileSeries *)calloc(num_files+1,sizeof(FileSeries));
+  if (num_threads < 1) {
+    num_threads=1;
+  }
+#ifndef PTHREADS
+  num_threads=1;
+#endif
+  run.workers=(SeriesWorker *)malloc(num_threads*sizeof(SeriesWorker));
+  if (run.files == NULL || run.workers == NULL) {
+    fprintf(stderr,"Error allocating the time series of %zu files\n",num_files);
+    free_series_run(&run,num_files,0);
+    return 2;
+  }
+  for (int n=0; n < num_threads; ++n) {
+    if (initialize_series_worker(query,&run.workers[n],num_threads) != 0) {
+	free_series_run(&run,num_files,n+1);
+	return 2;
+    }
+  }
+  for (size_t n=0; n < num_files; ++n) {
+    run.files[n].path=paths[n];
+  }
+  int serial=1;
+#ifdef PTHREADS
+  GRIBScheduler *scheduler=grib_scheduler_create(num_threads);
+  SeriesTask *tasks=(SeriesTask *)malloc((num_files+1)*sizeof(SeriesTask));
+  if (scheduler != NULL && tasks != NULL) {
+    GRIBTaskGroup group;
+    grib_task_group_init(&group);
+    for (size_t n=0; n < num_files; ++n) {
+	tasks[n].run=&run;
+	tasks[n].file=&run.files[n];
+	grib_task_spawn(scheduler,&group,series_task,&tasks[n]);
+    }
+    grib_task_wait(scheduler,&group);
+    serial=0;
+  }
+  else {
+    fprintf(stderr,"Warning: unable to start the extraction threads; reading the files one at a time\n");
+  }
+  if (scheduler != NULL) {
+    grib_scheduler_destroy(scheduler);
+  }
+  free(tasks);
+#endif
+  if (serial) {
+    for (size_t n=0; n < num_files; ++n) {
+	extract_file(query,&run.workers[0],&run.files[n]);
+    }
+  }
+/* put the grids of all of the files in order of time, and turn the rows into
+**   columns */
+  int status=0;
+  size_t num_rows=0;
+  for (size_t n=0; n < num_files; ++n) {
+    FileSeries *file=&run.files[n];
+    status|=file->status;
+    if (file->num_rows == 0) {
+	continue;
+    }
+    if (num_rows == 0) {
+	ts->num_columns=file->num_columns;
+	ts->ni=file->ni;
+	ts->nj=file->nj;
+    }
+    else if (file->num_columns != ts->num_columns || file->ni != ts->ni || file->nj != ts->nj) {
+	fprintf(stderr,"Warning: skipping %s: the box is %zux%zu gridpoints in its grids, but %zux%zu in the earlier files\n",file->path,file->ni,file->nj,ts->ni,ts->nj);
+	file->num_rows=0;
+	continue;
+    }
+    num_rows+=file->num_rows;
+  }
+  SeriesRow *rows=(SeriesRow *)malloc((num_rows+1)*sizeof(SeriesRow));
+  ts->valid_times=(long long *)malloc((num_rows+1)*sizeof(long long));
+  ts->ref_times=(long long *)malloc((num_rows+1)*sizeof(long long));
+  ts->values=(double *)malloc((num_rows*ts->num_columns+1)*sizeof(double));
+  if (rows == NULL || ts->valid_times == NULL || ts->ref_times == NULL || ts->values == NULL) {
+    fprintf(stderr,"Error allocating a time series of %zu times\n",num_rows);
+    free(rows);
+    free_time_series(ts);
+    free_series_run(&run,num_files,num_threads);
+    return 2;
+  }
+  size_t k=0;
+  for (size_t n=0; n < num_files; ++n) {
+    for (size_t m=0; m < run.files[n].num_rows; ++m) {
+	rows[k].valid_time=run.files[n].valid_times[m];
+	rows[k].ref_time=run.files[n].ref_times[m];
+	rows[k].file=n;
+	rows[k].row=m;
+	++k;
+    }
+  }
+  qsort(rows,num_rows,sizeof(SeriesRow),compare_series_rows);
+  ts->num_times=num_rows;
+  for (size_t n=0; n < num_rows; ++n) {
+    const FileSeries *file=&run.files[rows[n].file];
+    const double *row=&file->values[rows[n].row*ts->num_columns];
+    ts->valid_times[n]=rows[n].valid_time;
+    ts->ref_times[n]=rows[n].ref_time;
+    for (size_t m=0; m < ts->num_columns; ++m) {
+	ts->values[m*num_rows+n]=row[m];
+    }
+  }
+  free(rows);
+  free_series_run(&run,num_files,num_threads);
+  return status;
+}
+
+#endif
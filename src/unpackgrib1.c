@@ -22,6 +22,32 @@
 **   20 May 2017 - code refactoring, added bitmap to the GRIBMessage structure
 **                 to reduce memory reallocations
 **   10 Jul 2017 - decode Mercator grid definition
+**   18 Oct 2026 - IBM floats are converted with bit manipulation instead of
+**                 pow(); decode the vertical coordinate parameters in the GDS
+**               - split unpack_BDS into unpack_BDS_header and unpack_BDS_data
+**                 so that the packed data can be used without unpacking it
+**               - the unpack_* routines return a status code and record the
+**                 reason in 'error' instead of exiting on a message that they
+**                 can't unpack; section lengths and the packing width are
+**                 checked against the message before they are used
+**               - large grids are split into chunks that are unpacked by
+**                 several threads (see 'num_threads'); compile with -DPTHREADS
+**                 and link with -lpthread
+**               - when unpackgrib1 is called from a task of the scheduler in
+**                 grib_scheduler.c, the chunks are spawned as tasks on its
+**                 pool instead of on threads of their own; -DPTHREADS builds
+**                 need grib_scheduler.c in the same directory as this file
+**               - added filters (see 'matches' and 'filter') that are checked
+**                 after the PDS, so that the rest of the records that aren't
+**                 wanted aren't unpacked
+**               - added a perturbation number predicate to GRIBMatch, which is
+**                 read from the ensemble extensions of the PDS (see
+**                 grib_perturb_num)
+**               - added 'stride', which unpacks a preview of a grid with only
+**                 every k-th gridpoint of every k-th row, reading only the
+**                 packed values of those gridpoints
+**               - added free_grib_message, which frees the buffers of a
+**                 GRIBMessage
 **
 ** Purpose: to provide a single C-routine for unpacking GRIB grids
 **
@@ -51,23 +77,36 @@
 **
 **    initialize(&grib_msg);
 **    fp=fopen("my_GRIB_file","rb");
-**    while ( (status=unpackgrib1(fp,&grib_msg)) == 0) {
-**      if (status == -1) {
-**        printf("Found EOF\n");
-**      }
-**      else if (status == 1) {
+**    while ( (status=unpackgrib1(fp,&grib_msg)) != GRIB_EOF) {
+**      if (status == GRIB_READ_ERROR) {
 **        printf("Error reading GRIB record\n");
+**        break;
+**      }
+**      else if (status != 0) {
+**        printf("Skipping GRIB record: %s\n",grib_msg.error);
+**        continue;
 **      }
 **      ...
 **    }
+**    free_grib_message(&grib_msg);
 ** 
 ** where:
 **   fp            is a FILE pointer to an open GRIB data file
 **   GRIBMessage   is a structure used to hold the data in a GRIB message
 **
 ** On return:
-**   unpackgrib1 returns 0 for a successful read, -1 for an EOF, and 1 for a
-**   read error
+**   unpackgrib1 returns 0 for a successful read, GRIB_EOF (-1) for an EOF,
+**   GRIB_READ_ERROR (1) for a read error, GRIB_UNSUPPORTED (2) for a grid type
+**   or packing that these routines don't unpack, and GRIB_BAD_MESSAGE (3) for
+**   a damaged or inconsistent record; for the last two, 'error' says why, and
+**   the next record can still be read
+**
+**   When the message has a filter (see 'matches' and 'filter'), unpackgrib1
+**   returns GRIB_NO_MATCH (5) for a record that doesn't pass it, without
+**   unpacking anything after the PDS
+**
+**   All of the state of the routines is in the GRIBMessage, so threads can
+**   unpack different records at the same time, each with its own GRIBMessage
 **
 ** 
 ** Overview of GRIBMessage:
@@ -174,6 +213,11 @@
 **   bcapacity:       For internal use only (the capacity of 'bitmap', used to
 **                      minimize memory allocations)
 **   bitmap_len:      For internal use only (the length of the bitmap)
+**   bms_off:         Offset in bits from the beginning of 'buffer' to the
+**                      Bitmap Section, if there is one
+**   bds_off:         Offset in bits from the beginning of 'buffer' to the
+**                      Binary Data Section
+**   num_packed:      Number of packed data values in the Binary Data Section
 **   ref_val:         GRIB Reference Value
 **   gridpoints:      The array of gridpoints as a single stream - you will need
 **                      to use the grid definition parameters (dimensions,
@@ -181,15 +225,85 @@
 **                      properly
 **   gcapacity:       For internal use only (the capacity of 'gridpoints', used
 **                      to minimize memory allocations)
+**   nv:              Number of vertical coordinate parameters in the GDS
+**   pv:              The array of vertical coordinate parameters (e.g. the
+**                      coefficients of a hybrid coordinate)
+**   pvcapacity:      For internal use only (the capacity of 'pv', used to
+**                      minimize memory allocations)
+**   num_threads:     The number of threads that can unpack one large grid (set
+**                      by 'initialize' to the number of processors when
+**                      compiled with -DPTHREADS, otherwise 1); set it to 1 when
+**                      records are unpacked by several threads already
+**   matches:         An array of GRIBMatch predicates (NULL, the default, for
+**                      none); a record is unpacked only if it matches at least
+**                      one of them
+**   num_matches:     The number of predicates in 'matches'
+**   filter:          A function that is called with the message right after
+**                      the PDS of a record that gets past 'matches' has been
+**                      unpacked; the record is unpacked only if it returns
+**                      nonzero (NULL, the default, accepts every record)
+**   filter_arg:      Passed to 'filter' as its last argument
+**   stride:          1 (the default, set by 'initialize') to unpack every
+**                      gridpoint; k > 1 to unpack a preview of a grid with
+**                      only every k-th gridpoint of every k-th row: (nx-1)/k+1
+**                      by (ny-1)/k+1 gridpoints (see grib_stride_grid); records
+**                      without a grid that these routines recognize are
+**                      unpacked in full
+**   error:           The reason that the last record couldn't be unpacked
+**
+** Overview of GRIBMatch (a field that is GRIB_ANY matches any value;
+**   grib_match_any sets all of them to GRIB_ANY):
+**   table_ver, center_id, gen_proc, param, level_type, lvl1, lvl2,
+**   fcst_units, p1, p2, t_range: the same as in GRIBMessage
+**   perturb_num:     Perturbation number of an ensemble member, as returned by
+**                      grib_perturb_num (records that aren't ensemble members
+**                      never match it)
+**
+** example C syntax for unpacking only the 500 mb geopotential height:
+**    GRIBMatch match;
+**
+**    grib_match_any(&match);
+**    match.param=7;
+**    match.level_type=100;
+**    match.lvl1=500;
+**    grib_msg.matches=&match;
+**    grib_msg.num_matches=1;
 */
+#ifndef UNPACKGRIB1_C
+#define UNPACKGRIB1_C
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
+#ifdef PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#include "grib_scheduler.c"
+#endif
+#include "grib_parallel.c"
+
+/* the missing value and the status codes are the same as in unpackgrib2.c, so
+**   that both files can be included in the same program
+*/
+#define GRIB_MISSING_VALUE 1.e30
+#define GRIB_EOF -1
+#define GRIB_READ_ERROR 1
+#define GRIB_UNSUPPORTED 2
+#define GRIB_BAD_MESSAGE 3
+#define GRIB_DECODE_ERROR 4
+#define GRIB_NO_MATCH 5
+/* a predicate of a filter that is GRIB_ANY matches any value */
+#define GRIB_ANY INT_MIN
 
-const double GRIB_MISSING_VALUE=1.e30;
 typedef struct {
+  int table_ver,center_id,gen_proc,param,level_type,lvl1,lvl2,fcst_units,p1,p2,t_range;
+  int perturb_num;
+} GRIBMatch;
+
+typedef struct GRIBMessage {
   int total_len,pds_len,pds_ext_len,gds_len,bds_len;
   int ed_num,table_ver,center_id,gen_proc,grid_type,param,level_type,lvl1,lvl2,fcst_units,p1,p2,t_range,navg,nmiss,sub_center_id,bds_flag,pack_width;
   int gds_included,bms_included;
@@ -201,10 +315,24 @@ typedef struct {
   int xlen,ylen;
   unsigned char *buffer,*pds_ext,*bitmap;
   size_t buffer_capacity,bcapacity,bitmap_len;
+  int bms_off,bds_off;
+  size_t num_packed;
   double ref_val,*gridpoints;
   int gcapacity;
+  int nv;
+  double *pv;
+  size_t pvcapacity;
+  int num_threads;
+  const GRIBMatch *matches;
+  size_t num_matches;
+  int (*filter)(const struct GRIBMessage *grib_msg,void *filter_arg);
+  void *filter_arg;
+  int stride;
+  char error[256];
 } GRIBMessage;
 
+#ifndef GRIB_GET_BITS
+#define GRIB_GET_BITS
 /* get_bits gets the contents of the various GRIB octets
 **   buf is the GRIB buffer as a stream of bytes
 **   loc is the variable to hold the octet contents
@@ -212,17 +340,21 @@ typedef struct {
 **       of the octet(s) to be unpacked
 **   bits is the number of BITS to unpack - will be a multiple of 8 since GRIB
 **       octets are 8 bits long
+**   returns 0, or 1 (with 'loc' set to 0) if 'bits' won't fit in 'loc'
+**
+** get_bits is the same in unpackgrib1.c and unpackgrib2.c, so it is only
+**   defined once if both are included
 */
-void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
+int get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
 {
 /* no work to do */
   if (bits == 0) {
-    return;
+    return 0;
   }
   size_t loc_size=sizeof(int)*8;
   if (bits > loc_size) {
-    fprintf(stderr,"Error: unpacking %d bits into a %d-bit field\n",bits,loc_size);
-    exit(1);
+    *loc=0;
+    return 1;
   }
   else {
 /* create masks to use when right-shifting (necessary because different
@@ -233,11 +365,6 @@ void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
 	bmask<<=1;
 	bmask++;
     }
-    int lmask=1;
-    for (size_t n=1; n < loc_size; ++n) {
-	lmask<<=1;
-	lmask++;
-    }
 /* get number of words to skip before unpacking begins */
     size_t wskip=off/buf_size;
 /* right shift the bits in the packed buffer "word" to eliminate unneeded
@@ -247,7 +374,7 @@ void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
     if (rshift < 0) {
 	*loc=0;
 	while (rshift < 0) {
-	  int temp=buf[wskip++];
+	  unsigned int temp=buf[wskip++];
 	  *loc+=(temp<<-rshift);
 	  rshift+=buf_size;
 	}
@@ -263,33 +390,239 @@ void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
     }
 /* remove any unneeded leading bits */
     if (bits != loc_size) {
-	*loc&=~(lmask<<bits);
+	*loc&=(1u << bits)-1;
     }
   }
+  return 0;
+}
+#endif
+
+/* ibm_leading_zeros returns the number of leading zero bits in the 24-bit
+**   fraction of an IBM float (fr must be non-zero)
+*/
+int ibm_leading_zeros(unsigned int fr)
+{
+#if defined(__GNUC__)
+  return __builtin_clz(fr)-(sizeof(unsigned int)*8-24);
+#else
+  int n=0;
+  if ( (fr & 0xfff000) == 0) {
+    n+=12;
+    fr<<=12;
+  }
+  if ( (fr & 0xfc0000) == 0) {
+    n+=6;
+    fr<<=6;
+  }
+  if ( (fr & 0xe00000) == 0) {
+    n+=3;
+    fr<<=3;
+  }
+  if ( (fr & 0xc00000) == 0) {
+    n+=2;
+    fr<<=2;
+  }
+  if ( (fr & 0x800000) == 0) {
+    ++n;
+  }
+  return n;
+#endif
+}
+
+/* ibm_bits2real converts the 32 bits of an IBM single-precision float to a
+**   native double by building the IEEE bit pattern directly - every IBM value
+**   is exactly representable as a double, so no rounding takes place
+*/
+double ibm_bits2real(unsigned int ibm)
+{
+  union {
+    double d;
+    unsigned long long u;
+  } ieee;
+  unsigned int fr=ibm & 0xffffff;
+  if (fr == 0) {
+    return 0.;
+  }
+/* normalize the hexadecimal fraction to a binary one; the value is then
+**   (fr << shift)/2^23 * 2^(4*(exp-64)-shift-1)
+*/
+  int shift=ibm_leading_zeros(fr);
+  long long exp=(long long)((ibm >> 24) & 0x7f)*4-256-shift-1+1023;
+  ieee.u=((unsigned long long)(ibm & 0x80000000) << 32) | (exp << 52) | ((unsigned long long)((fr << shift) & 0x7fffff) << 29);
+  return ieee.d;
 }
 
 double ibm2real(unsigned char *buf,size_t off)
 {
-  int sign;
-  get_bits(buf,&sign,off,1);
-  int exp;
-  get_bits(buf,&exp,off+1,7);
-  exp-=64;
-  int fr;
-  get_bits(buf,&fr,off+8,24);
-  double native_real=pow(2.,-24.)*(double)fr*pow(16.,(double)exp);
-  return (sign == 1) ? -native_real : native_real;
+  unsigned int ibm;
+  if ( (off % 8) == 0) {
+    unsigned char *b=&buf[off/8];
+    ibm=((unsigned int)b[0] << 24) | ((unsigned int)b[1] << 16) | ((unsigned int)b[2] << 8) | b[3];
+  }
+  else {
+    int hi,lo;
+    get_bits(buf,&hi,off,16);
+    get_bits(buf,&lo,off+16,16);
+    ibm=((unsigned int)hi << 16) | (unsigned int)lo;
+  }
+  return ibm_bits2real(ibm);
+}
+
+/* ibm2real_array converts 'num' consecutive IBM floats starting at bit offset
+**   'off' in 'buf' into 'values' - used for lists of IBM floats, such as the
+**   vertical coordinate parameters in the GDS
+*/
+void ibm2real_array(unsigned char *buf,size_t off,double *values,size_t num)
+{
+  if ( (off % 8) != 0) {
+    for (size_t n=0; n < num; ++n) {
+	values[n]=ibm2real(buf,off);
+	off+=32;
+    }
+    return;
+  }
+  unsigned char *b=&buf[off/8];
+  for (size_t n=0; n < num; ++n) {
+    values[n]=ibm_bits2real(((unsigned int)b[0] << 24) | ((unsigned int)b[1] << 16) | ((unsigned int)b[2] << 8) | b[3]);
+    b+=4;
+  }
+}
+
+/* grib_error records the reason that a record can't be unpacked in 'error' and
+**   returns 'status'
+*/
+int grib_error(GRIBMessage *grib_msg,int status,const char *format,...)
+{
+  va_list ap;
+  va_start(ap,format);
+  vsnprintf(grib_msg->error,sizeof(grib_msg->error),format,ap);
+  va_end(ap);
+  return status;
 }
 
 void initialize(GRIBMessage *grib_msg)
 {
   grib_msg->buffer=NULL;
   grib_msg->buffer_capacity=0;
+  grib_msg->pds_ext=NULL;
+  grib_msg->bitmap=NULL;
+  grib_msg->bcapacity=0;
+  grib_msg->bitmap_len=0;
+  grib_msg->gridpoints=NULL;
+  grib_msg->gcapacity=0;
+  grib_msg->nv=0;
+  grib_msg->pv=NULL;
+  grib_msg->pvcapacity=0;
+  grib_msg->num_threads=grib_default_threads();
+  grib_msg->matches=NULL;
+  grib_msg->num_matches=0;
+  grib_msg->filter=NULL;
+  grib_msg->filter_arg=NULL;
+  grib_msg->stride=1;
+  grib_msg->error[0]='\0';
+}
+
+/* free_grib_message frees the buffers of a GRIBMessage; the message can still
+**   be used to unpack more records, which allocate them again
+*/
+void free_grib_message(GRIBMessage *grib_msg)
+{
+  free(grib_msg->buffer);
+  grib_msg->buffer=NULL;
+  grib_msg->buffer_capacity=0;
+  free(grib_msg->pds_ext);
+  grib_msg->pds_ext=NULL;
+  free(grib_msg->bitmap);
   grib_msg->bitmap=NULL;
   grib_msg->bcapacity=0;
   grib_msg->bitmap_len=0;
+  free(grib_msg->gridpoints);
   grib_msg->gridpoints=NULL;
   grib_msg->gcapacity=0;
+  free(grib_msg->pv);
+  grib_msg->pv=NULL;
+  grib_msg->pvcapacity=0;
+  grib_msg->nv=0;
+}
+
+/* grib_match_any sets all of the predicates of 'match' to GRIB_ANY, so that
+**   only the ones that are set afterwards are checked
+*/
+void grib_match_any(GRIBMatch *match)
+{
+  match->table_ver=match->center_id=match->gen_proc=GRIB_ANY;
+  match->param=match->level_type=match->lvl1=match->lvl2=GRIB_ANY;
+  match->fcst_units=match->p1=match->p2=match->t_range=GRIB_ANY;
+  match->perturb_num=GRIB_ANY;
+}
+
+/* grib_perturb_num returns the perturbation number of a record that is an
+**   ensemble member, or -1 if it isn't one; a control forecast is member 0
+**
+**   GRIB1 has no ensemble section, so the number is read from the extensions
+**   of the PDS:
+**     a 43-octet PDS:    as written by grib2to1, octet 41 is the ensemble type
+**                          (GRIB2 Code Table 4.6: 0 to 3 are control and
+**                          perturbed forecasts) and octet 42 is the
+**                          perturbation number
+**     NCEP (center 7):   octet 41 is 1 (ensemble), octet 42 is the type (1 =
+**                          control, 2 and 3 = negatively and positively
+**                          perturbed) and octet 43 is the perturbation number
+**     ECMWF (center 98): local definition 1 (octet 41), with octet 43 the
+**                          type (10 = control, 11 = perturbed) and octet 50
+**                          the perturbation number
+**   other records are never ensemble members
+*/
+int grib_perturb_num(const GRIBMessage *grib_msg)
+{
+  const unsigned char *ext=grib_msg->pds_ext;
+  int len= (ext != NULL) ? grib_msg->pds_ext_len : 0;
+  if (grib_msg->pds_len == 43 && len == 3) {
+    return (ext[0] <= 3) ? ext[1] : -1;
+  }
+  switch (grib_msg->center_id) {
+    case 7:
+    {
+	if (len >= 4 && ext[0] == 1) {
+	  if (ext[1] == 1) {
+	    return 0;
+	  }
+	  if (ext[1] == 2 || ext[1] == 3) {
+	    return ext[2];
+	  }
+	}
+	break;
+    }
+    case 98:
+    {
+	if (len >= 10 && ext[0] == 1 && (ext[2] == 10 || ext[2] == 11)) {
+	  return ext[9];
+	}
+	break;
+    }
+  }
+  return -1;
+}
+
+/* grib_record_matches returns 1 if a record whose PDS has been unpacked
+**   passes its filter: it matches at least one of 'matches' (when there are
+**   any), and 'filter' (when it is set) accepts it; otherwise it returns 0
+*/
+int grib_record_matches(const GRIBMessage *grib_msg)
+{
+  if (grib_msg->num_matches > 0) {
+    size_t n;
+    for (n=0; n < grib_msg->num_matches; ++n) {
+	const GRIBMatch *m=&grib_msg->matches[n];
+	if ((m->table_ver == GRIB_ANY || m->table_ver == grib_msg->table_ver) && (m->center_id == GRIB_ANY || m->center_id == grib_msg->center_id) && (m->gen_proc == GRIB_ANY || m->gen_proc == grib_msg->gen_proc) && (m->param == GRIB_ANY || m->param == grib_msg->param) && (m->level_type == GRIB_ANY || m->level_type == grib_msg->level_type) && (m->lvl1 == GRIB_ANY || m->lvl1 == grib_msg->lvl1) && (m->lvl2 == GRIB_ANY || m->lvl2 == grib_msg->lvl2) && (m->fcst_units == GRIB_ANY || m->fcst_units == grib_msg->fcst_units) && (m->p1 == GRIB_ANY || m->p1 == grib_msg->p1) && (m->p2 == GRIB_ANY || m->p2 == grib_msg->p2) && (m->t_range == GRIB_ANY || m->t_range == grib_msg->t_range) && (m->perturb_num == GRIB_ANY || (m->perturb_num >= 0 && m->perturb_num == grib_perturb_num(grib_msg)))) {
+	  break;
+	}
+    }
+    if (n == grib_msg->num_matches) {
+	return 0;
+    }
+  }
+  return (grib_msg->filter == NULL || grib_msg->filter(grib_msg,grib_msg->filter_arg) != 0);
 }
 
 int unpack_IS(FILE *fp,GRIBMessage *grib_msg)
@@ -359,6 +692,12 @@ int unpack_IS(FILE *fp,GRIBMessage *grib_msg)
     return 1;
   }
   get_bits(temp,&grib_msg->total_len,32,24);
+/* the stream is left after the first eight octets, so the next call to
+**   unpack_IS will look for the next record */
+  grib_msg->error[0]='\0';
+  if (grib_msg->total_len < 24) {
+    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"record length %d is too short",grib_msg->total_len);
+  }
   if (grib_msg->total_len == 24) {
     grib_msg->ed_num=0;
     grib_msg->pds_len=grib_msg->total_len;
@@ -371,6 +710,7 @@ int unpack_IS(FILE *fp,GRIBMessage *grib_msg)
     grib_msg->ed_num=1;
   }
   grib_msg->nx=grib_msg->ny=0;
+  grib_msg->nv=0;
   size_t required_size=grib_msg->total_len+4;
   if (required_size > grib_msg->buffer_capacity) {
     if (grib_msg->buffer != NULL) {
@@ -393,7 +733,7 @@ int unpack_IS(FILE *fp,GRIBMessage *grib_msg)
   }
 }
 
-void unpack_PDS(GRIBMessage *grib_msg)
+int unpack_PDS(GRIBMessage *grib_msg)
 {
   if (grib_msg->ed_num == 0) {
     grib_msg->offset=32;
@@ -402,6 +742,9 @@ void unpack_PDS(GRIBMessage *grib_msg)
     grib_msg->offset=64;
 /* length of PDS */
     get_bits(grib_msg->buffer,&grib_msg->pds_len,grib_msg->offset,24);
+    if (grib_msg->pds_len < 28 || grib_msg->pds_len+12 > grib_msg->total_len) {
+	return grib_error(grib_msg,GRIB_BAD_MESSAGE,"PDS length %d is not valid",grib_msg->pds_len);
+    }
 /* table version */
     get_bits(grib_msg->buffer,&grib_msg->table_ver,grib_msg->offset+24,8);
   }
@@ -497,7 +840,7 @@ void unpack_PDS(GRIBMessage *grib_msg)
   if (grib_msg->ed_num == 0) {
     grib_msg->pds_ext_len=0;
     grib_msg->offset+=192;
-    return;
+    return 0;
   }
   int cent;
   get_bits(grib_msg->buffer,&cent,grib_msg->offset+192,8);  /* century */
@@ -539,15 +882,43 @@ void unpack_PDS(GRIBMessage *grib_msg)
   else {
     grib_msg->pds_ext_len=0;
   }
+  return 0;
 }
 
-void unpack_GDS(GRIBMessage *grib_msg)
+int unpack_GDS(GRIBMessage *grib_msg)
 {
 /* length of the GDS */
   get_bits(grib_msg->buffer,&grib_msg->gds_len,grib_msg->offset,24);
   if (grib_msg->ed_num == 0) {
     grib_msg->total_len+=grib_msg->gds_len;
   }
+  else if (grib_msg->gds_len < 32 || grib_msg->offset/8+grib_msg->gds_len > grib_msg->total_len) {
+    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"GDS length %d is not valid",grib_msg->gds_len);
+  }
+/* number of vertical coordinate parameters */
+  get_bits(grib_msg->buffer,&grib_msg->nv,grib_msg->offset+24,8);
+  if (grib_msg->nv > 0) {
+/* location (octet number) of the list of vertical coordinate parameters */
+    int pv_loc;
+    get_bits(grib_msg->buffer,&pv_loc,grib_msg->offset+32,8);
+    if (pv_loc == 255 || (pv_loc-1+grib_msg->nv*4) > grib_msg->gds_len) {
+	grib_msg->nv=0;
+    }
+    else {
+	if ((size_t)grib_msg->nv > grib_msg->pvcapacity) {
+	  if (grib_msg->pv != NULL) {
+	    free(grib_msg->pv);
+	  }
+	  grib_msg->pv=(double *)malloc(grib_msg->nv*sizeof(double));
+	  if (grib_msg->pv == NULL) {
+	    grib_msg->pvcapacity=0;
+	    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"unable to allocate %d vertical coordinate parameters",grib_msg->nv);
+	  }
+	  grib_msg->pvcapacity=grib_msg->nv;
+	}
+	ibm2real_array(grib_msg->buffer,grib_msg->offset+(pv_loc-1)*8,grib_msg->pv,grib_msg->nv);
+    }
+  }
 /* data representation type */
   get_bits(grib_msg->buffer,&grib_msg->data_rep,grib_msg->offset+40,8);
   switch (grib_msg->data_rep) {
@@ -725,60 +1096,60 @@ void unpack_GDS(GRIBMessage *grib_msg)
     }
     default:
     {
-	fprintf(stderr,"Grid type %d is not understood\n",grib_msg->data_rep);
-	exit(1);
+	return grib_error(grib_msg,GRIB_UNSUPPORTED,"grid type %d is not understood",grib_msg->data_rep);
     }
   }
   grib_msg->offset+=grib_msg->gds_len*8;
+  return 0;
 }
 
-void unpack_BDS(GRIBMessage *grib_msg)
+/* unpack_BDS_header unpacks the Bitmap Section header, if there is one, and the
+**   Binary Data Section header, and records where the bitmap and the packed
+**   data values are in 'buffer', without unpacking them
+*/
+int unpack_BDS_header(GRIBMessage *grib_msg)
 {
   if (grib_msg->bms_included == 1) {
+    grib_msg->bms_off=grib_msg->offset;
     int bms_length;
     get_bits(grib_msg->buffer,&bms_length,grib_msg->offset,24);
     if (grib_msg->ed_num == 0) {
 	grib_msg->total_len+=bms_length;
     }
+    else if (bms_length < 6 || grib_msg->offset/8+bms_length > grib_msg->total_len) {
+	return grib_error(grib_msg,GRIB_BAD_MESSAGE,"BMS length %d is not valid",bms_length);
+    }
     int ub;
     get_bits(grib_msg->buffer,&ub,grib_msg->offset+24,8);
     int tref;
     get_bits(grib_msg->buffer,&tref,grib_msg->offset+32,16);
     if (tref != 0) {
-	fprintf(stderr,"Aborting: unknown pre-defined bit-map %d\n",tref);
-	exit(1);
+	return grib_error(grib_msg,GRIB_UNSUPPORTED,"unknown pre-defined bit-map %d",tref);
     }
     grib_msg->bitmap_len=(bms_length-6)*8-ub;
-    if (grib_msg->bitmap_len > grib_msg->bcapacity) {
-	if (grib_msg->bitmap != NULL) {
-	  free(grib_msg->bitmap);
-	}
-	grib_msg->bcapacity=grib_msg->bitmap_len;
-	grib_msg->bitmap=(unsigned char *)malloc(grib_msg->bcapacity*sizeof(unsigned char));
-    }
-    size_t boff=grib_msg->offset+48;
-    for (size_t n=0; n < grib_msg->bcapacity; ++n) {
-	int bval;
-	get_bits(grib_msg->buffer,&bval,boff,1);
-	grib_msg->bitmap[n]=bval;
-	++boff;
-    }
     grib_msg->offset+=bms_length*8;
   }
   else {
     grib_msg->bitmap_len=0;
   }
+  grib_msg->bds_off=grib_msg->offset;
 /* length of the BDS */
   get_bits(grib_msg->buffer,&grib_msg->bds_len,grib_msg->offset,24);
   if (grib_msg->ed_num == 0) {
     grib_msg->total_len+=(grib_msg->bds_len+1);
   }
+  else if (grib_msg->bds_len < 11 || grib_msg->offset/8+grib_msg->bds_len > grib_msg->total_len) {
+    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"BDS length %d is not valid",grib_msg->bds_len);
+  }
 /* flag */
   get_bits(grib_msg->buffer,&grib_msg->bds_flag,grib_msg->offset+24,4);
   int ub;
   get_bits(grib_msg->buffer,&ub,grib_msg->offset+28,4);
 /* bit width of the packed data points */
   get_bits(grib_msg->buffer,&grib_msg->pack_width,grib_msg->offset+80,8);
+  if (grib_msg->pack_width > 32) {
+    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"packing width %d is more than 32 bits",grib_msg->pack_width);
+  }
   int sign;
   get_bits(grib_msg->buffer,&sign,grib_msg->offset+32,1);
 /* binary scale factor */
@@ -786,108 +1157,366 @@ void unpack_BDS(GRIBMessage *grib_msg)
   if (sign == 1) {
     grib_msg->E=-grib_msg->E;
   }
-  double e=pow(2.,grib_msg->E);
 /* reference value */
   double d=pow(10.,grib_msg->D);
   grib_msg->ref_val=ibm2real(grib_msg->buffer,grib_msg->offset+48)/d;
-  if ((grib_msg->bds_flag & 0x40) == 0) {
-/* simple packing */
-    int *packed=NULL;
-    grib_msg->offset+=88;
-    size_t num_packed=0;
-    if (grib_msg->pack_width > 0) {
-	num_packed=(grib_msg->bds_len*8-88-ub)/grib_msg->pack_width;
-	packed=(int *)malloc(sizeof(int)*num_packed);
-    }
-    switch (grib_msg->data_rep) {
-	case 0:
-/* Latitude/Longitude grid */
-	case 4:
-/* Gaussian Lat/Lon grid */
-	case 10:
-/* Rotated Lat/Lon grid */
-	{
-	  switch (grib_msg->grid_type) {
-	    case 23:
-	    case 24:
-	    case 26:
-	    case 63:
-	    case 64:
-	    {
-		grib_msg->offset+=grib_msg->pack_width;
-		break;
-	    }
-	  }
+/* number of packed values */
+  grib_msg->num_packed=0;
+  if ((grib_msg->bds_flag & 0x40) == 0 && grib_msg->pack_width > 0) {
+    grib_msg->num_packed=(grib_msg->bds_len*8-88-ub)/grib_msg->pack_width;
+  }
+  return 0;
+}
+
+/* BDSChunks holds what the threads that unpack the chunks of a grid need
+*/
+typedef struct {
+  GRIBMessage *grib_msg;
+  size_t *offsets;
+  size_t num_points,num_kept;
+  double e,d;
+} BDSChunks;
+
+/* count_bds_values sets the offset of a chunk to the number of its gridpoints
+**   that have a value in the bitmap
+*/
+void count_bds_values(void *arg,size_t chunk,size_t start,size_t end)
+{
+  BDSChunks *b=(BDSChunks *)arg;
+  size_t num_values=0;
+  for (size_t n=start; n < end; ++n) {
+    num_values+=b->grib_msg->bitmap[n];
+  }
+  b->offsets[chunk]=num_values;
+}
+
+/* unpack_bds_chunk unpacks the gridpoints 'start' to 'end'-1; the first packed
+**   value of the chunk is at the offset of the chunk
+*/
+void unpack_bds_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  BDSChunks *b=(BDSChunks *)arg;
+  GRIBMessage *grib_msg=b->grib_msg;
+  size_t off=b->offsets[chunk];
+  for (size_t n=start; n < end; ++n) {
+    if (grib_msg->bitmap_len == 0 || grib_msg->bitmap[n] == 1) {
+	if (grib_msg->num_packed == 0) {
+/* constant field */
+	  grib_msg->gridpoints[n]=grib_msg->ref_val;
 	}
-	case 1:
-/* Mercator grid */
-	case 3:
-/* Lambert Conformal grid */
-	case 5:
-/* Polar Stereographic grid */
-	{
-	  for (size_t n=0; n < num_packed; ++n) {
-	    get_bits(grib_msg->buffer,&packed[n],grib_msg->offset,grib_msg->pack_width);
-	    grib_msg->offset+=grib_msg->pack_width;
-	  }
-	  size_t num_points=grib_msg->ny*grib_msg->nx;
-	  if (num_points > grib_msg->gcapacity) {
-	    if (grib_msg->gridpoints != NULL) {
-		free(grib_msg->gridpoints);
-	    }
-	    grib_msg->gcapacity=num_points;
-	    grib_msg->gridpoints=(double *)malloc(grib_msg->gcapacity*sizeof(double));
+	else {
+	  int pval=0;
+	  get_bits(grib_msg->buffer,&pval,off,grib_msg->pack_width);
+	  grib_msg->gridpoints[n]=grib_msg->ref_val+pval*b->e/b->d;
+	  off+=grib_msg->pack_width;
+	}
+    }
+    else {
+	grib_msg->gridpoints[n]=GRIB_MISSING_VALUE;
+    }
+  }
+}
+
+/* grib_stride_length returns the number of the 'n' points of a row or column
+**   that are kept when only every 'stride'-th one is unpacked, starting with
+**   the first
+*/
+int grib_stride_length(int n,int stride)
+{
+  return (n > 0) ? (n-1)/stride+1 : 0;
+}
+
+/* grib_strided_source returns the gridpoint of the full grid that is gridpoint
+**   'n' of the grid that is unpacked with 'stride'
+*/
+size_t grib_strided_source(const GRIBMessage *grib_msg,size_t n)
+{
+  size_t row_len= ((grib_msg->scan_mode & 0x20) == 0) ? grib_msg->nx : grib_msg->ny;
+  size_t strided_len=grib_stride_length(row_len,grib_msg->stride);
+  return n/strided_len*grib_msg->stride*row_len+(n % strided_len)*grib_msg->stride;
+}
+
+/* grib_stride_grid changes the grid definition of a grid that was unpacked
+**   with 'stride' to describe the strided grid: nx and ny are the numbers of
+**   kept gridpoints, the increments and grid lengths are multiplied by the
+**   stride (except for the number of latitude circles of a Gaussian grid), and
+**   elat and elon are the latitude and longitude of the last kept gridpoint;
+**   for a Gaussian grid, elat is not changed, and the kept rows are on every
+**   'stride'-th Gaussian latitude
+*/
+void grib_stride_grid(GRIBMessage *grib_msg)
+{
+  int stride=grib_msg->stride;
+  int nx=grib_stride_length(grib_msg->nx,stride),ny=grib_stride_length(grib_msg->ny,stride);
+  double xfrac= (grib_msg->nx > 1) ? (double)(nx-1)*stride/(grib_msg->nx-1) : 0.;
+  double yfrac= (grib_msg->ny > 1) ? (double)(ny-1)*stride/(grib_msg->ny-1) : 0.;
+  switch (grib_msg->data_rep) {
+    case 0:
+    case 1:
+    case 4:
+    case 10:
+    {
+	double dlon=grib_msg->elon-grib_msg->slon;
+	if ((grib_msg->scan_mode & 0x80) == 0 && dlon < 0.) {
+	  dlon+=360.;
+	}
+	else if ((grib_msg->scan_mode & 0x80) != 0 && dlon > 0.) {
+	  dlon-=360.;
+	}
+	grib_msg->elon=grib_msg->slon+dlon*xfrac;
+	if (grib_msg->elon > 360.) {
+	  grib_msg->elon-=360.;
+	}
+	else if (grib_msg->elon < -360.) {
+	  grib_msg->elon+=360.;
+	}
+	if (grib_msg->data_rep == 1) {
+/* Mercator: the rows are evenly spaced in the projected y */
+	  double quarter_pi=atan(1.),rad=quarter_pi/45.;
+	  double y1=log(tan(quarter_pi+grib_msg->slat*rad/2.));
+	  double y2=log(tan(quarter_pi+grib_msg->elat*rad/2.));
+	  grib_msg->elat=(2.*atan(exp(y1+(y2-y1)*yfrac))-2.*quarter_pi)/rad;
+	  grib_msg->xlen*=stride;
+	  grib_msg->ylen*=stride;
+	}
+	else {
+	  grib_msg->loinc*=stride;
+	  if (grib_msg->data_rep != 4) {
+	    grib_msg->elat=grib_msg->slat+(grib_msg->elat-grib_msg->slat)*yfrac;
+	    grib_msg->lainc*=stride;
 	  }
-	  size_t bcnt=0;
-	  size_t pcnt=0;
-	  for (size_t n=0; n < num_points; ++n) {
-	    if (grib_msg->bitmap_len == 0 || (grib_msg->bitmap_len > 0 && grib_msg->bitmap[bcnt++] == 1)) {
-		if (packed == NULL) {
+	}
+	break;
+    }
+    case 3:
+    case 5:
+    {
+	grib_msg->xlen*=stride;
+	grib_msg->ylen*=stride;
+	break;
+    }
+  }
+  grib_msg->nx=nx;
+  grib_msg->ny=ny;
+}
+
+/* count_strided_values sets the offset of a chunk of the kept gridpoints of a
+**   grid that is unpacked with a stride to the number of gridpoints of the full
+**   grid, from the first kept gridpoint of the chunk to the first of the next
+**   chunk, that have a value in the bitmap
+*/
+void count_strided_values(void *arg,size_t chunk,size_t start,size_t end)
+{
+  BDSChunks *b=(BDSChunks *)arg;
+  size_t last= (end < b->num_kept) ? grib_strided_source(b->grib_msg,end) : b->num_points;
+  size_t num_values=0;
+  for (size_t n=grib_strided_source(b->grib_msg,start); n < last; ++n) {
+    num_values+=b->grib_msg->bitmap[n];
+  }
+  b->offsets[chunk]=num_values;
+}
+
+/* unpack_strided_chunk unpacks the kept gridpoints 'start' to 'end'-1 of a grid
+**   that is unpacked with a stride; only the packed values of the kept
+**   gridpoints are read, and with a bitmap, the packed value of a gridpoint is
+**   found by counting the gridpoints before it that have a value
+*/
+void unpack_strided_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  BDSChunks *b=(BDSChunks *)arg;
+  GRIBMessage *grib_msg=b->grib_msg;
+  size_t first=grib_strided_source(grib_msg,start),pos=first,count=0;
+  for (size_t n=start; n < end; ++n) {
+    size_t point=grib_strided_source(grib_msg,n);
+    if (grib_msg->bitmap_len > 0) {
+	for (; pos < point; ++pos) {
+	  count+=grib_msg->bitmap[pos];
+	}
+	if (grib_msg->bitmap[point] == 0) {
+	  grib_msg->gridpoints[n]=GRIB_MISSING_VALUE;
+	  continue;
+	}
+    }
+    else {
+	count=point-first;
+    }
+    if (grib_msg->num_packed == 0) {
 /* constant field */
-		  grib_msg->gridpoints[n]=grib_msg->ref_val;
-		}
-		else {
-		  grib_msg->gridpoints[n]=grib_msg->ref_val+packed[pcnt++]*e/d;
-		}
-	    }
-	    else {
-		grib_msg->gridpoints[n]=GRIB_MISSING_VALUE;
-	    }
+	grib_msg->gridpoints[n]=grib_msg->ref_val;
+    }
+    else {
+	int pval=0;
+	get_bits(grib_msg->buffer,&pval,b->offsets[chunk]+count*grib_msg->pack_width,grib_msg->pack_width);
+	grib_msg->gridpoints[n]=grib_msg->ref_val+pval*b->e/b->d;
+    }
+  }
+}
+
+/* unpack_BDS_data unpacks the bitmap and the packed data values into
+**   'gridpoints'; unpack_BDS_header must be called first
+**
+**   value k of the grid is at bit k*pack_width of the packed data, so a large
+**   grid is split into chunks that are unpacked by 'num_threads' threads; with
+**   a bitmap, the number of values in each chunk is counted first, and the sums
+**   of the counts give the offset of each chunk
+**
+**   with a 'stride' greater than 1, the chunks are chunks of the kept
+**   gridpoints, and the grid definition is changed by grib_stride_grid
+*/
+int unpack_BDS_data(GRIBMessage *grib_msg)
+{
+  if ((grib_msg->bds_flag & 0x40) != 0) {
+/* second-order packing */
+    return grib_error(grib_msg,GRIB_UNSUPPORTED,"complex packing not currently supported");
+  }
+  BDSChunks b;
+  b.grib_msg=grib_msg;
+/* the number of gridpoints; without a recognized GDS, the gridpoints are just
+**   the stream of values, or the points of the bitmap */
+  size_t num_points;
+  int stream=0;
+  switch (grib_msg->data_rep) {
+    case 0:
+    case 1:
+    case 3:
+    case 4:
+    case 5:
+    case 10:
+    {
+	num_points=(size_t)grib_msg->ny*grib_msg->nx;
+	if (grib_msg->bitmap_len > 0 && grib_msg->bitmap_len < num_points) {
+/* some encoders set the number of unused bits at the end of a full bitmap to 8
+   instead of 0, so use the whole section if it covers the grid */
+	  int bms_length;
+	  get_bits(grib_msg->buffer,&bms_length,grib_msg->bms_off,24);
+	  if (bms_length < 6 || ((size_t)bms_length-6)*8 < num_points) {
+	    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"the bitmap has %zu points, but the grid has %zu",grib_msg->bitmap_len,num_points);
 	  }
-	  break;
+	  grib_msg->bitmap_len=num_points;
 	}
-	default:
-/* no recognized GDS, so just unpack the stream of gridpoints */
-	{
-	  size_t num_points= (num_packed > grib_msg->bitmap_len) ? num_packed : grib_msg->bitmap_len;
-	  if (num_points > grib_msg->gcapacity) {
-	    if (grib_msg->gridpoints != NULL) {
-		free(grib_msg->gridpoints);
-	    }
-	    grib_msg->gcapacity=num_points;
-	    grib_msg->gridpoints=(double *)malloc(grib_msg->gcapacity*sizeof(double));
-	  }
-	  size_t bcnt=0;
-	  size_t pcnt=0;
-	  for (size_t n=0; n < num_points; ++n) {
-	    if (grib_msg->bitmap_len == 0 || (grib_msg->bitmap_len > 0 && grib_msg->bitmap[bcnt++] == 1)) {
-		grib_msg->gridpoints[n]=grib_msg->ref_val+packed[pcnt++]*e/d;
-	    }
-	    else {
-		grib_msg->gridpoints[n]=GRIB_MISSING_VALUE;
-	    }
+	break;
+    }
+    default:
+    {
+	num_points= (grib_msg->bitmap_len > 0) ? grib_msg->bitmap_len : grib_msg->num_packed;
+	stream=1;
+    }
+  }
+  if (grib_msg->bms_included == 1) {
+    if (grib_msg->bitmap_len > grib_msg->bcapacity) {
+	if (grib_msg->bitmap != NULL) {
+	  free(grib_msg->bitmap);
+	}
+	grib_msg->bcapacity=grib_msg->bitmap_len;
+	grib_msg->bitmap=(unsigned char *)malloc(grib_msg->bcapacity*sizeof(unsigned char));
+	if (grib_msg->bitmap == NULL) {
+	  grib_msg->bcapacity=0;
+	  return grib_error(grib_msg,GRIB_BAD_MESSAGE,"unable to allocate a bitmap of %zu points",grib_msg->bitmap_len);
+	}
+    }
+/* the bitmap starts on an octet boundary, so expand it an octet at a time */
+    const unsigned char *bits=&grib_msg->buffer[grib_msg->bms_off/8+6];
+    for (size_t n=0; n < grib_msg->bitmap_len; ++n) {
+	grib_msg->bitmap[n]=(bits[n/8] >> (7-n%8)) & 0x1;
+    }
+  }
+/* the offset of the first packed value; some of the NCEP octant grids start
+**   with the value at the pole */
+  size_t off=grib_msg->bds_off+88;
+  switch (grib_msg->data_rep) {
+    case 0:
+/* Latitude/Longitude grid */
+    case 4:
+/* Gaussian Lat/Lon grid */
+    case 10:
+/* Rotated Lat/Lon grid */
+    {
+	switch (grib_msg->grid_type) {
+	  case 23:
+	  case 24:
+	  case 26:
+	  case 63:
+	  case 64:
+	  {
+	    off+=grib_msg->pack_width;
+	    break;
 	  }
 	}
     }
-    if (num_packed > 0) {
-	free(packed);
+  }
+  int stride= (grib_msg->stride > 1 && !stream) ? grib_msg->stride : 1;
+  b.num_points=num_points;
+  b.num_kept=num_points;
+  if (stride > 1) {
+    b.num_kept=(size_t)grib_stride_length(grib_msg->ny,stride)*grib_stride_length(grib_msg->nx,stride);
+  }
+  size_t num_chunks=grib_num_chunks(b.num_kept,grib_msg->num_threads);
+  size_t offset;
+  b.offsets= (num_chunks > 1) ? (size_t *)malloc(num_chunks*sizeof(size_t)) : &offset;
+  if (b.offsets == NULL) {
+    return grib_error(grib_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu chunks",num_chunks);
+  }
+/* make sure that there is a packed value for every gridpoint that has one,
+**   unless the field is constant */
+  size_t num_values=0;
+  if (grib_msg->bitmap_len > 0) {
+    grib_parallel_for(b.num_kept,grib_msg->num_threads,(stride > 1) ? count_strided_values : count_bds_values,&b);
+    for (size_t n=0; n < num_chunks; ++n) {
+	size_t num_chunk_values=b.offsets[n];
+	b.offsets[n]=off+num_values*grib_msg->pack_width;
+	num_values+=num_chunk_values;
     }
   }
   else {
-/* second-order packing */
-    fprintf(stderr,"Aborting: complex packing not currently supported\n");
-    exit(1);
+    for (size_t n=0; n < num_chunks; ++n) {
+	size_t start=b.num_kept*n/num_chunks;
+	if (stride > 1) {
+	  start=grib_strided_source(grib_msg,start);
+	}
+	b.offsets[n]=off+start*grib_msg->pack_width;
+    }
+    num_values=num_points;
+  }
+  int status=0;
+  size_t num_packed=grib_msg->num_packed;
+  if (num_values > num_packed && (num_packed > 0 || stream)) {
+    status=grib_error(grib_msg,GRIB_BAD_MESSAGE,"the grid has %zu values, but only %zu are packed",num_values,num_packed);
+  }
+  else if (b.num_kept > grib_msg->gcapacity) {
+    if (grib_msg->gridpoints != NULL) {
+	free(grib_msg->gridpoints);
+    }
+    grib_msg->gridpoints=(double *)malloc(b.num_kept*sizeof(double));
+    if (grib_msg->gridpoints == NULL) {
+	grib_msg->gcapacity=0;
+	status=grib_error(grib_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu gridpoints",b.num_kept);
+    }
+    else {
+	grib_msg->gcapacity=b.num_kept;
+    }
+  }
+  if (status == 0) {
+    b.e=pow(2.,grib_msg->E);
+    b.d=pow(10.,grib_msg->D);
+    grib_parallel_for(b.num_kept,grib_msg->num_threads,(stride > 1) ? unpack_strided_chunk : unpack_bds_chunk,&b);
+    grib_msg->offset=off+num_values*grib_msg->pack_width;
+    if (stride > 1) {
+	grib_stride_grid(grib_msg);
+    }
+  }
+  if (num_chunks > 1) {
+    free(b.offsets);
   }
+  return status;
+}
+
+int unpack_BDS(GRIBMessage *grib_msg)
+{
+  int status;
+  if ( (status=unpack_BDS_header(grib_msg)) != 0) {
+    return status;
+  }
+  return unpack_BDS_data(grib_msg);
 }
 
 int unpackgrib1(FILE *fp,GRIBMessage *grib_msg)
@@ -896,10 +1525,17 @@ int unpackgrib1(FILE *fp,GRIBMessage *grib_msg)
   if ( (status=unpack_IS(fp,grib_msg)) != 0) {
     return status;
   }
-  unpack_PDS(grib_msg);
-  if (grib_msg->gds_included == 1) {
-    unpack_GDS(grib_msg);
+  if ( (status=unpack_PDS(grib_msg)) != 0) {
+    return status;
   }
-  unpack_BDS(grib_msg);
-  return 0;
+/* nothing else is unpacked for a record that doesn't pass the filter */
+  if (!grib_record_matches(grib_msg)) {
+    return grib_error(grib_msg,GRIB_NO_MATCH,"the record doesn't match the filter");
+  }
+  if (grib_msg->gds_included == 1 && (status=unpack_GDS(grib_msg)) != 0) {
+    return status;
+  }
+  return unpack_BDS(grib_msg);
 }
+
+#endif
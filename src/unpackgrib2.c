@@ -45,6 +45,65 @@
 **               unpack DRS template 5.3
 **          13 Jul 2017:
 **             GDS Template 3.10 (Mercator grid)
+**          18 Oct 2026:
+**             DRS Template 5.42 (CCSDS lossless compression); the samples
+**               are in big-endian order when the template sets the
+**               AEC_DATA_MSB option, otherwise in little-endian order
+**              **NOTE: CCSDS unpacking requires libaec; compile with -DAEC
+**                      and link with -laec
+**             grids with simple packing can be left packed (see
+**               'unpack_simple'), and the locations of the DRS, bitmap and
+**               packed data are kept in the metadata
+**             constant fields (packing width of 0) with simple packing unpack
+**               to the reference value
+**             unpackgrib2 is split into unpack_IS and unpack_sections
+**             negative scale factors of the first and second level values are
+**               decoded (the first bit of the scale factor is its sign)
+**             the unpack_* routines return a status code and record the reason
+**               in 'error' instead of exiting on a message that they can't
+**               unpack; section lengths, packing widths and group lengths are
+**               checked against the message before they are used; bitmaps
+**               are kept in the message and reused instead of being
+**               allocated for every message
+**             large grids with simple packing are split into chunks that are
+**               unpacked by several threads (see 'num_threads'); compile with
+**               -DPTHREADS and link with -lpthread
+**             grids with complex packing (DRS Template 5.3) are unpacked by
+**               several threads too: the groups that start in each chunk of the
+**               grid are unpacked at the same time, using the offsets of the
+**               groups, and the spatial differencing is undone with a parallel
+**               prefix sum; the differences are added up exactly, instead of
+**               in single precision
+**             the Data Sections of a message are unpacked after the other
+**               sections, and the grids of a message with more than one grid
+**               are unpacked at the same time (see 'concurrent_grids')
+**             when unpackgrib2 is called from a task of the scheduler in
+**               grib_scheduler.c, the grids and the chunks of large grids are
+**               spawned as tasks on its pool instead of on threads of their
+**               own; -DPTHREADS builds need grib_scheduler.c in the same
+**               directory as this file
+**             added filters (see 'matches' and 'filter') that are checked
+**               after the Product Definition Section of each grid, so that the
+**               rest of the sections of the grids that aren't wanted are
+**               skipped
+**             added unpack_simple_subset, which unpacks only the gridpoints in
+**               a box of a grid with simple packing (see grib2_ij_subset and
+**               grib2_latlon_subset), finding the packed values of each row
+**               of the box from its position and the bits that are set in the
+**               bitmap before it
+**             unpack_GDS keeps the number of parallels between a pole and the
+**               equator of a Gaussian grid (GDS Template 3.40) in 'lainc'
+**             added 'stride', which unpacks a preview of each grid with only
+**               every k-th gridpoint of every k-th row: with simple packing,
+**               only the packed values of the kept gridpoints are read; with
+**               complex packing, the groups are unpacked one after another and
+**               the spatial differencing is undone as they are unpacked, so
+**               the full grid is never held; the grid definition is changed to
+**               describe the strided grid (see grib2_stride_grid)
+**             the location of the Grid Definition Section is kept in the
+**               metadata ('gds_off'), so that grids can be matched by its bytes
+**             added free_grib2_message, which frees the buffers of a
+**               GRIB2Message
 **
 ** Purpose: to provide a single C-routine for unpacking GRIB2 messages
 **
@@ -67,23 +126,49 @@
 **
 **    initialize(&grib2_msg);
 **    fp=fopen("my_GRIB2_file","rb");
-**    while ( (status=unpackgrib2(fp,&grib2_msg)) == 0) {
-**      if (status == -1) {
-**        printf("Found EOF\n");
-**      }
-**      else if (status == 1) {
+**    while ( (status=unpackgrib2(fp,&grib2_msg)) != GRIB_EOF) {
+**      if (status == GRIB_READ_ERROR) {
 **        printf("Error reading GRIB2 message\n");
+**        break;
+**      }
+**      else if (status != 0) {
+**        printf("Skipping message: %s\n",grib2_msg.error);
+**        continue;
 **      }
 **      ...
 **    }
+**    free_grib2_message(&grib2_msg);
 ** 
 ** where:
 **   fp            is a FILE pointer to an open GRIB data file
 **   GRIB2Message  is a structure used to hold the data in a GRIB2 message
 **
 ** On return:
-**   unpackgrib2 returns 0 for a successful read, -1 for an EOF, and 1 for a
-**   read error
+**   unpackgrib2 returns 0 for a successful read, GRIB_EOF (-1) for an EOF,
+**   GRIB_READ_ERROR (1) for a read error, GRIB_UNSUPPORTED (2) for a message
+**   that uses a template or feature that these routines don't unpack,
+**   GRIB_BAD_MESSAGE (3) for a damaged or inconsistent message, and
+**   GRIB_DECODE_ERROR (4) if the JPEG 2000 or CCSDS decoder fails; for the last
+**   three, 'error' says why, and the next message can still be read
+**
+**   When the message has a filter (see 'matches' and 'filter'), only the grids
+**   that pass it are unpacked and returned in 'grids'; the Data
+**   Representation, Bit Map and Data Sections of the others are skipped.
+**   unpackgrib2 returns GRIB_NO_MATCH (5) if none of the grids pass it.
+**
+**   To unpack only a box of a grid with simple packing, set 'unpack_simple' to
+**   0, find the box with grib2_latlon_subset or grib2_ij_subset, and unpack it
+**   with unpack_simple_subset:
+**    GRIB2Subset subset;
+**
+**    if (grib2_latlon_subset(&grib2_msg,0,30.,50.,-110.,-90.,&subset) == 0) {
+**      double *values=(double *)malloc(subset.ni*subset.nj*sizeof(double));
+**      unpack_simple_subset(&grib2_msg,0,&subset,values);
+**      ...
+**    }
+**
+**   All of the state of the routines is in the GRIB2Message, so threads can
+**   unpack different messages at the same time, each with its own GRIB2Message
 **
 ** Overview of the GRIB2Message structure:
 **   buffer:          For internal use only (used to hold the GRIB2 message that
@@ -107,10 +192,45 @@
 **   prod_status:     Production status of data
 **   data_type:       Type of data
 **   md:        Metadata that is common to all grids in the message
+**   unpack_simple:   1 (the default, set by 'initialize') to unpack grids with
+**                      simple packing (DRS Template 5.0); 0 to leave them
+**                      packed, so that their packed values can be used directly
+**                      - unpack_simple_packing will unpack one of these grids
+**                      later
 **   num_grids:       Number of individual grids in the GRIB2 message
 **   grids:           Array of individual grids
 **   grid_capacity:   For internal use only (the capacity of 'grids', used to
 **                      minimize memory allocations
+**   bitmaps:         For internal use only (the bitmaps of the message, which
+**                      are reused by later messages)
+**   bitmap_lens:     For internal use only (the capacity of each bitmap)
+**   num_bitmaps:     For internal use only (the number of bitmaps used by the
+**                      current message)
+**   bitmap_capacity: For internal use only (the capacity of 'bitmaps')
+**   num_threads:     The number of threads that can unpack a message: its grids
+**                      and the chunks of its large grids with simple or complex
+**                      packing (set by 'initialize' to the number of processors
+**                      when compiled with -DPTHREADS, otherwise 1); set it to 1
+**                      when messages are unpacked by several threads already
+**   concurrent_grids: 1 (the default, set by 'initialize') to unpack the grids
+**                      of a message with more than one grid at the same time,
+**                      sharing the 'num_threads' threads; 0 to unpack them one
+**                      after another, each with all of the threads
+**   stride:          1 (the default, set by 'initialize') to unpack every
+**                      gridpoint; k > 1 to unpack a preview of each grid with
+**                      only every k-th gridpoint of every k-th row: (nx-1)/k+1
+**                      by (ny-1)/k+1 gridpoints (see grib2_stride_grid)
+**   matches:         An array of GRIB2Match predicates (NULL, the default, for
+**                      none); a grid is unpacked only if it matches at least
+**                      one of them
+**   num_matches:     The number of predicates in 'matches'
+**   filter:          A function that is called with the metadata of each grid
+**                      that gets past 'matches', right after its Product
+**                      Definition Section has been unpacked; the grid is
+**                      unpacked only if it returns nonzero (NULL, the default,
+**                      accepts every grid)
+**   filter_arg:      Passed to 'filter' as its last argument
+**   error:           The reason that the last message couldn't be unpacked
 **
 ** Overview of the GRIB2Metadata structure:
 **   gds_templ_num:   Grid definition template number
@@ -124,7 +244,8 @@
 **     elat:            Latitude of the last gridpoint
 **     elon:            Longitude of the last gridpoint
 **     loinc:           Longitude increment
-**     lainc:           Latitude increment
+**     lainc:           Latitude increment (for Gaussian grids, the number of
+**                        parallels between a pole and the equator)
 **     scan_mode:       Scanning mode flags
 **
 **   For Mercator grids:
@@ -177,8 +298,55 @@
 **   D:               Decimal scale factor
 **   num_packed:      Number of packed values in the Data Section
 **   pack_width:      Number of bits used for each packed data value
+**   For CCSDS packing:
+**     ccsds.flags:       CCSDS compression options mask
+**     ccsds.block_size:  Block size
+**     ccsds.rsi:         Reference sample interval
 **   bms_ind:         Bit map indicator
-**   bitmap:          Buffer to hold the bitmap
+**   bitmap:          Buffer to hold the bitmap, or NULL if there is none
+**   bitmap_len:      Number of bits in 'bitmap'
+**   gds_off:         Offset in bits from the beginning of 'buffer' to the Grid
+**                      Definition Section
+**   drs_off:         Offset in bits from the beginning of 'buffer' to the Data
+**                      Representation Section
+**   bms_off:         Offset in bits from the beginning of 'buffer' to the Bit
+**                      Map Section that holds the bitmap, if there is one
+**   ds_off:          Offset in bits from the beginning of 'buffer' to the Data
+**                      Section
+**
+** Overview of the GRIB2Match structure (a field that is GRIB_ANY matches any
+**   value; grib2_match_any sets all of them to GRIB_ANY):
+**   disc:            Discipline number
+**   param_cat:       GRIB2 parameter category
+**   param_num:       GRIB2 parameter number
+**   lvl1_type:       Type of first level
+**   lvl1:            Value of first level
+**   lvl2_type:       Type of second level
+**   lvl2:            Value of second level
+**   gen_proc:        Type of generating process
+**   time_unit:       Indicator of unit of time range
+**   fcst_time:       Forecast time
+**   perturb_num:     Perturbation number of an ensemble member (grids that
+**                      aren't ensemble members never match it)
+**
+** example C syntax for unpacking only the 500 hPa geopotential height and the
+**   2 m temperature:
+**    GRIB2Match matches[2];
+**
+**    grib2_match_any(&matches[0]);
+**    matches[0].disc=0;
+**    matches[0].param_cat=3;
+**    matches[0].param_num=5;
+**    matches[0].lvl1_type=100;
+**    matches[0].lvl1=50000.;
+**    grib2_match_any(&matches[1]);
+**    matches[1].disc=0;
+**    matches[1].param_cat=0;
+**    matches[1].param_num=0;
+**    matches[1].lvl1_type=103;
+**    matches[1].lvl1=2.;
+**    grib2_msg.matches=matches;
+**    grib2_msg.num_matches=2;
 **
 ** Overview of the GRIB2Grid structure:
 **   md:          Metadata that is common to all grids in the message
@@ -188,14 +356,27 @@
 **   gcapacity:   For internal use only (the capacity of 'gridpoints', used to
 **                  minimize memory allocations)
 */
+#ifndef UNPACKGRIB2_C
+#define UNPACKGRIB2_C
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
+#ifdef PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#include "grib_scheduler.c"
+#endif
+#include "grib_parallel.c"
 #ifdef JASPER
 #include <jasper/jasper.h>
 #endif
+#ifdef AEC
+#include <libaec.h>
+#endif
 
 #ifdef JASPER
 int dec_jpeg2000(char *injpc,int bufsize,int *outfld)
@@ -261,7 +442,7 @@ int dec_jpeg2000(char *injpc,int bufsize,int *outfld)
 //       
     image=jpc_decode(jpcstream,opts);
     if ( image == 0 ) {
-       printf(" jpc_decode return = %d \n",ier);
+       jas_stream_close(jpcstream);
        return -3;
     }
     
@@ -271,7 +452,8 @@ int dec_jpeg2000(char *injpc,int bufsize,int *outfld)
 //   No color components.
 //
     if (image->numcmpts_ != 1 ) {
-       printf("dec_jpeg2000: Found color image.  Grayscale expected.\n");
+       jas_image_destroy(image);
+       jas_stream_close(jpcstream);
        return (-5);
     }
 
@@ -301,7 +483,18 @@ int dec_jpeg2000(char *injpc,int bufsize,int *outfld)
 }
 #endif
 
-const double GRIB_MISSING_VALUE=1.e30;
+/* the missing value and the status codes are the same as in unpackgrib1.c, so
+**   that both files can be included in the same program
+*/
+#define GRIB_MISSING_VALUE 1.e30
+#define GRIB_EOF -1
+#define GRIB_READ_ERROR 1
+#define GRIB_UNSUPPORTED 2
+#define GRIB_BAD_MESSAGE 3
+#define GRIB_DECODE_ERROR 4
+#define GRIB_NO_MATCH 5
+/* a predicate of a filter that is GRIB_ANY matches any value */
+#define GRIB_ANY INT_MIN
 
 typedef struct {
   int gds_templ_num;
@@ -352,11 +545,16 @@ typedef struct {
 	int order,order_vals_width;
     } spatial_diff;
   } complex_pack;
+  struct {
+    int flags,block_size,rsi;
+  } ccsds;
   int drs_templ_num;
   float R;
   int E,D,num_packed,pack_width,orig_val_type;
   int bms_ind;
   unsigned char *bitmap;
+  size_t bitmap_len;
+  size_t gds_off,drs_off,bms_off,ds_off;
 } GRIB2Metadata;
 
 typedef struct {
@@ -366,6 +564,14 @@ typedef struct {
 } GRIB2Grid;
 
 typedef struct {
+  int disc,param_cat,param_num;
+  int lvl1_type,lvl2_type;
+  double lvl1,lvl2;
+  int gen_proc,time_unit,fcst_time;
+  int perturb_num;
+} GRIB2Match;
+
+typedef struct GRIB2Message {
   unsigned char *buffer;
   size_t buffer_capacity;
   int offset;  /* offset in bytes to next GRIB2 section */
@@ -374,11 +580,24 @@ typedef struct {
   int yr,mo,dy,time;
   int prod_status,data_type;
   GRIB2Metadata md;
+  int unpack_simple;
   int num_grids;
   GRIB2Grid *grids;
   size_t grid_capacity;
+  unsigned char **bitmaps;
+  size_t *bitmap_lens;
+  size_t num_bitmaps,bitmap_capacity;
+  int num_threads,concurrent_grids;
+  int stride;
+  const GRIB2Match *matches;
+  size_t num_matches;
+  int (*filter)(const struct GRIB2Message *grib2_msg,const GRIB2Metadata *md,void *filter_arg);
+  void *filter_arg;
+  char error[256];
 } GRIB2Message;
 
+#ifndef GRIB_GET_BITS
+#define GRIB_GET_BITS
 /* get_bits gets the contents of the various GRIB octets
 **   buf is the GRIB2 buffer as a stream of bytes
 **   loc is the variable to hold the octet contents
@@ -386,17 +605,21 @@ typedef struct {
 **       of the octet(s) to be unpacked
 **   bits is the number of BITS to unpack - will be a multiple of 8 since GRIB2
 **       octets are 8 bits long
+**   returns 0, or 1 (with 'loc' set to 0) if 'bits' won't fit in 'loc'
+**
+** get_bits is the same in unpackgrib1.c and unpackgrib2.c, so it is only
+**   defined once if both are included
 */
-void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
+int get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
 {
 /* no work to do */
   if (bits == 0) {
-    return;
+    return 0;
   }
   size_t loc_size=sizeof(int)*8;
   if (bits > loc_size) {
-    fprintf(stderr,"Error: unpacking %d bits into a %d-bit field\n",bits,loc_size);
-    exit(1);
+    *loc=0;
+    return 1;
   }
   else {
 /* create masks to use when right-shifting (necessary because different
@@ -407,11 +630,6 @@ void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
 	bmask<<=1;
 	bmask++;
     }
-    int lmask=1;
-    for (size_t n=1; n < loc_size; ++n) {
-	lmask<<=1;
-	lmask++;
-    }
 /* get number of words to skip before unpacking begins */
     size_t wskip=off/buf_size;
 /* right shift the bits in the packed buffer "word" to eliminate unneeded
@@ -421,7 +639,7 @@ void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
     if (rshift < 0) {
 	*loc=0;
 	while (rshift < 0) {
-	  int temp=buf[wskip++];
+	  unsigned int temp=buf[wskip++];
 	  *loc+=(temp<<-rshift);
 	  rshift+=buf_size;
 	}
@@ -437,9 +655,23 @@ void get_bits(unsigned char *buf,int *loc,size_t off,size_t bits)
     }
 /* remove any unneeded leading bits */
     if (bits != loc_size) {
-	*loc&=~(lmask<<bits);
+	*loc&=(1u << bits)-1;
     }
   }
+  return 0;
+}
+#endif
+
+/* grib2_error records the reason that a message can't be unpacked in 'error'
+**   and returns 'status'
+*/
+int grib2_error(GRIB2Message *grib2_msg,int status,const char *format,...)
+{
+  va_list ap;
+  va_start(ap,format);
+  vsnprintf(grib2_msg->error,sizeof(grib2_msg->error),format,ap);
+  va_end(ap);
+  return status;
 }
 
 void initialize(GRIB2Message *grib2_msg)
@@ -449,6 +681,97 @@ void initialize(GRIB2Message *grib2_msg)
   grib2_msg->grids=NULL;
   grib2_msg->grid_capacity=0;
   grib2_msg->md.stat_proc.proc_code=NULL;
+  grib2_msg->md.bitmap=NULL;
+  grib2_msg->md.bitmap_len=0;
+  grib2_msg->unpack_simple=1;
+  grib2_msg->bitmaps=NULL;
+  grib2_msg->bitmap_lens=NULL;
+  grib2_msg->num_bitmaps=grib2_msg->bitmap_capacity=0;
+  grib2_msg->num_threads=grib_default_threads();
+  grib2_msg->concurrent_grids=1;
+  grib2_msg->stride=1;
+  grib2_msg->matches=NULL;
+  grib2_msg->num_matches=0;
+  grib2_msg->filter=NULL;
+  grib2_msg->filter_arg=NULL;
+  grib2_msg->error[0]='\0';
+}
+
+/* free_grib2_message frees the buffers of a GRIB2Message; the message can still
+**   be used to unpack more messages, which allocate them again
+*/
+void free_grib2_message(GRIB2Message *grib2_msg)
+{
+  free(grib2_msg->buffer);
+  grib2_msg->buffer=NULL;
+  grib2_msg->buffer_capacity=0;
+  for (size_t n=0; n < grib2_msg->grid_capacity; ++n) {
+    free(grib2_msg->grids[n].gridpoints);
+  }
+  free(grib2_msg->grids);
+  grib2_msg->grids=NULL;
+  grib2_msg->grid_capacity=0;
+  grib2_msg->num_grids=0;
+  if (grib2_msg->md.stat_proc.proc_code != NULL) {
+    free(grib2_msg->md.stat_proc.proc_code);
+    free(grib2_msg->md.stat_proc.incr_type);
+    free(grib2_msg->md.stat_proc.time_unit);
+    free(grib2_msg->md.stat_proc.time_length);
+    free(grib2_msg->md.stat_proc.incr_unit);
+    free(grib2_msg->md.stat_proc.incr_length);
+    grib2_msg->md.stat_proc.proc_code=NULL;
+  }
+  for (size_t n=0; n < grib2_msg->bitmap_capacity; ++n) {
+    free(grib2_msg->bitmaps[n]);
+  }
+  free(grib2_msg->bitmaps);
+  free(grib2_msg->bitmap_lens);
+  grib2_msg->bitmaps=NULL;
+  grib2_msg->bitmap_lens=NULL;
+  grib2_msg->num_bitmaps=grib2_msg->bitmap_capacity=0;
+  grib2_msg->md.bitmap=NULL;
+  grib2_msg->md.bitmap_len=0;
+}
+
+/* grib2_match_any sets all of the predicates of 'match' to GRIB_ANY, so that
+**   only the ones that are set afterwards are checked
+*/
+void grib2_match_any(GRIB2Match *match)
+{
+  match->disc=match->param_cat=match->param_num=GRIB_ANY;
+  match->lvl1_type=match->lvl2_type=GRIB_ANY;
+  match->lvl1=match->lvl2=GRIB_ANY;
+  match->gen_proc=match->time_unit=match->fcst_time=GRIB_ANY;
+  match->perturb_num=GRIB_ANY;
+}
+
+/* grib2_level_matches compares level values, which are decoded from a scaled
+**   integer, with a relative tolerance
+*/
+int grib2_level_matches(double match,double value)
+{
+  return (match == GRIB_ANY || fabs(value-match) <= 1.e-6*fabs(match));
+}
+
+/* grib2_grid_matches returns 1 if the grid described by 'md' passes the filter
+**   of a message: it matches at least one of 'matches' (when there are any),
+**   and 'filter' (when it is set) accepts it; otherwise it returns 0
+*/
+int grib2_grid_matches(const GRIB2Message *grib2_msg,const GRIB2Metadata *md)
+{
+  if (grib2_msg->num_matches > 0) {
+    size_t n;
+    for (n=0; n < grib2_msg->num_matches; ++n) {
+	const GRIB2Match *m=&grib2_msg->matches[n];
+	if ((m->disc == GRIB_ANY || m->disc == grib2_msg->disc) && (m->param_cat == GRIB_ANY || m->param_cat == md->param_cat) && (m->param_num == GRIB_ANY || m->param_num == md->param_num) && (m->lvl1_type == GRIB_ANY || m->lvl1_type == md->lvl1_type) && grib2_level_matches(m->lvl1,md->lvl1) && (m->lvl2_type == GRIB_ANY || m->lvl2_type == md->lvl2_type) && grib2_level_matches(m->lvl2,md->lvl2) && (m->gen_proc == GRIB_ANY || m->gen_proc == md->gen_proc) && (m->time_unit == GRIB_ANY || m->time_unit == md->time_unit) && (m->fcst_time == GRIB_ANY || m->fcst_time == md->fcst_time) && (m->perturb_num == GRIB_ANY || (md->ens_type >= 0 && m->perturb_num == md->perturb_num))) {
+	  break;
+	}
+    }
+    if (n == grib2_msg->num_matches) {
+	return 0;
+    }
+  }
+  return (grib2_msg->filter == NULL || grib2_msg->filter(grib2_msg,md,grib2_msg->filter_arg) != 0);
 }
 
 int unpack_IS(FILE *fp,GRIB2Message *grib2_msg)
@@ -521,6 +844,15 @@ int unpack_IS(FILE *fp,GRIB2Message *grib2_msg)
   get_bits(temp,&grib2_msg->disc,48,8);
   get_bits(temp,&grib2_msg->ed_num,56,8);
   get_bits(temp,&grib2_msg->total_len,96,32);
+/* the stream is left after the Indicator Section, so the next call to
+**   unpack_IS will look for the next message */
+  grib2_msg->error[0]='\0';
+  if (grib2_msg->ed_num != 2) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"edition number %d is not 2",grib2_msg->ed_num);
+  }
+  if (grib2_msg->total_len < 20) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"message length %d is too short",grib2_msg->total_len);
+  }
   grib2_msg->md.nx=grib2_msg->md.ny=0;
   size_t required_size=grib2_msg->total_len+4;
   if (required_size > grib2_msg->buffer_capacity) {
@@ -529,6 +861,10 @@ int unpack_IS(FILE *fp,GRIB2Message *grib2_msg)
     }
     grib2_msg->buffer_capacity=required_size;
     grib2_msg->buffer=(unsigned char *)malloc(grib2_msg->buffer_capacity*sizeof(unsigned char));
+    if (grib2_msg->buffer == NULL) {
+	grib2_msg->buffer_capacity=0;
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate a message of %d octets",grib2_msg->total_len);
+    }
   }
   memcpy(grib2_msg->buffer,temp,16);
   size_t num=grib2_msg->total_len-16;
@@ -545,11 +881,14 @@ int unpack_IS(FILE *fp,GRIB2Message *grib2_msg)
   }
 }
 
-void unpack_IDS(GRIB2Message *grib2_msg)
+int unpack_IDS(GRIB2Message *grib2_msg)
 {
   int length;
 /* length of the IDS */
   get_bits(grib2_msg->buffer,&length,grib2_msg->offset,32);
+  if (length < 21 || grib2_msg->offset+(size_t)length*8 > (size_t)grib2_msg->total_len*8) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"Identification Section length %d is not valid",length);
+  }
 /* center ID */
   get_bits(grib2_msg->buffer,&grib2_msg->center_id,grib2_msg->offset+40,16);
 /* sub-center ID */
@@ -581,27 +920,28 @@ void unpack_IDS(GRIB2Message *grib2_msg)
 /* type of data */
   get_bits(grib2_msg->buffer,&grib2_msg->data_type,grib2_msg->offset+160,8);
   grib2_msg->offset+=length*8;
+  return 0;
 }
 
-void unpack_LUS(GRIB2Message *grib2_msg)
+int unpack_LUS(GRIB2Message *grib2_msg)
 {
+  return 0;
 }
 
-void unpack_GDS(GRIB2Message *grib2_msg)
+int unpack_GDS(GRIB2Message *grib2_msg)
 {
+  grib2_msg->md.gds_off=grib2_msg->offset;
 /* source of grid definition */
   int src;
   get_bits(grib2_msg->buffer,&src,grib2_msg->offset+40,8);
   if (src != 0) {
-    fprintf(stderr,"Don't recognize predetermined grid definitions");
-    exit(1);
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"predetermined grid definitions (source %d) are not recognized",src);
   }
 /* quasi-regular grid indication */
   int num_in_list;
   get_bits(grib2_msg->buffer,&num_in_list,grib2_msg->offset+80,8);
   if (num_in_list > 0) {
-    fprintf(stderr,"Unable to unpack quasi-regular grids");
-    exit(1);
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"unable to unpack quasi-regular grids");
   }
 /* grid definition template number */
   get_bits(grib2_msg->buffer,&grib2_msg->md.gds_templ_num,grib2_msg->offset+96,16);
@@ -651,11 +991,15 @@ void unpack_GDS(GRIB2Message *grib2_msg)
 /* longitude increment */
 	get_bits(grib2_msg->buffer,&value,grib2_msg->offset+504,32);
 	grib2_msg->md.xinc.loinc=value/1000000.;
-/* latitude increment */
+/* latitude increment, or the number of parallels between a pole and the
+**   equator of a Gaussian grid */
 	get_bits(grib2_msg->buffer,&value,grib2_msg->offset+536,32);
 	if (grib2_msg->md.gds_templ_num == 0) {
 	  grib2_msg->md.yinc.lainc=value/1000000.;
 	}
+	else {
+	  grib2_msg->md.yinc.lainc=value;
+	}
 /* scanning mode flag */
 	get_bits(grib2_msg->buffer,&grib2_msg->md.scan_mode,grib2_msg->offset+568,8);
 	break;
@@ -799,20 +1143,28 @@ void unpack_GDS(GRIB2Message *grib2_msg)
     }
     default:
     {
-	fprintf(stderr,"Grid template %d is not understood\n",grib2_msg->md.gds_templ_num);
-	exit(1);
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"grid template %d is not understood",grib2_msg->md.gds_templ_num);
     }
   }
+/* the dimensions must agree with the number of data points, which also keeps
+**   nx*ny inside of an int */
+  int num_points;
+  get_bits(grib2_msg->buffer,&num_points,grib2_msg->offset+48,32);
+  if (grib2_msg->md.nx <= 0 || grib2_msg->md.ny <= 0 || num_points <= 0 || (long long)grib2_msg->md.nx*grib2_msg->md.ny != num_points) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid dimensions %d x %d don't match the %d data points",grib2_msg->md.nx,grib2_msg->md.ny,num_points);
+  }
+  return 0;
 }
 
-void unpack_PDS(GRIB2Message *grib2_msg)
+int unpack_PDS(GRIB2Message *grib2_msg)
 {
+  int len;
+  get_bits(grib2_msg->buffer,&len,grib2_msg->offset,32);
 /* indication of hybrid coordinate system */
   int num_coords;
   get_bits(grib2_msg->buffer,&num_coords,grib2_msg->offset+40,16);
   if (num_coords > 0) {
-    fprintf(stderr,"Unable to decode hybrid coordinates");
-    exit(1);
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"unable to decode hybrid coordinates");
   }
 /* product definition template number */
   get_bits(grib2_msg->buffer,&grib2_msg->md.pds_templ_num,grib2_msg->offset+56,16);
@@ -841,7 +1193,8 @@ void unpack_PDS(GRIB2Message *grib2_msg)
 	get_bits(grib2_msg->buffer,&grib2_msg->md.fcst_time,grib2_msg->offset+144,32);
 /* type of first level */
 	get_bits(grib2_msg->buffer,&grib2_msg->md.lvl1_type,grib2_msg->offset+176,8);
-/* value of first level */
+/* value of first level; the scale factor has a sign bit, and is all ones if
+** the level has no value */
 	int factor;
 	get_bits(grib2_msg->buffer,&factor,grib2_msg->offset+184,8);
 	int sign;
@@ -851,7 +1204,15 @@ void unpack_PDS(GRIB2Message *grib2_msg)
 	if (sign == 1) {
 	  value=-value;
 	}
-	grib2_msg->md.lvl1=(double)value/pow(10.,(double)factor);
+	if (factor == 0xff) {
+	  grib2_msg->md.lvl1=0.;
+	}
+	else {
+	  if ((factor & 0x80) == 0x80) {
+	    factor=-(factor & 0x7f);
+	  }
+	  grib2_msg->md.lvl1=(double)value/pow(10.,(double)factor);
+	}
 /* type of second level */
 	get_bits(grib2_msg->buffer,&grib2_msg->md.lvl2_type,grib2_msg->offset+224,8);
 /* value of second level */
@@ -861,7 +1222,15 @@ void unpack_PDS(GRIB2Message *grib2_msg)
 	if (sign == 1) {
 	  value=-value;
 	}
-	grib2_msg->md.lvl2=(double)value/pow(10.,(double)factor);
+	if (factor == 0xff) {
+	  grib2_msg->md.lvl2=0.;
+	}
+	else {
+	  if ((factor & 0x80) == 0x80) {
+	    factor=-(factor & 0x7f);
+	  }
+	  grib2_msg->md.lvl2=(double)value/pow(10.,(double)factor);
+	}
 	switch (grib2_msg->md.pds_templ_num) {
 	  case 1:
 	  case 11:
@@ -886,6 +1255,9 @@ void unpack_PDS(GRIB2Message *grib2_msg)
 		  get_bits(grib2_msg->buffer,&grib2_msg->md.stat_proc.num_ranges,grib2_msg->offset+352,8);
 /* number of values missing from process */
 		  get_bits(grib2_msg->buffer,&grib2_msg->md.stat_proc.nmiss,grib2_msg->offset+360,32);
+		  if (392+(size_t)grib2_msg->md.stat_proc.num_ranges*96 > (size_t)len*8) {
+		    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the time ranges don't fit in the Product Definition Section");
+		  }
 		  if (grib2_msg->md.stat_proc.proc_code != NULL) {
 		    free(grib2_msg->md.stat_proc.proc_code);
 		    free(grib2_msg->md.stat_proc.incr_type);
@@ -938,6 +1310,9 @@ void unpack_PDS(GRIB2Message *grib2_msg)
 		  get_bits(grib2_msg->buffer,&grib2_msg->md.stat_proc.num_ranges,grib2_msg->offset+344,8);
 /* number of values missing from process */
 		  get_bits(grib2_msg->buffer,&grib2_msg->md.stat_proc.nmiss,grib2_msg->offset+352,32);
+		  if (384+(size_t)grib2_msg->md.stat_proc.num_ranges*96 > (size_t)len*8) {
+		    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the time ranges don't fit in the Product Definition Section");
+		  }
 		  if (grib2_msg->md.stat_proc.proc_code != NULL) {
 		    free(grib2_msg->md.stat_proc.proc_code);
 		    free(grib2_msg->md.stat_proc.incr_type);
@@ -984,6 +1359,9 @@ void unpack_PDS(GRIB2Message *grib2_msg)
 	    get_bits(grib2_msg->buffer,&grib2_msg->md.stat_proc.num_ranges,grib2_msg->offset+328,8);
 /* number of values missing from process */
 	    get_bits(grib2_msg->buffer,&grib2_msg->md.stat_proc.nmiss,grib2_msg->offset+336,32);
+	    if (368+(size_t)grib2_msg->md.stat_proc.num_ranges*96 > (size_t)len*8) {
+	      return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the time ranges don't fit in the Product Definition Section");
+	    }
 	    if (grib2_msg->md.stat_proc.proc_code != NULL) {
 		free(grib2_msg->md.stat_proc.proc_code);
 		free(grib2_msg->md.stat_proc.incr_type);
@@ -1023,19 +1401,20 @@ void unpack_PDS(GRIB2Message *grib2_msg)
     }
     default:
     {
-	fprintf(stderr,"Product Definition Template %d is not understood\n",grib2_msg->md.pds_templ_num);
-	exit(1);
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"product definition template %d is not understood",grib2_msg->md.pds_templ_num);
     }
   }
+  return 0;
 }
 
-void unpack_DRS(GRIB2Message *grib2_msg)
+int unpack_DRS(GRIB2Message *grib2_msg)
 {
   union {
     float fval;
     int ival;
   } u;
 
+  grib2_msg->md.drs_off=grib2_msg->offset;
 /* number of packed values */
   get_bits(grib2_msg->buffer,&grib2_msg->md.num_packed,grib2_msg->offset+40,32);
 /* data representation template number */
@@ -1046,6 +1425,9 @@ void unpack_DRS(GRIB2Message *grib2_msg)
 #ifdef JASPER
     case 40:
     case 40000:
+#endif
+#ifdef AEC
+    case 42:
 #endif
     {
 	get_bits(grib2_msg->buffer,(int *)&grib2_msg->md.R,grib2_msg->offset+88,32);
@@ -1065,6 +1447,9 @@ void unpack_DRS(GRIB2Message *grib2_msg)
 	grib2_msg->md.D=value;
 	grib2_msg->md.R/=pow(10.,grib2_msg->md.D);
 	get_bits(grib2_msg->buffer,&grib2_msg->md.pack_width,grib2_msg->offset+152,8);
+	if (grib2_msg->md.pack_width > 32) {
+	  return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"packing width %d is more than 32 bits",grib2_msg->md.pack_width);
+	}
 	get_bits(grib2_msg->buffer,&grib2_msg->md.orig_val_type,grib2_msg->offset+160,8);
 	if (grib2_msg->md.drs_templ_num == 3) {
 	  get_bits(grib2_msg->buffer,&grib2_msg->md.complex_pack.split_method,grib2_msg->offset+168,8);
@@ -1082,8 +1467,7 @@ void unpack_DRS(GRIB2Message *grib2_msg)
 	    grib2_msg->md.complex_pack.secondary_miss_sub=u.ival;
 	  }
 	  else {
-	    fprintf(stderr,"Unable to decode missing value substitutes for original value type %d\n",grib2_msg->md.orig_val_type);
-	    exit(1);
+	    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"unable to decode missing value substitutes for original value type %d",grib2_msg->md.orig_val_type);
 	  }
 	  get_bits(grib2_msg->buffer,&grib2_msg->md.complex_pack.num_groups,grib2_msg->offset+248,32);
 	  get_bits(grib2_msg->buffer,&grib2_msg->md.complex_pack.width.ref,grib2_msg->offset+280,8);
@@ -1094,18 +1478,26 @@ void unpack_DRS(GRIB2Message *grib2_msg)
 	  get_bits(grib2_msg->buffer,&grib2_msg->md.complex_pack.length.pack_width,grib2_msg->offset+368,8);
 	  get_bits(grib2_msg->buffer,&grib2_msg->md.complex_pack.spatial_diff.order,grib2_msg->offset+376,8);
 	  get_bits(grib2_msg->buffer,&grib2_msg->md.complex_pack.spatial_diff.order_vals_width,grib2_msg->offset+384,8);
+	  if (grib2_msg->md.complex_pack.width.pack_width > 32 || grib2_msg->md.complex_pack.length.pack_width > 32 || grib2_msg->md.complex_pack.spatial_diff.order_vals_width > 4) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"a complex packing width is too large to unpack");
+	  }
+	}
+	else if (grib2_msg->md.drs_templ_num == 42) {
+	  get_bits(grib2_msg->buffer,&grib2_msg->md.ccsds.flags,grib2_msg->offset+168,8);
+	  get_bits(grib2_msg->buffer,&grib2_msg->md.ccsds.block_size,grib2_msg->offset+176,8);
+	  get_bits(grib2_msg->buffer,&grib2_msg->md.ccsds.rsi,grib2_msg->offset+184,16);
 	}
 	break;
     }
     default:
     {
-	fprintf(stderr,"Data template %d is not understood\n",grib2_msg->md.drs_templ_num);
-	exit(1);
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"data template %d is not understood",grib2_msg->md.drs_templ_num);
     }
   }
+  return 0;
 }
 
-void unpack_BMS(GRIB2Message *grib2_msg)
+int unpack_BMS(GRIB2Message *grib2_msg)
 {
 /* bit map indicator */
   int ind;
@@ -1115,57 +1507,903 @@ void unpack_BMS(GRIB2Message *grib2_msg)
     {
 	int len;
 	get_bits(grib2_msg->buffer,&len,grib2_msg->offset,32);
+	if (len < 6) {
+	  return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"Bit Map Section length %d is not valid",len);
+	}
 	len=(len-6)*8;
-	grib2_msg->md.bitmap=(unsigned char *)malloc(len*sizeof(unsigned char));
-	for (size_t n=0; n < len; ++n) {
-	  int bit;
-	  get_bits(grib2_msg->buffer,&bit,grib2_msg->offset+48+n,1);
-	  grib2_msg->md.bitmap[n]=bit;
+/* the bitmaps are kept in the message and reused by the next message, instead
+**   of being allocated for every message */
+	if (grib2_msg->num_bitmaps == grib2_msg->bitmap_capacity) {
+	  size_t capacity=grib2_msg->bitmap_capacity+4;
+/* the arrays are replaced one at a time, so the message still owns them and
+**   their bitmaps if one can't be grown */
+	  unsigned char **bitmaps=(unsigned char **)realloc(grib2_msg->bitmaps,capacity*sizeof(unsigned char *));
+	  if (bitmaps == NULL) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu bitmaps",capacity);
+	  }
+	  grib2_msg->bitmaps=bitmaps;
+	  size_t *bitmap_lens=(size_t *)realloc(grib2_msg->bitmap_lens,capacity*sizeof(size_t));
+	  if (bitmap_lens == NULL) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu bitmaps",capacity);
+	  }
+	  grib2_msg->bitmap_lens=bitmap_lens;
+	  for (size_t n=grib2_msg->num_bitmaps; n < capacity; ++n) {
+	    grib2_msg->bitmaps[n]=NULL;
+	    grib2_msg->bitmap_lens[n]=0;
+	  }
+	  grib2_msg->bitmap_capacity=capacity;
+	}
+	size_t bnum=grib2_msg->num_bitmaps;
+	if ((size_t)len > grib2_msg->bitmap_lens[bnum]) {
+	  if (grib2_msg->bitmaps[bnum] != NULL) {
+	    free(grib2_msg->bitmaps[bnum]);
+	  }
+	  grib2_msg->bitmap_lens[bnum]=0;
+	  if ( (grib2_msg->bitmaps[bnum]=(unsigned char *)malloc(len*sizeof(unsigned char))) == NULL) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate a bitmap of %d points",len);
+	  }
+	  grib2_msg->bitmap_lens[bnum]=len;
+	}
+	++grib2_msg->num_bitmaps;
+	grib2_msg->md.bitmap=grib2_msg->bitmaps[bnum];
+	grib2_msg->md.bitmap_len=len;
+	grib2_msg->md.bms_off=grib2_msg->offset;
+/* the bitmap starts on an octet boundary, so expand it an octet at a time */
+	unsigned char *b=&grib2_msg->buffer[grib2_msg->offset/8+6];
+	for (size_t n=0; n < len/8; ++n) {
+	  for (size_t m=0; m < 8; ++m) {
+	    grib2_msg->md.bitmap[n*8+m]=(b[n] >> (7-m)) & 0x1;
+	  }
 	}
 	break;
     }
     case 254:
     {
+	if (grib2_msg->md.bitmap == NULL) {
+	  return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"there is no previously defined bitmap to use");
+	}
 	break;
     }
     case 255:
     {
 	grib2_msg->md.bitmap=NULL;
+	grib2_msg->md.bitmap_len=0;
 	break;
     }
     default:
     {
-	fprintf(stderr,"This code is not currently set up to deal with predefined bit-maps\n");
-	exit(1);
+	return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"predefined bitmap %d is not supported",ind);
     }
   }
+  return 0;
 }
 
-void unpack_DS(GRIB2Message *grib2_msg,int grid_num)
+/* the index that grib2_strided_index returns for a gridpoint that isn't kept */
+#define GRIB2_NOT_KEPT ((size_t)-1)
+
+/* grib2_stride_length returns the number of the 'n' points of a row or column
+**   that are kept when only every 'stride'-th one is unpacked, starting with
+**   the first
+*/
+int grib2_stride_length(int n,int stride)
 {
-  float D=pow(10.,grib2_msg->md.D),E=pow(2.,grib2_msg->md.E);
-  size_t off=grib2_msg->offset+40;
-  switch (grib2_msg->md.drs_templ_num) {
+  return (n > 0) ? (n-1)/stride+1 : 0;
+}
+
+/* grib2_strided_points returns the number of gridpoints of a grid that are
+**   kept when only every 'stride'-th gridpoint of every 'stride'-th row is
+**   unpacked
+*/
+size_t grib2_strided_points(const GRIB2Metadata *md,int stride)
+{
+  return (size_t)grib2_stride_length(md->ny,stride)*grib2_stride_length(md->nx,stride);
+}
+
+/* grib2_strided_index returns the index in the strided grid of gridpoint 'n'
+**   (in the order that the gridpoints are packed) of the full grid, or
+**   GRIB2_NOT_KEPT if it isn't kept; with scanning mode 0x10, the rows of both
+**   grids alternate direction, so a gridpoint is kept by its position in the
+**   grid, not in the stream
+*/
+size_t grib2_strided_index(const GRIB2Metadata *md,int stride,size_t n)
+{
+  size_t row_len= ((md->scan_mode & 0x20) == 0) ? md->nx : md->ny;
+  size_t row=n/row_len,col=n % row_len;
+  if ((md->scan_mode & 0x10) != 0 && (row % 2) == 1) {
+    col=row_len-1-col;
+  }
+  if ((row % stride) != 0 || (col % stride) != 0) {
+    return GRIB2_NOT_KEPT;
+  }
+  size_t strided_len=grib2_stride_length(row_len,stride);
+  row/=stride;
+  col/=stride;
+  if ((md->scan_mode & 0x10) != 0 && (row % 2) == 1) {
+    col=strided_len-1-col;
+  }
+  return row*strided_len+col;
+}
+
+/* grib2_strided_source returns the gridpoint of the full grid that is the
+**   n-th of the kept gridpoints in the order that they are packed; this is
+**   the inverse of grib2_strided_index, except for the order of the kept
+**   gridpoints of the reversed rows of scanning mode 0x10
+*/
+size_t grib2_strided_source(const GRIB2Metadata *md,int stride,size_t n)
+{
+  size_t row_len= ((md->scan_mode & 0x20) == 0) ? md->nx : md->ny;
+  size_t strided_len=grib2_stride_length(row_len,stride);
+  size_t row=n/strided_len*stride,col=(n % strided_len)*stride;
+  if ((md->scan_mode & 0x10) != 0 && (row % 2) == 1) {
+    col+=(row_len-1) % stride;
+  }
+  return row*row_len+col;
+}
+
+/* grib2_stride_grid changes the grid definition of a grid that was unpacked
+**   with a stride to describe the strided grid:
+**   - nx and ny are the numbers of kept gridpoints
+**   - the increments (loinc and lainc, or dxinc and dyinc) are multiplied by
+**     the stride, except for the number of parallels of a Gaussian grid in
+**     'lainc'
+**   - elat and elon are the latitude and longitude of the last kept gridpoint,
+**     which is not the last gridpoint of the full grid unless nx-1 (or ny-1)
+**     is a multiple of the stride; for a Gaussian grid, elat is not changed,
+**     and the kept rows are on every 'stride'-th Gaussian latitude
+**   - the bitmap is removed, since the missing gridpoints are set to
+**     GRIB_MISSING_VALUE
+*/
+void grib2_stride_grid(GRIB2Metadata *md,int stride)
+{
+  int nx=grib2_stride_length(md->nx,stride),ny=grib2_stride_length(md->ny,stride);
+  double xfrac= (md->nx > 1) ? (double)(nx-1)*stride/(md->nx-1) : 0.;
+  double yfrac= (md->ny > 1) ? (double)(ny-1)*stride/(md->ny-1) : 0.;
+  switch (md->gds_templ_num) {
     case 0:
+    case 10:
+    case 40:
+    {
+	double dlon=md->lons.elon-md->slon;
+	if ((md->scan_mode & 0x80) == 0 && dlon < 0.) {
+	  dlon+=360.;
+	}
+	else if ((md->scan_mode & 0x80) != 0 && dlon > 0.) {
+	  dlon-=360.;
+	}
+	md->lons.elon=md->slon+dlon*xfrac;
+	if (md->lons.elon < 0.) {
+	  md->lons.elon+=360.;
+	}
+	else if (md->lons.elon >= 360.) {
+	  md->lons.elon-=360.;
+	}
+	if (md->gds_templ_num == 0) {
+	  md->lats.elat=md->slat+(md->lats.elat-md->slat)*yfrac;
+	  md->xinc.loinc*=stride;
+	  md->yinc.lainc*=stride;
+	}
+	else if (md->gds_templ_num == 40) {
+	  md->xinc.loinc*=stride;
+	}
+	else {
+/* Mercator: the rows are evenly spaced in the projected y */
+	  double quarter_pi=atan(1.),rad=quarter_pi/45.;
+	  double y1=log(tan(quarter_pi+md->slat*rad/2.));
+	  double y2=log(tan(quarter_pi+md->lats.elat*rad/2.));
+	  md->lats.elat=(2.*atan(exp(y1+(y2-y1)*yfrac))-2.*quarter_pi)/rad;
+	  md->xinc.dxinc*=stride;
+	  md->yinc.dyinc*=stride;
+	}
+	break;
+    }
+    case 30:
     {
-	size_t required_size=grib2_msg->md.ny*grib2_msg->md.nx;
-	if (required_size > grib2_msg->grids[grid_num].gcapacity) {
-	  if (grib2_msg->grids[grid_num].gridpoints != NULL) {
-	    free(grib2_msg->grids[grid_num].gridpoints);
+	md->xinc.dxinc*=stride;
+	md->yinc.dyinc*=stride;
+	break;
+    }
+  }
+  md->nx=nx;
+  md->ny=ny;
+  md->bitmap=NULL;
+  md->bitmap_len=0;
+}
+
+/* reserve_gridpoints makes sure that the gridpoints of a grid can hold all of
+**   its points, or the points that are kept with a 'stride' greater than 1
+*/
+int reserve_gridpoints(GRIB2Message *grib2_msg,GRIB2Grid *grid,int stride)
+{
+  size_t required_size=grib2_strided_points(&grid->md,stride);
+  if (required_size > grid->gcapacity) {
+    if (grid->gridpoints != NULL) {
+	free(grid->gridpoints);
+    }
+    grid->gridpoints=(double *)malloc(required_size*sizeof(double));
+    if (grid->gridpoints == NULL) {
+	grid->gcapacity=0;
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu gridpoints",required_size);
+    }
+    grid->gcapacity=required_size;
+  }
+  return 0;
+}
+
+/* check_data_length makes sure that the Data Section of a grid is long enough
+**   to hold 'num_values' values of 'width' bits
+*/
+int check_data_length(GRIB2Message *grib2_msg,const GRIB2Metadata *md,size_t num_values,size_t width)
+{
+  int len;
+  get_bits(grib2_msg->buffer,&len,md->ds_off,32);
+  if (num_values*width > ((size_t)len-5)*8) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the Data Section is too short to hold %zu %zu-bit values",num_values,width);
+  }
+  return 0;
+}
+
+/* check_grid_values makes sure that the bitmap of a grid covers all of its
+**   gridpoints; if 'num_values' is not NULL, it is set to the number of
+**   gridpoints that have a value, and the Data Section must be long enough to
+**   hold that many values of 'width' bits
+*/
+int check_grid_values(GRIB2Message *grib2_msg,const GRIB2Metadata *md,size_t width,size_t *num_values)
+{
+  size_t num_points=(size_t)md->ny*md->nx;
+  if (md->bitmap != NULL && md->bitmap_len < num_points) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the bitmap has %zu points, but the grid has %zu",md->bitmap_len,num_points);
+  }
+  if (num_values == NULL) {
+    return 0;
+  }
+  *num_values=num_points;
+  if (md->bitmap != NULL) {
+    *num_values=0;
+    for (size_t n=0; n < num_points; ++n) {
+	*num_values+=md->bitmap[n];
+    }
+  }
+  return check_data_length(grib2_msg,md,*num_values,width);
+}
+
+/* SimpleChunks holds what the threads that unpack the chunks of a grid with
+**   simple packing need
+*/
+typedef struct {
+  unsigned char *buffer;
+  GRIB2Grid *grid;
+  size_t *offsets;
+  const unsigned char *bits;
+  int stride;
+  float D,E;
+} SimpleChunks;
+
+/* count_simple_values sets the offset of a chunk to the number of its
+**   gridpoints that have a value in the bitmap
+*/
+void count_simple_values(void *arg,size_t chunk,size_t start,size_t end)
+{
+  SimpleChunks *s=(SimpleChunks *)arg;
+  size_t num_values=0;
+  for (size_t n=start; n < end; ++n) {
+    num_values+=s->grid->md.bitmap[n];
+  }
+  s->offsets[chunk]=num_values;
+}
+
+/* unpack_simple_chunk unpacks the gridpoints 'start' to 'end'-1 of a grid with
+**   simple packing; the first packed value of the chunk is at the offset of the
+**   chunk
+*/
+void unpack_simple_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  SimpleChunks *s=(SimpleChunks *)arg;
+  const GRIB2Metadata *md=&s->grid->md;
+  size_t off=s->offsets[chunk];
+  for (size_t n=start; n < end; ++n) {
+    if (md->bitmap == NULL || md->bitmap[n] == 1) {
+	int pval=0;
+	if (md->pack_width > 0) {
+	  get_bits(s->buffer,&pval,off,md->pack_width);
+	}
+	s->grid->gridpoints[n]=md->R+pval*s->E/s->D;
+	off+=md->pack_width;
+    }
+    else {
+	s->grid->gridpoints[n]=GRIB_MISSING_VALUE;
+    }
+  }
+}
+
+/* unpack_simple_packing unpacks the gridpoints of a grid with simple packing
+**   (DRS Template 5.0), using the locations in the metadata of the grid
+**
+**   value k of the grid is at bit k*pack_width of the packed data, so a large
+**   grid is split into chunks that are unpacked by 'num_threads' threads; with
+**   a bitmap, the number of values in each chunk is counted first, and the sums
+**   of the counts give the offset of each chunk
+*/
+int unpack_simple_packing(GRIB2Message *grib2_msg,int grid_num)
+{
+  GRIB2Grid *grid=&grib2_msg->grids[grid_num];
+  size_t num_points=(size_t)grid->md.ny*grid->md.nx;
+  int status;
+  if ( (status=check_grid_values(grib2_msg,&grid->md,0,NULL)) != 0) {
+    return status;
+  }
+  SimpleChunks s;
+  s.buffer=grib2_msg->buffer;
+  s.grid=grid;
+  s.D=pow(10.,grid->md.D);
+  s.E=pow(2.,grid->md.E);
+  size_t num_chunks=grib_num_chunks(num_points,grib2_msg->num_threads);
+  size_t offset;
+  s.offsets= (num_chunks > 1) ? (size_t *)malloc(num_chunks*sizeof(size_t)) : &offset;
+  if (s.offsets == NULL) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate %zu chunks",num_chunks);
+  }
+  size_t num_values=0;
+  if (grid->md.bitmap != NULL) {
+    grib_parallel_for(num_points,grib2_msg->num_threads,count_simple_values,&s);
+    for (size_t n=0; n < num_chunks; ++n) {
+	size_t num_chunk_values=s.offsets[n];
+	s.offsets[n]=grid->md.ds_off+40+num_values*grid->md.pack_width;
+	num_values+=num_chunk_values;
+    }
+  }
+  else {
+    for (size_t n=0; n < num_chunks; ++n) {
+	s.offsets[n]=grid->md.ds_off+40+num_points*n/num_chunks*grid->md.pack_width;
+    }
+    num_values=num_points;
+  }
+  if ( (status=check_data_length(grib2_msg,&grid->md,num_values,grid->md.pack_width)) == 0 && (status=reserve_gridpoints(grib2_msg,grid,1)) == 0) {
+    grib_parallel_for(num_points,grib2_msg->num_threads,unpack_simple_chunk,&s);
+  }
+  if (num_chunks > 1) {
+    free(s.offsets);
+  }
+  return status;
+}
+
+/* grib2_count_bits returns the number of bits that are set in the bits 'start'
+**   to 'end'-1 of 'bits', counting 64 bits at a time
+*/
+size_t grib2_count_bits(const unsigned char *bits,size_t start,size_t end)
+{
+  size_t count=0;
+  for (; start < end && (start & 7) != 0; ++start) {
+    count+=(bits[start/8] >> (7-(start & 7))) & 0x1;
+  }
+  for (; start+64 <= end; start+=64) {
+    unsigned long long x;
+    memcpy(&x,&bits[start/8],8);
+    x-=(x >> 1) & 0x5555555555555555ULL;
+    x=(x & 0x3333333333333333ULL)+((x >> 2) & 0x3333333333333333ULL);
+    x=(x+(x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    count+=(x*0x0101010101010101ULL) >> 56;
+  }
+  for (; start < end; ++start) {
+    count+=(bits[start/8] >> (7-(start & 7))) & 0x1;
+  }
+  return count;
+}
+
+/* unpack_strided_chunk unpacks the kept gridpoints 'start' to 'end'-1 (in the
+**   order that they are packed) of a grid with simple packing that is
+**   unpacked with a stride; only the bits of their packed values are read, and
+**   with a bitmap, the packed value of a gridpoint is found by counting the
+**   bits that are set in the bitmap before it
+*/
+void unpack_strided_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  SimpleChunks *s=(SimpleChunks *)arg;
+  const GRIB2Metadata *md=&s->grid->md;
+  size_t pos=grib2_strided_source(md,s->stride,start),count=0;
+  if (s->bits != NULL) {
+    count=grib2_count_bits(s->bits,0,pos);
+  }
+  for (size_t n=start; n < end; ++n) {
+    size_t point=grib2_strided_source(md,s->stride,n);
+    double *value=&s->grid->gridpoints[grib2_strided_index(md,s->stride,point)];
+    if (s->bits != NULL) {
+	count+=grib2_count_bits(s->bits,pos,point);
+	pos=point;
+	if (((s->bits[point/8] >> (7-(point & 7))) & 0x1) == 0) {
+	  *value=GRIB_MISSING_VALUE;
+	  continue;
+	}
+    }
+    else {
+	count=point;
+    }
+    int pval=0;
+    if (md->pack_width > 0) {
+	get_bits(s->buffer,&pval,md->ds_off+40+count*md->pack_width,md->pack_width);
+    }
+    *value=md->R+pval*s->E/s->D;
+  }
+}
+
+/* unpack_simple_strided unpacks every 'stride'-th gridpoint of every
+**   'stride'-th row of a grid with simple packing into a grid of
+**   grib2_strided_points gridpoints; the kept gridpoints are split into chunks
+**   that are unpacked by 'num_threads' threads
+*/
+int unpack_simple_strided(GRIB2Message *grib2_msg,int grid_num,int stride)
+{
+  GRIB2Grid *grid=&grib2_msg->grids[grid_num];
+  size_t num_points=(size_t)grid->md.ny*grid->md.nx;
+  int status;
+  if ( (status=check_grid_values(grib2_msg,&grid->md,0,NULL)) != 0) {
+    return status;
+  }
+  SimpleChunks s;
+  s.buffer=grib2_msg->buffer;
+  s.grid=grid;
+  s.stride=stride;
+  s.D=pow(10.,grid->md.D);
+  s.E=pow(2.,grid->md.E);
+  s.bits=NULL;
+  size_t num_values=num_points;
+  if (grid->md.bitmap != NULL) {
+    s.bits=&grib2_msg->buffer[grid->md.bms_off/8+6];
+    num_values=grib2_count_bits(s.bits,0,num_points);
+  }
+  if ( (status=check_data_length(grib2_msg,&grid->md,num_values,grid->md.pack_width)) == 0 && (status=reserve_gridpoints(grib2_msg,grid,stride)) == 0) {
+    grib_parallel_for(grib2_strided_points(&grid->md,stride),grib2_msg->num_threads,unpack_strided_chunk,&s);
+  }
+  return status;
+}
+
+/* GRIB2Subset is a box of gridpoints of a grid
+**   i1, i2: the first and last columns (points along a row); i1 > i2 when
+**             the box crosses the edge of a global grid, and the columns are
+**             then i1 to nx-1 followed by 0 to i2
+**   j1, j2: the first and last rows
+**   ni, nj: the number of columns and rows in the box
+**   columns and rows are counted from the first gridpoint of the grid, in the
+**   directions given by its scanning mode
+*/
+typedef struct {
+  int i1,i2,j1,j2;
+  size_t ni,nj;
+} GRIB2Subset;
+
+/* grib2_ij_subset fills 'subset' with the columns i1 to i2 and the rows j1 to
+**   j2 of a grid, after checking that they are inside of it
+*/
+int grib2_ij_subset(GRIB2Message *grib2_msg,int grid_num,int i1,int i2,int j1,int j2,GRIB2Subset *subset)
+{
+  const GRIB2Metadata *md=&grib2_msg->grids[grid_num].md;
+  if (i1 < 0 || i1 >= md->nx || i2 < 0 || i2 >= md->nx || j1 < 0 || j1 > j2 || j2 >= md->ny) {
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"the subset %d-%d,%d-%d is not inside of the %dx%d grid",i1,i2,j1,j2,md->nx,md->ny);
+  }
+  subset->i1=i1;
+  subset->i2=i2;
+  subset->j1=j1;
+  subset->j2=j2;
+  subset->ni= (i1 <= i2) ? i2-i1+1 : md->nx-i1+i2+1;
+  subset->nj=j2-j1+1;
+  return 0;
+}
+
+/* grib2_latlon_subset fills 'subset' with the gridpoints of a
+**   latitude/longitude grid (GDS Template 3.0) that are inside of a box; the
+**   box is from 'west' east to 'east', so it crosses the date line if 'east'
+**   is less than 'west'
+*/
+int grib2_latlon_subset(GRIB2Message *grib2_msg,int grid_num,double south,double north,double west,double east,GRIB2Subset *subset)
+{
+  const GRIB2Metadata *md=&grib2_msg->grids[grid_num].md;
+  if (md->gds_templ_num != 0) {
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"a latitude/longitude box can't be found on a grid with GDS Template 3.%d",md->gds_templ_num);
+  }
+  if (md->nx < 1 || md->ny < 1 || md->xinc.loinc <= 0. || (md->ny > 1 && md->yinc.lainc <= 0.)) {
+    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid definition is not valid");
+  }
+/* rows */
+  double dlat= (md->lats.elat >= md->slat) ? md->yinc.lainc : -md->yinc.lainc;
+  double a= (md->ny > 1) ? (south-md->slat)/dlat : 0.;
+  double b= (md->ny > 1) ? (north-md->slat)/dlat : 0.;
+  double j1=ceil(((a < b) ? a : b)-1.e-6);
+  double j2=floor(((a < b) ? b : a)+1.e-6);
+  if (md->ny == 1 && (md->slat < south-1.e-6 || md->slat > north+1.e-6)) {
+    j1=1.;
+  }
+  if (j1 < 0.) {
+    j1=0.;
+  }
+  if (j2 > md->ny-1) {
+    j2=md->ny-1;
+  }
+/* columns: measure longitudes eastward from 'west' (or westward from 'east'
+**   when the points are scanned in the -i direction) */
+  double dlon=md->xinc.loinc;
+  double width=fmod(east-west,360.);
+  if (width < 0.) {
+    width+=360.;
+  }
+  if (east-west >= 360.) {
+    width=360.;
+  }
+  double x0= ((md->scan_mode & 0x80) == 0) ? md->slon-west : east-md->slon;
+  x0=fmod(x0,360.);
+  if (x0 < 0.) {
+    x0+=360.;
+  }
+/* column i is 'x0'+i*'dlon' degrees from the edge of the box, so the columns
+**   in the box are the ones that are 360 to 360+'width' degrees from it (on a
+**   global grid, these wrap around to the first columns) and, when the grid
+**   starts inside of the box, the ones up to 'width' degrees from it */
+  double i1=ceil((360.-x0)/dlon-1.e-6);
+  double i2=floor((360.-x0+width)/dlon+1.e-6);
+  int empty=(j1 > j2);
+  if (fabs(md->nx*dlon-360.) < dlon/2.) {
+    if (i1 > i2) {
+	empty=1;
+    }
+    else if (i2-i1+1 >= md->nx) {
+	i1=0.;
+	i2=md->nx-1;
+    }
+    else {
+	i1=fmod(i1,md->nx);
+	i2=fmod(i2,md->nx);
+    }
+  }
+  else {
+    if (i2 > md->nx-1) {
+	i2=md->nx-1;
+    }
+    if (x0 <= width+1.e-6) {
+/* the columns up to the end of the box come after the ones that are 360
+**   degrees around from its start, so the box wraps around the grid */
+	double end=floor((width-x0)/dlon+1.e-6);
+	if (end > md->nx-1) {
+	  end=md->nx-1;
+	}
+	if (i1 > i2) {
+	  i1=0.;
+	  i2=end;
+	}
+	else if (end+1 >= i1) {
+	  i1=0.;
+	  i2=md->nx-1;
+	}
+	else {
+	  i2=end;
+	}
+    }
+    else if (i1 > i2) {
+	empty=1;
+    }
+  }
+  if (empty) {
+    return grib2_error(grib2_msg,GRIB_NO_MATCH,"there are no gridpoints in the box %g,%g to %g,%g",south,west,north,east);
+  }
+  return grib2_ij_subset(grib2_msg,grid_num,i1,i2,j1,j2,subset);
+}
+
+/* unpack_simple_run unpacks 'num' gridpoints of a grid with simple packing,
+**   starting at gridpoint 'start', into values[out], values[out+stride], ...;
+**   '*pos' and '*count' are a gridpoint and the number of values that are in
+**   the packed data before it, and they are moved to the end of the run, so
+**   the runs must be unpacked in the order of the gridpoints
+*/
+int unpack_simple_run(GRIB2Message *grib2_msg,const GRIB2Metadata *md,const unsigned char *bits,size_t start,size_t num,size_t *pos,size_t *count,double *values,size_t out,size_t stride)
+{
+  size_t num_values=num;
+  if (bits != NULL) {
+    *count+=grib2_count_bits(bits,*pos,start);
+    num_values=grib2_count_bits(bits,start,start+num);
+  }
+  else {
+    *count=start;
+  }
+  int status;
+  if ( (status=check_data_length(grib2_msg,md,*count+num_values,md->pack_width)) != 0) {
+    return status;
+  }
+  float D=pow(10.,md->D);
+  float E=pow(2.,md->E);
+  size_t off=md->ds_off+40+*count*md->pack_width;
+  for (size_t n=0; n < num; ++n,out+=stride) {
+    if (bits == NULL || ((bits[(start+n)/8] >> (7-((start+n) & 7))) & 0x1) == 1) {
+	int pval=0;
+	if (md->pack_width > 0) {
+	  get_bits(grib2_msg->buffer,&pval,off,md->pack_width);
+	}
+	values[out]=md->R+pval*E/D;
+	off+=md->pack_width;
+    }
+    else {
+	values[out]=GRIB_MISSING_VALUE;
+    }
+  }
+  *pos=start+num;
+  *count+=num_values;
+  return 0;
+}
+
+/* unpack_simple_subset unpacks only the gridpoints in 'subset' of a grid with
+**   simple packing (DRS Template 5.0) into 'values', which must hold
+**   subset->ni*subset->nj values; values[(j-j1)*ni+k] is the gridpoint in row
+**   j and column k of the subset
+**
+**   the packed values of a row are found directly from its position, and with
+**   a bitmap, from the number of bits that are set in the bitmap before the
+**   row, so the time that it takes depends on the size of the subset and not
+**   on the size of the grid; the grid can be left packed by setting
+**   'unpack_simple' to 0 before unpacking the message
+*/
+int unpack_simple_subset(GRIB2Message *grib2_msg,int grid_num,const GRIB2Subset *subset,double *values)
+{
+  const GRIB2Metadata *md=&grib2_msg->grids[grid_num].md;
+  if (md->drs_templ_num != 0) {
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"subsets can't be unpacked from grids with DRS Template 5.%d",md->drs_templ_num);
+  }
+  if ((md->scan_mode & 0x10) != 0) {
+    return grib2_error(grib2_msg,GRIB_UNSUPPORTED,"subsets can't be unpacked from grids whose rows alternate direction");
+  }
+  int status;
+  if ( (status=check_grid_values(grib2_msg,&grib2_msg->grids[grid_num].md,0,NULL)) != 0) {
+    return status;
+  }
+  const unsigned char *bits= (md->bitmap != NULL) ? &grib2_msg->buffer[md->bms_off/8+6] : NULL;
+  size_t nx=md->nx,ny=md->ny;
+  size_t ni=subset->ni,nj=subset->nj;
+  size_t i1=subset->i1,i2=subset->i2,j1=subset->j1,j2=subset->j2;
+  size_t pos=0,count=0;
+  if ((md->scan_mode & 0x20) == 0) {
+/* consecutive points are in the same row; the columns that wrap around the
+**   edge of the grid come first in the packed data */
+    for (size_t j=j1; j <= j2 && status == 0; ++j) {
+	size_t out=(j-j1)*ni;
+	if (i1 > i2) {
+	  if ( (status=unpack_simple_run(grib2_msg,md,bits,j*nx,i2+1,&pos,&count,values,out+nx-i1,1)) == 0) {
+	    status=unpack_simple_run(grib2_msg,md,bits,j*nx+i1,nx-i1,&pos,&count,values,out,1);
 	  }
-	  grib2_msg->grids[grid_num].gcapacity=required_size;
-	  grib2_msg->grids[grid_num].gridpoints=(double *)malloc(grib2_msg->grids[grid_num].gcapacity*sizeof(double));
 	}
-	for (size_t n=0; n < grib2_msg->md.ny*grib2_msg->md.nx; ++n) {
-	  if (grib2_msg->md.bitmap == NULL || grib2_msg->md.bitmap[n] == 1) {
-	    int pval;
-	    get_bits(grib2_msg->buffer,&pval,off,grib2_msg->md.pack_width);
-	    grib2_msg->grids[grid_num].gridpoints[n]=grib2_msg->md.R+pval*E/D;
-	    off+=grib2_msg->md.pack_width;
+	else {
+	  status=unpack_simple_run(grib2_msg,md,bits,j*nx+i1,ni,&pos,&count,values,out,1);
+	}
+    }
+  }
+  else {
+/* consecutive points are in the same column */
+    for (size_t k=0; k < ni && status == 0; ++k) {
+	size_t i=i1+k;
+	if (i1 > i2) {
+	  i= (k <= i2) ? k : i1+k-i2-1;
+	}
+	status=unpack_simple_run(grib2_msg,md,bits,i*ny+j1,nj,&pos,&count,values,(i+nx-i1) % nx,ni);
+    }
+  }
+  return status;
+}
+
+/* ComplexChunks holds what the threads that unpack the chunks of a grid with
+**   complex packing and spatial differencing (DRS Template 5.3) need
+*/
+typedef struct {
+  unsigned char *buffer;
+  const GRIB2Metadata *md;
+  double *gridpoints;
+  size_t num_points;
+  int num_threads;
+  size_t num_groups;
+  int *ref_vals,*widths,*lengths,omin;
+  long long miss_val;
+  size_t *group_starts,*group_offsets,total_length;
+  size_t first_diff;
+  double *sums,*carries;
+  int last_pass;
+  float E,D;
+} ComplexChunks;
+
+/* unpack_groups_chunk unpacks the groups that start at gridpoints 'start' to
+**   'end'-1, and sets the gridpoints in that range that don't belong to a
+**   group to missing
+*/
+void unpack_groups_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  ComplexChunks *c=(ComplexChunks *)arg;
+// find the first group that starts in the chunk
+  size_t first=0,last=c->num_groups;
+  while (first < last) {
+    size_t middle=first+(last-first)/2;
+    if (c->group_starts[middle] < start) {
+	first=middle+1;
+    }
+    else {
+	last=middle;
+    }
+  }
+  for (size_t n=first; n < c->num_groups && c->group_starts[n] < end; ++n) {
+    size_t gridpoint_index=c->group_starts[n];
+    if (c->widths[n] > 0) {
+	long long group_miss_val;
+	if (c->md->complex_pack.miss_val_mgmt > 0) {
+	  group_miss_val=pow(2.,c->widths[n])-1;
+	}
+	else {
+	  group_miss_val=LLONG_MAX;
+	}
+	size_t off=c->group_offsets[n];
+	for (int m=0; m < c->lengths[n]; ++m) {
+	  int pval;
+	  get_bits(c->buffer,&pval,off,c->widths[n]);
+	  off+=c->widths[n];
+	  if ((c->md->bitmap != NULL && c->md->bitmap[gridpoint_index] == 0) || pval == group_miss_val) {
+	    c->gridpoints[gridpoint_index]=GRIB_MISSING_VALUE;
 	  }
 	  else {
-	    grib2_msg->grids[grid_num].gridpoints[n]=GRIB_MISSING_VALUE;
+	    c->gridpoints[gridpoint_index]=pval+c->ref_vals[n]+c->omin;
+	  }
+	  ++gridpoint_index;
+	}
+    }
+    else {
+// constant group
+	for (int m=0; m < c->lengths[n]; ++m) {
+	  if ((c->md->bitmap != NULL && c->md->bitmap[gridpoint_index] == 0) || c->ref_vals[n] == c->miss_val) {
+	    c->gridpoints[gridpoint_index]=GRIB_MISSING_VALUE;
+	  }
+	  else {
+	    c->gridpoints[gridpoint_index]=c->ref_vals[n]+c->omin;
+	  }
+	  ++gridpoint_index;
+	}
+    }
+  }
+  for (size_t n= (start > c->total_length) ? start : c->total_length; n < end; ++n) {
+    c->gridpoints[n]=GRIB_MISSING_VALUE;
+  }
+}
+
+/* sum_differences_chunk sets the sum of a chunk to the sum of its differences;
+**   the differences are whole numbers, so the sums are exact and don't depend
+**   on how the grid is split
+*/
+void sum_differences_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  ComplexChunks *c=(ComplexChunks *)arg;
+  double sum=0.;
+  for (size_t n= (start > c->first_diff) ? start : c->first_diff; n < end; ++n) {
+    if (c->gridpoints[n] != GRIB_MISSING_VALUE) {
+	sum+=c->gridpoints[n];
+    }
+  }
+  c->sums[chunk]=sum;
+}
+
+/* scan_differences_chunk replaces each difference in a chunk with the running
+**   sum of the differences, starting from the carry of the chunk, and sets the
+**   sum of the chunk to the sum of the new values for the next pass; on the
+**   last pass, the running sums are the packed values, which are scaled
+*/
+void scan_differences_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  ComplexChunks *c=(ComplexChunks *)arg;
+  double sum=c->carries[chunk],next_sum=0.;
+  for (size_t n= (start > c->first_diff) ? start : c->first_diff; n < end; ++n) {
+    if (c->gridpoints[n] != GRIB_MISSING_VALUE) {
+	sum+=c->gridpoints[n];
+	if (c->last_pass) {
+	  c->gridpoints[n]=c->md->R+sum*c->E/c->D;
+	}
+	else {
+	  c->gridpoints[n]=sum;
+	  next_sum+=sum;
+	}
+    }
+  }
+  c->sums[chunk]=next_sum;
+}
+
+/* scan_differences adds up the differences of a grid, starting from 'first':
+**   the carry of each chunk is 'first' plus the sums of the chunks before it,
+**   and then the chunks are scanned in parallel
+*/
+void scan_differences(ComplexChunks *c,double first,int last_pass)
+{
+  size_t num_chunks=grib_num_chunks(c->num_points,c->num_threads);
+  for (size_t n=0; n < num_chunks; ++n) {
+    c->carries[n]=first;
+    first+=c->sums[n];
+  }
+  c->last_pass=last_pass;
+  grib_parallel_for(c->num_points,c->num_threads,scan_differences_chunk,c);
+}
+
+/* unpack_complex_strided unpacks the groups of a grid with complex packing and
+**   spatial differencing one after another, undoing the differencing of each
+**   gridpoint as it is unpacked, and keeps only the gridpoints that are kept
+**   with 'stride'; the running sums of the passes of scan_differences are
+**   carried from one gridpoint to the next, so no array of the full grid is
+**   needed
+*/
+int unpack_complex_strided(ComplexChunks *c,const int *first_vals,int stride)
+{
+  const GRIB2Metadata *md=c->md;
+  int order=md->complex_pack.spatial_diff.order;
+  int num_passes= (order > 1) ? order : 1;
+  double *sums=(double *)malloc(num_passes*sizeof(double));
+  if (sums == NULL) {
+    return 1;
+  }
+  for (int n=0; n < order-1; ++n) {
+    sums[n]=(double)first_vals[order-1-n]-first_vals[order-2-n];
+  }
+  sums[num_passes-1]= (order > 0) ? first_vals[order-1] : 0.;
+  size_t gridpoint_index=0;
+  int num_not_missing=0;
+  for (size_t n=0; n < c->num_groups; ++n) {
+    long long group_miss_val=c->miss_val;
+    if (c->widths[n] > 0) {
+	group_miss_val= (md->complex_pack.miss_val_mgmt > 0) ? pow(2.,c->widths[n])-1 : LLONG_MAX;
+    }
+    size_t off=c->group_offsets[n];
+    for (int m=0; m < c->lengths[n]; ++m,++gridpoint_index) {
+	int pval=c->ref_vals[n];
+	if (c->widths[n] > 0) {
+	  get_bits(c->buffer,&pval,off,c->widths[n]);
+	  off+=c->widths[n];
+	}
+	size_t index=grib2_strided_index(md,stride,gridpoint_index);
+	if ((md->bitmap != NULL && md->bitmap[gridpoint_index] == 0) || pval == group_miss_val) {
+	  if (index != GRIB2_NOT_KEPT) {
+	    c->gridpoints[index]=GRIB_MISSING_VALUE;
+	  }
+	  continue;
+	}
+	double value;
+	if (num_not_missing < order) {
+	  value=md->R+first_vals[num_not_missing]*c->E/c->D;
+	  ++num_not_missing;
+	}
+	else {
+	  double sum= (c->widths[n] > 0) ? pval+c->ref_vals[n]+c->omin : c->ref_vals[n]+c->omin;
+	  for (int l=0; l < num_passes; ++l) {
+	    sums[l]+=sum;
+	    sum=sums[l];
 	  }
+	  value=md->R+sum*c->E/c->D;
+	}
+	if (index != GRIB2_NOT_KEPT) {
+	  c->gridpoints[index]=value;
+	}
+    }
+  }
+  for (; gridpoint_index < c->num_points; ++gridpoint_index) {
+    size_t index=grib2_strided_index(md,stride,gridpoint_index);
+    if (index != GRIB2_NOT_KEPT) {
+	c->gridpoints[index]=GRIB_MISSING_VALUE;
+    }
+  }
+  free(sums);
+  return 0;
+}
+
+int unpack_DS(GRIB2Message *grib2_msg,int grid_num)
+{
+  float D=pow(10.,grib2_msg->md.D),E=pow(2.,grib2_msg->md.E);
+  size_t off=grib2_msg->offset+40;
+  int stride= (grib2_msg->stride > 1) ? grib2_msg->stride : 1;
+  int status;
+  switch (grib2_msg->md.drs_templ_num) {
+    case 0:
+    {
+	if (grib2_msg->unpack_simple == 0) {
+/* the grid is left packed */
+	  return 0;
+	}
+	if (stride == 1) {
+	  return unpack_simple_packing(grib2_msg,grid_num);
+	}
+	if ( (status=unpack_simple_strided(grib2_msg,grid_num,stride)) != 0) {
+	  return status;
 	}
 	break;
     }
@@ -1177,20 +2415,27 @@ void unpack_DS(GRIB2Message *grib2_msg,int grid_num)
 	  long long miss_val,group_miss_val;
 	  int max_length;
 	} groups;
-	size_t required_size=grib2_msg->md.ny*grib2_msg->md.nx;
-	if (required_size > grib2_msg->grids[grid_num].gcapacity) {
-	  if (grib2_msg->grids[grid_num].gridpoints != NULL) {
-	    free(grib2_msg->grids[grid_num].gridpoints);
-	  }
-	  grib2_msg->grids[grid_num].gcapacity=required_size;
-	  grib2_msg->grids[grid_num].gridpoints=(double *)malloc(grib2_msg->grids[grid_num].gcapacity*sizeof(double));
+	if ( (status=check_grid_values(grib2_msg,&grib2_msg->md,0,NULL)) != 0) {
+	  return status;
+	}
+	int len;
+	get_bits(grib2_msg->buffer,&len,grib2_msg->offset,32);
+	size_t end_off=grib2_msg->offset+(size_t)len*8;
+	size_t required_size=(size_t)grib2_msg->md.ny*grib2_msg->md.nx;
+	if ( (status=reserve_gridpoints(grib2_msg,&grib2_msg->grids[grid_num],stride)) != 0) {
+	  return status;
 	}
 	if (grib2_msg->md.complex_pack.num_groups > 0) {
+	  size_t group_bits=(size_t)grib2_msg->md.complex_pack.num_groups*(grib2_msg->md.pack_width+grib2_msg->md.complex_pack.width.pack_width+grib2_msg->md.complex_pack.length.pack_width);
+	  if (off+(grib2_msg->md.complex_pack.spatial_diff.order+1)*grib2_msg->md.complex_pack.spatial_diff.order_vals_width*8+group_bits > end_off) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the Data Section is too short to hold %d groups",grib2_msg->md.complex_pack.num_groups);
+	  }
 	  if (grib2_msg->md.complex_pack.miss_val_mgmt > 0) {
 	    groups.miss_val=pow(2.,grib2_msg->md.pack_width)-1;
 	  }
 	  else {
-	    groups.miss_val=GRIB_MISSING_VALUE;
+/* there are no missing values, so use a value that no packed value can have */
+	    groups.miss_val=LLONG_MAX;
 	  }
 	  groups.first_vals=(int *)malloc(grib2_msg->md.complex_pack.spatial_diff.order*sizeof(int));
 	  for (int n=0; n < grib2_msg->md.complex_pack.spatial_diff.order; ++n) {
@@ -1240,74 +2485,89 @@ void unpack_DS(GRIB2Message *grib2_msg,int grid_num)
 	  if (groups.lengths[end] > groups.max_length) {
 	    groups.max_length=groups.lengths[end];
 	  }
-// unpack the field of differences
-	  size_t gridpoint_index=0;
-	  for (int n=0; n < grib2_msg->md.complex_pack.num_groups; ++n) {
-	    if (groups.widths[n] > 0) {
-		if (grib2_msg->md.complex_pack.miss_val_mgmt > 0) {
-		  groups.group_miss_val=pow(2.,groups.widths[n])-1;
-		}
-		else {
-		  groups.group_miss_val=GRIB_MISSING_VALUE;
-		}
-		for (size_t m=0; m < groups.lengths[n]; ++m) {
-		  int pval;
-		  get_bits(grib2_msg->buffer,&pval,off,groups.widths[n]);
-		  off+=groups.widths[n];
-		  if ((grib2_msg->md.bitmap != NULL && grib2_msg->md.bitmap[gridpoint_index] == 0) || pval == groups.group_miss_val) {
-		    grib2_msg->grids[grid_num].gridpoints[gridpoint_index]=GRIB_MISSING_VALUE;
-		  }
-		  else {
-		    grib2_msg->grids[grid_num].gridpoints[gridpoint_index]=pval+groups.ref_vals[n]+groups.omin;
-		  }
-		  ++gridpoint_index;
-		}
+// make sure that the groups fit in the grid and in the Data Section, and find
+// the first gridpoint and the offset of the packed values of each group
+	  ComplexChunks c;
+	  c.num_groups=grib2_msg->md.complex_pack.num_groups;
+	  c.group_starts=(size_t *)malloc(c.num_groups*sizeof(size_t));
+	  c.group_offsets=(size_t *)malloc(c.num_groups*sizeof(size_t));
+	  size_t num_points=required_size,total_length=0,total_bits=0;
+	  if (c.group_starts == NULL || c.group_offsets == NULL) {
+	    total_length=num_points+1;
+	  }
+	  for (int n=0; n < grib2_msg->md.complex_pack.num_groups && total_length <= num_points; ++n) {
+	    if (groups.lengths[n] < 0 || groups.widths[n] > 32) {
+		total_length=num_points+1;
 	    }
 	    else {
-// constant group
-		for (int m=0; m < groups.lengths[n]; ++m) {
-		  if ((grib2_msg->md.bitmap != NULL && grib2_msg->md.bitmap[gridpoint_index] == 0) || groups.ref_vals[n] == groups.miss_val) {
-		    grib2_msg->grids[grid_num].gridpoints[gridpoint_index]=GRIB_MISSING_VALUE;
-		  }
-		  else {
-		    grib2_msg->grids[grid_num].gridpoints[gridpoint_index]=groups.ref_vals[n]+groups.omin;
-		  }
-		  ++gridpoint_index;
-		}
+		c.group_starts[n]=total_length;
+		c.group_offsets[n]=off+total_bits;
+		total_length+=groups.lengths[n];
+		total_bits+=(size_t)groups.lengths[n]*groups.widths[n];
 	    }
 	  }
-	  for (; gridpoint_index < grib2_msg->md.nx*grib2_msg->md.ny; ++gridpoint_index) {
-	    grib2_msg->grids[grid_num].gridpoints[gridpoint_index]=GRIB_MISSING_VALUE;
+	  size_t num_chunks=grib_num_chunks(num_points,grib2_msg->num_threads);
+	  double sum,carry;
+	  c.sums= (num_chunks > 1) ? (double *)malloc(num_chunks*sizeof(double)) : &sum;
+	  c.carries= (num_chunks > 1) ? (double *)malloc(num_chunks*sizeof(double)) : &carry;
+	  if (total_length > num_points || off+total_bits > end_off || c.sums == NULL || c.carries == NULL) {
+	    free(groups.first_vals);
+	    free(groups.ref_vals);
+	    free(groups.widths);
+	    free(groups.lengths);
+	    free(c.group_starts);
+	    free(c.group_offsets);
+	    if (num_chunks > 1) {
+		free(c.sums);
+		free(c.carries);
+	    }
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the groups of packed values don't fit in the grid or in the Data Section");
 	  }
-	  float lastgp;
-	  for (int n=grib2_msg->md.complex_pack.spatial_diff.order-1; n > 0; --n) {
-	    lastgp=groups.first_vals[n]-groups.first_vals[n-1];
-	    int num_not_missing=0;
-	    for (size_t l=0; l < grib2_msg->md.nx*grib2_msg->md.ny; ++l) {
-		if (grib2_msg->grids[grid_num].gridpoints[l] != GRIB_MISSING_VALUE) {
-		  if (num_not_missing >= grib2_msg->md.complex_pack.spatial_diff.order) {
-		    grib2_msg->grids[grid_num].gridpoints[l]+=lastgp;
-		    lastgp=grib2_msg->grids[grid_num].gridpoints[l];
-		  }
+// unpack the field of differences; the groups are independent, so the groups
+// that start in each chunk of the grid are unpacked by a separate thread
+	  c.buffer=grib2_msg->buffer;
+	  c.md=&grib2_msg->md;
+	  c.gridpoints=grib2_msg->grids[grid_num].gridpoints;
+	  c.num_points=num_points;
+	  c.num_threads=grib2_msg->num_threads;
+	  c.ref_vals=groups.ref_vals;
+	  c.widths=groups.widths;
+	  c.lengths=groups.lengths;
+	  c.omin=groups.omin;
+	  c.miss_val=groups.miss_val;
+	  c.total_length=total_length;
+	  c.E=E;
+	  c.D=D;
+	  if (stride > 1) {
+// a strided grid is unpacked sequentially, without the full grid
+	    status=unpack_complex_strided(&c,groups.first_vals,stride);
+	  }
+	  else {
+	    grib_parallel_for(num_points,c.num_threads,unpack_groups_chunk,&c);
+// the first values that aren't missing are the original values; the others are
+// restored by adding up the differences, once for each order of differencing
+	    size_t num_not_missing=0,l;
+	    for (l=0; l < num_points && num_not_missing < grib2_msg->md.complex_pack.spatial_diff.order; ++l) {
+		if (c.gridpoints[l] != GRIB_MISSING_VALUE) {
+		  c.gridpoints[l]=grib2_msg->md.R+groups.first_vals[num_not_missing]*E/D;
 		  ++num_not_missing;
 		}
 	    }
-	  }
-	  lastgp=0.;
-	  size_t num_not_missing=0;
-	  for (size_t l=0; l < grib2_msg->md.nx*grib2_msg->md.ny; ++l) {
-	    if (grib2_msg->grids[grid_num].gridpoints[l] != GRIB_MISSING_VALUE) {
-		if (num_not_missing < grib2_msg->md.complex_pack.spatial_diff.order) {
-		  grib2_msg->grids[grid_num].gridpoints[l]=grib2_msg->md.R+groups.first_vals[num_not_missing]*E/D;
-		  lastgp=grib2_msg->md.R*D/E+groups.first_vals[num_not_missing];
+	    if (num_not_missing == grib2_msg->md.complex_pack.spatial_diff.order) {
+		c.first_diff=l;
+		grib_parallel_for(num_points,c.num_threads,sum_differences_chunk,&c);
+		for (int n=grib2_msg->md.complex_pack.spatial_diff.order-1; n > 0; --n) {
+		  scan_differences(&c,(double)groups.first_vals[n]-groups.first_vals[n-1],0);
 		}
-		else {
-		  lastgp+=grib2_msg->grids[grid_num].gridpoints[l];
-		  grib2_msg->grids[grid_num].gridpoints[l]=lastgp*E/D;
-		}
-		++num_not_missing;
+		scan_differences(&c,(num_not_missing > 0) ? groups.first_vals[num_not_missing-1] : 0.,1);
 	    }
 	  }
+	  free(c.group_starts);
+	  free(c.group_offsets);
+	  if (num_chunks > 1) {
+	    free(c.sums);
+	    free(c.carries);
+	  }
 	  if (grib2_msg->md.complex_pack.spatial_diff.order > 0) {
 	    free(groups.first_vals);
 	  }
@@ -1316,9 +2576,13 @@ void unpack_DS(GRIB2Message *grib2_msg,int grid_num)
 	    free(groups.widths);
 	    free(groups.lengths);
 	  }
+	  if (status != 0) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate the sums of %d orders of differencing",grib2_msg->md.complex_pack.spatial_diff.order);
+	  }
 	}
 	else {
-	  for (int n=0; n < grib2_msg->md.ny*grib2_msg->md.nx; ++n) {
+	  size_t num_points=grib2_strided_points(&grib2_msg->md,stride);
+	  for (size_t n=0; n < num_points; ++n) {
 	    grib2_msg->grids[grid_num].gridpoints[n]=GRIB_MISSING_VALUE;
 	  }
 	}
@@ -1331,64 +2595,199 @@ void unpack_DS(GRIB2Message *grib2_msg,int grid_num)
 	int len;
 	get_bits(grib2_msg->buffer,&len,grib2_msg->offset,32);
 	len=len-5;
-	int *jvals=(int *)malloc(grib2_msg->md.ny*grib2_msg->md.nx*sizeof(int));
-	size_t required_size=grib2_msg->md.ny*grib2_msg->md.nx;
-	if (required_size > grib2_msg->grids[grid_num].gcapacity) {
-	  if (grib2_msg->grids[grid_num].gridpoints != NULL) {
-	    free(grib2_msg->grids[grid_num].gridpoints);
-	  }
-	  grib2_msg->grids[grid_num].gcapacity=required_size;
-	  grib2_msg->grids[grid_num].gridpoints=(double *)malloc(grib2_msg->grids[grid_num].gcapacity*sizeof(double));
+	size_t required_size=(size_t)grib2_msg->md.ny*grib2_msg->md.nx;
+	if ( (status=reserve_gridpoints(grib2_msg,&grib2_msg->grids[grid_num],stride)) != 0) {
+	  return status;
+	}
+	if ( (status=check_grid_values(grib2_msg,&grib2_msg->md,0,NULL)) != 0) {
+	  return status;
 	}
-	if (len > 0) {
-	  dec_jpeg2000((char *)&grib2_msg->buffer[grib2_msg->offset/8+5],len,jvals);
+	int *jvals=(int *)malloc(required_size*sizeof(int));
+	if (len > 0 && dec_jpeg2000((char *)&grib2_msg->buffer[grib2_msg->offset/8+5],len,jvals) != 0) {
+	  free(jvals);
+	  return grib2_error(grib2_msg,GRIB_DECODE_ERROR,"error decoding JPEG 2000 data");
 	}
 	size_t cnt=0;
 	for (size_t n=0; n < grib2_msg->md.ny*grib2_msg->md.nx; ++n) {
+	  size_t index= (stride > 1) ? grib2_strided_index(&grib2_msg->md,stride,n) : n;
 	  if (grib2_msg->md.bitmap == NULL || grib2_msg->md.bitmap[n] == 1) {
 	    if (len == 0) {
 		jvals[cnt]=0;
 	    }
-	    grib2_msg->grids[grid_num].gridpoints[n]=grib2_msg->md.R+jvals[cnt++]*E/D;
+	    if (index != GRIB2_NOT_KEPT) {
+		grib2_msg->grids[grid_num].gridpoints[index]=grib2_msg->md.R+jvals[cnt]*E/D;
+	    }
+	    ++cnt;
 	  }
-	  else {
-	    grib2_msg->grids[grid_num].gridpoints[n]=GRIB_MISSING_VALUE;
+	  else if (index != GRIB2_NOT_KEPT) {
+	    grib2_msg->grids[grid_num].gridpoints[index]=GRIB_MISSING_VALUE;
 	  }
 	}
 	free(jvals);
 	break;
     }
 #endif
+#ifdef AEC
+    case 42:
+    {
+	int len;
+	get_bits(grib2_msg->buffer,&len,grib2_msg->offset,32);
+	len=len-5;
+	size_t required_size=(size_t)grib2_msg->md.ny*grib2_msg->md.nx;
+	if ( (status=reserve_gridpoints(grib2_msg,&grib2_msg->grids[grid_num],stride)) != 0) {
+	  return status;
+	}
+/* samples are decoded into 1, 2, 3 or 4 octets each; 17- to 24-bit samples
+   only use 3 octets if the AEC_DATA_3BYTE option is set */
+	size_t nbytes=(grib2_msg->md.pack_width+7)/8;
+	if (nbytes == 3 && (grib2_msg->md.ccsds.flags & AEC_DATA_3BYTE) == 0) {
+	  nbytes=4;
+	}
+/* the octets of each sample are in big-endian order if the AEC_DATA_MSB
+   option is set, otherwise in little-endian order */
+	int msb=(grib2_msg->md.ccsds.flags & AEC_DATA_MSB) != 0;
+	size_t num_values;
+	if ( (status=check_grid_values(grib2_msg,&grib2_msg->md,0,&num_values)) != 0) {
+	  return status;
+	}
+	if (grib2_msg->md.num_packed < 0 || num_values > (size_t)grib2_msg->md.num_packed || (size_t)grib2_msg->md.num_packed > required_size) {
+	  return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"the grid has %zu values, but only %d are packed",num_values,grib2_msg->md.num_packed);
+	}
+	unsigned char *samples=NULL;
+	if (len > 0 && grib2_msg->md.pack_width > 0) {
+	  samples=(unsigned char *)malloc(grib2_msg->md.num_packed*nbytes);
+	  if (samples == NULL) {
+	    return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"unable to allocate %d CCSDS samples",grib2_msg->md.num_packed);
+	  }
+	  struct aec_stream strm;
+	  strm.next_in=&grib2_msg->buffer[grib2_msg->offset/8+5];
+	  strm.avail_in=len;
+	  strm.next_out=samples;
+	  strm.avail_out=grib2_msg->md.num_packed*nbytes;
+	  strm.bits_per_sample=grib2_msg->md.pack_width;
+	  strm.block_size=grib2_msg->md.ccsds.block_size;
+	  strm.rsi=grib2_msg->md.ccsds.rsi;
+	  strm.flags=grib2_msg->md.ccsds.flags;
+	  if (aec_buffer_decode(&strm) != AEC_OK) {
+	    free(samples);
+	    return grib2_error(grib2_msg,GRIB_DECODE_ERROR,"error decoding CCSDS data");
+	  }
+	}
+	size_t cnt=0;
+	for (size_t n=0; n < grib2_msg->md.ny*grib2_msg->md.nx; ++n) {
+	  size_t index= (stride > 1) ? grib2_strided_index(&grib2_msg->md,stride,n) : n;
+	  if (grib2_msg->md.bitmap == NULL || grib2_msg->md.bitmap[n] == 1) {
+	    unsigned int pval=0;
+	    if (samples != NULL && index != GRIB2_NOT_KEPT) {
+		unsigned char *s=&samples[cnt*nbytes];
+		if (msb) {
+		  for (size_t m=0; m < nbytes; ++m) {
+		    pval=(pval << 8) | s[m];
+		  }
+		}
+		else {
+		  for (size_t m=nbytes; m > 0; --m) {
+		    pval=(pval << 8) | s[m-1];
+		  }
+		}
+	    }
+	    if (index != GRIB2_NOT_KEPT) {
+		grib2_msg->grids[grid_num].gridpoints[index]=grib2_msg->md.R+pval*E/D;
+	    }
+	    ++cnt;
+	  }
+	  else if (index != GRIB2_NOT_KEPT) {
+	    grib2_msg->grids[grid_num].gridpoints[index]=GRIB_MISSING_VALUE;
+	  }
+	}
+	if (samples != NULL) {
+	  free(samples);
+	}
+	break;
+    }
+#endif
+    default:
+    {
+/* the grid can't be unpacked, so its grid definition is left alone */
+	return 0;
+    }
+  }
+  if (stride > 1) {
+    grib2_stride_grid(&grib2_msg->grids[grid_num].md,stride);
   }
+  return 0;
 }
 
-int unpackgrib2(FILE *fp,GRIB2Message *grib2_msg)
+/* GridStatus holds the result of unpacking some of the grids of a message
+*/
+typedef struct {
+  int status;
+  char error[256];
+} GridStatus;
+
+/* GridTasks holds what the threads that unpack the grids of a message need
+*/
+typedef struct {
+  GRIB2Message *grib2_msg;
+  int threads_per_grid;
+  GridStatus *statuses;
+} GridTasks;
+
+/* unpack_grids_chunk unpacks the grids 'start' to 'end'-1 of a message; each
+**   grid is unpacked with a copy of the message that holds the metadata of the
+**   grid, so that the chunks don't share anything that they change except for
+**   their own grids
+*/
+void unpack_grids_chunk(void *arg,size_t chunk,size_t start,size_t end)
+{
+  GridTasks *tasks=(GridTasks *)arg;
+  GRIB2Message grib2_msg=*tasks->grib2_msg;
+  grib2_msg.num_threads=tasks->threads_per_grid;
+  GridStatus *s=&tasks->statuses[chunk];
+  s->status=0;
+  for (size_t n=start; n < end && s->status == 0; ++n) {
+    grib2_msg.md=grib2_msg.grids[n].md;
+    grib2_msg.offset=grib2_msg.md.ds_off;
+    if ( (s->status=unpack_DS(&grib2_msg,n)) != 0) {
+	strcpy(s->error,grib2_msg.error);
+    }
+  }
+}
+
+/* unpack_sections unpacks the sections of a GRIB2 message that has already been
+**   read by unpack_IS; reading and unpacking are separate so that messages can
+**   be read by one thread and unpacked by others
+*/
+int unpack_sections(GRIB2Message *grib2_msg)
 {
   int status;
-  if ( (status=unpack_IS(fp,grib2_msg)) != 0) {
+  grib2_msg->md.bitmap=NULL;
+  grib2_msg->md.bitmap_len=0;
+  grib2_msg->num_bitmaps=0;
+  if ( (status=unpack_IDS(grib2_msg)) != 0) {
     return status;
   }
-  unpack_IDS(grib2_msg);
-/* find out how many grids are in this message */
+/* find out how many grids are in this message, and make sure that all of the
+**   sections are inside of it */
   size_t off=grib2_msg->offset;
-  while (strncmp(&((char *)grib2_msg->buffer)[off/8],"7777",4) != 0) {
+  size_t end_off=(size_t)grib2_msg->total_len*8;
+  while (off+32 > end_off || strncmp(&((char *)grib2_msg->buffer)[off/8],"7777",4) != 0) {
     int len;
-    get_bits(grib2_msg->buffer,&len,off,32);
+    if (off+40 > end_off || get_bits(grib2_msg->buffer,&len,off,32) != 0 || len < 5 || off+(size_t)len*8 > end_off) {
+	grib2_msg->num_grids=0;
+	return grib2_error(grib2_msg,GRIB_BAD_MESSAGE,"a section runs past the end of the message");
+    }
     int sec_num;
     get_bits(grib2_msg->buffer,&sec_num,off+32,8);
     if (sec_num == 7) {
 	++grib2_msg->num_grids;
     }
-    off+=len*8;
+    off+=(size_t)len*8;
   }
 /* allocate space for the grids */
   if (grib2_msg->num_grids > grib2_msg->grid_capacity) {
     if (grib2_msg->grids != NULL) {
 	for (size_t n=0; n < grib2_msg->grid_capacity; ++n) {
-	  if (grib2_msg->grids[n].md.bitmap != NULL) {
-	    free(grib2_msg->grids[n].md.bitmap);
-	    grib2_msg->grids[n].md.bitmap=NULL;
-	  }
 	  free(grib2_msg->grids[n].gridpoints);
 	}
 	free(grib2_msg->grids);
@@ -1401,8 +2800,13 @@ int unpackgrib2(FILE *fp,GRIB2Message *grib2_msg)
 	grib2_msg->grids[n].gcapacity=0;
     }
   }
-/* now decode the message */
+/* now decode the message; the Data Representation, Bit Map and Data Sections
+**   of a grid that doesn't pass the filter are skipped, and its bitmap is only
+**   expanded if a later grid reuses it (bms_pending is the offset of a bitmap
+**   that hasn't been expanded yet) */
   int grid_num=0;
+  int skip=0;
+  size_t bms_pending=0;
   while (strncmp(&((char *)grib2_msg->buffer)[grib2_msg->offset/8],"7777",4) != 0) {
     int len;
     get_bits(grib2_msg->buffer,&len,grib2_msg->offset,32);
@@ -1411,38 +2815,120 @@ int unpackgrib2(FILE *fp,GRIB2Message *grib2_msg)
     switch (sec_num) {
 	case 2:
 	{
-	  unpack_LUS(grib2_msg);
+	  status=unpack_LUS(grib2_msg);
 	  break;
 	}
 	case 3:
 	{
-	  unpack_GDS(grib2_msg);
+	  status=unpack_GDS(grib2_msg);
 	  break;
 	}
 	case 4:
 	{
-	  unpack_PDS(grib2_msg);
+	  if ( (status=unpack_PDS(grib2_msg)) == 0) {
+	    skip=!grib2_grid_matches(grib2_msg,&grib2_msg->md);
+	  }
 	  break;
 	}
 	case 5:
 	{
-	  unpack_DRS(grib2_msg);
+	  status= (skip) ? 0 : unpack_DRS(grib2_msg);
 	  break;
 	}
 	case 6:
 	{
-	  unpack_BMS(grib2_msg);
+	  int ind;
+	  get_bits(grib2_msg->buffer,&ind,grib2_msg->offset+40,8);
+	  status=0;
+	  if (skip) {
+	    if (ind == 0) {
+		bms_pending=grib2_msg->offset;
+	    }
+	    else if (ind != 254) {
+		bms_pending=0;
+		grib2_msg->md.bitmap=NULL;
+		grib2_msg->md.bitmap_len=0;
+	    }
+	    break;
+	  }
+	  if (ind == 254 && bms_pending > 0) {
+	    int offset=grib2_msg->offset;
+	    grib2_msg->offset=bms_pending;
+	    status=unpack_BMS(grib2_msg);
+	    grib2_msg->offset=offset;
+	  }
+	  bms_pending=0;
+	  if (status == 0) {
+	    status=unpack_BMS(grib2_msg);
+	  }
 	  break;
 	}
 	case 7:
 	{
+	  status=0;
+	  if (skip) {
+	    break;
+	  }
+/* the metadata of the grid is all that is needed to unpack it, so the Data
+   Sections are unpacked after all of the other sections */
+	  grib2_msg->md.ds_off=grib2_msg->offset;
 	  grib2_msg->grids[grid_num].md=grib2_msg->md;
-	  unpack_DS(grib2_msg,grid_num);
 	  ++grid_num;
 	  break;
 	}
     }
+    if (status != 0) {
+/* none of the grids can be used if the message can't be unpacked */
+	grib2_msg->num_grids=0;
+	return status;
+    }
     grib2_msg->offset+=len*8;
   }
-  return 0;
+  if (grid_num == 0 && grib2_msg->num_grids > 0) {
+    grib2_msg->num_grids=0;
+    return grib2_error(grib2_msg,GRIB_NO_MATCH,"none of the grids match the filter");
+  }
+  grib2_msg->num_grids=grid_num;
+/* unpack the grids, several at a time if there are threads for them; each
+**   grid gets an equal share of the threads for its own chunks */
+  GridTasks tasks;
+  tasks.grib2_msg=grib2_msg;
+  size_t num_tasks=1;
+  if (grib2_msg->concurrent_grids == 1 && grib2_msg->num_threads > 1) {
+    num_tasks= ((size_t)grib2_msg->num_grids < (size_t)grib2_msg->num_threads) ? grib2_msg->num_grids : grib2_msg->num_threads;
+  }
+  if (num_tasks == 0) {
+    return 0;
+  }
+  tasks.threads_per_grid=grib2_msg->num_threads/num_tasks;
+  GridStatus task_status;
+  tasks.statuses= (num_tasks > 1) ? (GridStatus *)malloc(num_tasks*sizeof(GridStatus)) : &task_status;
+  if (tasks.statuses == NULL) {
+    num_tasks=1;
+    tasks.threads_per_grid=grib2_msg->num_threads;
+    tasks.statuses=&task_status;
+  }
+  grib_run_chunks(grib2_msg->num_grids,num_tasks,unpack_grids_chunk,&tasks);
+  status=0;
+  for (size_t n=0; n < num_tasks && status == 0; ++n) {
+    if ( (status=tasks.statuses[n].status) != 0) {
+	strcpy(grib2_msg->error,tasks.statuses[n].error);
+	grib2_msg->num_grids=0;
+    }
+  }
+  if (tasks.statuses != &task_status) {
+    free(tasks.statuses);
+  }
+  return status;
 }
+
+int unpackgrib2(FILE *fp,GRIB2Message *grib2_msg)
+{
+  int status;
+  if ( (status=unpack_IS(fp,grib2_msg)) != 0) {
+    return status;
+  }
+  return unpack_sections(grib2_msg);
+}
+
+#endif